@@ -0,0 +1,264 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+/*
+    Real in-memory B+Tree with PCM access accounting
+
+    Tree holds real keys and values in node arena. Every touch of node is charged
+    to PCM model by memory lines, node i is placed at simulated address i * node_stride
+    (or gets its own place in region of PCM created by pcm_create_region, then writes are
+    charged by address) and has the same layout as on PCM:
+
+    Leaf:  [entry_0 | entry_1 | ... ], entry = key (key_size) + payload (entry_size - key_size)
+    Unsorted leaf: [bitmap | slot_0 | slot_1 | ... ], slot is entry, bit i is set iff slot i is used
+    Inner: [child_0 | key_0 child_1 | key_1 child_2 | ... ], pair = key_size + sizeof(void *)
+    Overflow: [entry_0 | entry_1 | ... ] of leaf or [key_0 child_0 | key_1 child_1 | ...] of inner
+
+    Overflow node (CB-Tree, OCB-Tree) is attached to full sorted node and gets appended entries
+    instead of split, node is split together with its overflow when overflow is full.
+    Node with non empty overflow is always full, OCB-Tree has overflows also on the last level of inners.
+
+    Search in sorted node is binary search, unsorted leaf is scanned (vector compare of all slots),
+    each memory line is charged once per node visit.
+    Write charges only changed bytes (shifted entries, new nodes, separators, slot + bitmap byte),
+    node header (counter, next leaf) is kept as metadata and is not charged.
+    Content-aware PCM gets image of node in this layout, so it charges only programmed bits of changed bytes.
+    The top levels of inners can be placed in DRAM (btree_set_placement), their lines are charged by DRAM time.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE: GPL 3.0
+*/
+
+#include <compiler.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pcm.h>
+
+typedef unsigned long btree_key_t;
+typedef size_t btree_value_t;
+
+#define BTREE_NODE_NULL ((size_t)-1)
+#define BTREE_SLOT_NULL ((size_t)-1)
+
+/* flags of B+Tree, can be combined */
+#define BTREE_FLAG_INNERS_IN_RAM   (1U << 0) /* all inners in DRAM with free access (shorthand of btree_set_placement) */
+#define BTREE_FLAG_UNSORTED_LEAVES (1U << 1) /* leaves are unsorted, append to free slot */
+#define BTREE_FLAG_LEAF_OVERFLOW   (1U << 2) /* overflow nodes of leaves (CB-Tree) */
+#define BTREE_FLAG_INNER_OVERFLOW  (1U << 3) /* overflow nodes of the last level of inners (OCB-Tree) */
+
+/* height is at most log_2(entries) so it is enough for any size_t number of entries */
+#define BTREE_MAX_HEIGHT (sizeof(size_t) * 8)
+
+/* dram_levels of btree_set_placement, every level of inners is placed in DRAM */
+#define BTREE_DRAM_INNERS ((size_t)-1)
+
+typedef struct BTreeNode
+{
+    size_t count; /* keys in node */
+    size_t next; /* next leaf or next free node, BTREE_NODE_NULL if there is no next */
+    size_t overflow; /* overflow node, BTREE_NODE_NULL if there is no overflow */
+    size_t addr; /* address of node in PCM region, PCM_NO_ADDR iff PCM has no region */
+    size_t level; /* 0 for leaves, level of owner for overflow node */
+    bool leaf; /* overflow node has the same type as its owner */
+    bool is_overflow; /* node is overflow node of another node */
+} BTreeNode;
+
+typedef struct BTreePair
+{
+    btree_key_t key;
+    size_t ptr; /* child or value */
+} BTreePair;
+
+typedef struct BTree
+{
+    /* node arena, node i has keys[i * node_slots], ptrs[i * (node_slots + 1)] and bitmaps[i * bitmap_size] */
+    BTreeNode *nodes;
+    btree_key_t *keys;
+    size_t *ptrs; /* children in inners, values in leaves */
+    unsigned char *bitmaps; /* used slots of unsorted leaves */
+    size_t node_slots; /* max keys in node + 1 slot for insertion before split */
+    size_t nodes_capacity;
+    size_t nodes_used; /* high-water mark of arena */
+    size_t free_nodes; /* list of freed nodes */
+
+    size_t root;
+    size_t height;
+    size_t num_entries;
+    size_t leaves;
+    size_t inners;
+    size_t overflows; /* overflow nodes in use */
+
+    size_t leaf_capacity; /* entries in leaf */
+    size_t inner_capacity; /* keys in inner */
+    size_t bitmap_size; /* bytes of bitmap in unsorted leaf, 0 for sorted leaves */
+    size_t overflow_capacity; /* entries (pairs) in overflow node */
+
+    size_t key_size; /* in bytes */
+    size_t entry_size; /* in bytes */
+    size_t node_size; /* in bytes */
+    size_t node_stride; /* node_size aligned to memory line */
+
+    bool unsorted_leaves;
+    bool leaf_overflow;
+    bool inner_overflow;
+
+    btree_key_t *scratch; /* node_slots keys, used to find median of unsorted leaf */
+    BTreePair *pairs; /* 2 * node_slots pairs, node is merged here with its overflow before split */
+
+    /* lines read during current node visit */
+    unsigned long long *line_mask;
+    size_t line_mask_words;
+
+    unsigned char *image; /* node_stride bytes, node in PCM layout for content-aware PCM (see pcm_set_write_mode) */
+
+    /* placement of the top levels of inners in DRAM (see btree_set_placement) */
+    size_t level_nodes[BTREE_MAX_HEIGHT]; /* nodes on each level (with overflow nodes), [0] leaves */
+    size_t dram_levels; /* top levels of inners in DRAM, BTREE_DRAM_INNERS for all of them */
+    size_t dram_budget; /* max bytes of nodes in DRAM, 0 iff there is no limit */
+    pcm_time_t dram_time; /* time of DRAM memory line access (read or write) */
+    size_t dram_lines_read;
+    size_t dram_lines_written;
+
+    PCM *pcm;
+} BTree;
+
+/*
+    Create empty B+Tree
+
+    PARAMS
+    @IN pcm - pointer to PCM
+    @IN key_size - size of key in bytes
+    @IN entry_size - size of entry in bytes
+    @IN node_size - size of node in bytes
+    @IN flags - BTREE_FLAG_* flags
+
+    RETURN
+    Pointer to new B+Tree iff success
+    NULL iff failure
+*/
+BTree *btree_create(PCM *pcm, size_t key_size, size_t entry_size, size_t node_size, unsigned int flags);
+
+/*
+    Destroy B+Tree
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+
+    RETURN
+    This is a void function
+*/
+void btree_destroy(BTree *tree);
+
+/*
+    Set capacity of overflow nodes, it can be changed only if no overflow node is in use
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN capacity - entries in overflow node (1 .. capacity of node - 1)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int btree_set_overflow_capacity(BTree *tree, size_t capacity);
+
+/*
+    Place the top levels of inners in DRAM, accesses to them are charged as DRAM lines instead of PCM.
+    Levels are counted from root, budget drops the lowest of them until their nodes fit in it.
+    Leaves are always on PCM, so placement follows tree when it grows or shrinks
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN dram_levels - top levels of inners in DRAM (0 = everything on PCM, BTREE_DRAM_INNERS = all inners)
+    @IN dram_budget - max bytes of nodes in DRAM (0 = no limit)
+    @IN dram_time - time of DRAM memory line access
+
+    RETURN
+    This is a void function
+*/
+void btree_set_placement(BTree *tree, size_t dram_levels, size_t dram_budget, pcm_time_t dram_time);
+
+/*
+    Get bytes of nodes placed in DRAM by current placement
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+
+    RETURN
+    DRAM footprint in bytes
+*/
+size_t btree_dram_footprint(const BTree *tree);
+
+/*
+    Insert key into B+Tree, value of existing key is overwritten
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN key - key
+    @IN value - value
+
+    RETURN
+    Insert time
+*/
+pcm_time_t btree_insert(BTree *tree, btree_key_t key, btree_value_t value);
+
+/*
+    Insert sorted keys via bulkload. If keys are greater than all keys in tree, new leaves are
+    appended with node_factor fill, otherwise keys are inserted one by one in sorted order
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN keys - sorted array of unique keys
+    @IN values - array of values
+    @IN entries - number of keys
+    @IN node_factor - fill factor of new nodes
+
+    RETURN
+    Bulkload time
+*/
+pcm_time_t btree_bulkload(BTree *tree, const btree_key_t *keys, const btree_value_t *values, size_t entries, double node_factor);
+
+/*
+    Find key in B+Tree
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN key - key to find
+    @OUT value - value of found key (can be NULL)
+    @OUT found - true iff key has been found
+
+    RETURN
+    Search time
+*/
+pcm_time_t btree_search(BTree *tree, btree_key_t key, btree_value_t *value, bool *found);
+
+/*
+    Scan entries in key order starting from the first key >= key
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN key - first key of range
+    @IN entries - max number of entries to scan
+    @OUT scanned - number of scanned entries (can be NULL)
+
+    RETURN
+    Search time
+*/
+pcm_time_t btree_range_search(BTree *tree, btree_key_t key, size_t entries, size_t *scanned);
+
+/*
+    Delete key from B+Tree
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN key - key to delete
+    @OUT found - true iff key has been found and deleted (can be NULL)
+
+    RETURN
+    Delete time
+*/
+pcm_time_t btree_delete(BTree *tree, btree_key_t key, bool *found);
+
+#endif
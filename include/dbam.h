@@ -13,9 +13,12 @@
 #include <pcm.h>
 #include <dbindex.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <darray.h>
 #include <dbutils.h>
 #include <partitions.h>
+#include <genrand.h>
+#include <dbstat.h>
 
 typedef struct DB_AM
 {
@@ -34,8 +37,24 @@ typedef struct DB_AM
     DB_index *index;
     DB_index *deletion_index;
     PCM *pcm;
+    DB_stat *stat; /* statistics context (not owned), shared with indexes, db_stat_get_default() by default */
 
     invalidation_type_t invalidation_type;
+
+    bool fence_pointers; /* partitions have fences (min key per line) in RAM, false by default */
+    /* how many times any partition has been seeked, per partition counts are in partitions->parts[i].seeks (engine),
+       the model has no partition boundaries and spreads seeks evenly */
+    size_t seeked_partitions;
+
+    sampling_t sampling_type; /* how QUERY_RANDOM is sampled, SAMPLING_BINOMIAL by default */
+    Genrand *rng; /* random generator used by queries (not owned) */
+
+    /* real adaptive merging engine, NULL iff AM is only analytical model */
+    Partitions *partitions;
+    btree_key_t *table_keys; /* keys of table in table order, freed after the first query */
+    btree_key_t *sorted_keys; /* keys of table in key order, queries take ranges from them */
+    size_t query_cursor; /* rank of the first key of next QUERY_SEQUENTIAL_PATTERN query */
+    bool initialized; /* first query has been done */
 } DB_AM;
 
 /*
@@ -43,6 +62,7 @@ typedef struct DB_AM
 
     PARAMS
     @IN PCM - pcm
+    @IN rng - random generator used by queries (NULL means genrand_default())
     @IN num_entries - number of entries in table (process works on those entries)
     @IN key_size - key size in Bytes
     @IN entry_size - size of entry in Bytes
@@ -54,7 +74,29 @@ typedef struct DB_AM
     RETURN
     Pointer to new raw Table
 */
-DB_AM *db_am_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, invalidation_type_t invalidation_type, btree_type_t index_type);
+DB_AM *db_am_create(PCM *pcm, Genrand *rng, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, invalidation_type_t invalidation_type, btree_type_t index_type);
+
+/*
+    Create instance of AM system backed by real engine. Table gets real keys,
+    the first query splits table into sorted runs of buffer_size Bytes stored as partitions,
+    each next query extracts its key range from every partition and merges it into B+Tree engine
+
+    PARAMS
+    @IN PCM - pcm
+    @IN rng - random generator used by queries (NULL means genrand_default())
+    @IN num_entries - number of entries in table (process works on those entries)
+    @IN key_size - key size in Bytes
+    @IN entry_size - size of entry in Bytes
+    @IN buffer_size - buffer size (size in bytes)
+    @IN index_node_size - size of B+TreeNode in Bytes
+    @IN invalidation_type - algorithm to invalidate entries during moving from partition to index
+    @IN index_type - B+Tree type supported by engine (see db_index_create_engine)
+
+    RETURN
+    Pointer to new AM system iff success
+    NULL iff failure
+*/
+DB_AM *db_am_create_engine(PCM *pcm, Genrand *rng, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, invalidation_type_t invalidation_type, btree_type_t index_type);
 
 /*
     Destroy AM system
@@ -67,6 +109,18 @@ DB_AM *db_am_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entry_
 */
 void db_am_destroy(DB_AM *am);
 
+/*
+    Set statistics context of AM system (also for its indexes)
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN stat - pointer to statistics context (not owned)
+
+    RETURN
+    This is a void function
+*/
+void db_am_set_stat(DB_AM *am, DB_stat *stat);
+
 /*
     Find entries by key
 
@@ -78,7 +132,7 @@ void db_am_destroy(DB_AM *am);
     RETURN
     Query time
 */
-double db_am_search(DB_AM *am, query_t type, size_t entries);
+pcm_time_t db_am_search(DB_AM *am, query_t type, size_t entries);
 
 /*
     Insert entries into AM Index
@@ -90,7 +144,19 @@ double db_am_search(DB_AM *am, query_t type, size_t entries);
     RETURN
     Query time
 */
-double db_am_insert(DB_AM *am, size_t entries);
+pcm_time_t db_am_insert(DB_AM *am, size_t entries);
+
+/*
+    Insert entries into AM Index one by one (the same result as calling db_am_insert(am, 1) entries times)
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN entries - number fo entries to insert
+
+    RETURN
+    Query time
+*/
+pcm_time_t db_am_insert_batch(DB_AM *am, size_t entries);
 
 /*
     Delete entries from AM
@@ -102,6 +168,6 @@ double db_am_insert(DB_AM *am, size_t entries);
     RETURN
     Query time
 */
-double db_am_delete(DB_AM* am, size_t entries);
+pcm_time_t db_am_delete(DB_AM* am, size_t entries);
 
 #endif
\ No newline at end of file
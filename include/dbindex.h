@@ -23,6 +23,9 @@
 #include <stddef.h>
 #include <sys/types.h>
 #include <pcm.h>
+#include <dbstat.h>
+#include <btree.h>
+#include <genrand.h>
 
 typedef enum
 {
@@ -33,7 +36,7 @@ typedef enum
     OCBTREE, /* CBTree + OverFlow node also on the last level of inners */
     BTREE_2SECTION_NODE, /* 2sections, [SORTED|UNSORTED] to keep good insertion and good deletion */
     BTREE_SKIP_COST,
-    /* buffered versions so inners are in RAM */
+    /* buffered versions so inners are in RAM (shorthands of base type with all inners placed in DRAM, see db_index_set_placement) */
     BTREE_NORMAL_INNERS_RAM,
     BTREE_UNSORTED_LEAVES_INNERS_RAM,
     CBTREE_INNERS_RAM,
@@ -41,9 +44,14 @@ typedef enum
     BTREE_WITH_BUFFERED_TREE, /* B+Tree 2sectionNode + full buffered tree in RAM */
 } btree_type_t;
 
+/* default overflow capacity, can be changed via db_index_set_overflow_capacity */
 #define CBTREE_OPERATION_BUFFER_SIZE         10
 #define OCBTREE_OPERATION_BUFFER_SIZE        10
 #define BTREE_WITH_BUFFERED_TREE_BUFFER_SIZE 1000
+
+/* each level has at least 2x less nodes than level below, so size_t is enough to count levels */
+#define DB_INDEX_MAX_LEVELS                  (sizeof(size_t) * 8)
+
 typedef struct DB_index
 {
     size_t num_entries;
@@ -54,11 +62,35 @@ typedef struct DB_index
     size_t node_size; /* in bytes */
     double node_factor;
 
+    /* shape of BTree, updated incrementally with num_entries */
+    size_t keys_per_node;
+    size_t leaf_size; /* used bytes in leaf (node_size * node_factor) */
+    size_t level_nodes[DB_INDEX_MAX_LEVELS]; /* [0] leaves, [i] inners on i-th level above leaves */
+    size_t levels; /* number of used levels in level_nodes */
+    size_t inners; /* sum of inners on all levels */
+    size_t leaves_height; /* height for current number of leaves */
+
     btree_type_t type;
 
+    /* placement of the top levels of inners in DRAM (see db_index_set_placement) */
+    size_t dram_levels; /* top levels of inners in DRAM, BTREE_DRAM_INNERS for all of them */
+    size_t dram_budget; /* max bytes of inners in DRAM, 0 iff there is no limit */
+    pcm_time_t dram_time; /* time of DRAM memory line access (read or write) */
+    size_t dram_lines_read;
+    size_t dram_lines_written;
+
     size_t buffered_operation; /* used in CBTree and OCBTree */
+    size_t overflow_capacity; /* splits postponed by overflow nodes (model), entries in overflow node (engine) */
 
     PCM *pcm;
+    DB_stat *stat; /* statistics context (not owned), db_stat_get_default() by default */
+
+    /* real B+Tree engine, NULL iff index is only analytical model */
+    BTree *engine;
+    Genrand *rng; /* chooses keys of queries (not owned) */
+    btree_key_t *engine_keys; /* keys stored in engine, to choose existing key in O(1) */
+    size_t engine_keys_capacity;
+    unsigned long long engine_next_key; /* counter of generated keys */
 } DB_index;
 
 /*
@@ -77,6 +109,28 @@ typedef struct DB_index
 */
 DB_index *db_index_create(PCM *pcm, size_t key_size, size_t entry_size, size_t node_size, double node_factor, btree_type_t btree_type);
 
+/*
+    Create empty index backed by real B+Tree engine. Every operation works on real keys
+    (new keys are unique and random, queried keys are drawn from existing ones)
+    and is charged by memory lines touched in B+Tree nodes.
+    Supported types: BTREE_NORMAL, BTREE_NORMAL_INNERS_RAM, BTREE_UNSORTED_LEAVES, BTREE_UNSORTED_LEAVES_INNERS_RAM,
+    CBTREE, CBTREE_INNERS_RAM, OCBTREE (engine starts with the biggest overflow node, see db_index_set_overflow_capacity)
+
+    PARAMS
+    @IN PCM - pcm
+    @IN rng - random generator to choose keys (NULL means genrand_default())
+    @IN key_size - size of key in Bytes
+    @IN entry_size - size of entry in Bytes
+    @IN node_size - size of node in Bytes
+    @IN node_factor - node factor (fill of node during bulkload)
+    @IN btree_type - type of BTree
+
+    RETURN
+    Pointer to new index iff success
+    NULL iff failure
+*/
+DB_index *db_index_create_engine(PCM *pcm, Genrand *rng, size_t key_size, size_t entry_size, size_t node_size, double node_factor, btree_type_t btree_type);
+
 /*
     Destroy index
 
@@ -88,6 +142,62 @@ DB_index *db_index_create(PCM *pcm, size_t key_size, size_t entry_size, size_t n
 */
 void db_index_destroy(DB_index *index);
 
+/*
+    Set statistics context of index
+
+    PARAMS
+    @IN index - pointer to index
+    @IN stat - pointer to statistics context (not owned)
+
+    RETURN
+    This is a void function
+*/
+void db_index_set_stat(DB_index *index, DB_stat *stat);
+
+/*
+    Set capacity of overflow nodes (CBTree, OCBTree). In model it is number of splits postponed
+    before flush, in engine it is number of entries in overflow node (engine cannot change it
+    when overflow nodes are in use)
+
+    PARAMS
+    @IN index - pointer to index
+    @IN capacity - overflow capacity
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_index_set_overflow_capacity(DB_index *index, size_t capacity);
+
+/*
+    Place the top levels of inners in DRAM, any type of BTree can be combined with any placement.
+    Levels in DRAM are charged by dram_time per memory line and they do not touch PCM.
+    Levels are counted from root, budget drops the lowest of them until their nodes fit in it.
+    Types *_INNERS_RAM are created as their base type with all inners in DRAM for free
+    (dram_levels = BTREE_DRAM_INNERS, dram_time = 0), so index->type holds the base type
+
+    PARAMS
+    @IN index - pointer to index
+    @IN dram_levels - top levels of inners in DRAM (0 = everything on PCM, BTREE_DRAM_INNERS = all inners)
+    @IN dram_budget - max bytes of inners in DRAM (0 = no limit)
+    @IN dram_time - time of DRAM memory line access
+
+    RETURN
+    This is a void function
+*/
+void db_index_set_placement(DB_index *index, size_t dram_levels, size_t dram_budget, pcm_time_t dram_time);
+
+/*
+    Get bytes of inners placed in DRAM by current placement
+
+    PARAMS
+    @IN index - pointer to index
+
+    RETURN
+    DRAM footprint in bytes
+*/
+size_t db_index_dram_footprint(const DB_index *index);
+
 /*
     Insert entries to index
 
@@ -98,7 +208,21 @@ void db_index_destroy(DB_index *index);
     RETURN
     Insert time
 */
-double db_index_insert(DB_index *index, size_t entries);
+pcm_time_t db_index_insert(DB_index *index, size_t entries);
+
+/*
+    Insert entries to index one by one (the same result as calling db_index_insert(index, 1) entries times)
+    Costs are calculated in closed form, so this is much faster than the loop. Result is bit-identical
+    to the loop only because PCM time is integer (products summed once equal the same products summed N times)
+
+    PARAMS
+    @IN index - pointer to index
+    @IN entries - entries to insert
+
+    RETURN
+    Insert time
+*/
+pcm_time_t db_index_insert_batch(DB_index *index, size_t entries);
 
 /*
     Insert entries via bulkload method
@@ -110,7 +234,7 @@ double db_index_insert(DB_index *index, size_t entries);
     RETURN
     Insert time
 */
-double db_index_bulkload(DB_index *index, size_t entries);
+pcm_time_t db_index_bulkload(DB_index *index, size_t entries);
 
 /*
     Find entries by point search
@@ -122,7 +246,7 @@ double db_index_bulkload(DB_index *index, size_t entries);
     RETURN
     Search time
 */
-double db_index_point_search(DB_index *index, size_t entries);
+pcm_time_t db_index_point_search(DB_index *index, size_t entries);
 
 /*
     Find entries by range search
@@ -134,7 +258,7 @@ double db_index_point_search(DB_index *index, size_t entries);
     RETURN
     Search time
 */
-double db_index_range_search(DB_index *index, size_t entries);
+pcm_time_t db_index_range_search(DB_index *index, size_t entries);
 
 /*
     Delete entries from index
@@ -146,7 +270,7 @@ double db_index_range_search(DB_index *index, size_t entries);
     RETURN
     Delete time
 */
-double db_index_delete(DB_index *index, size_t entries);
+pcm_time_t db_index_delete(DB_index *index, size_t entries);
 
 /*
     Update entries in index
@@ -158,6 +282,44 @@ double db_index_delete(DB_index *index, size_t entries);
     RETURN
     Update Time
 */
-double db_index_update(DB_index *index, size_t entries);
+pcm_time_t db_index_update(DB_index *index, size_t entries);
+
+/*
+    Generate new unique key of engine. Keys of AM table are taken from the same sequence,
+    so they never collide with keys inserted later
+
+    PARAMS
+    @IN index - pointer to index backed by engine
+
+    RETURN
+    New key
+*/
+btree_key_t db_index_new_key(DB_index *index);
+
+/*
+    Insert given keys via bulkload method (engine only)
+
+    PARAMS
+    @IN index - pointer to index backed by engine
+    @IN keys - sorted array of unique keys (not present in index)
+    @IN entries - number of keys
+
+    RETURN
+    Insert time
+*/
+pcm_time_t db_index_bulkload_keys(DB_index *index, const btree_key_t *keys, size_t entries);
+
+/*
+    Find entries by range search starting from the first key >= key (engine only)
+
+    PARAMS
+    @IN index - pointer to index backed by engine
+    @IN key - first key of range
+    @IN entries - entries to find
+
+    RETURN
+    Search time
+*/
+pcm_time_t db_index_range_search_key(DB_index *index, btree_key_t key, size_t entries);
 
 #endif
\ No newline at end of file
@@ -29,6 +29,7 @@ typedef struct DB_PAM
 
     PARAMS
     @IN PCM - pcm
+    @IN rng - random generator used by queries (NULL means genrand_default())
     @IN num_entries - number of entries in table (process works on those entries)
     @IN key_size - key size in Bytes
     @IN entry_size - size of entry in Bytes
@@ -39,7 +40,7 @@ typedef struct DB_PAM
     RETURN
     Pointer to new raw Table
 */
-DB_PAM *db_pam_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, btree_type_t index_type);
+DB_PAM *db_pam_create(PCM *pcm, Genrand *rng, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, btree_type_t index_type);
 
 /*
     Destroy PAM system
@@ -52,6 +53,18 @@ DB_PAM *db_pam_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entr
 */
 void db_pam_destroy(DB_PAM *pam);
 
+/*
+    Set statistics context of PAM system
+
+    PARAMS
+    @IN pam - pointer to PAM system
+    @IN stat - pointer to statistics context (not owned)
+
+    RETURN
+    This is a void function
+*/
+void db_pam_set_stat(DB_PAM *pam, DB_stat *stat);
+
 /*
     Find entries by key
 
@@ -63,7 +76,7 @@ void db_pam_destroy(DB_PAM *pam);
     RETURN
     Query time
 */
-double db_pam_search(DB_PAM *pam, query_t type, size_t entries);
+pcm_time_t db_pam_search(DB_PAM *pam, query_t type, size_t entries);
 
 /*
     Insert entries into PAM Index
@@ -75,7 +88,19 @@ double db_pam_search(DB_PAM *pam, query_t type, size_t entries);
     RETURN
     Query time
 */
-double db_pam_insert(DB_PAM *pam, size_t entries);
+pcm_time_t db_pam_insert(DB_PAM *pam, size_t entries);
+
+/*
+    Insert entries into PAM Index one by one (the same result as calling db_pam_insert(pam, 1) entries times)
+
+    PARAMS
+    @IN pam - pointer to PAM system
+    @IN entries - number fo entries to insert
+
+    RETURN
+    Query time
+*/
+pcm_time_t db_pam_insert_batch(DB_PAM *pam, size_t entries);
 
 
 /*
@@ -88,6 +113,6 @@ double db_pam_insert(DB_PAM *pam, size_t entries);
     RETURN
     Query time
 */
-double db_pam_delete(DB_PAM* pam, size_t entries);
+pcm_time_t db_pam_delete(DB_PAM* pam, size_t entries);
 
 #endif
\ No newline at end of file
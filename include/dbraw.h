@@ -22,6 +22,7 @@
 #include <stddef.h>
 #include <sys/types.h>
 #include <pcm.h>
+#include <dbstat.h>
 
 typedef struct DB_raw
 {
@@ -29,7 +30,7 @@ typedef struct DB_raw
     size_t entry_size; /* in bytes */
 
     PCM *pcm;
-
+    DB_stat *stat; /* statistics context (not owned), db_stat_get_default() by default */
 } DB_raw;
 
 /*
@@ -55,6 +56,18 @@ DB_raw *db_raw_create(PCM *pcm, size_t entry_size);
 */
 void db_raw_destroy(DB_raw *raw);
 
+/*
+    Set statistics context of raw table
+
+    PARAMS
+    @IN raw - pointer to raw table
+    @IN stat - pointer to statistics context (not owned)
+
+    RETURN
+    This is a void function
+*/
+void db_raw_set_stat(DB_raw *raw, DB_stat *stat);
+
 /*
     Insert entries to raw
 
@@ -65,7 +78,7 @@ void db_raw_destroy(DB_raw *raw);
     RETURN
     Insert time
 */
-double db_raw_insert(DB_raw *raw, size_t entries);
+pcm_time_t db_raw_insert(DB_raw *raw, size_t entries);
 
 /*
     Insert entries via bulkload method
@@ -77,7 +90,7 @@ double db_raw_insert(DB_raw *raw, size_t entries);
     RETURN
     Insert time
 */
-double db_raw_bulkload(DB_raw *raw, size_t entries);
+pcm_time_t db_raw_bulkload(DB_raw *raw, size_t entries);
 
 /*
     Find entries by point search
@@ -89,7 +102,7 @@ double db_raw_bulkload(DB_raw *raw, size_t entries);
     RETURN
     Search time
 */
-double db_raw_point_search(DB_raw *raw, size_t entries);
+pcm_time_t db_raw_point_search(DB_raw *raw, size_t entries);
 
 /*
     Find entries by range search
@@ -101,7 +114,7 @@ double db_raw_point_search(DB_raw *raw, size_t entries);
     RETURN
     Search time
 */
-double db_raw_range_search(DB_raw *raw, size_t entries);
+pcm_time_t db_raw_range_search(DB_raw *raw, size_t entries);
 
 /*
     Delete entries from raw table
@@ -113,7 +126,7 @@ double db_raw_range_search(DB_raw *raw, size_t entries);
     RETURN
     Delete time
 */
-double db_raw_delete(DB_raw *raw, size_t entries);
+pcm_time_t db_raw_delete(DB_raw *raw, size_t entries);
 
 /*
     Update entries in raw table
@@ -125,6 +138,6 @@ double db_raw_delete(DB_raw *raw, size_t entries);
     RETURN
     Update Time
 */
-double db_raw_update(DB_raw *raw, size_t entries);
+pcm_time_t db_raw_update(DB_raw *raw, size_t entries);
 
 #endif
\ No newline at end of file
@@ -13,17 +13,28 @@
 #include <compiler.h>
 #include <stddef.h>
 #include <sys/types.h>
+#include <pcm.h>
 
 typedef struct DB_snapshot
 {
-    /* time in seconds */
-    double invalidation_time; /* data invalidation in partition */
-    double index_time; /* index search / insert / delete time */
-    double misc_time; /* others */
+    /* time in picoseconds (see pcm_time_t) */
+    pcm_time_t invalidation_time; /* data invalidation in partition */
+    pcm_time_t index_time; /* index search / insert / delete time */
+    pcm_time_t misc_time; /* others */
 } DB_snapshot;
 
-extern DB_snapshot db_current_query;
-extern DB_snapshot db_total;
+/* Statistics context, each simulated structure can have its own one */
+typedef struct DB_stat
+{
+    DB_snapshot current_query;
+    DB_snapshot total;
+} DB_stat;
+
+/* default context used by functions without context */
+extern DB_stat db_stat_default;
+
+#define db_current_query (db_stat_default.current_query)
+#define db_total         (db_stat_default.total)
 
 /*
     Private function, do not use directly
@@ -34,14 +45,81 @@ extern DB_snapshot db_total;
     RETURN
     Sum of all fields related to time
 */
-static ___inline___ double __db_stat_get_time(DB_snapshot *sh);
+static ___inline___ pcm_time_t __db_stat_get_time(const DB_snapshot *sh);
 
 
-static ___inline___ double __db_stat_get_time(DB_snapshot *sh)
+static ___inline___ pcm_time_t __db_stat_get_time(const DB_snapshot *sh)
 {
     return  sh->index_time + sh->invalidation_time + sh->misc_time;
 }
 
+/*
+    Create new statistics context (already reset)
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Pointer to new context iff success
+    NULL iff failure
+*/
+DB_stat *db_stat_create(void);
+
+/*
+    Destroy statistics context
+
+    PARAMS
+    @IN stat - pointer to context
+
+    RETURN
+    This is a void function
+*/
+void db_stat_destroy(DB_stat *stat);
+
+/*
+    Get default statistics context
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Pointer to default context
+*/
+static ___inline___ DB_stat *db_stat_get_default(void);
+
+/*
+    Add total statistics from src into dst (aggregation of independent simulations)
+
+    PARAMS
+    @IN dst - pointer to destination context
+    @IN src - pointer to source context
+
+    RETURN
+    This is a void function
+*/
+void db_stat_merge(DB_stat *dst, const DB_stat *src);
+
+/*
+    Functions with _r suffix work on given context,
+    functions without suffix work on default context
+
+    PARAMS
+    @IN stat - pointer to context
+*/
+void db_stat_reset_r(DB_stat *stat);
+void db_stat_reset_query_r(DB_stat *stat);
+void db_stat_start_query_r(DB_stat *stat);
+void db_stat_finish_query_r(DB_stat *stat);
+void db_stat_current_print_r(DB_stat *stat);
+void db_stat_summary_print_r(DB_stat *stat);
+
+static ___inline___ void db_stat_update_invalidation_time_r(DB_stat *stat, pcm_time_t s);
+static ___inline___ void db_stat_update_index_time_r(DB_stat *stat, pcm_time_t s);
+static ___inline___ void db_stat_update_misc_time_r(DB_stat *stat, pcm_time_t s);
+
+static ___inline___ pcm_time_t db_stat_get_current_time_r(const DB_stat *stat);
+static ___inline___ pcm_time_t db_stat_get_total_time_r(const DB_stat *stat);
+
 /*
     Reset whole DB Stat
 
@@ -112,14 +190,14 @@ void db_stat_summary_print(void);
     Update statistics  for current query
 
     PARAMS
-    @IN s - seconds
+    @IN s - time in picoseconds
 
     RETURN
     This is a void function
 */
-static ___inline___ void db_stat_update_invalidation_time(double s);
-static ___inline___ void db_stat_update_index_time(double s);
-static ___inline___ void db_stat_update_misc_time(double s);
+static ___inline___ void db_stat_update_invalidation_time(pcm_time_t s);
+static ___inline___ void db_stat_update_index_time(pcm_time_t s);
+static ___inline___ void db_stat_update_misc_time(pcm_time_t s);
 
 /*
     Get query time  current query and total time
@@ -128,35 +206,65 @@ static ___inline___ void db_stat_update_misc_time(double s);
     NO PARAMS
 
     RETURN
-    Query time
+    Query time in picoseconds (pcm_time_to_seconds converts it for reports)
 */
-static ___inline___ double db_stat_get_current_time(void);
-static ___inline___ double db_stat_get_total_time(void);
+static ___inline___ pcm_time_t db_stat_get_current_time(void);
+static ___inline___ pcm_time_t db_stat_get_total_time(void);
+
+
+static ___inline___ DB_stat *db_stat_get_default(void)
+{
+    return &db_stat_default;
+}
+
+static ___inline___ void db_stat_update_invalidation_time_r(DB_stat *stat, pcm_time_t s)
+{
+    stat->current_query.invalidation_time += s;
+}
 
+static ___inline___ void db_stat_update_index_time_r(DB_stat *stat, pcm_time_t s)
+{
+    stat->current_query.index_time += s;
+}
+
+static ___inline___ void db_stat_update_misc_time_r(DB_stat *stat, pcm_time_t s)
+{
+    stat->current_query.misc_time += s;
+}
+
+static ___inline___ pcm_time_t db_stat_get_current_time_r(const DB_stat *stat)
+{
+    return __db_stat_get_time(&stat->current_query);
+}
+
+static ___inline___ pcm_time_t db_stat_get_total_time_r(const DB_stat *stat)
+{
+    return __db_stat_get_time(&stat->total);
+}
 
-static ___inline___ void db_stat_update_invalidation_time(double s)
+static ___inline___ void db_stat_update_invalidation_time(pcm_time_t s)
 {
-    db_current_query.invalidation_time += s;
+    db_stat_update_invalidation_time_r(&db_stat_default, s);
 }
 
-static ___inline___ void db_stat_update_index_time(double s)
+static ___inline___ void db_stat_update_index_time(pcm_time_t s)
 {
-    db_current_query.index_time += s;
+    db_stat_update_index_time_r(&db_stat_default, s);
 }
 
-static ___inline___ void db_stat_update_misc_time(double s)
+static ___inline___ void db_stat_update_misc_time(pcm_time_t s)
 {
-    db_current_query.misc_time += s;
+    db_stat_update_misc_time_r(&db_stat_default, s);
 }
 
-static ___inline___ double db_stat_get_current_time(void)
+static ___inline___ pcm_time_t db_stat_get_current_time(void)
 {
-    return __db_stat_get_time(&db_current_query);
+    return db_stat_get_current_time_r(&db_stat_default);
 }
 
-static ___inline___ double db_stat_get_total_time(void)
+static ___inline___ pcm_time_t db_stat_get_total_time(void)
 {
-    return __db_stat_get_time(&db_total);
+    return db_stat_get_total_time_r(&db_stat_default);
 }
 
 #endif
@@ -21,6 +21,12 @@ typedef enum query_t
     QUERY_SEQUENTIAL_PATTERN,
 } query_t;
 
+typedef enum sampling_t
+{
+    SAMPLING_BINOMIAL, /* draw number of entries from whole query at once */
+    SAMPLING_PER_ENTRY, /* draw each entry separately (slow, use only for validation) */
+} sampling_t;
+
 #define INT_CEIL_DIV(n, k) (((n) + (k) - 1) / (k))
 
 #endif
\ No newline at end of file
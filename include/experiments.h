@@ -11,7 +11,104 @@
 */
 
 #include <stddef.h>
+#include <stdbool.h>
 #include <dbutils.h>
+#include <pcm.h>
+#include <dbindex.h>
+#include <partitions.h>
+#include <genrand.h>
+
+/* max number of structures in one experiment cell, each structure has its own random stream */
+#define EXPERIMENT_MAX_STRUCTURES 16
+
+/*
+    Set master seed of experiments. Each structure in experiment gets its own
+    random stream derived from (seed, cell, structure), so runs are reproducible
+
+    PARAMS
+    @IN seed - master seed
+
+    RETURN
+    This is a void function
+*/
+void experiments_set_seed(unsigned long seed);
+
+/*
+    Set number of worker threads used by experiments with independent cells
+
+    PARAMS
+    @IN threads - number of threads (0 means number of CPUs)
+
+    RETURN
+    This is a void function
+*/
+void experiments_set_threads(size_t threads);
+
+/*
+    Silence progress and statistics which paper experiments print to stdout.
+    Their results are written to files anyway, db_* experiments print results
+    to stdout, so their output is never silenced
+
+    PARAMS
+    @IN quiet - true iff paper experiments should not print to stdout
+
+    RETURN
+    This is a void function
+*/
+void experiments_set_quiet(bool quiet);
+
+/*
+    Set PCM model used by all experiments (paper and db_*),
+    default is pcm_create_default_model
+
+    PARAMS
+    @IN mem_line - memory line in bytes
+    @IN read_time - read time per mem_line
+    @IN write_time - write time per mem_line
+
+    RETURN
+    This is a void function
+*/
+void experiments_set_pcm(size_t mem_line, pcm_time_t read_time, pcm_time_t write_time);
+
+/*
+    Create random generator for structure in experiment cell.
+    Stream depends only on master seed, cell and structure, so results are reproducible
+
+    PARAMS
+    @IN cell - experiment cell (for example selectivity step)
+    @IN structure - structure id in cell
+
+    RETURN
+    Pointer to new generator iff success
+    NULL iff failure
+*/
+Genrand *experiments_create_rng(size_t cell, size_t structure);
+
+/*
+    Create PCM model set by experiments_set_pcm
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Pointer to new PCM iff success
+    NULL iff failure
+*/
+PCM *experiments_create_pcm(void);
+
+/*
+    Create PCM with region and model set by experiments_set_pcm (see pcm_create_region)
+
+    PARAMS
+    @IN size - size of region in bytes
+    @IN path - path to file with region, NULL means anonymous mapping
+
+    RETURN
+    Pointer to new PCM iff success
+    NULL iff failure
+*/
+PCM *experiments_create_pcm_region(size_t size, const char *path);
 
 /*
     Normal workload experiment
@@ -29,9 +126,10 @@
     @IN queries - number of queries in batch (N)
 
     RETURN
-    This is a void function
+    0 iff success
+    Non-zero value iff failure
 */
-void db_raw_experiment_workload(size_t queries);
+int db_raw_experiment_workload(size_t queries);
 
 
 /*
@@ -50,9 +148,50 @@ void db_raw_experiment_workload(size_t queries);
     @IN queries - number of queries in batch (N)
 
     RETURN
-    This is a void function
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_index_experiment_workload(size_t queries);
+
+/*
+    Compare analytical B+Tree model with real B+Tree engine
+
+        1. Bulkload N,
+        2. Q x Insert,
+        3. Q x point search,
+        4. Q x range search with 1% selectivity,
+        5. Q x delete
+
+    For each step prints PCM time of model and engine and real throughput of engine
+
+    PARAMS
+    @IN entries - number of entries in bulkload (N)
+    @IN queries - number of queries in each step (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_index_experiment_engine(size_t entries, size_t queries);
+
+/*
+    Compare placements of inner levels in DRAM (PCM only, root, 2 top levels, all inners, all inners in 1MB budget)
+    for B+Tree and CB-Tree, both model and engine
+
+        1. Bulkload N,
+        2. Q x (insert, point search, delete)
+
+    For each placement prints time of step 2, DRAM lines and DRAM footprint
+
+    PARAMS
+    @IN entries - number of entries in bulkload (N)
+    @IN queries - number of queries (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
 */
-void db_index_experiment_workload(size_t queries);
+int db_index_experiment_placement(size_t entries, size_t queries);
 
 /*
     This is only test workload for db la to check all of functions
@@ -61,9 +200,168 @@ void db_index_experiment_workload(size_t queries);
     @IN entries - number of entries in table
 
     RETURN
-    This is a void function
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_workload(size_t entries);
+
+/*
+    Validation of QUERY_RANDOM sampling. For each sampling_type of AM runs QUERY_RANDOM
+    on fresh AM models with in_partitions entries in partitions, prints mean and variance
+    of entries read from index against binomial expectation
+
+    PARAMS
+    @IN entries - number of entries in table
+    @IN in_partitions - number of entries in partitions
+    @IN selectivity - query selectivity
+    @IN samples - number of queries per sampling type
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
 */
-void db_am_experiment_workload(size_t entries);
+int db_am_experiment_sampling(size_t entries, size_t in_partitions, double selectivity, size_t samples);
+
+/*
+    Compare analytical AM model with real AM engine (B+-tree, flag invalidation, buffer 1% of table)
+
+    For each query type runs Q range queries with 1% selectivity on table with N entries,
+    after each query prints PCM time of model and engine, partitions and entries left in partitions
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of queries (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_engine(size_t entries, size_t queries);
+
+/*
+    Compare invalidation strategies of analytical AM model and real AM engine
+    (B+-tree, buffer 1% of table, Q random range queries with 1% selectivity on table with N entries)
+
+    For each strategy prints PCM time and invalidation time of model and engine,
+    and memory lines read and written by engine
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of queries (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_invalidation(size_t entries, size_t queries);
+
+/*
+    Compare wear of PCM region under AM engines: AM (overwrite, B+-tree), eAM (bitmap, unsorted leaves)
+    and PAM (journal, CB-tree as engine has no buffered tree), inners in RAM, buffer 1% of table.
+    After the first query (init is skipped) each of Q steps runs range query with 1% selectivity,
+    0.1% inserts and 0.1% deletes.
+
+    Prints wear percentiles, the hottest line and lifetime for cell endurance 1e8 writes,
+    then histogram of writes per line for each engine
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of steps (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_wear(size_t entries, size_t queries);
+
+/*
+    Compare wear leveling of PCM region under AM engine (overwrite, B+-tree, inners in RAM):
+    none, Start-Gap (domain 4096 lines, gap moves every 100 writes), Security Refresh
+    (domain 4096 lines, refresh every 100 writes) and table of segments (4096 lines, swap every 100000 writes).
+    Workload is the same as in db_am_experiment_wear.
+
+    Prints time and wearout with migrations, the hottest line and lifetime for cell endurance 1e8 writes
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of steps (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_leveling(size_t entries, size_t queries);
+
+/*
+    Compare timing of AM engine (overwrite, B+-tree, inners in RAM) on PCM with 1, 4, 16 and 64 banks
+    (lines interleaved, PCM_BANK_QUEUE writes queued per bank) and with serial accesses (0 banks).
+    Workload is the same as in db_am_experiment_wear.
+
+    Prints time of the first query (partitions and bulkload), time of the rest of steps
+    and their serial time (sum of latencies of all accesses)
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of steps (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_banks(size_t entries, size_t queries);
+
+/*
+    Compare B+-tree inners in RAM with B+-tree on PCM behind DRAM write-back cache
+    (no cache, LRU 64KB, 1MB, 16MB and CLOCK 1MB, 8 ways) under AM engine with flags.
+    Workload is the same as in db_am_experiment_wear, dirty lines are flushed at the end.
+
+    Prints time, lines written to PCM, wearout, hit rate and write backs
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of steps (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_cache(size_t entries, size_t queries);
+
+/*
+    Compare B+-tree with sorted and unsorted leaves (on PCM) under AM engine with flags
+    when PCM writes whole lines, uses Data-Comparison Write or Flip-N-Write (128 bits per round).
+    Only B+-tree stores content, partitions are charged by lines in every mode.
+    Workload is the same as in db_am_experiment_wear.
+
+    Prints time, lines written, wearout, programmed bits and bits of the most programmed line
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of steps (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_write_mode(size_t entries, size_t queries);
+
+/*
+    Record AM engine with flags (workload of db_am_experiment_wear) to PCM trace once
+    and replay it on grid of PCM configurations: memory line 64B / 128B / 256B (times scale with line),
+    write time 1us / 500ns per 64B, serial access / 8 banks, no cache / 1MB LRU DRAM cache.
+
+    Saves time (total and per structure), lines, wearout and hit rate of each configuration to am_replay.txt,
+    then runs the same steps directly on PCM with LRU cache and prints whether counters match the replay
+
+    PARAMS
+    @IN entries - number of entries in table (N)
+    @IN queries - number of steps (Q)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int db_am_experiment_replay(size_t entries, size_t queries);
 
 /*
     This is only test workload for db la to check all of functions
@@ -72,9 +370,10 @@ void db_am_experiment_workload(size_t entries);
     @IN entries - number of entries in table
 
     RETURN
-    This is a void function
+    0 iff success
+    Non-zero value iff failure
 */
-void db_pam_experiment_workload(size_t entries);
+int db_pam_experiment_workload(size_t entries);
 
 /*
     This experiment shows invalidation impact on whole AM process time and PCM wearout
@@ -88,9 +387,10 @@ void db_pam_experiment_workload(size_t entries);
     @IN selectivity - query selectivity
 
     RETURN
-    This is a void function
+    0 iff success
+    Non-zero value iff failure
 */
-void experiment1(const char *file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
+int experiment1(const char *file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
 
 /*
     This experiment shows Btree Type impact on whole AM process time and PCM wearout
@@ -104,9 +404,10 @@ void experiment1(const char *file, size_t key_size, size_t data_size, size_t ent
     @IN selectivity - query selectivity
 
     RETURN
-    This is a void function
+    0 iff success
+    Non-zero value iff failure
 */
-void experiment2(const char *file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
+int experiment2(const char *file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
 
 /*
     AM vs PAM.
@@ -121,11 +422,12 @@ void experiment2(const char *file, size_t key_size, size_t data_size, size_t ent
     @IN selectivity - query selectivity
 
     RETURN
-    This is a void function
+    0 iff success
+    Non-zero value iff failure
 */
-void experiment3(const char *file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
+int experiment3(const char *file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
 
-void experiment3_1(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
+int experiment3_1(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity);
 
 typedef struct StressBatch
 {
@@ -137,14 +439,47 @@ typedef struct StressBatch
     double selectivity_min; /* when step == 0 use min */
     double selectivity_max;
     double selectivity_step;
+
+    size_t buffer_size; /* sort buffer in bytes, 0 means default (512KB) */
 } StressBatch;
 
-void experiment_stress(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
+/*
+    Structure tested in stress experiments
+*/
+typedef struct StressStructure
+{
+    const char *name;
+    bool pam; /* PAM or AM */
+    invalidation_type_t invalidation_type; /* only for AM */
+    btree_type_t btree_type;
+} StressStructure;
+
+int experiment_stress(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
+
+int experiment_stress_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
 
-void experiment_stress_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
+int experiment_stress_pam_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
 
-void experiment_stress_pam_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
+/*
+    Stress step experiment on given structures, each (selectivity, structure) cell runs in parallel.
+    Saves time and wearout per selectivity, one column per structure
+
+    PARAMS
+    @IN file - base file name
+    @IN key_size - sizeof(key) in Table T
+    @IN data_size - sizeof(Record) in Table T
+    @IN entries - how many entries is in Table T
+    @IN batch - pointer to batch description
+    @IN batches - number of batches
+    @IN structures - array of tested structures
+    @IN num_structures - number of tested structures (at most EXPERIMENT_MAX_STRUCTURES)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int experiment_stress_custom(const char *file, size_t key_size, size_t data_size, size_t entries, const StressBatch *batch, size_t batches, const StressStructure *structures, size_t num_structures);
 
-void experiment_index(const char * const file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
+int experiment_index(const char * const file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches);
 
 #endif
\ No newline at end of file
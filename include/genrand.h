@@ -1,6 +1,9 @@
 #ifndef GENRAND_H
 #define GENRAND_H
 
+#include <compiler.h>
+#include <stddef.h>
+
 /* A C-program for MT19937: Integer version (1999/10/28)          */
 /*  genrand() generates one pseudorandom unsigned integer (32bit) */
 /* which is uniformly distributed among 0 to 2^32-1  for each     */
@@ -36,10 +39,105 @@
 /* ACM Transactions on Modeling and Computer Simulation,           */
 /* Vol. 8, No. 1, January 1998, pp 3--30.                          */
 
+/*
+    Backend is selected at build time:
+    default          - MT19937 (bit exact reference, the same sequence as the original code)
+    GENRAND_XOSHIRO  - xoshiro256** with GENRAND_LANES interleaved streams, refilled in blocks
+                       by vector code (SSE2 by default, AVX2 with -mavx2)
+    Both backends generate GENRAND_BLOCK_SIZE numbers at once into buf, so genrand_r is
+    only a load from buf and a call of genrand_refill once per block
+*/
+#ifdef GENRAND_XOSHIRO
+
+#define GENRAND_LANES 4
+#define GENRAND_BLOCK_SIZE (GENRAND_LANES * 16)
+#define GENRAND_UNSEEDED (GENRAND_BLOCK_SIZE + 1)
+
+/* Generator state, every instance produces its own independent sequence */
+typedef struct Genrand
+{
+    unsigned long long s[4][GENRAND_LANES]; /* state word x lane */
+    unsigned long buf[GENRAND_BLOCK_SIZE]; /* block of generated numbers */
+    size_t mti; /* next number in buf, mti == GENRAND_UNSEEDED means state is not initialized */
+} Genrand;
+
+#else
+
+/* Period parameters */
+#define GENRAND_STATE_SIZE 624
+#define GENRAND_BLOCK_SIZE GENRAND_STATE_SIZE
+#define GENRAND_UNSEEDED (GENRAND_BLOCK_SIZE + 1)
+
+/* Generator state, every instance produces its own independent sequence */
+typedef struct Genrand
+{
+    unsigned long mt[GENRAND_STATE_SIZE]; /* the array for the state vector  */
+    unsigned long buf[GENRAND_BLOCK_SIZE]; /* tempered words of last twist */
+    size_t mti; /* next number in buf, mti == GENRAND_UNSEEDED means mt is not initialized */
+} Genrand;
+
+#endif
+
+/* Create generator initialized with a seed */
+Genrand *genrand_create(unsigned long seed);
+
+/*
+    Create generator for substream of master seed, so N workers with stream
+    0..N-1 get independent and reproducible sequences from one master seed.
+    MT19937: 64-bit seed derived from (master_seed, stream) by SplitMix64 mixing
+    initializes the state via init_by_array, different streams get different seeds.
+    xoshiro: stream is master_seed state moved by stream long jumps (2^192 steps each),
+    so streams never overlap. Cost of creation grows with stream
+*/
+Genrand *genrand_create_stream(unsigned long master_seed, unsigned long stream);
+
+/* Destroy generator */
+void genrand_destroy(Genrand *rng);
+
+/* Default generator used by sgenrand() and genrand() */
+Genrand *genrand_default(void);
+
 /* Initializing the array with a seed */
+void sgenrand_r(Genrand *rng, unsigned long seed);
+
+/*
+    Generate next GENRAND_BLOCK_SIZE numbers into rng->buf (seed 4357 is used iff
+    generator is not initialized), slow path of genrand_r
+
+    PARAMS
+    @IN rng - generator
+
+    RETURN
+    This is a void function
+*/
+void genrand_refill(Genrand *rng);
+
+/*
+    generate random number
+
+    PARAMS
+    @IN rng - generator
+
+    RETURN
+    Random 32-bit number
+*/
+static ___inline___ unsigned long genrand_r(Genrand *rng);
+
+static ___inline___ unsigned long genrand_r(Genrand *rng)
+{
+    if (rng->mti >= GENRAND_BLOCK_SIZE)
+        genrand_refill(rng);
+
+    return rng->buf[rng->mti++];
+}
+
+/* generate n random numbers into buf, the same sequence as n calls of genrand_r */
+void genrand_fill_r(Genrand *rng, unsigned long *buf, size_t n);
+
+/* Initializing the default generator with a seed */
 void sgenrand(unsigned long seed);
 
-/* generate random number */
+/* generate random number from the default generator */
 unsigned long genrand(void);
 
 #endif
\ No newline at end of file
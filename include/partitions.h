@@ -4,12 +4,37 @@
 /*
     Adaptive Merging Partitions (set of sorted entries)
 
+    Partitions are sorted runs stored one by one in emulated PCM region,
+    entry i of region is placed at simulated address i * entry_size
+    (from the place in region of PCM iff PCM is created by pcm_create_region).
+    Region is append only, entry extracted by query is only invalidated.
+    Partition without valid entries is dropped.
+
+    Seek in partition is binary search on PCM (each probe charges its line once),
+    with fences (min key per line in RAM) only partitions with entries from the query are touched.
+
+    Invalidation of extracted entries:
+    FLAG - byte of each entry is set, scan reads invalid entries too
+    BITMAP - bit of each entry in bitmap of partition, scan reads bitmap and only valid entries
+    JOURNAL - extracted key range is appended to journal (2 keys), journal is read by each query,
+              scan reads only valid entries, journal is dropped together with the last partition
+    OVERWRITE - tail of partition is moved to close the gap, partitions are always dense
+    SKIP - invalidation is free
+
     Author: Michal Kukowski
     email: michalkukowski10@gmail.com
 
     LICENCE GPL 3.0
 */
 
+#include <compiler.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pcm.h>
+#include <btree.h>
+#include <dbstat.h>
+#include <genrand.h>
+
 typedef enum
 {
     INVALIDATION_FLAG,
@@ -19,4 +44,142 @@ typedef enum
     INVALIDATION_SKIP,
 } invalidation_type_t;
 
-#endif
\ No newline at end of file
+typedef struct Partition
+{
+    size_t first; /* position of the first entry in region */
+    size_t entries; /* valid and invalid entries */
+    size_t valid; /* valid entries */
+    size_t seeks; /* how many times partition has been seeked */
+} Partition;
+
+typedef struct Partitions
+{
+    /* emulated PCM region */
+    btree_key_t *keys;
+    bool *valid; /* RAM mirror of invalidation state (flags, bitmaps or journal) */
+    size_t region_entries; /* used entries of region */
+    size_t region_capacity;
+
+    Partition *parts;
+    size_t num_parts;
+    size_t parts_capacity;
+
+    size_t num_entries; /* valid entries in all partitions */
+
+    /* positions of valid entries in region, to choose random valid entry in O(1) */
+    size_t *live;
+    size_t *live_pos;
+
+    btree_key_t *extracted; /* keys extracted by last query */
+
+    size_t key_size;
+    size_t entry_size;
+
+    invalidation_type_t invalidation_type;
+    bool fence_pointers; /* partitions have fences (min key per line) in RAM */
+    size_t seeked_partitions; /* how many times any partition has been seeked (sum of seeks of partitions, dropped ones too) */
+
+    size_t journal_entries; /* extracted ranges in journal (INVALIDATION_JOURNAL) */
+
+    /* places in region of PCM (see pcm_create_region), PCM_NO_ADDR iff PCM has no region */
+    size_t addr; /* entries */
+    size_t bitmap_addr; /* bitmaps */
+    size_t journal_addr; /* journal */
+
+    PCM *pcm;
+    DB_stat *stat; /* statistics context (not owned), db_stat_get_default() by default */
+} Partitions;
+
+/*
+    Create empty set of partitions
+
+    PARAMS
+    @IN pcm - pcm
+    @IN capacity - max number of entries written to region
+    @IN key_size - key size in Bytes
+    @IN entry_size - size of entry in Bytes
+    @IN invalidation_type - algorithm to invalidate extracted entries
+
+    RETURN
+    Pointer to new Partitions iff success
+    NULL iff failure
+*/
+Partitions *partitions_create(PCM *pcm, size_t capacity, size_t key_size, size_t entry_size, invalidation_type_t invalidation_type);
+
+/*
+    Destroy partitions
+
+    PARAMS
+    @IN parts - pointer to Partitions
+
+    RETURN
+    This is a void function
+*/
+void partitions_destroy(Partitions *parts);
+
+/*
+    Set statistics context of partitions
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN stat - pointer to statistics context (not owned)
+
+    RETURN
+    This is a void function
+*/
+void partitions_set_stat(Partitions *parts, DB_stat *stat);
+
+/*
+    Write sorted run as new partition at the end of region
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN keys - sorted array of unique keys
+    @IN entries - number of keys
+
+    RETURN
+    Write time
+*/
+pcm_time_t partitions_add_run(Partitions *parts, const btree_key_t *keys, size_t entries);
+
+/*
+    Extract valid entries with key in [lo, hi] from every partition and invalidate them
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN lo - the first key of range
+    @IN hi - the last key of range
+    @OUT keys - extracted keys (owned by partitions, valid until next extraction), sorted per partition
+    @OUT entries - number of extracted keys
+
+    RETURN
+    Time of seeks, reads and invalidation
+*/
+pcm_time_t partitions_extract(Partitions *parts, btree_key_t lo, btree_key_t hi, btree_key_t **keys, size_t *entries);
+
+/*
+    Extract all valid entries and drop all partitions
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @OUT keys - extracted keys (owned by partitions, valid until next extraction), sorted per partition
+    @OUT entries - number of extracted keys
+
+    RETURN
+    Read time
+*/
+pcm_time_t partitions_extract_all(Partitions *parts, btree_key_t **keys, size_t *entries);
+
+/*
+    Choose random valid entry (in RAM, no PCM cost)
+
+    PARAMS
+    @IN parts - pointer to Partitions with at least 1 valid entry
+    @IN rng - random generator
+
+    RETURN
+    Key of chosen entry
+*/
+btree_key_t partitions_random_key(const Partitions *parts, Genrand *rng);
+
+#endif
@@ -14,20 +14,175 @@
 #include <stddef.h>
 #include <dbutils.h>
 
+/* time in picoseconds, integer so long sums are exact and reproducible */
+typedef unsigned long long pcm_time_t;
+
+#define PCM_TIME_PER_SECOND 1000000000000ULL
+
+typedef enum
+{
+    PCM_LEVELING_NONE,
+    PCM_LEVELING_START_GAP, /* Start-Gap: lines of domain rotate through 1 spare (gap) line */
+    PCM_LEVELING_SECURITY_REFRESH, /* Security Refresh: lines of domain are remapped by XOR with key changed in rounds */
+    PCM_LEVELING_TABLE, /* table of segments: hottest segment is swapped with the least worn one (unused ones too) iff their wear differs enough */
+} pcm_leveling_t;
+
+typedef enum
+{
+    PCM_CACHE_LRU,
+    PCM_CACHE_CLOCK,
+} pcm_cache_policy_t;
+
+typedef enum
+{
+    PCM_WRITE_FULL, /* every touched line is written whole */
+    PCM_WRITE_DCW, /* Data-Comparison Write: only changed bits are programmed */
+    PCM_WRITE_FNW, /* Flip-N-Write: word is stored inverted iff it programs fewer bits (+1 flag bit) */
+} pcm_write_mode_t;
+
+typedef enum
+{
+    PCM_TRACE_READ, /* pcm_read, pcm_read_many: bytes, times */
+    PCM_TRACE_WRITE, /* pcm_write, pcm_write_many: bytes, times */
+    PCM_TRACE_READ_LINES, /* pcm_read_lines: lines */
+    PCM_TRACE_WRITE_LINES, /* pcm_write_lines: lines, bytes */
+    PCM_TRACE_READ_AT, /* pcm_read_at: addr, len */
+    PCM_TRACE_WRITE_AT, /* pcm_write_at, pcm_write_bytes_at: addr, len, bytes */
+    PCM_TRACE_STORE_AT, /* pcm_store_at: addr, len (data is not recorded) */
+    PCM_TRACE_OPS,
+} pcm_trace_op_t;
+
+/* structure which accesses PCM (see pcm_trace_set_tag), user can add own tags after PCM_TRACE_TAGS */
+typedef enum
+{
+    PCM_TRACE_TAG_NONE,
+    PCM_TRACE_TAG_INDEX,
+    PCM_TRACE_TAG_PARTITIONS,
+    PCM_TRACE_TAG_AM, /* adaptive merging outside index and partitions (scan of table) */
+    PCM_TRACE_TAG_RAW,
+    PCM_TRACE_TAGS,
+} pcm_trace_tag_t;
+
+/* state of wear leveling (private) */
+struct PCM_leveling;
+
+/* DRAM write-back cache (private) */
+struct PCM_cache;
+
+/* recorder of access trace (private) */
+struct PCM_trace;
+
 typedef struct PCM
 {
     size_t mem_line; /* minimum unit of read and write, like page in flash */
 
-    /* time in seconds per mem_line*/
-    double read_time;
-    double write_time;
+    /* time in picoseconds per mem_line */
+    pcm_time_t read_time;
+    pcm_time_t write_time;
+
+    /* counters of touched lines (write also reads line) */
+    size_t lines_read;
+    size_t lines_written;
 
     /* global wearout of memory (in bytes) */
     size_t wearout;
+
+    /* emulated device (see pcm_create_region), region is NULL iff PCM is only cost model */
+    unsigned char *region;
+    size_t region_size;
+    size_t region_used; /* bytes given by pcm_alloc */
+    size_t physical_lines; /* lines of device, region lines and spare lines of wear leveling */
+    size_t *line_writes; /* writes of each physical line, NULL iff region is too big (sketch is used) */
+    size_t *wear_sketch; /* count-min sketch of line writes (PCM_WEAR_SKETCH_DEPTH rows), used for huge region */
+    size_t max_line_writes; /* writes of the hottest line (estimated by sketch for huge region) */
+    int region_fd; /* file with region, -1 iff region is anonymous mapping */
+
+    /* wear leveling between lines of region and physical lines (see pcm_set_leveling), NULL iff disabled */
+    struct PCM_leveling *leveling;
+    size_t migrated_lines; /* lines written by wear leveling */
+
+    /* banks of device (see pcm_set_banks), accesses by address are serial iff bank_busy is NULL */
+    size_t banks;
+    size_t bank_interleave; /* bytes of region mapped to bank before the next one */
+    size_t bank_queue; /* writes queued in bank before issuer stalls */
+    pcm_time_t *bank_busy; /* bank has accepted accesses until this time */
+    pcm_time_t *bank_writes; /* queued writes of bank are served one by one from this time */
+    pcm_time_t clock; /* time of issuer of accesses by address */
+
+    /* DRAM write-back cache of lines accessed by address (see pcm_set_cache), NULL iff disabled */
+    struct PCM_cache *cache;
+    size_t cache_hits; /* lines */
+    size_t cache_misses; /* lines */
+    size_t cache_write_backs; /* dirty lines written to PCM */
+
+    /* content-aware writes of pcm_store_at (see pcm_set_write_mode) */
+    pcm_write_mode_t write_mode;
+    size_t round_bits; /* bits programmed in parallel, line write takes rounds of its programmed bits */
+    unsigned char *fnw_flags; /* Flip-N-Write: bit per word of region, word is stored inverted iff bit is set */
+    size_t bits_written; /* programmed bits (energy of writes) */
+    size_t *line_bits; /* programmed bits of each physical line, NULL iff line_writes is NULL */
+    size_t max_line_bits; /* programmed bits of the most programmed line */
+    pcm_time_t saved_time; /* write time of rounds skipped by content-aware writes */
+
+    /* recorder of every access to binary trace (see pcm_trace_open), NULL iff disabled */
+    struct PCM_trace *trace;
+    unsigned int trace_tag; /* structure which accesses PCM now */
 } PCM;
 
-#define NANO(x)  ((double)x / (double)1000000000)
-#define MICRO(x) ((double)x / (double)1000000)
+/* address of structure without place in region */
+#define PCM_NO_ADDR ((size_t)-1)
+
+/* region with more lines has line writes counted by sketch */
+#define PCM_WEAR_EXACT_LINES  (1UL << 24)
+#define PCM_WEAR_SKETCH_DEPTH 4
+#define PCM_WEAR_SKETCH_WIDTH (1UL << 20) /* power of 2 */
+
+/* bytes of word with own flag bit in Flip-N-Write */
+#define PCM_FNW_WORD 4
+
+/* table wear leveling swaps segments only when their writes differ by more than this many writes per line of segment */
+#define PCM_LEVELING_TABLE_GAP 8
+
+/* writes queued per bank before issuer stalls, like write queue of memory controller */
+#define PCM_BANK_QUEUE 8
+
+/*
+    Binary trace: header is PCM_TRACE_MAGIC, version byte and varints of mem_line, read_time, write_time, region_size.
+    Record is byte with op (low bits) and PCM_TRACE_HAS_* flags, then varints:
+    [tag iff HAS_TAG] [address iff op is *_AT, zigzag delta from the end of previous access by address]
+    size [times iff HAS_TIMES, 1 otherwise] [extra bytes iff HAS_EXTRA, size otherwise]
+*/
+#define PCM_TRACE_MAGIC     "PCMTRACE"
+#define PCM_TRACE_VERSION   2 /* version 1 had no region_size in header */
+#define PCM_TRACE_OP_MASK   0x0fU
+#define PCM_TRACE_HAS_TAG   0x10U /* tag is changed */
+#define PCM_TRACE_HAS_TIMES 0x20U
+#define PCM_TRACE_HAS_EXTRA 0x40U
+#define PCM_TRACE_BUFFER    (1UL << 16) /* bytes of trace kept in memory before write to file */
+
+/* histogram[0] counts lines never written, histogram[i] lines with writes in [2^(i - 1), 2^i) */
+#define PCM_WEAR_HISTOGRAM (sizeof(size_t) * 8 + 1)
+
+/* wear of physical lines in use (lines of region given by pcm_alloc and their domains of wear leveling) */
+typedef struct PCM_wear
+{
+    size_t lines;
+    size_t worn_lines; /* lines written at least once */
+    size_t max; /* writes of the hottest line */
+    double mean; /* writes per line */
+
+    /* percentiles of writes per line, with precision 1/8 of value */
+    size_t p50;
+    size_t p90;
+    size_t p99;
+    size_t p999;
+
+    size_t histogram[PCM_WEAR_HISTOGRAM];
+} PCM_wear;
+
+#define PICO(x)  ((pcm_time_t)(x))
+#define NANO(x)  ((pcm_time_t)(x) * 1000ULL)
+#define MICRO(x) ((pcm_time_t)(x) * 1000000ULL)
 
 /* from Rethinking Database Algorithms for PCM */
 #define pcm_create_default_model() pcm_create(64, NANO(50), MICRO(1))
@@ -37,14 +192,313 @@ typedef struct PCM
 
     PARAMS
     @IN mem_line - memory line (minimum unit of read and write, like page)
-    @IN rtime - read time in seconds per mem_line
-    @IN wtime - write time in seconds per mem_line
+    @IN rtime - read time in picoseconds per mem_line
+    @IN wtime - write time in picoseconds per mem_line
 
     RETURN
     Pointer to new PCM instance iff success
     NULL iff failure
 */
-PCM *pcm_create(size_t mem_line, double rtime, double wtime);
+PCM *pcm_create(size_t mem_line, pcm_time_t rtime, pcm_time_t wtime);
+
+/*
+    Create a PCM instance with emulated device. Region is mapped from file (it should be on tmpfs,
+    file is created if needed and stays after destroy) or anonymously. Accesses by address
+    (pcm_read_at, pcm_write_at) charge every touched mem_line and count writes of each line
+
+    PARAMS
+    @IN mem_line - memory line (minimum unit of read and write, like page)
+    @IN rtime - read time in picoseconds per mem_line
+    @IN wtime - write time in picoseconds per mem_line
+    @IN size - size of region in bytes
+    @IN path - path to file with region, NULL means anonymous mapping
+
+    RETURN
+    Pointer to new PCM instance iff success
+    NULL iff failure
+*/
+PCM *pcm_create_region(size_t mem_line, pcm_time_t rtime, pcm_time_t wtime, size_t size, const char *path);
+
+/*
+    Allocate place in region of PCM, place is aligned to mem_line and never freed
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN bytes - size of place
+    @OUT addr - address of place
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (PCM has no region or region is full)
+*/
+int pcm_alloc(PCM *pcm, size_t bytes, size_t *addr);
+
+/*
+    Simulate READ of bytes [addr, addr + len) of region, each touched line is charged
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN len - number of bytes to read
+
+    RETURN
+    time consumed by read
+*/
+pcm_time_t pcm_read_at(PCM *pcm, size_t addr, size_t len);
+
+/*
+    Simulate WRITE of bytes [addr, addr + len) of region, each touched line is charged and counted
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN len - number of bytes to write
+
+    RETURN
+    time consumed by write
+*/
+pcm_time_t pcm_write_at(PCM *pcm, size_t addr, size_t len);
+
+/*
+    Simulate WRITE of bytes spread over lines of [addr, addr + len) (like flags of entries on the same line)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN len - number of bytes covering all written bytes
+    @IN bytes - number of written bytes
+
+    RETURN
+    time consumed by write
+*/
+pcm_time_t pcm_write_bytes_at(PCM *pcm, size_t addr, size_t len, size_t bytes);
+
+/*
+    Set wear leveling of region. Wear leveling remaps lines of region to physical lines
+    (only wear is remapped, data stays at its address), each migration of line is charged as read and write
+    of line. Line counters are reset, so set it before workload
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN type - type of wear leveling
+    @IN lines - lines in domain (Start-Gap, Security Refresh - power of 2) or in segment (table)
+    @IN interval - writes to domain between migrations (Start-Gap, Security Refresh) or writes to region between checks of swap (table)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int pcm_set_leveling(PCM *pcm, pcm_leveling_t type, size_t lines, size_t interval);
+
+/*
+    Set banks of device. Lines of region are interleaved over banks, accesses by address to different
+    banks overlap: read waits only for access in service in its bank (reads have priority over queued writes),
+    write is queued in its bank and issuer stalls only when queue of bank is full.
+    Accesses by address return time of issuer (pcm->clock), counters and pcm_get_time stay serial.
+    Accesses without address are still serial and do not use banks
+
+    PARAMS
+    @IN pcm - pointer to PCM
+    @IN banks - number of banks, 0 means serial accesses (one bank without queue)
+    @IN interleave - bytes mapped to bank before the next one (multiple of mem_line)
+    @IN queue - writes queued per bank (PCM_BANK_QUEUE by default), 0 means that write blocks issuer
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int pcm_set_banks(PCM *pcm, size_t banks, size_t interleave, size_t queue);
+
+/*
+    Wait until all banks serve queued accesses
+
+    PARAMS
+    @IN pcm - pointer to PCM
+
+    RETURN
+    Waited time
+*/
+pcm_time_t pcm_bank_sync(PCM *pcm);
+
+/*
+    Set DRAM write-back cache in front of region. Accesses by address go through cache: hit costs DRAM time,
+    read miss reads line from PCM, write miss allocates line without fetch. Dirty line is written to PCM
+    (counters, wear, banks) only when it is evicted or flushed, so lines_written counts writes which reach PCM.
+    Accesses without address bypass cache. Dirty lines of previous cache are flushed
+
+    PARAMS
+    @IN pcm - pointer to PCM
+    @IN lines - capacity in lines, 0 means no cache
+    @IN ways - associativity (lines has to be multiple of ways)
+    @IN policy - replacement policy in set
+    @IN time - DRAM access time per line
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int pcm_set_cache(PCM *pcm, size_t lines, size_t ways, pcm_cache_policy_t policy, pcm_time_t time);
+
+/*
+    Write all dirty lines of cache to PCM
+
+    PARAMS
+    @IN pcm - pointer to PCM
+
+    RETURN
+    Time of write backs
+*/
+pcm_time_t pcm_cache_flush(PCM *pcm);
+
+/*
+    Set how pcm_store_at charges writes. Content-aware modes compare new data with data in region,
+    line without programmed bits is only read (compare) and is not written, other lines are written
+    in rounds of round_bits programmed bits (write_time covers rounds of whole line).
+    Line counters and counters of programmed bits are reset
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN mode - write mode
+    @IN round_bits - bits programmed in parallel (e.g. 128)
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int pcm_set_write_mode(PCM *pcm, pcm_write_mode_t mode, size_t round_bits);
+
+/*
+    Store data to bytes [addr, addr + len) of region and charge write by write mode.
+    With cache write is charged when dirty line is written back: line written only by stores is compared
+    with content before its first store, line written also by pcm_write_at is written whole
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN data - new content
+    @IN len - number of bytes
+
+    RETURN
+    time consumed by write
+*/
+pcm_time_t pcm_store_at(PCM *pcm, size_t addr, const void *data, size_t len);
+
+/*
+    Start recording of every access to PCM into binary trace file (file is truncated).
+    Accesses are recorded as they are requested (before cache, banks and wear leveling),
+    so trace can be replayed on PCM with different parameters
+
+    PARAMS
+    @IN pcm - pointer to PCM
+    @IN path - path to trace file
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int pcm_trace_open(PCM *pcm, const char *path);
+
+/*
+    Stop recording, flush and close trace file (it is closed also by pcm_destroy)
+
+    PARAMS
+    @IN pcm - pointer to PCM
+
+    RETURN
+    0 iff success (whole trace is written)
+    Non-zero value iff failure
+*/
+int pcm_trace_close(PCM *pcm);
+
+/*
+    Append record to trace, it is called by access functions iff trace is enabled
+
+    PARAMS
+    @IN pcm - pointer to PCM with trace
+    @IN op - operation
+    @IN addr - address in region (only for *_AT operations)
+    @IN size - bytes (lines for *_LINES operations)
+    @IN times - how many times operation is repeated
+    @IN extra - written bytes (size iff all bytes are written)
+
+    RETURN
+    This is a void function
+*/
+void pcm_trace_record(PCM *pcm, pcm_trace_op_t op, size_t addr, size_t size, size_t times, size_t extra);
+
+/*
+    Set tag of structure which accesses PCM from now, it is recorded in trace
+
+    PARAMS
+    @IN pcm - pointer to PCM
+    @IN tag - pcm_trace_tag_t or own tag
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void pcm_trace_set_tag(PCM *pcm, unsigned int tag);
+
+static ___inline___ void pcm_trace_set_tag(PCM *pcm, unsigned int tag)
+{
+    pcm->trace_tag = tag;
+}
+
+/*
+    Get number of writes of physical line (estimate iff region is tracked by sketch,
+    estimate is never lower than real value)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN line - physical line (the same as line of region without wear leveling)
+
+    RETURN
+    Number of writes
+*/
+size_t pcm_line_writes(const PCM *pcm, size_t line);
+
+/*
+    Get wear of region (histogram and percentiles of writes per line)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @OUT wear - wear of region
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (PCM has no region)
+*/
+int pcm_wear(const PCM *pcm, PCM_wear *wear);
+
+/*
+    Project lifetime of device: workload which took pcm_get_time(pcm) is repeated
+    until the hottest line reaches endurance of cell
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN endurance - writes which cell survives (e.g. 1e8)
+
+    RETURN
+    Lifetime in seconds (INFINITY iff nothing has been written)
+*/
+double pcm_lifetime(const PCM *pcm, double endurance);
+
+/*
+    Get pointer to data at address of region, structures living in region access data by it
+    and charge accesses by pcm_read_at / pcm_write_at
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+
+    RETURN
+    Pointer to data
+*/
+static ___inline___ void *pcm_region_ptr(const PCM *pcm, size_t addr);
+
+static ___inline___ void *pcm_region_ptr(const PCM *pcm, size_t addr)
+{
+    return pcm->region + addr;
+}
 
 /*
     Destroy PCM instance
@@ -57,6 +511,49 @@ PCM *pcm_create(size_t mem_line, double rtime, double wtime);
 */
 void pcm_destroy(PCM *pcm);
 
+/*
+    Convert PCM time to seconds, use it only for reporting
+
+    PARAMS
+    @IN t - time in picoseconds
+
+    RETURN
+    Time in seconds
+*/
+static ___inline___ double pcm_time_to_seconds(pcm_time_t t);
+
+static ___inline___ double pcm_time_to_seconds(pcm_time_t t)
+{
+    return (double)t / (double)PCM_TIME_PER_SECOND;
+}
+
+/*
+    Reset counters and wearout of PCM instance
+
+    PARAMS
+    @IN pcm - pointer to PCM
+
+    RETURN
+    This is a void function
+*/
+void pcm_reset_counters(PCM *pcm);
+
+/*
+    Get time of all operations counted by PCM instance
+
+    PARAMS
+    @IN pcm - pointer to PCM
+
+    RETURN
+    Time in picoseconds
+*/
+static ___inline___ pcm_time_t pcm_get_time(const PCM *pcm);
+
+static ___inline___ pcm_time_t pcm_get_time(const PCM *pcm)
+{
+    return (pcm_time_t)pcm->lines_read * pcm->read_time + (pcm_time_t)pcm->lines_written * pcm->write_time - pcm->saved_time;
+}
+
 /*
     Simulate READ from PCM instance
 
@@ -67,13 +564,17 @@ void pcm_destroy(PCM *pcm);
     RETURN
     time consumed by read
 */
-static ___inline___ double pcm_read(const PCM *pcm, size_t bytes);
+static ___inline___ pcm_time_t pcm_read(PCM *pcm, size_t bytes);
 
-static ___inline___ double pcm_read(const PCM *pcm, size_t bytes)
+static ___inline___ pcm_time_t pcm_read(PCM *pcm, size_t bytes)
 {
     const size_t lines = INT_CEIL_DIV(bytes, pcm->mem_line);
 
-    return (double)lines * pcm->read_time;
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_READ, PCM_NO_ADDR, bytes, 1, bytes);
+
+    pcm->lines_read += lines;
+    return (pcm_time_t)lines * pcm->read_time;
 }
 
 /*
@@ -86,16 +587,117 @@ static ___inline___ double pcm_read(const PCM *pcm, size_t bytes)
     RETURN
     time consumed by write
 */
-static ___inline___ double pcm_write(PCM *pcm, size_t bytes);
+static ___inline___ pcm_time_t pcm_write(PCM *pcm, size_t bytes);
 
-static ___inline___ double pcm_write(PCM *pcm, size_t bytes)
+static ___inline___ pcm_time_t pcm_write(PCM *pcm, size_t bytes)
 {
-    pcm->wearout += bytes;
     const size_t lines = INT_CEIL_DIV(bytes, pcm->mem_line);
-    return (double)lines * pcm->write_time + pcm_read(pcm, bytes);
+
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_WRITE, PCM_NO_ADDR, bytes, 1, bytes);
+
+    /* line is read before write */
+    pcm->wearout += bytes;
+    pcm->lines_written += lines;
+    pcm->lines_read += lines;
+    return (pcm_time_t)lines * (pcm->write_time + pcm->read_time);
+}
+
+/*
+    Simulate the same READ repeated many times (in one step)
+
+    PARAMS
+    @IN pcm - pointer to PCM instance
+    @IN bytes - number of bytes to read by single operation
+    @IN times - how many times read is repeated
+
+    RETURN
+    time consumed by all reads
+*/
+static ___inline___ pcm_time_t pcm_read_many(PCM *pcm, size_t bytes, size_t times);
+
+static ___inline___ pcm_time_t pcm_read_many(PCM *pcm, size_t bytes, size_t times)
+{
+    const size_t lines = INT_CEIL_DIV(bytes, pcm->mem_line) * times;
+
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_READ, PCM_NO_ADDR, bytes, times, bytes);
+
+    pcm->lines_read += lines;
+    return (pcm_time_t)lines * pcm->read_time;
+}
+
+/*
+    Simulate the same WRITE repeated many times (in one step)
+
+    PARAMS
+    @IN pcm - pointer to PCM instance
+    @IN bytes - number of bytes to write by single operation
+    @IN times - how many times write is repeated
+
+    RETURN
+    time consumed by all writes
+*/
+static ___inline___ pcm_time_t pcm_write_many(PCM *pcm, size_t bytes, size_t times);
+
+static ___inline___ pcm_time_t pcm_write_many(PCM *pcm, size_t bytes, size_t times)
+{
+    const size_t lines = INT_CEIL_DIV(bytes, pcm->mem_line) * times;
+
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_WRITE, PCM_NO_ADDR, bytes, times, bytes);
+
+    /* line is read before write */
+    pcm->wearout += bytes * times;
+    pcm->lines_written += lines;
+    pcm->lines_read += lines;
+    return (pcm_time_t)lines * (pcm->write_time + pcm->read_time);
 }
 
+/*
+    Simulate READ of whole memory lines (for accesses not aligned to memory line)
 
+    PARAMS
+    @IN pcm - pointer to PCM instance
+    @IN lines - number of touched memory lines
+
+    RETURN
+    time consumed by read
+*/
+static ___inline___ pcm_time_t pcm_read_lines(PCM *pcm, size_t lines);
 
+static ___inline___ pcm_time_t pcm_read_lines(PCM *pcm, size_t lines)
+{
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_READ_LINES, PCM_NO_ADDR, lines, 1, lines);
+
+    pcm->lines_read += lines;
+    return (pcm_time_t)lines * pcm->read_time;
+}
+
+/*
+    Simulate WRITE of bytes spread over memory lines (for accesses not aligned to memory line)
+
+    PARAMS
+    @IN pcm - pointer to PCM instance
+    @IN lines - number of touched memory lines
+    @IN bytes - number of written bytes
+
+    RETURN
+    time consumed by write
+*/
+static ___inline___ pcm_time_t pcm_write_lines(PCM *pcm, size_t lines, size_t bytes);
+
+static ___inline___ pcm_time_t pcm_write_lines(PCM *pcm, size_t lines, size_t bytes)
+{
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_WRITE_LINES, PCM_NO_ADDR, lines, 1, bytes);
+
+    /* line is read before write */
+    pcm->wearout += bytes;
+    pcm->lines_written += lines;
+    pcm->lines_read += lines;
+    return (pcm_time_t)lines * (pcm->write_time + pcm->read_time);
+}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef PCMREPLAY_H
+#define PCMREPLAY_H
+
+/*
+    Replay of PCM access trace (see pcm_trace_open) on many PCM configurations
+
+    Trace is mapped and streamed once per worker, each worker replays every record on its group of
+    configurations, so sweep of device parameters costs one scan of trace instead of one simulation per PCM.
+    Accesses by address are replayed on region of the same size as recording PCM (with banks and cache),
+    lines of pcm_read_lines / pcm_write_lines are rescaled to mem_line of configuration.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE GPL 3.0
+*/
+
+#include <compiler.h>
+#include <stddef.h>
+#include <pcm.h>
+
+typedef struct PCM_replay_config
+{
+    size_t mem_line;
+    pcm_time_t read_time; /* per mem_line */
+    pcm_time_t write_time; /* per mem_line */
+    size_t banks; /* 0 iff accesses by address are serial */
+    size_t cache_lines; /* lines of DRAM cache (8 ways, LRU), 0 iff there is no cache */
+    pcm_time_t cache_time; /* DRAM access time per line */
+} PCM_replay_config;
+
+typedef struct PCM_replay_result
+{
+    pcm_time_t time; /* sum of times of replayed accesses and final flush of cache */
+    pcm_time_t tag_time[PCM_TRACE_TAGS]; /* time per structure, own tags are counted as PCM_TRACE_TAG_NONE */
+    size_t lines_read;
+    size_t lines_written;
+    size_t wearout;
+    size_t cache_hits;
+    size_t cache_misses;
+    size_t records; /* replayed records */
+    int error; /* non-zero iff configuration could not be replayed */
+} PCM_replay_result;
+
+/*
+    Replay trace on every configuration
+
+    PARAMS
+    @IN path - path to trace file
+    @IN configs - array of configurations
+    @OUT results - array of results (result i belongs to configuration i)
+    @IN num_configs - number of configurations
+    @IN threads - number of workers (0 means taskpool_default_threads())
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure (trace is broken or at least 1 configuration has failed)
+*/
+int pcm_replay(const char *path, const PCM_replay_config *configs, PCM_replay_result *results, size_t num_configs, size_t threads);
+
+/*
+    Write table of configurations and their results (one row per configuration, tab separated)
+
+    PARAMS
+    @IN path - path to output file (truncated)
+    @IN configs - array of configurations
+    @IN results - array of results
+    @IN num_configs - number of configurations
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int pcm_replay_save(const char *path, const PCM_replay_config *configs, const PCM_replay_result *results, size_t num_configs);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef RANDDIST_H
+#define RANDDIST_H
+
+/*
+    Random distributions built on top of MT19937 generator (genrand)
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE GPL 3.0
+*/
+
+#include <stddef.h>
+#include <genrand.h>
+
+/*
+    Generate uniformly distributed real number from [0, 1) with 53 bits resolution
+
+    PARAMS
+    @IN rng - pointer to generator
+
+    RETURN
+    Random real number from [0, 1)
+*/
+static ___inline___ double genrand_real(Genrand *rng);
+
+static ___inline___ double genrand_real(Genrand *rng)
+{
+    /* 27 + 26 bits from 2 draws */
+    const unsigned long a = genrand_r(rng) >> 5;
+    const unsigned long b = genrand_r(rng) >> 6;
+
+    return ((double)a * 67108864.0 + (double)b) * (1.0 / 9007199254740992.0);
+}
+
+/*
+    Generate number of successes in n Bernoulli trials with probability p.
+    Expected time is O(1) (BTPE for big n * p, inversion for small n * p)
+
+    PARAMS
+    @IN rng - pointer to generator
+    @IN n - number of trials
+    @IN p - probability of success
+
+    RETURN
+    Random number from Binomial(n, p)
+*/
+size_t genrand_binomial(Genrand *rng, size_t n, double p);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+/*
+    Simple pool of worker threads for independent tasks.
+    Workers take next task from shared counter, so faster workers take more tasks
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE GPL 3.0
+*/
+
+#include <stddef.h>
+
+typedef void (*task_fn_t)(void *task);
+
+/*
+    Get default number of workers (number of online CPUs)
+
+    PARAMS
+    NO PARAMS
+
+    RETURN
+    Number of workers
+*/
+size_t taskpool_default_threads(void);
+
+/*
+    Run all tasks and wait for them. Tasks are stored in array, every task is
+    called exactly once, order of execution is not defined.
+
+    PARAMS
+    @IN threads - number of workers (0 means taskpool_default_threads())
+    @IN fn - task function
+    @IN tasks - array of tasks
+    @IN task_size - size of one task in bytes
+    @IN num_tasks - number of tasks
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+int taskpool_run(size_t threads, task_fn_t fn, void *tasks, size_t task_size, size_t num_tasks);
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+/*
+    Declarative workload specification (INI file) and driver of experiments.
+
+    Spec describes table, PCM model, run settings and list of experiments:
+
+        # comment (also ;)
+        [table]
+        entries = 100000000
+        key_size = 4
+        data_size = 8
+
+        [pcm]
+        mem_line = 64
+        read_time = 50ns            (units: ps, ns, us, ms, s, default ns)
+        write_time = 1us
+
+        [run]
+        seed = 4357                 (or time)
+        threads = 0                 (0 means number of CPUs)
+
+        [experiment ex4_stress_step4]   (name is base of output files)
+        type = stress_step
+        inserts = 100000
+        deletes = 100000
+        rsearches = 5
+        selectivity_min = 0.01
+        selectivity_max = 0.05
+        selectivity_step = 0.01
+        batches = 5
+        buffer_size = 15360000
+
+    Keys of experiment: type, entries / key_size / data_size (override table), query (random, new, sequential),
+    selectivity, rsearches, psearches, inserts, deletes, selectivity_min, selectivity_max, selectivity_step,
+    batches, buffer_size, queries, in_partitions, samples and structure (stress_custom only, repeated):
+
+        structure = eAM, am, unsorted_leaves_inners_ram, bitmap
+        structure = PAM BB+tree, pam, with_buffered_tree
+
+    Experiments run in order of spec, see workload_type_names in workload.c for supported types.
+    Experiments db_* use seed and [pcm] of spec with their own key and data sizes.
+
+    Author: Michal Kukowski
+    email: michalkukowski10@gmail.com
+
+    LICENCE GPL 3.0
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pcm.h>
+#include <dbutils.h>
+#include <experiments.h>
+
+#define WORKLOAD_NAME_LEN 128
+
+typedef enum
+{
+    WORKLOAD_EXPERIMENT1,
+    WORKLOAD_EXPERIMENT2,
+    WORKLOAD_EXPERIMENT3,
+    WORKLOAD_EXPERIMENT3_1,
+    WORKLOAD_STRESS,
+    WORKLOAD_STRESS_STEP,
+    WORKLOAD_STRESS_PAM_STEP,
+    WORKLOAD_STRESS_CUSTOM,
+    WORKLOAD_INDEX,
+    WORKLOAD_DB_RAW_WORKLOAD,
+    WORKLOAD_DB_INDEX_WORKLOAD,
+    WORKLOAD_DB_INDEX_ENGINE,
+    WORKLOAD_DB_INDEX_PLACEMENT,
+    WORKLOAD_DB_AM_WORKLOAD,
+    WORKLOAD_DB_AM_ENGINE,
+    WORKLOAD_DB_AM_INVALIDATION,
+    WORKLOAD_DB_AM_WEAR,
+    WORKLOAD_DB_AM_LEVELING,
+    WORKLOAD_DB_AM_BANKS,
+    WORKLOAD_DB_AM_CACHE,
+    WORKLOAD_DB_AM_WRITE_MODE,
+    WORKLOAD_DB_AM_REPLAY,
+    WORKLOAD_DB_AM_SAMPLING,
+    WORKLOAD_DB_PAM_WORKLOAD,
+    WORKLOAD_TYPES
+} workload_type_t;
+
+typedef struct WorkloadExperiment
+{
+    char name[WORKLOAD_NAME_LEN]; /* base of output files */
+    workload_type_t type;
+    bool enabled; /* false iff experiment was filtered out (see workload_select) */
+
+    /* 0 means value from table */
+    size_t entries;
+    size_t key_size;
+    size_t data_size;
+
+    query_t query;
+    double selectivity;
+    StressBatch batch;
+    size_t batches;
+    size_t queries;
+    size_t in_partitions;
+    size_t samples;
+
+    /* names are stored separately, so experiments can be moved */
+    StressStructure structures[EXPERIMENT_MAX_STRUCTURES];
+    char structure_names[EXPERIMENT_MAX_STRUCTURES][WORKLOAD_NAME_LEN];
+    size_t num_structures;
+} WorkloadExperiment;
+
+typedef struct Workload
+{
+    size_t entries;
+    size_t key_size;
+    size_t data_size;
+
+    size_t mem_line;
+    pcm_time_t read_time;
+    pcm_time_t write_time;
+
+    unsigned long seed;
+    size_t threads;
+    bool progress; /* print progress of experiments to stderr */
+    bool quiet; /* paper experiments do not print to stdout, results of db_* are still printed */
+
+    WorkloadExperiment *experiments;
+    size_t num_experiments;
+    size_t capacity;
+} Workload;
+
+/*
+    Load workload from spec file
+
+    PARAMS
+    @IN path - path to spec file
+
+    RETURN
+    Pointer to new workload iff success
+    NULL iff failure (error with line of spec is printed to stderr)
+*/
+Workload *workload_load(const char *path);
+
+/*
+    Destroy workload
+
+    PARAMS
+    @IN workload - pointer to workload
+
+    RETURN
+    This is a void function
+*/
+void workload_destroy(Workload *workload);
+
+/*
+    Override sizes of table in workload and in every experiment (also db_* experiments)
+
+    PARAMS
+    @IN workload - pointer to workload
+    @IN entries - number of entries (0 means keep spec value)
+    @IN key_size - size of key (0 means keep spec value)
+    @IN data_size - size of record (0 means keep spec value)
+
+    RETURN
+    This is a void function
+*/
+void workload_override_sizes(Workload *workload, size_t entries, size_t key_size, size_t data_size);
+
+/*
+    Enable only experiments with given names, other experiments are skipped by workload_run
+
+    PARAMS
+    @IN workload - pointer to workload
+    @IN names - array of names of experiments
+    @IN num_names - number of names
+    @OUT found - found[i] is set to true iff workload has experiment names[i] (can be NULL)
+
+    RETURN
+    Number of enabled experiments
+*/
+size_t workload_select(Workload *workload, const char * const *names, size_t num_names, bool *found);
+
+/*
+    Parse unsigned integer (value of spec or command line)
+
+    PARAMS
+    @IN str - string
+    @OUT value - parsed value
+
+    RETURN
+    0 iff success
+    Non-zero value iff str is not unsigned integer
+*/
+int workload_parse_size(const char *str, size_t *value);
+
+/*
+    Parse master seed: unsigned integer or "time" (current time)
+
+    PARAMS
+    @IN str - string
+    @OUT value - parsed seed
+
+    RETURN
+    0 iff success
+    Non-zero value iff str is neither unsigned integer nor "time"
+*/
+int workload_parse_seed(const char *str, unsigned long *value);
+
+/*
+    Get name of experiment type used in spec
+
+    PARAMS
+    @IN type - type of experiment
+
+    RETURN
+    Name of type iff type is valid
+    NULL iff type is unknown
+*/
+const char *workload_type_name(workload_type_t type);
+
+/*
+    Run all enabled experiments of workload in order of spec,
+    failed experiment does not stop the next ones
+
+    PARAMS
+    @IN workload - pointer to workload
+
+    RETURN
+    0 iff success
+    Non-zero value iff any experiment failed
+*/
+int workload_run(const Workload *workload);
+
+#endif
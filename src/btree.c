@@ -0,0 +1,2959 @@
+#include <btree.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BTREE_PTR_SIZE           sizeof(void *)
+#define BTREE_MASK_BITS          (sizeof(unsigned long long) * 8)
+#define BTREE_MIN_CAPACITY       3
+#define BTREE_INIT_NODES         16
+#define BTREE_VEC_LANES          4
+
+/* keys of unsorted leaf are compared BTREE_VEC_LANES at once (GCC vector extensions) */
+typedef btree_key_t btree_key_vec_t __attribute__((vector_size(BTREE_VEC_LANES * sizeof(btree_key_t))));
+typedef long btree_mask_vec_t __attribute__((vector_size(BTREE_VEC_LANES * sizeof(long))));
+
+/*
+    Get keys / ptrs (children or values) of node
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - node id
+
+    RETURN
+    Pointer to first key / ptr of node
+*/
+static ___inline___ btree_key_t *btree_node_keys(const BTree *tree, size_t node);
+static ___inline___ size_t *btree_node_ptrs(const BTree *tree, size_t node);
+
+/*
+    Offsets of entries in node layout on PCM
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN i - position in node
+
+    RETURN
+    Offset in bytes from the beginning of node
+*/
+static ___inline___ size_t btree_leaf_offset(const BTree *tree, size_t i);
+static ___inline___ size_t btree_inner_key_offset(const BTree *tree, size_t i);
+static ___inline___ size_t btree_inner_child_offset(const BTree *tree, size_t i);
+
+/*
+    Number of memory lines touched by bytes starting at offset
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN offset - offset in node
+    @IN bytes - number of bytes
+
+    RETURN
+    Number of touched lines
+*/
+static ___inline___ size_t btree_span_lines(const BTree *tree, size_t offset, size_t bytes);
+
+/*
+    Get number of the top levels of inners placed in DRAM for current height and budget
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+
+    RETURN
+    Levels in DRAM
+*/
+static size_t btree_dram_levels(const BTree *tree);
+
+/*
+    Is node placed in DRAM
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - node id
+
+    RETURN
+    true iff accesses to node are charged as DRAM lines
+*/
+static ___inline___ bool btree_node_in_dram(const BTree *tree, size_t node);
+
+/*
+    Start visit of node, from now reads are marked in line mask
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void btree_visit_begin(BTree *tree);
+
+/*
+    Mark bytes of visited node as read
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN offset - offset in node
+    @IN bytes - number of bytes
+
+    RETURN
+    This is a void function
+*/
+static void btree_visit_read(BTree *tree, size_t offset, size_t bytes);
+
+/*
+    Finish visit of node and charge PCM by each read line once
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - visited node
+
+    RETURN
+    Read time
+*/
+static pcm_time_t btree_visit_end(BTree *tree, size_t node);
+
+/*
+    Charge PCM by write of bytes in node
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - written node
+    @IN offset - offset in node
+    @IN bytes - number of bytes
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_charge_write(BTree *tree, size_t node, size_t offset, size_t bytes);
+
+/*
+    Write entry in its PCM layout: key, value and payload generated from key (payload moves with key)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @OUT dst - place of entry (entry_size bytes)
+    @IN key - key
+    @IN value - value
+
+    RETURN
+    This is a void function
+*/
+static void btree_image_entry(const BTree *tree, unsigned char *dst, btree_key_t key, size_t value);
+
+/*
+    Build image of node in PCM layout in tree->image, bytes without content keep content of region
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - node with place in region
+
+    RETURN
+    This is a void function
+*/
+static void btree_node_image(BTree *tree, size_t node);
+
+/*
+    Make sure that arena has place for nodes new nodes, so alloc during operation cannot fail
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN nodes - number of nodes
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int btree_reserve(BTree *tree, size_t nodes);
+
+/*
+    Allocate / free node in arena (place has to be reserved)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN level - level of new node (0 for leaf)
+    @IN node - node id
+
+    RETURN
+    Id of new node / This is a void function
+*/
+static size_t btree_node_alloc(BTree *tree, size_t level);
+static void btree_node_free(BTree *tree, size_t node);
+
+/*
+    Get bitmap of unsorted leaf
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf
+
+    RETURN
+    Pointer to first byte of bitmap
+*/
+static ___inline___ unsigned char *btree_node_bitmap(const BTree *tree, size_t leaf);
+
+/*
+    Offset of slot in unsorted leaf layout on PCM
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN slot - slot in leaf
+
+    RETURN
+    Offset in bytes from the beginning of leaf
+*/
+static ___inline___ size_t btree_uleaf_offset(const BTree *tree, size_t slot);
+
+/*
+    Is slot of unsorted leaf used
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf
+    @IN slot - slot in leaf
+
+    RETURN
+    true iff slot holds entry
+*/
+static ___inline___ bool btree_uleaf_used(const BTree *tree, size_t leaf, size_t slot);
+
+/*
+    Mark bitmap and the first bytes of each used slot of visited unsorted leaf as read
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf
+    @IN bytes - bytes read from each used slot
+
+    RETURN
+    This is a void function
+*/
+static void btree_uleaf_visit_slots(BTree *tree, size_t leaf, size_t bytes);
+
+/*
+    Scan visited unsorted leaf for key
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf
+    @IN key - key
+
+    RETURN
+    Slot with key iff key is in leaf
+    BTREE_SLOT_NULL iff key is not in leaf
+*/
+static size_t btree_uleaf_find(BTree *tree, size_t leaf, btree_key_t key);
+
+/*
+    Put entry into the first free slot of unsorted leaf, nothing is charged
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf with free slot
+    @IN key - key
+    @IN value - value
+
+    RETURN
+    Used slot
+*/
+static size_t btree_uleaf_store(BTree *tree, size_t leaf, btree_key_t key, btree_value_t value);
+
+/*
+    Put entry into unsorted leaf, slot and bitmap byte are charged
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf with free slot
+    @IN key - key
+    @IN value - value
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_uleaf_put(BTree *tree, size_t leaf, btree_key_t key, btree_value_t value);
+
+/*
+    Free slot of unsorted leaf, only bitmap byte is charged
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf
+    @IN slot - used slot
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_uleaf_remove(BTree *tree, size_t leaf, size_t slot);
+
+/*
+    Find slot with min / max key of unsorted leaf (keys are already read)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - non empty unsorted leaf
+    @IN max - true iff max key is wanted
+
+    RETURN
+    Slot with min / max key
+*/
+static size_t btree_uleaf_extreme(const BTree *tree, size_t leaf, bool max);
+
+/*
+    Count keys >= key in visited unsorted leaf
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf
+    @IN key - key
+
+    RETURN
+    Number of keys >= key
+*/
+static size_t btree_uleaf_count_from(const BTree *tree, size_t leaf, btree_key_t key);
+
+/*
+    Read all entries of unsorted leaf
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - unsorted leaf
+
+    RETURN
+    Read time
+*/
+static pcm_time_t btree_uleaf_read_all(BTree *tree, size_t leaf);
+
+/*
+    Get max key of non empty leaf (keys are in RAM)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - leaf
+
+    RETURN
+    Max key of leaf
+*/
+static btree_key_t btree_leaf_max_key(const BTree *tree, size_t leaf);
+
+/*
+    Size / offset of slot in overflow node
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN ovf - overflow node
+    @IN slot - slot in overflow node
+
+    RETURN
+    Size of slot / offset in bytes from the beginning of overflow node
+*/
+static ___inline___ size_t btree_overflow_slot_size(const BTree *tree, size_t ovf);
+static ___inline___ size_t btree_overflow_offset(const BTree *tree, size_t ovf, size_t slot);
+
+/*
+    Attach new overflow node to owner / release overflow node of owner
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN owner - leaf or inner
+
+    RETURN
+    Id of overflow node / This is a void function
+*/
+static size_t btree_overflow_alloc(BTree *tree, size_t owner);
+static void btree_overflow_free(BTree *tree, size_t owner);
+
+/*
+    Append pair to overflow node of owner (overflow is created if needed)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN owner - full leaf or inner
+    @IN key - key
+    @IN ptr - value or child
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_overflow_append(BTree *tree, size_t owner, btree_key_t key, size_t ptr);
+
+/*
+    Remove slot of overflow node, the last slot is moved into its place.
+    Empty overflow node is released
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN owner - owner of overflow node
+    @IN slot - slot to remove
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_overflow_remove(BTree *tree, size_t owner, size_t slot);
+
+/*
+    Read the first bytes of each slot of overflow node
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN owner - owner of overflow node
+    @IN bytes - bytes read from each slot
+
+    RETURN
+    Read time
+*/
+static pcm_time_t btree_overflow_read(BTree *tree, size_t owner, size_t bytes);
+
+/*
+    Find key / min or max key in overflow node (slots are already read)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN owner - owner of overflow node
+    @IN key - key
+    @IN max - true iff max key is wanted
+
+    RETURN
+    Slot of key iff key is in overflow
+    BTREE_SLOT_NULL iff key is not in overflow or there is no overflow
+*/
+static size_t btree_overflow_find(const BTree *tree, size_t owner, btree_key_t key);
+static size_t btree_overflow_extreme(const BTree *tree, size_t owner, bool max);
+
+/*
+    Move the last pair of overflow node into sorted owner, so owner stays full
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - leaf / inner with one free place
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_leaf_refill(BTree *tree, size_t leaf);
+static pcm_time_t btree_inner_refill(BTree *tree, size_t node);
+
+/*
+    Split full node together with its full overflow and new pair
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - full leaf or inner with full overflow
+    @IN key - new key
+    @IN ptr - new value or child
+    @OUT sep - separator of new node
+    @OUT new_node - new right node
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_split_overflow(BTree *tree, size_t node, btree_key_t key, size_t ptr, btree_key_t *sep, size_t *new_node);
+
+/*
+    Get logical pair of inner, pairs of sorted part go first, then pairs of overflow
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - inner
+    @IN idx - index of pair
+    @OUT key - separator
+    @OUT child - child on the right of separator
+
+    RETURN
+    This is a void function
+*/
+static void btree_inner_pair(const BTree *tree, size_t node, size_t idx, btree_key_t *key, size_t *child);
+
+/*
+    Number of logical pairs of inner
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - inner
+
+    RETURN
+    Keys in inner and its overflow
+*/
+static size_t btree_inner_pairs(const BTree *tree, size_t node);
+
+/*
+    Find logical pair of child
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - inner
+    @IN child - child of inner
+
+    RETURN
+    Index of pair with child
+    BTREE_SLOT_NULL iff child is the first child (it has no separator)
+*/
+static size_t btree_inner_pair_of(const BTree *tree, size_t node, size_t child);
+
+/*
+    Find the child of inner with overflow to follow (sorted part is already searched)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - inner with overflow
+    @IN i - position of child found in sorted part
+    @IN key - key
+    @OUT time - read time of overflow is added here
+
+    RETURN
+    Child which can contain key
+*/
+static size_t btree_inner_overflow_child(BTree *tree, size_t node, size_t i, btree_key_t key, pcm_time_t *time);
+
+/*
+    Find neighbours of child in key order (overflow of parent is also taken into account)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN parent - parent
+    @IN i - position of child in sorted part of parent (used iff parent has no overflow)
+    @IN node - child
+    @OUT left - left sibling or BTREE_NODE_NULL
+    @OUT right - right sibling or BTREE_NODE_NULL
+
+    RETURN
+    This is a void function
+*/
+static void btree_inner_siblings(const BTree *tree, size_t parent, size_t i, size_t node, size_t *left, size_t *right);
+
+/*
+    Set separator of child in parent
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN parent - parent
+    @IN child - child with separator
+    @IN key - new separator
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_inner_set_sep(BTree *tree, size_t parent, size_t child, btree_key_t key);
+
+/*
+    Remove child with its separator from parent
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN parent - parent
+    @IN child - child with separator
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_inner_remove_child(BTree *tree, size_t parent, size_t child);
+
+/*
+    Take min / max entry of leaf (overflow is also taken into account)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - sorted leaf
+    @IN max - true iff max entry is taken
+    @OUT key - key of entry
+    @OUT value - value of entry
+
+    RETURN
+    Access time
+*/
+static pcm_time_t btree_leaf_take(BTree *tree, size_t leaf, bool max, btree_key_t *key, btree_value_t *value);
+
+/*
+    Get min key of non empty leaf (keys are in RAM)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - leaf
+
+    RETURN
+    Min key of leaf
+*/
+static btree_key_t btree_leaf_min_key(const BTree *tree, size_t leaf);
+
+/*
+    Compare pairs by key for qsort
+
+    PARAMS
+    @IN a - pointer to the first pair
+    @IN b - pointer to the second pair
+
+    RETURN
+    -1 iff a < b
+    0 iff a == b
+    1 iff a > b
+*/
+static int btree_pair_cmp(const void *a, const void *b);
+
+/*
+    Binary search in visited leaf
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - leaf
+    @IN key - key
+
+    RETURN
+    Position of the first key >= key
+*/
+static size_t btree_leaf_lower_bound(BTree *tree, size_t node, btree_key_t key);
+
+/*
+    Binary search in visited inner
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - inner
+    @IN key - key
+
+    RETURN
+    Position of child which can contain key
+*/
+static size_t btree_inner_find_child(BTree *tree, size_t node, btree_key_t key);
+
+/*
+    Go from root to leaf
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN key - key
+    @OUT path - visited inners
+    @OUT pos - position of followed child in each inner
+    @OUT depth - number of visited inners
+    @OUT time - read time is added here
+
+    RETURN
+    Leaf which can contain key
+*/
+static size_t btree_find_leaf(BTree *tree, btree_key_t key, size_t *path, size_t *pos, size_t *depth, pcm_time_t *time);
+
+/*
+    Go from root to the last leaf (path of bulkload is cached, so it is not charged)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @OUT path - visited inners
+    @OUT pos - position of followed child in each inner
+    @OUT depth - number of visited inners
+
+    RETURN
+    The last leaf
+*/
+static size_t btree_find_last_leaf(const BTree *tree, size_t *path, size_t *pos, size_t *depth);
+
+/*
+    Insert separator and right node into parent of left node, split parents if needed
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN left - left (old) node
+    @IN sep - separator (the first key in right node)
+    @IN right - right (new) node
+    @IN path - inners from root to parent of left
+    @IN pos - position of left in each inner
+    @IN depth - number of inners in path
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_insert_into_parent(BTree *tree, size_t left, btree_key_t sep, size_t right, const size_t *path, const size_t *pos, size_t depth);
+
+/*
+    Split leaf with capacity + 1 entries
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - leaf to split
+    @IN i - position of new entry
+    @IN path - inners from root to parent of leaf
+    @IN pos - position of child in each inner
+    @IN depth - number of inners in path
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_split_leaf(BTree *tree, size_t leaf, size_t i, const size_t *path, const size_t *pos, size_t depth);
+
+/*
+    Split full unsorted leaf with new entry, keys >= median are moved to new leaf
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN leaf - full unsorted leaf
+    @IN key - new key
+    @IN value - new value
+    @IN path - inners from root to parent of leaf
+    @IN pos - position of child in each inner
+    @IN depth - number of inners in path
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_uleaf_split(BTree *tree, size_t leaf, btree_key_t key, btree_value_t value, const size_t *path, const size_t *pos, size_t depth);
+
+/*
+    Borrow entry for underfilled leaf from its sibling
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - underfilled leaf
+    @IN parent - parent of leaf
+    @IN left - left sibling (can be BTREE_NODE_NULL)
+    @IN right - right sibling (can be BTREE_NODE_NULL)
+    @IN min - min number of entries in leaf
+    @OUT time - write time is added here
+
+    RETURN
+    true iff entry has been borrowed
+*/
+static bool btree_leaf_borrow(BTree *tree, size_t node, size_t parent, size_t left, size_t right, size_t min, pcm_time_t *time);
+static bool btree_uleaf_borrow(BTree *tree, size_t node, size_t parent, size_t left, size_t right, size_t min, pcm_time_t *time);
+
+/*
+    Move entries of right leaf into left leaf
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN left - left leaf
+    @IN right - right leaf
+
+    RETURN
+    Merge time
+*/
+static pcm_time_t btree_leaf_merge(BTree *tree, size_t left, size_t right);
+static pcm_time_t btree_uleaf_merge(BTree *tree, size_t left, size_t right);
+
+/*
+    Compare keys for qsort
+
+    PARAMS
+    @IN a - pointer to the first key
+    @IN b - pointer to the second key
+
+    RETURN
+    -1 iff a < b
+    0 iff a == b
+    1 iff a > b
+*/
+static int btree_key_cmp(const void *a, const void *b);
+
+/*
+    Remove key i and child i + 1 from inner
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - inner
+    @IN i - position of key
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_inner_remove(BTree *tree, size_t node, size_t i);
+
+/*
+    Rotate child of sibling into underfilled inner if the child is referenced from overflow of sibling
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - underfilled inner
+    @IN parent - parent of inner
+    @IN i - position of inner in parent
+    @IN sibling - sibling which can lend a child
+    @IN from_left - true iff sibling is on the left
+    @OUT time - access time is added here
+
+    RETURN
+    true iff child has been rotated from overflow
+*/
+static bool btree_inner_rotate_overflow(BTree *tree, size_t node, size_t parent, size_t i, size_t sibling, bool from_left, pcm_time_t *time);
+
+/*
+    Fix underflow of node after delete (borrow from sibling or merge with sibling)
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN node - node after delete
+    @IN path - inners from root to parent of node
+    @IN pos - position of child in each inner
+    @IN depth - number of inners in path
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_rebalance(BTree *tree, size_t node, const size_t *path, const size_t *pos, size_t depth);
+
+/*
+    Build levels of inners over nodes
+
+    PARAMS
+    @IN tree - pointer to B+Tree
+    @IN nodes - nodes of level (overwritten by next levels)
+    @IN min_keys - min key of each node (overwritten by next levels)
+    @IN n - number of nodes
+    @IN children - children per inner
+
+    RETURN
+    Write time
+*/
+static pcm_time_t btree_build_inners(BTree *tree, size_t *nodes, btree_key_t *min_keys, size_t n, size_t children);
+
+static ___inline___ btree_key_t *btree_node_keys(const BTree *tree, size_t node)
+{
+    return &tree->keys[node * tree->node_slots];
+}
+
+static ___inline___ size_t *btree_node_ptrs(const BTree *tree, size_t node)
+{
+    return &tree->ptrs[node * (tree->node_slots + 1)];
+}
+
+static ___inline___ unsigned char *btree_node_bitmap(const BTree *tree, size_t leaf)
+{
+    return &tree->bitmaps[leaf * tree->bitmap_size];
+}
+
+static ___inline___ size_t btree_leaf_offset(const BTree *tree, size_t i)
+{
+    return i * tree->entry_size;
+}
+
+static ___inline___ size_t btree_uleaf_offset(const BTree *tree, size_t slot)
+{
+    return tree->bitmap_size + slot * tree->entry_size;
+}
+
+static ___inline___ bool btree_uleaf_used(const BTree *tree, size_t leaf, size_t slot)
+{
+    return (btree_node_bitmap(tree, leaf)[slot / 8] >> (slot % 8)) & 1;
+}
+
+static ___inline___ size_t btree_inner_key_offset(const BTree *tree, size_t i)
+{
+    return BTREE_PTR_SIZE + i * (tree->key_size + BTREE_PTR_SIZE);
+}
+
+static ___inline___ size_t btree_inner_child_offset(const BTree *tree, size_t i)
+{
+    if (i == 0)
+        return 0;
+
+    return btree_inner_key_offset(tree, i - 1) + tree->key_size;
+}
+
+static ___inline___ size_t btree_span_lines(const BTree *tree, size_t offset, size_t bytes)
+{
+    if (bytes == 0)
+        return 0;
+
+    return (offset + bytes - 1) / tree->pcm->mem_line - offset / tree->pcm->mem_line + 1;
+}
+
+static size_t btree_dram_levels(const BTree *tree)
+{
+    const size_t inner_levels = tree->height > 1 ? tree->height - 1 : 0;
+    const size_t levels = MIN(tree->dram_levels, inner_levels);
+    size_t bytes = 0;
+    size_t i;
+
+    if (tree->dram_budget == 0)
+        return levels;
+
+    /* levels are taken from root while they fit in budget */
+    for (i = 0; i < levels; ++i)
+    {
+        bytes += tree->level_nodes[tree->height - 1 - i] * tree->node_stride;
+        if (bytes > tree->dram_budget)
+            return i;
+    }
+
+    return levels;
+}
+
+static ___inline___ bool btree_node_in_dram(const BTree *tree, size_t node)
+{
+    const size_t levels = tree->dram_levels == 0 ? 0 : btree_dram_levels(tree);
+
+    return levels > 0 && !tree->nodes[node].leaf && tree->nodes[node].level + levels >= tree->height;
+}
+
+static ___inline___ void btree_visit_begin(BTree *tree)
+{
+    (void)memset(tree->line_mask, 0, tree->line_mask_words * sizeof(*tree->line_mask));
+}
+
+static void btree_visit_read(BTree *tree, size_t offset, size_t bytes)
+{
+    size_t line;
+    size_t last;
+
+    if (bytes == 0)
+        return;
+
+    last = (offset + bytes - 1) / tree->pcm->mem_line;
+    for (line = offset / tree->pcm->mem_line; line <= last; ++line)
+        tree->line_mask[line / BTREE_MASK_BITS] |= 1ULL << (line % BTREE_MASK_BITS);
+}
+
+static pcm_time_t btree_visit_end(BTree *tree, size_t node)
+{
+    const size_t mask_lines = tree->line_mask_words * BTREE_MASK_BITS;
+    pcm_time_t time = 0;
+    size_t lines = 0;
+    size_t first;
+    size_t i;
+
+    if (btree_node_in_dram(tree, node))
+    {
+        for (i = 0; i < tree->line_mask_words; ++i)
+            lines += (size_t)__builtin_popcountll(tree->line_mask[i]);
+
+        tree->dram_lines_read += lines;
+        return (pcm_time_t)lines * tree->dram_time;
+    }
+
+    if (tree->nodes[node].addr == PCM_NO_ADDR)
+    {
+        for (i = 0; i < tree->line_mask_words; ++i)
+            lines += (size_t)__builtin_popcountll(tree->line_mask[i]);
+
+        return pcm_read_lines(tree->pcm, lines);
+    }
+
+    /* each run of read lines is issued at once, so banks serve its lines in parallel and cache sees them (also in trace) */
+    for (i = 0; i < mask_lines; ++i)
+    {
+        if (!((tree->line_mask[i / BTREE_MASK_BITS] >> (i % BTREE_MASK_BITS)) & 1ULL))
+            continue;
+
+        for (first = i; i + 1 < mask_lines && ((tree->line_mask[(i + 1) / BTREE_MASK_BITS] >> ((i + 1) % BTREE_MASK_BITS)) & 1ULL); ++i)
+            ;
+
+        time += pcm_read_at(tree->pcm, tree->nodes[node].addr + first * tree->pcm->mem_line, (i - first + 1) * tree->pcm->mem_line);
+    }
+
+    return time;
+}
+
+static void btree_image_entry(const BTree *tree, unsigned char *dst, btree_key_t key, size_t value)
+{
+    const size_t key_bytes = MIN(tree->key_size, sizeof(key));
+    const size_t value_bytes = MIN(tree->entry_size - tree->key_size, sizeof(value));
+    unsigned long long payload = key * 0x9e3779b97f4a7c15ULL;
+    size_t i;
+
+    (void)memset(dst, 0, tree->key_size);
+    (void)memcpy(dst, &key, key_bytes);
+    (void)memcpy(dst + tree->key_size, &value, value_bytes);
+
+    for (i = tree->key_size + value_bytes; i < tree->entry_size; ++i)
+    {
+        dst[i] = (unsigned char)(payload >> ((i % 8) * 8));
+        if (i % 8 == 7)
+            payload ^= payload >> 29;
+    }
+}
+
+static void btree_node_image(BTree *tree, size_t node)
+{
+    const BTreeNode *n = &tree->nodes[node];
+    const btree_key_t *keys = btree_node_keys(tree, node);
+    const size_t *ptrs = btree_node_ptrs(tree, node);
+    const size_t pair_size = tree->key_size + BTREE_PTR_SIZE;
+    unsigned char *image = tree->image;
+    size_t i;
+
+    (void)memcpy(image, pcm_region_ptr(tree->pcm, n->addr), tree->node_stride);
+
+    if (n->is_overflow)
+    {
+        for (i = 0; i < n->count && (i + 1) * btree_overflow_slot_size(tree, node) <= tree->node_stride; ++i)
+            if (n->leaf)
+                btree_image_entry(tree, image + btree_overflow_offset(tree, node, i), keys[i], ptrs[i]);
+            else
+            {
+                (void)memset(image + btree_overflow_offset(tree, node, i), 0, pair_size);
+                (void)memcpy(image + btree_overflow_offset(tree, node, i), &keys[i], MIN(tree->key_size, sizeof(*keys)));
+                (void)memcpy(image + btree_overflow_offset(tree, node, i) + tree->key_size, &ptrs[i], BTREE_PTR_SIZE);
+            }
+    }
+    else if (n->leaf && tree->unsorted_leaves)
+    {
+        (void)memcpy(image, btree_node_bitmap(tree, node), tree->bitmap_size);
+        for (i = 0; i < tree->leaf_capacity; ++i)
+            if (btree_uleaf_used(tree, node, i))
+                btree_image_entry(tree, image + btree_uleaf_offset(tree, i), keys[i], ptrs[i]);
+    }
+    else if (n->leaf)
+    {
+        for (i = 0; i < n->count && btree_leaf_offset(tree, i + 1) <= tree->node_stride; ++i)
+            btree_image_entry(tree, image + btree_leaf_offset(tree, i), keys[i], ptrs[i]);
+    }
+    else
+    {
+        (void)memcpy(image, &ptrs[0], BTREE_PTR_SIZE);
+        for (i = 0; i < n->count && btree_inner_key_offset(tree, i) + pair_size <= tree->node_stride; ++i)
+        {
+            (void)memset(image + btree_inner_key_offset(tree, i), 0, tree->key_size);
+            (void)memcpy(image + btree_inner_key_offset(tree, i), &keys[i], MIN(tree->key_size, sizeof(*keys)));
+            (void)memcpy(image + btree_inner_child_offset(tree, i + 1), &ptrs[i + 1], BTREE_PTR_SIZE);
+        }
+    }
+}
+
+static pcm_time_t btree_charge_write(BTree *tree, size_t node, size_t offset, size_t bytes)
+{
+    size_t stored;
+    size_t lines;
+
+    if (bytes == 0)
+        return 0;
+
+    if (btree_node_in_dram(tree, node))
+    {
+        lines = btree_span_lines(tree, offset, bytes);
+        tree->dram_lines_written += lines;
+
+        return (pcm_time_t)lines * tree->dram_time;
+    }
+
+    if (tree->nodes[node].addr != PCM_NO_ADDR && tree->pcm->write_mode != PCM_WRITE_FULL && offset < tree->node_stride)
+    {
+        /* content-aware PCM compares new content of node with region */
+        btree_node_image(tree, node);
+        stored = MIN(bytes, tree->node_stride - offset);
+
+        return pcm_store_at(tree->pcm, tree->nodes[node].addr + offset, tree->image + offset, stored) +
+               (bytes > stored ? pcm_write_at(tree->pcm, tree->nodes[node].addr + offset + stored, bytes - stored) : 0);
+    }
+
+    if (tree->nodes[node].addr != PCM_NO_ADDR)
+        return pcm_write_at(tree->pcm, tree->nodes[node].addr + offset, bytes);
+
+    return pcm_write_lines(tree->pcm, btree_span_lines(tree, offset, bytes), bytes);
+}
+
+static int btree_reserve(BTree *tree, size_t nodes)
+{
+    BTreeNode *new_nodes;
+    btree_key_t *new_keys;
+    size_t *new_ptrs;
+    unsigned char *new_bitmaps;
+    size_t capacity;
+
+    if (tree->nodes_used + nodes <= tree->nodes_capacity)
+        return 0;
+
+    capacity = MAX(tree->nodes_capacity * 2, tree->nodes_used + nodes);
+
+    new_nodes = realloc(tree->nodes, capacity * sizeof(*new_nodes));
+    if (new_nodes == NULL)
+        ERROR("realloc error\n", 1);
+
+    tree->nodes = new_nodes;
+
+    new_keys = realloc(tree->keys, capacity * tree->node_slots * sizeof(*new_keys));
+    if (new_keys == NULL)
+        ERROR("realloc error\n", 1);
+
+    tree->keys = new_keys;
+
+    new_ptrs = realloc(tree->ptrs, capacity * (tree->node_slots + 1) * sizeof(*new_ptrs));
+    if (new_ptrs == NULL)
+        ERROR("realloc error\n", 1);
+
+    tree->ptrs = new_ptrs;
+
+    if (tree->bitmap_size > 0)
+    {
+        new_bitmaps = realloc(tree->bitmaps, capacity * tree->bitmap_size);
+        if (new_bitmaps == NULL)
+            ERROR("realloc error\n", 1);
+
+        tree->bitmaps = new_bitmaps;
+    }
+
+    tree->nodes_capacity = capacity;
+
+    return 0;
+}
+
+static size_t btree_node_alloc(BTree *tree, size_t level)
+{
+    size_t node;
+
+    if (tree->free_nodes != BTREE_NODE_NULL)
+    {
+        node = tree->free_nodes;
+        tree->free_nodes = tree->nodes[node].next;
+    }
+    else
+    {
+        node = tree->nodes_used++;
+
+        /* freed node keeps its place in region */
+        if (tree->pcm->region == NULL || pcm_alloc(tree->pcm, tree->node_stride, &tree->nodes[node].addr))
+            tree->nodes[node].addr = PCM_NO_ADDR;
+    }
+
+    tree->nodes[node].count = 0;
+    tree->nodes[node].next = BTREE_NODE_NULL;
+    tree->nodes[node].overflow = BTREE_NODE_NULL;
+    tree->nodes[node].level = level;
+    tree->nodes[node].leaf = level == 0;
+    tree->nodes[node].is_overflow = false;
+
+    ++tree->level_nodes[level];
+    if (level == 0)
+        ++tree->leaves;
+    else
+        ++tree->inners;
+
+    if (level == 0 && tree->unsorted_leaves)
+        (void)memset(btree_node_bitmap(tree, node), 0, tree->bitmap_size);
+
+    return node;
+}
+
+static void btree_node_free(BTree *tree, size_t node)
+{
+    --tree->level_nodes[tree->nodes[node].level];
+    if (tree->nodes[node].leaf)
+        --tree->leaves;
+    else
+        --tree->inners;
+
+    tree->nodes[node].count = 0;
+    tree->nodes[node].next = tree->free_nodes;
+    tree->free_nodes = node;
+}
+
+static void btree_uleaf_visit_slots(BTree *tree, size_t leaf, size_t bytes)
+{
+    size_t slot;
+
+    btree_visit_read(tree, 0, tree->bitmap_size);
+    for (slot = 0; slot < tree->leaf_capacity; ++slot)
+        if (btree_uleaf_used(tree, leaf, slot))
+            btree_visit_read(tree, btree_uleaf_offset(tree, slot), bytes);
+}
+
+static size_t btree_uleaf_find(BTree *tree, size_t leaf, btree_key_t key)
+{
+    const btree_key_t *keys = btree_node_keys(tree, leaf);
+    btree_key_vec_t needle;
+    btree_key_vec_t vec;
+    btree_mask_vec_t eq;
+    long lanes[BTREE_VEC_LANES];
+    size_t slot;
+    size_t j;
+
+    btree_uleaf_visit_slots(tree, leaf, tree->key_size);
+
+    for (j = 0; j < BTREE_VEC_LANES; ++j)
+        needle[j] = key;
+
+    /* free slots can hold stale keys, so each hit is checked in bitmap */
+    for (slot = 0; slot + BTREE_VEC_LANES <= tree->leaf_capacity; slot += BTREE_VEC_LANES)
+    {
+        (void)memcpy(&vec, &keys[slot], sizeof(vec));
+        eq = vec == needle;
+        (void)memcpy(lanes, &eq, sizeof(lanes));
+
+        for (j = 0; j < BTREE_VEC_LANES; ++j)
+            if (lanes[j] != 0 && btree_uleaf_used(tree, leaf, slot + j))
+                return slot + j;
+    }
+
+    for (; slot < tree->leaf_capacity; ++slot)
+        if (keys[slot] == key && btree_uleaf_used(tree, leaf, slot))
+            return slot;
+
+    return BTREE_SLOT_NULL;
+}
+
+static size_t btree_uleaf_store(BTree *tree, size_t leaf, btree_key_t key, btree_value_t value)
+{
+    unsigned char *bitmap = btree_node_bitmap(tree, leaf);
+    size_t slot = BTREE_SLOT_NULL;
+    size_t i;
+
+    for (i = 0; i < tree->bitmap_size; ++i)
+        if (bitmap[i] != 0xff)
+        {
+            slot = i * 8 + (size_t)__builtin_ctz(~(unsigned int)bitmap[i]);
+            break;
+        }
+
+    bitmap[slot / 8] = (unsigned char)(bitmap[slot / 8] | (1U << (slot % 8)));
+    btree_node_keys(tree, leaf)[slot] = key;
+    btree_node_ptrs(tree, leaf)[slot] = value;
+    ++tree->nodes[leaf].count;
+
+    return slot;
+}
+
+static pcm_time_t btree_uleaf_put(BTree *tree, size_t leaf, btree_key_t key, btree_value_t value)
+{
+    const size_t slot = btree_uleaf_store(tree, leaf, key, value);
+
+    return btree_charge_write(tree, leaf, btree_uleaf_offset(tree, slot), tree->entry_size) +
+           btree_charge_write(tree, leaf, slot / 8, 1);
+}
+
+static pcm_time_t btree_uleaf_remove(BTree *tree, size_t leaf, size_t slot)
+{
+    unsigned char *bitmap = btree_node_bitmap(tree, leaf);
+
+    bitmap[slot / 8] = (unsigned char)(bitmap[slot / 8] & ~(1U << (slot % 8)));
+    --tree->nodes[leaf].count;
+
+    return btree_charge_write(tree, leaf, slot / 8, 1);
+}
+
+static size_t btree_uleaf_extreme(const BTree *tree, size_t leaf, bool max)
+{
+    const btree_key_t *keys = btree_node_keys(tree, leaf);
+    size_t best = BTREE_SLOT_NULL;
+    size_t slot;
+
+    for (slot = 0; slot < tree->leaf_capacity; ++slot)
+        if (btree_uleaf_used(tree, leaf, slot) && (best == BTREE_SLOT_NULL || (max ? keys[slot] > keys[best] : keys[slot] < keys[best])))
+            best = slot;
+
+    return best;
+}
+
+static size_t btree_uleaf_count_from(const BTree *tree, size_t leaf, btree_key_t key)
+{
+    const btree_key_t *keys = btree_node_keys(tree, leaf);
+    size_t k = 0;
+    size_t slot;
+
+    for (slot = 0; slot < tree->leaf_capacity; ++slot)
+        if (btree_uleaf_used(tree, leaf, slot) && keys[slot] >= key)
+            ++k;
+
+    return k;
+}
+
+static pcm_time_t btree_uleaf_read_all(BTree *tree, size_t leaf)
+{
+    btree_visit_begin(tree);
+    btree_uleaf_visit_slots(tree, leaf, tree->entry_size);
+
+    return btree_visit_end(tree, leaf);
+}
+
+static btree_key_t btree_leaf_max_key(const BTree *tree, size_t leaf)
+{
+    const size_t slot = btree_overflow_extreme(tree, leaf, true);
+    btree_key_t key;
+
+    if (tree->unsorted_leaves)
+        return btree_node_keys(tree, leaf)[btree_uleaf_extreme(tree, leaf, true)];
+
+    key = btree_node_keys(tree, leaf)[tree->nodes[leaf].count - 1];
+    if (slot != BTREE_SLOT_NULL && btree_node_keys(tree, tree->nodes[leaf].overflow)[slot] > key)
+        return btree_node_keys(tree, tree->nodes[leaf].overflow)[slot];
+
+    return key;
+}
+
+static ___inline___ size_t btree_overflow_slot_size(const BTree *tree, size_t ovf)
+{
+    return tree->nodes[ovf].leaf ? tree->entry_size : tree->key_size + BTREE_PTR_SIZE;
+}
+
+static ___inline___ size_t btree_overflow_offset(const BTree *tree, size_t ovf, size_t slot)
+{
+    return slot * btree_overflow_slot_size(tree, ovf);
+}
+
+static size_t btree_overflow_alloc(BTree *tree, size_t owner)
+{
+    const size_t ovf = btree_node_alloc(tree, tree->nodes[owner].level);
+
+    /* overflow nodes are counted apart from leaves and inners */
+    if (tree->nodes[ovf].leaf)
+        --tree->leaves;
+    else
+        --tree->inners;
+
+    ++tree->overflows;
+    tree->nodes[owner].overflow = ovf;
+    tree->nodes[ovf].is_overflow = true;
+
+    return ovf;
+}
+
+static void btree_overflow_free(BTree *tree, size_t owner)
+{
+    const size_t ovf = tree->nodes[owner].overflow;
+
+    if (tree->nodes[ovf].leaf)
+        ++tree->leaves;
+    else
+        ++tree->inners;
+
+    --tree->overflows;
+    btree_node_free(tree, ovf);
+    tree->nodes[owner].overflow = BTREE_NODE_NULL;
+}
+
+static pcm_time_t btree_overflow_append(BTree *tree, size_t owner, btree_key_t key, size_t ptr)
+{
+    size_t ovf = tree->nodes[owner].overflow;
+    size_t slot;
+
+    if (ovf == BTREE_NODE_NULL)
+        ovf = btree_overflow_alloc(tree, owner);
+
+    slot = tree->nodes[ovf].count++;
+    btree_node_keys(tree, ovf)[slot] = key;
+    btree_node_ptrs(tree, ovf)[slot] = ptr;
+
+    return btree_charge_write(tree, ovf, btree_overflow_offset(tree, ovf, slot), btree_overflow_slot_size(tree, ovf));
+}
+
+static pcm_time_t btree_overflow_remove(BTree *tree, size_t owner, size_t slot)
+{
+    const size_t ovf = tree->nodes[owner].overflow;
+    const size_t last = --tree->nodes[ovf].count;
+    pcm_time_t time = 0;
+
+    if (slot != last)
+    {
+        btree_node_keys(tree, ovf)[slot] = btree_node_keys(tree, ovf)[last];
+        btree_node_ptrs(tree, ovf)[slot] = btree_node_ptrs(tree, ovf)[last];
+        time = btree_charge_write(tree, ovf, btree_overflow_offset(tree, ovf, slot), btree_overflow_slot_size(tree, ovf));
+    }
+
+    if (last == 0)
+        btree_overflow_free(tree, owner);
+
+    return time;
+}
+
+static pcm_time_t btree_overflow_read(BTree *tree, size_t owner, size_t bytes)
+{
+    const size_t ovf = tree->nodes[owner].overflow;
+    size_t slot;
+
+    btree_visit_begin(tree);
+    for (slot = 0; slot < tree->nodes[ovf].count; ++slot)
+        btree_visit_read(tree, btree_overflow_offset(tree, ovf, slot), bytes);
+
+    return btree_visit_end(tree, ovf);
+}
+
+static size_t btree_overflow_find(const BTree *tree, size_t owner, btree_key_t key)
+{
+    const size_t ovf = tree->nodes[owner].overflow;
+    size_t slot;
+
+    if (ovf == BTREE_NODE_NULL)
+        return BTREE_SLOT_NULL;
+
+    for (slot = 0; slot < tree->nodes[ovf].count; ++slot)
+        if (btree_node_keys(tree, ovf)[slot] == key)
+            return slot;
+
+    return BTREE_SLOT_NULL;
+}
+
+static size_t btree_overflow_extreme(const BTree *tree, size_t owner, bool max)
+{
+    const size_t ovf = tree->nodes[owner].overflow;
+    const btree_key_t *keys;
+    size_t best = BTREE_SLOT_NULL;
+    size_t slot;
+
+    if (ovf == BTREE_NODE_NULL)
+        return BTREE_SLOT_NULL;
+
+    keys = btree_node_keys(tree, ovf);
+    for (slot = 0; slot < tree->nodes[ovf].count; ++slot)
+        if (best == BTREE_SLOT_NULL || (max ? keys[slot] > keys[best] : keys[slot] < keys[best]))
+            best = slot;
+
+    return best;
+}
+
+static pcm_time_t btree_leaf_refill(BTree *tree, size_t leaf)
+{
+    const size_t ovf = tree->nodes[leaf].overflow;
+    btree_key_t *keys = btree_node_keys(tree, leaf);
+    size_t *values = btree_node_ptrs(tree, leaf);
+    const size_t n = tree->nodes[leaf].count;
+    btree_key_t key;
+    size_t last;
+    size_t j;
+
+    if (ovf == BTREE_NODE_NULL)
+        return 0;
+
+    last = tree->nodes[ovf].count - 1;
+    key = btree_node_keys(tree, ovf)[last];
+
+    for (j = n; j > 0 && keys[j - 1] > key; --j)
+        ;
+
+    (void)memmove(&keys[j + 1], &keys[j], (n - j) * sizeof(*keys));
+    (void)memmove(&values[j + 1], &values[j], (n - j) * sizeof(*values));
+    keys[j] = key;
+    values[j] = btree_node_ptrs(tree, ovf)[last];
+    tree->nodes[leaf].count = n + 1;
+
+    return btree_charge_write(tree, leaf, btree_leaf_offset(tree, j), (n + 1 - j) * tree->entry_size) +
+           btree_overflow_remove(tree, leaf, last);
+}
+
+static pcm_time_t btree_inner_refill(BTree *tree, size_t node)
+{
+    const size_t ovf = tree->nodes[node].overflow;
+    btree_key_t *keys = btree_node_keys(tree, node);
+    size_t *ptrs = btree_node_ptrs(tree, node);
+    const size_t n = tree->nodes[node].count;
+    btree_key_t key;
+    size_t last;
+    size_t j;
+
+    if (ovf == BTREE_NODE_NULL)
+        return 0;
+
+    last = tree->nodes[ovf].count - 1;
+    key = btree_node_keys(tree, ovf)[last];
+
+    for (j = n; j > 0 && keys[j - 1] > key; --j)
+        ;
+
+    (void)memmove(&keys[j + 1], &keys[j], (n - j) * sizeof(*keys));
+    (void)memmove(&ptrs[j + 2], &ptrs[j + 1], (n - j) * sizeof(*ptrs));
+    keys[j] = key;
+    ptrs[j + 1] = btree_node_ptrs(tree, ovf)[last];
+    tree->nodes[node].count = n + 1;
+
+    return btree_charge_write(tree, node, btree_inner_key_offset(tree, j), (n + 1 - j) * (tree->key_size + BTREE_PTR_SIZE)) +
+           btree_overflow_remove(tree, node, last);
+}
+
+static pcm_time_t btree_split_overflow(BTree *tree, size_t node, btree_key_t key, size_t ptr, btree_key_t *sep, size_t *new_node)
+{
+    pcm_time_t time = 0;
+    const bool leaf = tree->nodes[node].leaf;
+    const size_t ovf = tree->nodes[node].overflow;
+    const size_t n = tree->nodes[node].count;
+    const size_t base = leaf ? 0 : 1; /* inner keeps its first child */
+    btree_key_t *keys = btree_node_keys(tree, node);
+    size_t *ptrs = btree_node_ptrs(tree, node);
+    btree_key_t *rkeys;
+    size_t *rptrs;
+    size_t total = 0;
+    size_t first;
+    size_t right;
+    size_t l;
+    size_t j;
+
+    for (j = 0; j < n; ++j)
+    {
+        tree->pairs[total].key = keys[j];
+        tree->pairs[total].ptr = ptrs[j + base];
+        ++total;
+    }
+
+    for (j = 0; j < tree->nodes[ovf].count; ++j)
+    {
+        tree->pairs[total].key = btree_node_keys(tree, ovf)[j];
+        tree->pairs[total].ptr = btree_node_ptrs(tree, ovf)[j];
+        ++total;
+    }
+
+    tree->pairs[total].key = key;
+    tree->pairs[total].ptr = ptr;
+    ++total;
+
+    qsort(tree->pairs, total, sizeof(*tree->pairs), btree_pair_cmp);
+    btree_overflow_free(tree, node);
+
+    /* prefix of node which is not changed is not written */
+    l = total / 2;
+    for (first = 0; first < MIN(n, l) && keys[first] == tree->pairs[first].key; ++first)
+        ;
+
+    right = btree_node_alloc(tree, tree->nodes[node].level);
+    rkeys = btree_node_keys(tree, right);
+    rptrs = btree_node_ptrs(tree, right);
+
+    for (j = 0; j < l; ++j)
+    {
+        keys[j] = tree->pairs[j].key;
+        ptrs[j + base] = tree->pairs[j].ptr;
+    }
+    tree->nodes[node].count = l;
+    *sep = tree->pairs[l].key;
+
+    if (leaf)
+    {
+        for (j = l; j < total; ++j)
+        {
+            rkeys[j - l] = tree->pairs[j].key;
+            rptrs[j - l] = tree->pairs[j].ptr;
+        }
+        tree->nodes[right].count = total - l;
+
+        tree->nodes[right].next = tree->nodes[node].next;
+        tree->nodes[node].next = right;
+
+        time += btree_charge_write(tree, node, btree_leaf_offset(tree, first), (l - first) * tree->entry_size);
+        time += btree_charge_write(tree, right, 0, (total - l) * tree->entry_size);
+    }
+    else
+    {
+        /* separator goes to parent, its child is the first child of right */
+        rptrs[0] = tree->pairs[l].ptr;
+        for (j = l + 1; j < total; ++j)
+        {
+            rkeys[j - l - 1] = tree->pairs[j].key;
+            rptrs[j - l] = tree->pairs[j].ptr;
+        }
+        tree->nodes[right].count = total - l - 1;
+
+        time += btree_charge_write(tree, node, btree_inner_key_offset(tree, first), (l - first) * (tree->key_size + BTREE_PTR_SIZE));
+        time += btree_charge_write(tree, right, 0, btree_inner_key_offset(tree, total - l - 1));
+    }
+
+    *new_node = right;
+    return time;
+}
+
+static void btree_inner_pair(const BTree *tree, size_t node, size_t idx, btree_key_t *key, size_t *child)
+{
+    const size_t n = tree->nodes[node].count;
+
+    if (idx < n)
+    {
+        *key = btree_node_keys(tree, node)[idx];
+        *child = btree_node_ptrs(tree, node)[idx + 1];
+    }
+    else
+    {
+        *key = btree_node_keys(tree, tree->nodes[node].overflow)[idx - n];
+        *child = btree_node_ptrs(tree, tree->nodes[node].overflow)[idx - n];
+    }
+}
+
+static size_t btree_inner_pairs(const BTree *tree, size_t node)
+{
+    const size_t ovf = tree->nodes[node].overflow;
+
+    return tree->nodes[node].count + (ovf == BTREE_NODE_NULL ? 0 : tree->nodes[ovf].count);
+}
+
+static size_t btree_inner_pair_of(const BTree *tree, size_t node, size_t child)
+{
+    const size_t pairs = btree_inner_pairs(tree, node);
+    btree_key_t key;
+    size_t c;
+    size_t idx;
+
+    for (idx = 0; idx < pairs; ++idx)
+    {
+        btree_inner_pair(tree, node, idx, &key, &c);
+        if (c == child)
+            return idx;
+    }
+
+    return BTREE_SLOT_NULL;
+}
+
+static size_t btree_inner_overflow_child(BTree *tree, size_t node, size_t i, btree_key_t key, pcm_time_t *time)
+{
+    const size_t ovf = tree->nodes[node].overflow;
+    const btree_key_t *okeys = btree_node_keys(tree, ovf);
+    size_t child = btree_node_ptrs(tree, node)[i];
+    bool bounded = i > 0;
+    btree_key_t bound = bounded ? btree_node_keys(tree, node)[i - 1] : 0;
+    size_t slot;
+
+    /* overflow is unsorted, the greatest separator <= key wins */
+    *time += btree_overflow_read(tree, node, tree->key_size + BTREE_PTR_SIZE);
+    for (slot = 0; slot < tree->nodes[ovf].count; ++slot)
+        if (okeys[slot] <= key && (!bounded || okeys[slot] > bound))
+        {
+            bounded = true;
+            bound = okeys[slot];
+            child = btree_node_ptrs(tree, ovf)[slot];
+        }
+
+    return child;
+}
+
+static void btree_inner_siblings(const BTree *tree, size_t parent, size_t i, size_t node, size_t *left, size_t *right)
+{
+    const size_t pairs = btree_inner_pairs(tree, parent);
+    size_t idx;
+    size_t own;
+    size_t child;
+    btree_key_t key;
+    btree_key_t sep = 0;
+    btree_key_t lkey = 0;
+    btree_key_t rkey = 0;
+
+    if (tree->nodes[parent].overflow == BTREE_NODE_NULL)
+    {
+        *left = i > 0 ? btree_node_ptrs(tree, parent)[i - 1] : BTREE_NODE_NULL;
+        *right = i < tree->nodes[parent].count ? btree_node_ptrs(tree, parent)[i + 1] : BTREE_NODE_NULL;
+        return;
+    }
+
+    own = btree_inner_pair_of(tree, parent, node);
+    if (own != BTREE_SLOT_NULL)
+        btree_inner_pair(tree, parent, own, &sep, &child);
+
+    /* the first child has no separator, so it is the left neighbour of the smallest one */
+    *left = own == BTREE_SLOT_NULL ? BTREE_NODE_NULL : btree_node_ptrs(tree, parent)[0];
+    *right = BTREE_NODE_NULL;
+    for (idx = 0; idx < pairs; ++idx)
+    {
+        if (idx == own)
+            continue;
+
+        btree_inner_pair(tree, parent, idx, &key, &child);
+        if (own != BTREE_SLOT_NULL && key < sep)
+        {
+            if (*left == btree_node_ptrs(tree, parent)[0] || key > lkey)
+            {
+                *left = child;
+                lkey = key;
+            }
+        }
+        else if (*right == BTREE_NODE_NULL || key < rkey)
+        {
+            *right = child;
+            rkey = key;
+        }
+    }
+}
+
+static pcm_time_t btree_inner_set_sep(BTree *tree, size_t parent, size_t child, btree_key_t key)
+{
+    const size_t idx = btree_inner_pair_of(tree, parent, child);
+    const size_t n = tree->nodes[parent].count;
+    const size_t ovf = tree->nodes[parent].overflow;
+
+    if (idx < n)
+    {
+        btree_node_keys(tree, parent)[idx] = key;
+        return btree_charge_write(tree, parent, btree_inner_key_offset(tree, idx), tree->key_size);
+    }
+
+    btree_node_keys(tree, ovf)[idx - n] = key;
+    return btree_charge_write(tree, ovf, btree_overflow_offset(tree, ovf, idx - n), tree->key_size);
+}
+
+static pcm_time_t btree_inner_remove_child(BTree *tree, size_t parent, size_t child)
+{
+    const size_t idx = btree_inner_pair_of(tree, parent, child);
+    const size_t n = tree->nodes[parent].count;
+
+    if (idx < n)
+        return btree_inner_remove(tree, parent, idx) + btree_inner_refill(tree, parent);
+
+    return btree_overflow_remove(tree, parent, idx - n);
+}
+
+static pcm_time_t btree_leaf_take(BTree *tree, size_t leaf, bool max, btree_key_t *key, btree_value_t *value)
+{
+    pcm_time_t time = 0;
+    btree_key_t *keys = btree_node_keys(tree, leaf);
+    size_t *values = btree_node_ptrs(tree, leaf);
+    const size_t n = tree->nodes[leaf].count;
+    const size_t pos = max ? n - 1 : 0;
+    const size_t ovf = tree->nodes[leaf].overflow;
+    size_t slot = BTREE_SLOT_NULL;
+
+    if (ovf != BTREE_NODE_NULL)
+    {
+        time += btree_overflow_read(tree, leaf, tree->key_size);
+        slot = btree_overflow_extreme(tree, leaf, max);
+        if (max ? btree_node_keys(tree, ovf)[slot] < keys[pos] : btree_node_keys(tree, ovf)[slot] > keys[pos])
+            slot = BTREE_SLOT_NULL;
+    }
+
+    if (slot != BTREE_SLOT_NULL)
+    {
+        *key = btree_node_keys(tree, ovf)[slot];
+        *value = btree_node_ptrs(tree, ovf)[slot];
+
+        return time + btree_overflow_remove(tree, leaf, slot);
+    }
+
+    *key = keys[pos];
+    *value = values[pos];
+    if (!max)
+    {
+        (void)memmove(&keys[0], &keys[1], (n - 1) * sizeof(*keys));
+        (void)memmove(&values[0], &values[1], (n - 1) * sizeof(*values));
+        time += btree_charge_write(tree, leaf, 0, (n - 1) * tree->entry_size);
+    }
+    tree->nodes[leaf].count = n - 1;
+
+    return time + btree_leaf_refill(tree, leaf);
+}
+
+static btree_key_t btree_leaf_min_key(const BTree *tree, size_t leaf)
+{
+    const size_t slot = btree_overflow_extreme(tree, leaf, false);
+    const btree_key_t key = btree_node_keys(tree, leaf)[0];
+
+    if (slot != BTREE_SLOT_NULL && btree_node_keys(tree, tree->nodes[leaf].overflow)[slot] < key)
+        return btree_node_keys(tree, tree->nodes[leaf].overflow)[slot];
+
+    return key;
+}
+
+static int btree_pair_cmp(const void *a, const void *b)
+{
+    return btree_key_cmp(&((const BTreePair *)a)->key, &((const BTreePair *)b)->key);
+}
+
+static size_t btree_leaf_lower_bound(BTree *tree, size_t node, btree_key_t key)
+{
+    const btree_key_t *keys = btree_node_keys(tree, node);
+    size_t lo = 0;
+    size_t hi = tree->nodes[node].count;
+    size_t mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        btree_visit_read(tree, btree_leaf_offset(tree, mid), tree->key_size);
+
+        if (keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static size_t btree_inner_find_child(BTree *tree, size_t node, btree_key_t key)
+{
+    const btree_key_t *keys = btree_node_keys(tree, node);
+    size_t lo = 0;
+    size_t hi = tree->nodes[node].count;
+    size_t mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        btree_visit_read(tree, btree_inner_key_offset(tree, mid), tree->key_size);
+
+        if (keys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    btree_visit_read(tree, btree_inner_child_offset(tree, lo), BTREE_PTR_SIZE);
+
+    return lo;
+}
+
+static size_t btree_find_leaf(BTree *tree, btree_key_t key, size_t *path, size_t *pos, size_t *depth, pcm_time_t *time)
+{
+    size_t node = tree->root;
+    size_t i;
+    size_t d = 0;
+
+    while (!tree->nodes[node].leaf)
+    {
+        btree_visit_begin(tree);
+        i = btree_inner_find_child(tree, node, key);
+        *time += btree_visit_end(tree, node);
+
+        path[d] = node;
+        pos[d] = i;
+        ++d;
+
+        if (tree->nodes[node].overflow != BTREE_NODE_NULL)
+            node = btree_inner_overflow_child(tree, node, i, key, time);
+        else
+            node = btree_node_ptrs(tree, node)[i];
+    }
+
+    *depth = d;
+    return node;
+}
+
+static size_t btree_find_last_leaf(const BTree *tree, size_t *path, size_t *pos, size_t *depth)
+{
+    size_t node = tree->root;
+    size_t d = 0;
+    size_t slot;
+    size_t n;
+
+    while (!tree->nodes[node].leaf)
+    {
+        n = tree->nodes[node].count;
+        path[d] = node;
+        pos[d] = n;
+        ++d;
+
+        slot = btree_overflow_extreme(tree, node, true);
+        if (slot != BTREE_SLOT_NULL && btree_node_keys(tree, tree->nodes[node].overflow)[slot] > btree_node_keys(tree, node)[n - 1])
+            node = btree_node_ptrs(tree, tree->nodes[node].overflow)[slot];
+        else
+            node = btree_node_ptrs(tree, node)[n];
+    }
+
+    *depth = d;
+    return node;
+}
+
+static pcm_time_t btree_insert_into_parent(BTree *tree, size_t left, btree_key_t sep, size_t right, const size_t *path, const size_t *pos, size_t depth)
+{
+    pcm_time_t time = 0;
+    const size_t pair_size = tree->key_size + BTREE_PTR_SIZE;
+
+    size_t node;
+    size_t new_node;
+    size_t i;
+    size_t n;
+    size_t m;
+    btree_key_t *keys;
+    size_t *ptrs;
+    btree_key_t *new_keys;
+    size_t *new_ptrs;
+
+    for (;;)
+    {
+        if (depth == 0)
+        {
+            /* left was root, tree grows */
+            node = btree_node_alloc(tree, tree->height);
+            keys = btree_node_keys(tree, node);
+            ptrs = btree_node_ptrs(tree, node);
+
+            keys[0] = sep;
+            ptrs[0] = left;
+            ptrs[1] = right;
+            tree->nodes[node].count = 1;
+
+            tree->root = node;
+            ++tree->height;
+
+            return time + btree_charge_write(tree, node, 0, btree_inner_key_offset(tree, 1));
+        }
+
+        --depth;
+        node = path[depth];
+        i = pos[depth];
+        n = tree->nodes[node].count;
+        keys = btree_node_keys(tree, node);
+        ptrs = btree_node_ptrs(tree, node);
+
+        /* OCB-Tree: full inner of the last level postpones split via overflow */
+        if (tree->inner_overflow && n == tree->inner_capacity && tree->nodes[ptrs[0]].leaf)
+        {
+            if (tree->nodes[node].overflow == BTREE_NODE_NULL || tree->nodes[tree->nodes[node].overflow].count < tree->overflow_capacity)
+                return time + btree_overflow_append(tree, node, sep, right);
+
+            time += btree_split_overflow(tree, node, sep, right, &sep, &new_node);
+            left = node;
+            right = new_node;
+            continue;
+        }
+
+        (void)memmove(&keys[i + 1], &keys[i], (n - i) * sizeof(*keys));
+        (void)memmove(&ptrs[i + 2], &ptrs[i + 1], (n - i) * sizeof(*ptrs));
+        keys[i] = sep;
+        ptrs[i + 1] = right;
+        tree->nodes[node].count = ++n;
+
+        if (n <= tree->inner_capacity)
+            return time + btree_charge_write(tree, node, btree_inner_key_offset(tree, i), (n - i) * pair_size);
+
+        /* split inner, middle key goes to parent */
+        m = n / 2;
+        new_node = btree_node_alloc(tree, tree->nodes[node].level);
+        new_keys = btree_node_keys(tree, new_node);
+        new_ptrs = btree_node_ptrs(tree, new_node);
+
+        (void)memcpy(new_keys, &keys[m + 1], (n - m - 1) * sizeof(*keys));
+        (void)memcpy(new_ptrs, &ptrs[m + 1], (n - m) * sizeof(*ptrs));
+        tree->nodes[new_node].count = n - m - 1;
+        tree->nodes[node].count = m;
+
+        if (i < m)
+            time += btree_charge_write(tree, node, btree_inner_key_offset(tree, i), (m - i) * pair_size);
+
+        time += btree_charge_write(tree, new_node, 0, btree_inner_key_offset(tree, n - m - 1));
+
+        left = node;
+        sep = keys[m];
+        right = new_node;
+    }
+}
+
+static pcm_time_t btree_split_leaf(BTree *tree, size_t leaf, size_t i, const size_t *path, const size_t *pos, size_t depth)
+{
+    pcm_time_t time = 0;
+    const size_t n = tree->nodes[leaf].count;
+    const size_t l = n / 2;
+    size_t right;
+
+    right = btree_node_alloc(tree, 0);
+
+    (void)memcpy(btree_node_keys(tree, right), &btree_node_keys(tree, leaf)[l], (n - l) * sizeof(btree_key_t));
+    (void)memcpy(btree_node_ptrs(tree, right), &btree_node_ptrs(tree, leaf)[l], (n - l) * sizeof(size_t));
+    tree->nodes[right].count = n - l;
+    tree->nodes[leaf].count = l;
+
+    tree->nodes[right].next = tree->nodes[leaf].next;
+    tree->nodes[leaf].next = right;
+
+    /* left keeps its entries, only entries shifted by new one are written */
+    if (i < l)
+        time += btree_charge_write(tree, leaf, btree_leaf_offset(tree, i), (l - i) * tree->entry_size);
+
+    time += btree_charge_write(tree, right, 0, (n - l) * tree->entry_size);
+
+    return time + btree_insert_into_parent(tree, leaf, btree_node_keys(tree, right)[0], right, path, pos, depth);
+}
+
+static pcm_time_t btree_uleaf_split(BTree *tree, size_t leaf, btree_key_t key, btree_value_t value, const size_t *path, const size_t *pos, size_t depth)
+{
+    pcm_time_t time = 0;
+    const btree_key_t *keys = btree_node_keys(tree, leaf);
+    const size_t *values = btree_node_ptrs(tree, leaf);
+    unsigned char *bitmap = btree_node_bitmap(tree, leaf);
+    btree_key_t median;
+    size_t right;
+    size_t slot;
+    size_t n = 0;
+
+    /* leaf has been scanned, so median is found in RAM */
+    for (slot = 0; slot < tree->leaf_capacity; ++slot)
+        if (btree_uleaf_used(tree, leaf, slot))
+            tree->scratch[n++] = keys[slot];
+
+    tree->scratch[n++] = key;
+    qsort(tree->scratch, n, sizeof(*tree->scratch), btree_key_cmp);
+    median = tree->scratch[n / 2];
+
+    right = btree_node_alloc(tree, 0);
+    for (slot = 0; slot < tree->leaf_capacity; ++slot)
+        if (btree_uleaf_used(tree, leaf, slot) && keys[slot] >= median)
+        {
+            (void)btree_uleaf_store(tree, right, keys[slot], values[slot]);
+            bitmap[slot / 8] = (unsigned char)(bitmap[slot / 8] & ~(1U << (slot % 8)));
+            --tree->nodes[leaf].count;
+        }
+
+    tree->nodes[right].next = tree->nodes[leaf].next;
+    tree->nodes[leaf].next = right;
+
+    /* moved entries stay in left as garbage, only its bitmap is rewritten */
+    time += btree_charge_write(tree, leaf, 0, tree->bitmap_size);
+
+    if (key >= median)
+        (void)btree_uleaf_store(tree, right, key, value);
+    else
+        time += btree_uleaf_put(tree, leaf, key, value);
+
+    /* new leaf is filled from slot 0 */
+    time += btree_charge_write(tree, right, 0, btree_uleaf_offset(tree, tree->nodes[right].count));
+
+    return time + btree_insert_into_parent(tree, leaf, median, right, path, pos, depth);
+}
+
+static bool btree_leaf_borrow(BTree *tree, size_t node, size_t parent, size_t left, size_t right, size_t min, pcm_time_t *time)
+{
+    btree_key_t *keys = btree_node_keys(tree, node);
+    size_t *ptrs = btree_node_ptrs(tree, node);
+    const size_t n = tree->nodes[node].count;
+    btree_key_t key;
+    btree_value_t value;
+
+    if (right != BTREE_NODE_NULL && tree->nodes[right].count > min)
+    {
+        /* borrow the first entry of right sibling */
+        *time += btree_leaf_take(tree, right, false, &key, &value);
+
+        keys[n] = key;
+        ptrs[n] = value;
+        tree->nodes[node].count = n + 1;
+
+        *time += btree_charge_write(tree, node, btree_leaf_offset(tree, n), tree->entry_size);
+        *time += btree_inner_set_sep(tree, parent, right, btree_leaf_min_key(tree, right));
+
+        return true;
+    }
+
+    if (left != BTREE_NODE_NULL && tree->nodes[left].count > min)
+    {
+        /* borrow the last entry of left sibling */
+        *time += btree_leaf_take(tree, left, true, &key, &value);
+
+        (void)memmove(&keys[1], &keys[0], n * sizeof(*keys));
+        (void)memmove(&ptrs[1], &ptrs[0], n * sizeof(*ptrs));
+        keys[0] = key;
+        ptrs[0] = value;
+        tree->nodes[node].count = n + 1;
+
+        *time += btree_charge_write(tree, node, 0, (n + 1) * tree->entry_size);
+        *time += btree_inner_set_sep(tree, parent, node, key);
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool btree_uleaf_borrow(BTree *tree, size_t node, size_t parent, size_t left, size_t right, size_t min, pcm_time_t *time)
+{
+    btree_key_t key;
+    size_t slot;
+
+    if (right != BTREE_NODE_NULL && tree->nodes[right].count > min)
+    {
+        /* borrow min entry of right sibling, its new min becomes separator */
+        *time += btree_uleaf_read_all(tree, right);
+
+        slot = btree_uleaf_extreme(tree, right, false);
+        *time += btree_uleaf_put(tree, node, btree_node_keys(tree, right)[slot], btree_node_ptrs(tree, right)[slot]);
+        *time += btree_uleaf_remove(tree, right, slot);
+
+        *time += btree_inner_set_sep(tree, parent, right, btree_node_keys(tree, right)[btree_uleaf_extreme(tree, right, false)]);
+
+        return true;
+    }
+
+    if (left != BTREE_NODE_NULL && tree->nodes[left].count > min)
+    {
+        /* borrow max entry of left sibling, it becomes separator */
+        *time += btree_uleaf_read_all(tree, left);
+
+        slot = btree_uleaf_extreme(tree, left, true);
+        key = btree_node_keys(tree, left)[slot];
+        *time += btree_uleaf_put(tree, node, key, btree_node_ptrs(tree, left)[slot]);
+        *time += btree_uleaf_remove(tree, left, slot);
+        *time += btree_inner_set_sep(tree, parent, node, key);
+
+        return true;
+    }
+
+    return false;
+}
+
+static pcm_time_t btree_leaf_merge(BTree *tree, size_t left, size_t right)
+{
+    const size_t ln = tree->nodes[left].count;
+    const size_t rn = tree->nodes[right].count;
+
+    (void)memcpy(&btree_node_keys(tree, left)[ln], btree_node_keys(tree, right), rn * sizeof(btree_key_t));
+    (void)memcpy(&btree_node_ptrs(tree, left)[ln], btree_node_ptrs(tree, right), rn * sizeof(size_t));
+    tree->nodes[left].count = ln + rn;
+    tree->nodes[left].next = tree->nodes[right].next;
+
+    return btree_charge_write(tree, left, btree_leaf_offset(tree, ln), rn * tree->entry_size);
+}
+
+static pcm_time_t btree_uleaf_merge(BTree *tree, size_t left, size_t right)
+{
+    pcm_time_t time;
+    size_t slot;
+    size_t s;
+
+    time = btree_uleaf_read_all(tree, right);
+    for (slot = 0; slot < tree->leaf_capacity; ++slot)
+        if (btree_uleaf_used(tree, right, slot))
+        {
+            s = btree_uleaf_store(tree, left, btree_node_keys(tree, right)[slot], btree_node_ptrs(tree, right)[slot]);
+            time += btree_charge_write(tree, left, btree_uleaf_offset(tree, s), tree->entry_size);
+        }
+
+    tree->nodes[left].next = tree->nodes[right].next;
+
+    return time + btree_charge_write(tree, left, 0, tree->bitmap_size);
+}
+
+static int btree_key_cmp(const void *a, const void *b)
+{
+    const btree_key_t ka = *(const btree_key_t *)a;
+    const btree_key_t kb = *(const btree_key_t *)b;
+
+    if (ka < kb)
+        return -1;
+
+    return ka > kb;
+}
+
+static pcm_time_t btree_inner_remove(BTree *tree, size_t node, size_t i)
+{
+    btree_key_t *keys = btree_node_keys(tree, node);
+    size_t *ptrs = btree_node_ptrs(tree, node);
+    const size_t n = tree->nodes[node].count;
+
+    (void)memmove(&keys[i], &keys[i + 1], (n - i - 1) * sizeof(*keys));
+    (void)memmove(&ptrs[i + 1], &ptrs[i + 2], (n - i - 1) * sizeof(*ptrs));
+    tree->nodes[node].count = n - 1;
+
+    return btree_charge_write(tree, node, btree_inner_key_offset(tree, i), (n - i - 1) * (tree->key_size + BTREE_PTR_SIZE));
+}
+
+static bool btree_inner_rotate_overflow(BTree *tree, size_t node, size_t parent, size_t i, size_t sibling, bool from_left, pcm_time_t *time)
+{
+    const size_t ovf = tree->nodes[sibling].overflow;
+    btree_key_t *keys = btree_node_keys(tree, node);
+    size_t *ptrs = btree_node_ptrs(tree, node);
+    btree_key_t *pkeys = btree_node_keys(tree, parent);
+    const btree_key_t *skeys = btree_node_keys(tree, sibling);
+    const size_t n = tree->nodes[node].count;
+    const size_t sn = tree->nodes[sibling].count;
+    btree_key_t key;
+    size_t child;
+    size_t slot;
+
+    if (ovf == BTREE_NODE_NULL)
+        return false;
+
+    *time += btree_overflow_read(tree, sibling, tree->key_size + BTREE_PTR_SIZE);
+    slot = btree_overflow_extreme(tree, sibling, from_left);
+    key = btree_node_keys(tree, ovf)[slot];
+    child = btree_node_ptrs(tree, ovf)[slot];
+
+    if (from_left ? key < skeys[sn - 1] : key > skeys[0])
+        return false;
+
+    if (from_left)
+    {
+        /* rotate right: the last child of left sibling is in its overflow */
+        (void)memmove(&keys[1], &keys[0], n * sizeof(*keys));
+        (void)memmove(&ptrs[1], &ptrs[0], (n + 1) * sizeof(*ptrs));
+        keys[0] = pkeys[i - 1];
+        ptrs[0] = child;
+        pkeys[i - 1] = key;
+
+        *time += btree_charge_write(tree, node, 0, btree_inner_key_offset(tree, n + 1));
+        *time += btree_charge_write(tree, parent, btree_inner_key_offset(tree, i - 1), tree->key_size);
+    }
+    else
+    {
+        /* rotate left: the smallest separator of right sibling is in its overflow */
+        keys[n] = pkeys[i];
+        ptrs[n + 1] = btree_node_ptrs(tree, sibling)[0];
+        btree_node_ptrs(tree, sibling)[0] = child;
+        pkeys[i] = key;
+
+        *time += btree_charge_write(tree, node, btree_inner_key_offset(tree, n), tree->key_size + BTREE_PTR_SIZE);
+        *time += btree_charge_write(tree, sibling, 0, BTREE_PTR_SIZE);
+        *time += btree_charge_write(tree, parent, btree_inner_key_offset(tree, i), tree->key_size);
+    }
+    tree->nodes[node].count = n + 1;
+
+    *time += btree_overflow_remove(tree, sibling, slot);
+    return true;
+}
+
+static pcm_time_t btree_rebalance(BTree *tree, size_t node, const size_t *path, const size_t *pos, size_t depth)
+{
+    pcm_time_t time = 0;
+    const size_t pair_size = tree->key_size + BTREE_PTR_SIZE;
+
+    size_t parent;
+    size_t i;
+    size_t n;
+    size_t min;
+    size_t left;
+    size_t right;
+    size_t ln;
+    size_t rn;
+    btree_key_t *keys;
+    size_t *ptrs;
+    btree_key_t *pkeys;
+    btree_key_t *skeys;
+    size_t *sptrs;
+
+    for (;;)
+    {
+        n = tree->nodes[node].count;
+        if (depth == 0)
+        {
+            /* root can have less keys, empty root is removed */
+            if (n == 0)
+            {
+                tree->root = tree->nodes[node].leaf ? BTREE_NODE_NULL : btree_node_ptrs(tree, node)[0];
+                --tree->height;
+                btree_node_free(tree, node);
+            }
+
+            return time;
+        }
+
+        min = tree->nodes[node].leaf ? tree->leaf_capacity / 2 : tree->inner_capacity / 2;
+        if (n >= min)
+            return time;
+
+        --depth;
+        parent = path[depth];
+        i = pos[depth];
+        pkeys = btree_node_keys(tree, parent);
+        left = i > 0 ? btree_node_ptrs(tree, parent)[i - 1] : BTREE_NODE_NULL;
+        right = i < tree->nodes[parent].count ? btree_node_ptrs(tree, parent)[i + 1] : BTREE_NODE_NULL;
+
+        keys = btree_node_keys(tree, node);
+        ptrs = btree_node_ptrs(tree, node);
+
+        if (tree->nodes[node].leaf)
+        {
+            /* parent can have overflow (OCB-Tree), so siblings are found in key order */
+            btree_inner_siblings(tree, parent, i, node, &left, &right);
+            if (tree->unsorted_leaves ? btree_uleaf_borrow(tree, node, parent, left, right, min, &time) : btree_leaf_borrow(tree, node, parent, left, right, min, &time))
+                return time;
+
+            /* merge right node into left one, sibling with overflow is full so it never merges */
+            if (right == BTREE_NODE_NULL)
+                right = node;
+            else
+                left = node;
+
+            time += tree->unsorted_leaves ? btree_uleaf_merge(tree, left, right) : btree_leaf_merge(tree, left, right);
+            time += btree_inner_remove_child(tree, parent, right);
+            btree_node_free(tree, right);
+
+            node = parent;
+            continue;
+        }
+        else
+        {
+            if (right != BTREE_NODE_NULL && tree->nodes[right].count > min && btree_inner_rotate_overflow(tree, node, parent, i, right, false, &time))
+                return time;
+
+            if (right != BTREE_NODE_NULL && tree->nodes[right].count > min)
+            {
+                /* rotate left: separator goes down, the first key of right sibling goes up */
+                skeys = btree_node_keys(tree, right);
+                sptrs = btree_node_ptrs(tree, right);
+                rn = tree->nodes[right].count - 1;
+
+                keys[n] = pkeys[i];
+                ptrs[n + 1] = sptrs[0];
+                tree->nodes[node].count = n + 1;
+                pkeys[i] = skeys[0];
+
+                (void)memmove(&skeys[0], &skeys[1], rn * sizeof(*skeys));
+                (void)memmove(&sptrs[0], &sptrs[1], (rn + 1) * sizeof(*sptrs));
+                tree->nodes[right].count = rn;
+
+                time += btree_charge_write(tree, node, btree_inner_key_offset(tree, n), pair_size);
+                time += btree_charge_write(tree, right, 0, btree_inner_key_offset(tree, rn));
+                time += btree_charge_write(tree, parent, btree_inner_key_offset(tree, i), tree->key_size);
+
+                return time + btree_inner_refill(tree, right);
+            }
+
+            if (left != BTREE_NODE_NULL && tree->nodes[left].count > min && btree_inner_rotate_overflow(tree, node, parent, i, left, true, &time))
+                return time;
+
+            if (left != BTREE_NODE_NULL && tree->nodes[left].count > min)
+            {
+                /* rotate right: separator goes down, the last key of left sibling goes up */
+                skeys = btree_node_keys(tree, left);
+                sptrs = btree_node_ptrs(tree, left);
+                ln = tree->nodes[left].count - 1;
+
+                (void)memmove(&keys[1], &keys[0], n * sizeof(*keys));
+                (void)memmove(&ptrs[1], &ptrs[0], (n + 1) * sizeof(*ptrs));
+                keys[0] = pkeys[i - 1];
+                ptrs[0] = sptrs[ln + 1];
+                tree->nodes[node].count = n + 1;
+                pkeys[i - 1] = skeys[ln];
+                tree->nodes[left].count = ln;
+
+                time += btree_charge_write(tree, node, 0, btree_inner_key_offset(tree, n + 1));
+                time += btree_charge_write(tree, parent, btree_inner_key_offset(tree, i - 1), tree->key_size);
+
+                return time + btree_inner_refill(tree, left);
+            }
+
+            /* merge right node into left one, separator goes down */
+            if (right == BTREE_NODE_NULL)
+            {
+                right = node;
+                node = left;
+                --i;
+            }
+            else
+            {
+                left = node;
+            }
+
+            ln = tree->nodes[left].count;
+            rn = tree->nodes[right].count;
+            skeys = btree_node_keys(tree, left);
+            skeys[ln] = pkeys[i];
+            (void)memcpy(&skeys[ln + 1], btree_node_keys(tree, right), rn * sizeof(btree_key_t));
+            (void)memcpy(&btree_node_ptrs(tree, left)[ln + 1], btree_node_ptrs(tree, right), (rn + 1) * sizeof(size_t));
+            tree->nodes[left].count = ln + rn + 1;
+
+            time += btree_charge_write(tree, left, btree_inner_key_offset(tree, ln), (rn + 1) * pair_size);
+        }
+
+        btree_node_free(tree, right);
+        time += btree_inner_remove(tree, parent, i);
+
+        node = parent;
+    }
+}
+
+static pcm_time_t btree_build_inners(BTree *tree, size_t *nodes, btree_key_t *min_keys, size_t n, size_t children)
+{
+    pcm_time_t time = 0;
+    size_t parents;
+    size_t node;
+    size_t k;
+    size_t i;
+    size_t j;
+    size_t first;
+    size_t level = tree->height;
+
+    /* final height is known before build, so each level is charged to its place (DRAM or PCM) */
+    for (parents = n; parents > 1; parents = INT_CEIL_DIV(parents, children))
+        ++tree->height;
+
+    while (n > 1)
+    {
+        parents = INT_CEIL_DIV(n, children);
+        first = 0;
+        for (i = 0; i < parents; ++i)
+        {
+            /* spread children evenly, so no inner is underfilled */
+            k = n / parents + (i < n % parents ? 1 : 0);
+
+            node = btree_node_alloc(tree, level);
+            for (j = 0; j < k; ++j)
+            {
+                btree_node_ptrs(tree, node)[j] = nodes[first + j];
+                if (j > 0)
+                    btree_node_keys(tree, node)[j - 1] = min_keys[first + j];
+            }
+            tree->nodes[node].count = k - 1;
+            time += btree_charge_write(tree, node, 0, btree_inner_key_offset(tree, k - 1));
+
+            /* level is built in place, i <= first */
+            min_keys[i] = min_keys[first];
+            nodes[i] = node;
+            first += k;
+        }
+
+        n = parents;
+        ++level;
+    }
+
+    tree->root = nodes[0];
+    return time;
+}
+
+BTree *btree_create(PCM *pcm, size_t key_size, size_t entry_size, size_t node_size, unsigned int flags)
+{
+    BTree *tree;
+    size_t leaf_capacity;
+
+    TRACE();
+
+    if (key_size == 0 || entry_size < key_size || node_size <= BTREE_PTR_SIZE)
+        ERROR("Incorrect key, entry or node size\n", NULL);
+
+    /* unsorted leaf has to fit bitmap with bit per slot */
+    leaf_capacity = node_size / entry_size;
+    if (flags & BTREE_FLAG_UNSORTED_LEAVES)
+        while (leaf_capacity > 0 && INT_CEIL_DIV(leaf_capacity, 8) + leaf_capacity * entry_size > node_size)
+            --leaf_capacity;
+
+    if (leaf_capacity < BTREE_MIN_CAPACITY || (node_size - BTREE_PTR_SIZE) / (key_size + BTREE_PTR_SIZE) < BTREE_MIN_CAPACITY)
+        ERROR("Node is too small\n", NULL);
+
+    /* overflow node is merged with sorted node on split, so leaves have to be sorted */
+    if ((flags & BTREE_FLAG_UNSORTED_LEAVES) && (flags & (BTREE_FLAG_LEAF_OVERFLOW | BTREE_FLAG_INNER_OVERFLOW)))
+        ERROR("Overflow nodes need sorted leaves\n", NULL);
+
+    tree = malloc(sizeof(*tree));
+    if (tree == NULL)
+        ERROR("malloc error\n", NULL);
+
+    tree->pcm = pcm;
+    tree->key_size = key_size;
+    tree->entry_size = entry_size;
+    tree->node_size = node_size;
+    tree->node_stride = INT_CEIL_DIV(node_size, pcm->mem_line) * pcm->mem_line;
+    tree->unsorted_leaves = (flags & BTREE_FLAG_UNSORTED_LEAVES) != 0;
+    tree->leaf_overflow = (flags & BTREE_FLAG_LEAF_OVERFLOW) != 0;
+    tree->inner_overflow = (flags & BTREE_FLAG_INNER_OVERFLOW) != 0;
+
+    tree->leaf_capacity = leaf_capacity;
+    tree->inner_capacity = (node_size - BTREE_PTR_SIZE) / (key_size + BTREE_PTR_SIZE);
+    tree->node_slots = MAX(tree->leaf_capacity, tree->inner_capacity) + 1;
+    tree->bitmap_size = tree->unsorted_leaves ? INT_CEIL_DIV(leaf_capacity, 8) : 0;
+
+    /* by default overflow node is as big as it can be (node with overflow + 1 entry has to fit in 2 nodes) */
+    tree->overflow_capacity = MIN(tree->leaf_capacity, tree->inner_capacity) - 1;
+
+    tree->line_mask_words = INT_CEIL_DIV(tree->node_stride / pcm->mem_line, BTREE_MASK_BITS);
+    tree->line_mask = malloc(tree->line_mask_words * sizeof(*tree->line_mask));
+    if (tree->line_mask == NULL)
+    {
+        FREE(tree);
+        ERROR("malloc error\n", NULL);
+    }
+
+    tree->image = malloc(tree->node_stride);
+    if (tree->image == NULL)
+    {
+        FREE(tree->line_mask);
+        FREE(tree);
+        ERROR("malloc error\n", NULL);
+    }
+
+    tree->nodes = NULL;
+    tree->keys = NULL;
+    tree->ptrs = NULL;
+    tree->bitmaps = NULL;
+    tree->scratch = NULL;
+    tree->pairs = NULL;
+    tree->nodes_capacity = 0;
+    tree->nodes_used = 0;
+    tree->free_nodes = BTREE_NODE_NULL;
+
+    tree->root = BTREE_NODE_NULL;
+    tree->height = 0;
+    tree->num_entries = 0;
+    tree->leaves = 0;
+    tree->inners = 0;
+    tree->overflows = 0;
+
+    (void)memset(tree->level_nodes, 0, sizeof(tree->level_nodes));
+    tree->dram_levels = (flags & BTREE_FLAG_INNERS_IN_RAM) ? BTREE_DRAM_INNERS : 0;
+    tree->dram_budget = 0;
+    tree->dram_time = 0;
+    tree->dram_lines_read = 0;
+    tree->dram_lines_written = 0;
+
+    if (btree_reserve(tree, BTREE_INIT_NODES))
+    {
+        btree_destroy(tree);
+        ERROR("btree_reserve error\n", NULL);
+    }
+
+    if (tree->unsorted_leaves)
+    {
+        tree->scratch = malloc(tree->node_slots * sizeof(*tree->scratch));
+        if (tree->scratch == NULL)
+        {
+            btree_destroy(tree);
+            ERROR("malloc error\n", NULL);
+        }
+    }
+
+    if (tree->leaf_overflow || tree->inner_overflow)
+    {
+        tree->pairs = malloc(2 * tree->node_slots * sizeof(*tree->pairs));
+        if (tree->pairs == NULL)
+        {
+            btree_destroy(tree);
+            ERROR("malloc error\n", NULL);
+        }
+    }
+
+    return tree;
+}
+
+void btree_destroy(BTree *tree)
+{
+    TRACE();
+
+    if (tree == NULL)
+        return;
+
+    FREE(tree->nodes);
+    FREE(tree->keys);
+    FREE(tree->ptrs);
+    FREE(tree->bitmaps);
+    FREE(tree->scratch);
+    FREE(tree->pairs);
+    FREE(tree->line_mask);
+    FREE(tree->image);
+    FREE(tree);
+}
+
+int btree_set_overflow_capacity(BTree *tree, size_t capacity)
+{
+    TRACE();
+
+    if (tree->overflows > 0)
+        ERROR("Overflow nodes are in use\n", 1);
+
+    if (capacity == 0 || capacity >= MIN(tree->leaf_capacity, tree->inner_capacity))
+        ERROR("Incorrect overflow capacity\n", 1);
+
+    tree->overflow_capacity = capacity;
+
+    return 0;
+}
+
+void btree_set_placement(BTree *tree, size_t dram_levels, size_t dram_budget, pcm_time_t dram_time)
+{
+    TRACE();
+
+    tree->dram_levels = dram_levels;
+    tree->dram_budget = dram_budget;
+    tree->dram_time = dram_time;
+}
+
+size_t btree_dram_footprint(const BTree *tree)
+{
+    const size_t levels = btree_dram_levels(tree);
+    size_t nodes = 0;
+    size_t i;
+
+    TRACE();
+
+    for (i = 0; i < levels; ++i)
+        nodes += tree->level_nodes[tree->height - 1 - i];
+
+    return nodes * tree->node_stride;
+}
+
+pcm_time_t btree_insert(BTree *tree, btree_key_t key, btree_value_t value)
+{
+    pcm_time_t time = 0;
+    size_t path[BTREE_MAX_HEIGHT];
+    size_t pos[BTREE_MAX_HEIGHT];
+    size_t depth;
+    size_t leaf;
+    size_t i;
+    size_t n;
+    size_t ovf;
+    size_t slot;
+    size_t right;
+    btree_key_t sep;
+    btree_key_t *keys;
+    size_t *values;
+
+    TRACE();
+
+    /* split can create one node on each level and new root, overflow can be created for leaf and its parent */
+    if (btree_reserve(tree, tree->height + 3))
+        ERROR("btree_reserve error\n", 0);
+
+    if (tree->root == BTREE_NODE_NULL)
+    {
+        tree->root = btree_node_alloc(tree, 0);
+        tree->height = 1;
+    }
+
+    leaf = btree_find_leaf(tree, key, path, pos, &depth, &time);
+    keys = btree_node_keys(tree, leaf);
+    values = btree_node_ptrs(tree, leaf);
+    n = tree->nodes[leaf].count;
+
+    if (tree->unsorted_leaves)
+    {
+        btree_visit_begin(tree);
+        i = btree_uleaf_find(tree, leaf, key);
+        time += btree_visit_end(tree, leaf);
+
+        if (i != BTREE_SLOT_NULL)
+        {
+            values[i] = value;
+            return time + btree_charge_write(tree, leaf, btree_uleaf_offset(tree, i) + tree->key_size, tree->entry_size - tree->key_size);
+        }
+
+        ++tree->num_entries;
+        if (n < tree->leaf_capacity)
+            return time + btree_uleaf_put(tree, leaf, key, value);
+
+        return time + btree_uleaf_split(tree, leaf, key, value, path, pos, depth);
+    }
+
+    btree_visit_begin(tree);
+    i = btree_leaf_lower_bound(tree, leaf, key);
+    time += btree_visit_end(tree, leaf);
+
+    if (i < n && keys[i] == key)
+    {
+        values[i] = value;
+        return time + btree_charge_write(tree, leaf, btree_leaf_offset(tree, i) + tree->key_size, tree->entry_size - tree->key_size);
+    }
+
+    ovf = tree->nodes[leaf].overflow;
+    if (ovf != BTREE_NODE_NULL)
+    {
+        time += btree_overflow_read(tree, leaf, tree->key_size);
+        slot = btree_overflow_find(tree, leaf, key);
+        if (slot != BTREE_SLOT_NULL)
+        {
+            btree_node_ptrs(tree, ovf)[slot] = value;
+            return time + btree_charge_write(tree, ovf, btree_overflow_offset(tree, ovf, slot) + tree->key_size, tree->entry_size - tree->key_size);
+        }
+    }
+
+    /* CB-Tree: full leaf postpones split via overflow */
+    if (tree->leaf_overflow && n == tree->leaf_capacity)
+    {
+        ++tree->num_entries;
+        if (ovf == BTREE_NODE_NULL || tree->nodes[ovf].count < tree->overflow_capacity)
+            return time + btree_overflow_append(tree, leaf, key, value);
+
+        time += btree_split_overflow(tree, leaf, key, value, &sep, &right);
+        return time + btree_insert_into_parent(tree, leaf, sep, right, path, pos, depth);
+    }
+
+    (void)memmove(&keys[i + 1], &keys[i], (n - i) * sizeof(*keys));
+    (void)memmove(&values[i + 1], &values[i], (n - i) * sizeof(*values));
+    keys[i] = key;
+    values[i] = value;
+    tree->nodes[leaf].count = ++n;
+    ++tree->num_entries;
+
+    if (n <= tree->leaf_capacity)
+        return time + btree_charge_write(tree, leaf, btree_leaf_offset(tree, i), (n - i) * tree->entry_size);
+
+    return time + btree_split_leaf(tree, leaf, i, path, pos, depth);
+}
+
+pcm_time_t btree_bulkload(BTree *tree, const btree_key_t *keys, const btree_value_t *values, size_t entries, double node_factor)
+{
+    pcm_time_t time = 0;
+    size_t path[BTREE_MAX_HEIGHT];
+    size_t pos[BTREE_MAX_HEIGHT];
+    size_t depth;
+    size_t *nodes = NULL;
+    btree_key_t *min_keys = NULL;
+    size_t per_leaf;
+    size_t children;
+    size_t leaves;
+    size_t leaf;
+    size_t last;
+    size_t first;
+    size_t k;
+    size_t i;
+    size_t j;
+    double fill;
+
+    TRACE();
+
+    if (entries == 0)
+        return 0;
+
+    if (tree->root != BTREE_NODE_NULL)
+    {
+        last = btree_find_last_leaf(tree, path, pos, &depth);
+        if (keys[0] <= btree_leaf_max_key(tree, last))
+        {
+            /* keys are mixed with existing ones, so there is nothing to append */
+            for (i = 0; i < entries; ++i)
+                time += btree_insert(tree, keys[i], values[i]);
+
+            return time;
+        }
+    }
+
+    fill = (double)tree->leaf_capacity * node_factor;
+    per_leaf = MIN(MAX((size_t)fill, 1), tree->leaf_capacity);
+    fill = (double)tree->inner_capacity * node_factor;
+    children = MIN(MAX((size_t)fill + 1, BTREE_MIN_CAPACITY), tree->inner_capacity + 1);
+
+    leaves = INT_CEIL_DIV(entries, per_leaf);
+    /* each appended leaf can split inner or create overflow of inner */
+    if (btree_reserve(tree, 3 * leaves + BTREE_MAX_HEIGHT))
+        ERROR("btree_reserve error\n", 0);
+
+    if (tree->root == BTREE_NODE_NULL)
+    {
+        nodes = malloc(leaves * sizeof(*nodes));
+        min_keys = malloc(leaves * sizeof(*min_keys));
+        if (nodes == NULL || min_keys == NULL)
+        {
+            FREE(nodes);
+            FREE(min_keys);
+            ERROR("malloc error\n", 0);
+        }
+    }
+
+    first = 0;
+    last = BTREE_NODE_NULL;
+    for (i = 0; i < leaves; ++i)
+    {
+        /* spread entries evenly, so no leaf is underfilled */
+        k = entries / leaves + (i < entries % leaves ? 1 : 0);
+
+        leaf = btree_node_alloc(tree, 0);
+        (void)memcpy(btree_node_keys(tree, leaf), &keys[first], k * sizeof(*keys));
+        (void)memcpy(btree_node_ptrs(tree, leaf), &values[first], k * sizeof(*values));
+        tree->nodes[leaf].count = k;
+
+        /* unsorted leaf is filled from slot 0 */
+        for (j = 0; tree->unsorted_leaves && j < k; ++j)
+            btree_node_bitmap(tree, leaf)[j / 8] = (unsigned char)(btree_node_bitmap(tree, leaf)[j / 8] | (1U << (j % 8)));
+
+        time += btree_charge_write(tree, leaf, 0, tree->bitmap_size + k * tree->entry_size);
+
+        if (nodes != NULL)
+        {
+            /* empty tree, leaves are linked here and inners are built level by level */
+            if (last != BTREE_NODE_NULL)
+                tree->nodes[last].next = leaf;
+
+            nodes[i] = leaf;
+            min_keys[i] = keys[first];
+        }
+        else
+        {
+            /* append to the right edge of tree */
+            last = btree_find_last_leaf(tree, path, pos, &depth);
+            tree->nodes[last].next = leaf;
+            time += btree_insert_into_parent(tree, last, keys[first], leaf, path, pos, depth);
+        }
+
+        last = leaf;
+        first += k;
+    }
+
+    tree->num_entries += entries;
+
+    if (nodes != NULL)
+    {
+        tree->height = 1;
+        time += btree_build_inners(tree, nodes, min_keys, leaves, children);
+
+        FREE(nodes);
+        FREE(min_keys);
+    }
+
+    return time;
+}
+
+pcm_time_t btree_search(BTree *tree, btree_key_t key, btree_value_t *value, bool *found)
+{
+    pcm_time_t time = 0;
+    size_t path[BTREE_MAX_HEIGHT];
+    size_t pos[BTREE_MAX_HEIGHT];
+    size_t depth;
+    size_t leaf;
+    size_t i;
+    size_t ovf;
+    size_t slot;
+
+    TRACE();
+
+    *found = false;
+    if (tree->root == BTREE_NODE_NULL)
+        return 0;
+
+    leaf = btree_find_leaf(tree, key, path, pos, &depth, &time);
+
+    btree_visit_begin(tree);
+    if (tree->unsorted_leaves)
+        i = btree_uleaf_find(tree, leaf, key);
+    else
+        i = btree_leaf_lower_bound(tree, leaf, key);
+
+    if (tree->unsorted_leaves && i != BTREE_SLOT_NULL)
+    {
+        btree_visit_read(tree, btree_uleaf_offset(tree, i), tree->entry_size);
+        if (value != NULL)
+            *value = btree_node_ptrs(tree, leaf)[i];
+
+        *found = true;
+    }
+    else if (!tree->unsorted_leaves && i < tree->nodes[leaf].count && btree_node_keys(tree, leaf)[i] == key)
+    {
+        btree_visit_read(tree, btree_leaf_offset(tree, i), tree->entry_size);
+        if (value != NULL)
+            *value = btree_node_ptrs(tree, leaf)[i];
+
+        *found = true;
+    }
+    time += btree_visit_end(tree, leaf);
+
+    ovf = tree->nodes[leaf].overflow;
+    if (!*found && ovf != BTREE_NODE_NULL)
+    {
+        /* overflow is unsorted, keys are scanned and found entry is read */
+        slot = btree_overflow_find(tree, leaf, key);
+
+        btree_visit_begin(tree);
+        for (i = 0; i < tree->nodes[ovf].count; ++i)
+            btree_visit_read(tree, btree_overflow_offset(tree, ovf, i), i == slot ? tree->entry_size : tree->key_size);
+
+        time += btree_visit_end(tree, ovf);
+
+        if (slot != BTREE_SLOT_NULL)
+        {
+            if (value != NULL)
+                *value = btree_node_ptrs(tree, ovf)[slot];
+
+            *found = true;
+        }
+    }
+
+    return time;
+}
+
+pcm_time_t btree_range_search(BTree *tree, btree_key_t key, size_t entries, size_t *scanned)
+{
+    pcm_time_t time = 0;
+    size_t path[BTREE_MAX_HEIGHT];
+    size_t pos[BTREE_MAX_HEIGHT];
+    size_t depth;
+    size_t leaf;
+    size_t i;
+    size_t k;
+    size_t j;
+    size_t ovf;
+    size_t left = entries;
+    bool first = true;
+
+    TRACE();
+
+    if (tree->root == BTREE_NODE_NULL || entries == 0)
+    {
+        if (scanned != NULL)
+            *scanned = 0;
+
+        return 0;
+    }
+
+    leaf = btree_find_leaf(tree, key, path, pos, &depth, &time);
+
+    btree_visit_begin(tree);
+    i = tree->unsorted_leaves ? 0 : btree_leaf_lower_bound(tree, leaf, key);
+    for (;;)
+    {
+        if (tree->unsorted_leaves)
+        {
+            /* order is unknown, so whole leaf is read, only the first leaf can have keys < key */
+            btree_uleaf_visit_slots(tree, leaf, tree->entry_size);
+            k = MIN(first ? btree_uleaf_count_from(tree, leaf, key) : tree->nodes[leaf].count, left);
+        }
+        else
+        {
+            k = MIN(tree->nodes[leaf].count - i, left);
+            btree_visit_read(tree, btree_leaf_offset(tree, i), k * tree->entry_size);
+        }
+        time += btree_visit_end(tree, leaf);
+
+        /* overflow is unsorted, so it is read whole */
+        ovf = tree->nodes[leaf].overflow;
+        if (ovf != BTREE_NODE_NULL && k < left)
+        {
+            time += btree_overflow_read(tree, leaf, tree->entry_size);
+            for (j = 0; j < tree->nodes[ovf].count && k < left; ++j)
+                if (!first || btree_node_keys(tree, ovf)[j] >= key)
+                    ++k;
+        }
+        first = false;
+
+        left -= k;
+        leaf = tree->nodes[leaf].next;
+        if (left == 0 || leaf == BTREE_NODE_NULL)
+            break;
+
+        btree_visit_begin(tree);
+        i = 0;
+    }
+
+    if (scanned != NULL)
+        *scanned = entries - left;
+
+    return time;
+}
+
+pcm_time_t btree_delete(BTree *tree, btree_key_t key, bool *found)
+{
+    pcm_time_t time = 0;
+    size_t path[BTREE_MAX_HEIGHT];
+    size_t pos[BTREE_MAX_HEIGHT];
+    size_t depth;
+    size_t leaf;
+    size_t i;
+    size_t n;
+    size_t slot;
+    btree_key_t *keys;
+    size_t *values;
+
+    TRACE();
+
+    if (found != NULL)
+        *found = false;
+
+    if (tree->root == BTREE_NODE_NULL)
+        return 0;
+
+    leaf = btree_find_leaf(tree, key, path, pos, &depth, &time);
+
+    if (tree->unsorted_leaves)
+    {
+        btree_visit_begin(tree);
+        i = btree_uleaf_find(tree, leaf, key);
+        time += btree_visit_end(tree, leaf);
+
+        if (i == BTREE_SLOT_NULL)
+            return time;
+
+        --tree->num_entries;
+        if (found != NULL)
+            *found = true;
+
+        time += btree_uleaf_remove(tree, leaf, i);
+
+        return time + btree_rebalance(tree, leaf, path, pos, depth);
+    }
+
+    btree_visit_begin(tree);
+    i = btree_leaf_lower_bound(tree, leaf, key);
+    time += btree_visit_end(tree, leaf);
+
+    keys = btree_node_keys(tree, leaf);
+    values = btree_node_ptrs(tree, leaf);
+    n = tree->nodes[leaf].count;
+
+    if ((i == n || keys[i] != key) && tree->nodes[leaf].overflow != BTREE_NODE_NULL)
+    {
+        time += btree_overflow_read(tree, leaf, tree->key_size);
+        slot = btree_overflow_find(tree, leaf, key);
+        if (slot == BTREE_SLOT_NULL)
+            return time;
+
+        --tree->num_entries;
+        if (found != NULL)
+            *found = true;
+
+        /* leaf is still full, so there is nothing to rebalance */
+        return time + btree_overflow_remove(tree, leaf, slot);
+    }
+
+    if (i == n || keys[i] != key)
+        return time;
+
+    (void)memmove(&keys[i], &keys[i + 1], (n - i - 1) * sizeof(*keys));
+    (void)memmove(&values[i], &values[i + 1], (n - i - 1) * sizeof(*values));
+    tree->nodes[leaf].count = n - 1;
+    --tree->num_entries;
+
+    if (found != NULL)
+        *found = true;
+
+    time += btree_charge_write(tree, leaf, btree_leaf_offset(tree, i), (n - i - 1) * tree->entry_size);
+
+    /* leaf with overflow has to stay full */
+    time += btree_leaf_refill(tree, leaf);
+
+    return time + btree_rebalance(tree, leaf, path, pos, depth);
+}
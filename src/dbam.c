@@ -5,10 +5,13 @@
 #include <log.h>
 #include <dbutils.h>
 #include <genrand.h>
+#include <randdist.h>
 #include <dbstat.h>
 #include <math.h>
+#include <string.h>
 
 #define DB_AM_LOG(n, k) (log(n) / log(k))
+#define DB_AM_SAMPLING_BLOCK 256
 
 /*
     Based on query type calculate number of entries to load from index
@@ -33,7 +36,7 @@ static ___inline___ size_t get_num_entries_from_index(DB_AM *am, query_t type, s
     RETURN
     Time consumed by this operation
 */
-static ___inline___ double copy_entries_to_index(DB_AM *am, size_t entries);
+static ___inline___ pcm_time_t copy_entries_to_index(DB_AM *am, size_t entries);
 
 /*
     Copy all entries from am to index
@@ -44,7 +47,7 @@ static ___inline___ double copy_entries_to_index(DB_AM *am, size_t entries);
     RETURN
     Consumed time
 */
-static ___inline___ double db_am_write_all_to_index(DB_AM *am);
+static ___inline___ pcm_time_t db_am_write_all_to_index(DB_AM *am);
 
 /*
     Load entries from index
@@ -56,7 +59,7 @@ static ___inline___ double db_am_write_all_to_index(DB_AM *am);
     RETURN
     Time consumed by this operation
 */
-static ___inline___ double load_entries_from_index(DB_AM *am, size_t entries);
+static ___inline___ pcm_time_t load_entries_from_index(DB_AM *am, size_t entries);
 
 /*
     Read entries from partitions
@@ -68,7 +71,21 @@ static ___inline___ double load_entries_from_index(DB_AM *am, size_t entries);
     RETURN
     Time consumed by loading from partitions
 */
-static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries, bool to_delete);
+static ___inline___ pcm_time_t load_entries_from_partition(DB_AM *am, size_t entries, bool to_delete);
+
+/*
+    Seek partitions to find the first entry needed by query.
+    Without fences each partition is seeked by binary search on PCM,
+    with fences only partitions with entries from the query are touched (1 line each)
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN entries - number of entries to load from partitions
+
+    RETURN
+    Time consumed by seeking
+*/
+static ___inline___ pcm_time_t seek_partitions(DB_AM *am, size_t entries);
 
 /*
     Init Adaptive Merging System (Call it only once at first query)
@@ -80,7 +97,7 @@ static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries
     RETURN
     Time needed for init
 */
-static double db_am_init(DB_AM *am, size_t entries);
+static pcm_time_t db_am_init(DB_AM *am, size_t entries);
 
 /*
     Create initial partition set for entries
@@ -89,14 +106,109 @@ static double db_am_init(DB_AM *am, size_t entries);
     @IN am - pointer to DB_AM
     @IN entries - number of entries
 */
-static double create_partitions_for_entries(DB_AM *am, size_t entries);
+static pcm_time_t create_partitions_for_entries(DB_AM *am, size_t entries);
+
+/*
+    Compare keys for qsort
+
+    PARAMS
+    @IN a - pointer to 1st key
+    @IN b - pointer to 2nd key
+
+    RETURN
+    -1 iff a < b
+    0 iff a == b
+    1 iff a > b
+*/
+static int db_am_engine_key_cmp(const void *a, const void *b);
+
+/*
+    Get random number from [0, n) for engine
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN n - upper bound (n > 0)
+
+    RETURN
+    Random number
+*/
+static ___inline___ size_t db_am_engine_random(DB_AM *am, size_t n);
+
+/*
+    Pass settings of AM to partitions before operation / counters of partitions to AM after operation
+
+    PARAMS
+    @IN am - pointer to AM system
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void db_am_engine_prepare(DB_AM *am);
+static ___inline___ void db_am_engine_sync(DB_AM *am);
+
+/*
+    Choose rank (in sorted_keys) of the first key of query range
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN type - query type
+    @IN entries - number of keys in range (entries <= num_entries)
+
+    RETURN
+    Rank of the first key
+*/
+static size_t db_am_engine_query_rank(DB_AM *am, query_t type, size_t entries);
+
+/*
+    Read table, bulkload query range into index and write the rest as sorted runs (first query)
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN lo - the first key of query range
+    @IN hi - the last key of query range
+    @IN entries - number of keys in range
+
+    RETURN
+    Time needed for init
+*/
+static pcm_time_t db_am_engine_init(DB_AM *am, btree_key_t lo, btree_key_t hi, size_t entries);
+
+/*
+    Sort extracted keys in RAM and bulkload them into index
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN keys - extracted keys
+    @IN entries - number of keys
+
+    RETURN
+    Bulkload time
+*/
+static pcm_time_t db_am_engine_merge(DB_AM *am, btree_key_t *keys, size_t entries);
+
+/*
+    Operations of AM backed by engine (see public db_am_* functions)
+
+    PARAMS
+    @IN am - pointer to AM system
+    @IN type - query type
+    @IN entries - number of entries
+
+    RETURN
+    Time of operation
+*/
+static pcm_time_t db_am_engine_search(DB_AM *am, query_t type, size_t entries);
+static pcm_time_t db_am_engine_delete(DB_AM *am, size_t entries);
 
 
 static ___inline___ size_t get_num_entries_from_index(DB_AM *am, query_t type, size_t entries)
 {
     size_t entries_from_index = 0;
     size_t i;
-    unsigned long r;
+    size_t j;
+    size_t len;
+    unsigned long r[DB_AM_SAMPLING_BLOCK];
+    double p;
 
     TRACE();
 
@@ -112,12 +224,23 @@ static ___inline___ size_t get_num_entries_from_index(DB_AM *am, query_t type, s
         }
         case QUERY_RANDOM:
         {
-            entries_from_index = 0;
-            for (i = 0; i < entries; ++i)
+            if (am->sampling_type == SAMPLING_PER_ENTRY)
             {
-                r = genrand() % am->num_entries;
-                if ((size_t)r >= am->num_entries_in_partitions)
-                    ++entries_from_index;
+                entries_from_index = 0;
+                for (i = 0; i < entries; i += len)
+                {
+                    len = MIN(entries - i, (size_t)DB_AM_SAMPLING_BLOCK);
+                    genrand_fill_r(am->rng, r, len);
+                    for (j = 0; j < len; ++j)
+                        if ((size_t)(r[j] % am->num_entries) >= am->num_entries_in_partitions)
+                            ++entries_from_index;
+                }
+            }
+            else
+            {
+                /* each entry is in index with p = (entries in index) / (all entries) */
+                p = (double)(am->num_entries - MIN(am->num_entries_in_partitions, am->num_entries)) / (double)am->num_entries;
+                entries_from_index = genrand_binomial(am->rng, entries, p);
             }
             break;
         }
@@ -158,9 +281,9 @@ static ___inline___ size_t get_num_entries_from_index(DB_AM *am, query_t type, s
     return entries_from_index;
 }
 
-static ___inline___ double db_am_write_all_to_index(DB_AM *am)
+static ___inline___ pcm_time_t db_am_write_all_to_index(DB_AM *am)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
     TRACE();
 
     time += copy_entries_to_index(am, am->num_entries_in_partitions);
@@ -169,33 +292,34 @@ static ___inline___ double db_am_write_all_to_index(DB_AM *am)
     return time;
 }
 
-static ___inline___ double load_entries_from_index(DB_AM *am, size_t entries)
+static ___inline___ pcm_time_t load_entries_from_index(DB_AM *am, size_t entries)
 {
     if (entries > 0)
         return db_index_range_search(am->index, entries);
 
-    return 0.0;
+    return 0;
 }
 
-static ___inline___ double copy_entries_to_index(DB_AM *am, size_t entries)
+static ___inline___ pcm_time_t copy_entries_to_index(DB_AM *am, size_t entries)
 {
     if (entries > 0)
         return db_index_bulkload(am->index, entries);
 
-    return 0.0;
+    return 0;
 }
 
-static double db_am_init(DB_AM *am, size_t entries)
+static pcm_time_t db_am_init(DB_AM *am, size_t entries)
 {
-    double total_time = 0.0;
-    double time;
+    pcm_time_t total_time = 0;
+    pcm_time_t time;
     size_t entries_to_sort;
 
     TRACE();
 
     /* read entries from table */
+    pcm_trace_set_tag(am->pcm, PCM_TRACE_TAG_AM);
     time = pcm_read(am->pcm, am->num_entries * am->entry_size);
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(am->stat, time);
     total_time += time;
 
     /* create index with entries */
@@ -210,27 +334,61 @@ static double db_am_init(DB_AM *am, size_t entries)
     return total_time;
 }
 
-static double create_partitions_for_entries(DB_AM *am, size_t entries)
+static pcm_time_t create_partitions_for_entries(DB_AM *am, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     TRACE();
 
     am->num_entries_in_partitions += entries;
     am->num_of_partitions = INT_CEIL_DIV(entries * am->entry_size, am->sort_buffer_size);
 
+    pcm_trace_set_tag(am->pcm, PCM_TRACE_TAG_PARTITIONS);
     if (am->index->type != BTREE_SKIP_COST && am->invalidation_type != INVALIDATION_SKIP)
         time += pcm_write(am->pcm, entries * am->entry_size);
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(am->stat, time);
 
     return time;
 }
 
-static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries, bool to_delete)
+static ___inline___ pcm_time_t seek_partitions(DB_AM *am, size_t entries)
 {
-    double total_time = 0.0;
-    double time = 0.0;
+    size_t partitions;
+    size_t steps;
+    double hit_ratio;
+    double touched;
+
+    /* entries are loaded and invalidated in partitions after seek */
+    pcm_trace_set_tag(am->pcm, PCM_TRACE_TAG_PARTITIONS);
+
+    if (entries == 0 || am->num_of_partitions == 0 || am->num_entries_in_partitions == 0)
+        return 0;
+
+    if (am->fence_pointers)
+    {
+        /* entries are spread over partitions, so partition is touched iff at least 1 entry from query is there */
+        hit_ratio = 1.0 - pow(1.0 - 1.0 / (double)am->num_of_partitions, (double)entries);
+        touched = ceil((double)am->num_of_partitions * hit_ratio);
+        partitions = MIN((size_t)touched, MIN(am->num_of_partitions, entries));
+        steps = 1;
+    }
+    else
+    {
+        /* seek each partition in logarithmic way */
+        partitions = am->num_of_partitions;
+        steps = (size_t)DB_AM_LOG((double)(am->num_entries_in_partitions * am->entry_size), 2.0);
+    }
+
+    am->seeked_partitions += partitions;
+
+    return pcm_read_many(am->pcm, 1, partitions * steps);
+}
+
+static ___inline___ pcm_time_t load_entries_from_partition(DB_AM *am, size_t entries, bool to_delete)
+{
+    pcm_time_t total_time = 0;
+    pcm_time_t time = 0;
 
     size_t i;
     size_t num_partitions = am->num_of_partitions;
@@ -238,34 +396,28 @@ static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries
     TRACE();
 
     if (entries == 0 || am->num_entries_in_partitions == 0)
-        return 0.0;
+        return 0;
 
     /* Journal will cutoff some partitions, lets assume for now that will cut a half */
     if (am->invalidation_type == INVALIDATION_JOURNAL)
         num_partitions /= 2;
 
-    /* seek partitions in logarithmic way */
-    for (i = 0; i < am->num_of_partitions; ++i)
-    {
-        // time += pcm_read(am->pcm, (size_t)DB_AM_LOG((double)(am->num_entries_in_partitions * am->entry_size), 2.0));
-
-        for (size_t j = 0; j < (size_t)DB_AM_LOG((double)(am->num_entries_in_partitions * am->entry_size), 2.0); ++j)
-            time += pcm_read(am->pcm, 1);
-    }
+    /* find entries in partitions */
+    time = seek_partitions(am, entries);
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(am->stat, time);
     total_time += time;
 
     if(!to_delete)
     {
         /* load entries */
         time = pcm_read(am->pcm, entries * am->entry_size);
-        db_stat_update_misc_time(time);
+        db_stat_update_misc_time_r(am->stat, time);
         total_time += time;
     }
 
     /* invalid entries */
-    time = 0.0;
+    time = 0;
     switch (am->invalidation_type)
     {
         case INVALIDATION_FLAG:
@@ -274,7 +426,7 @@ static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries
             for (i = 0; i < entries; ++i)
                 time += pcm_write(am->pcm, 1);
 
-            db_stat_update_invalidation_time(time);
+            db_stat_update_invalidation_time_r(am->stat, time);
             total_time += time;
 
             break;
@@ -285,12 +437,10 @@ static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries
             // time = pcm_write(am->pcm, (am->num_of_partitions + INT_CEIL_DIV(entries, 8)));
 
             size_t entries_per_partition = INT_CEIL_DIV(entries, am->num_of_partitions);
-            for (i = 0; i < am->num_of_partitions; ++i)
-            {
-                /* each partition has a bitmap, also 1 bitmap can store 64 entries, so each byte can store 8 entries */
-                time += pcm_write(am->pcm, INT_CEIL_DIV(entries_per_partition, 8));
-            }
-            db_stat_update_invalidation_time(time);
+
+            /* each partition has a bitmap, also 1 bitmap can store 64 entries, so each byte can store 8 entries */
+            time += pcm_write_many(am->pcm, INT_CEIL_DIV(entries_per_partition, 8), am->num_of_partitions);
+            db_stat_update_invalidation_time_r(am->stat, time);
             total_time += time;
 
             break;
@@ -301,7 +451,7 @@ static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries
             if (entries > 0)
             {
                 time = pcm_write(am->pcm, am->index->key_size * 2);
-                db_stat_update_invalidation_time(time);
+                db_stat_update_invalidation_time_r(am->stat, time);
                 total_time += time;
             }
 
@@ -311,7 +461,7 @@ static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries
         {
             /* we need a move in avg half of partition, in avg we will load 1/2 partitions or 1/4 paritions */
             time = pcm_write(am->pcm, (am->num_entries_in_partitions * am->entry_size) / 8);
-            db_stat_update_invalidation_time(time);
+            db_stat_update_invalidation_time_r(am->stat, time);
             total_time += time;
         }
         case INVALIDATION_SKIP:
@@ -325,7 +475,236 @@ static ___inline___ double load_entries_from_partition(DB_AM *am, size_t entries
     return total_time;
 }
 
-DB_AM *db_am_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, invalidation_type_t invalidation_type, btree_type_t index_type)
+static int db_am_engine_key_cmp(const void *a, const void *b)
+{
+    const btree_key_t ka = *(const btree_key_t *)a;
+    const btree_key_t kb = *(const btree_key_t *)b;
+
+    if (ka < kb)
+        return -1;
+
+    return ka > kb ? 1 : 0;
+}
+
+static ___inline___ size_t db_am_engine_random(DB_AM *am, size_t n)
+{
+    size_t r = (size_t)genrand_r(am->rng);
+
+    /* genrand gives 32 bits */
+    if (n > 0xffffffffUL)
+        r = (r << 32) | (size_t)genrand_r(am->rng);
+
+    return r % n;
+}
+
+static ___inline___ void db_am_engine_prepare(DB_AM *am)
+{
+    am->partitions->fence_pointers = am->fence_pointers;
+    am->partitions->invalidation_type = am->invalidation_type;
+}
+
+static ___inline___ void db_am_engine_sync(DB_AM *am)
+{
+    am->num_of_partitions = am->partitions->num_parts;
+    am->num_entries_in_partitions = am->partitions->num_entries;
+    am->seeked_partitions = am->partitions->seeked_partitions;
+}
+
+static size_t db_am_engine_query_rank(DB_AM *am, query_t type, size_t entries)
+{
+    const size_t ranks = am->num_entries - entries + 1;
+    btree_key_t key;
+    btree_key_t *pos;
+    size_t rank;
+
+    switch (type)
+    {
+        case QUERY_ALWAYS_NEW:
+        {
+            if (!am->initialized || am->partitions->num_entries == 0)
+                return db_am_engine_random(am, ranks);
+
+            /* range starts at key which is still in partitions */
+            key = partitions_random_key(am->partitions, am->rng);
+            pos = bsearch(&key, am->sorted_keys, am->num_entries, sizeof(*am->sorted_keys), db_am_engine_key_cmp);
+
+            return MIN((size_t)(pos - am->sorted_keys), ranks - 1);
+        }
+        case QUERY_SEQUENTIAL_PATTERN:
+        {
+            if (am->query_cursor >= ranks)
+                am->query_cursor = 0;
+
+            rank = am->query_cursor;
+            am->query_cursor += entries;
+
+            return rank;
+        }
+        case QUERY_RANDOM:
+            return db_am_engine_random(am, ranks);
+        default:
+            ERROR("Incorrect query type\n", 0);
+    }
+}
+
+static pcm_time_t db_am_engine_init(DB_AM *am, btree_key_t lo, btree_key_t hi, size_t entries)
+{
+    pcm_time_t total_time = 0;
+    pcm_time_t time;
+    btree_key_t *query_keys;
+    btree_key_t *run;
+    const size_t run_entries = MAX(am->sort_buffer_size / am->entry_size, (size_t)1);
+    size_t in_query = 0;
+    size_t in_run = 0;
+    size_t i;
+
+    TRACE();
+
+    query_keys = malloc(MAX(entries, (size_t)1) * sizeof(*query_keys));
+    run = malloc(run_entries * sizeof(*run));
+    if (query_keys == NULL || run == NULL)
+    {
+        FREE(query_keys);
+        FREE(run);
+        ERROR("malloc error\n", 0);
+    }
+
+    /* read entries from table */
+    pcm_trace_set_tag(am->pcm, PCM_TRACE_TAG_AM);
+    time = pcm_read(am->pcm, am->num_entries * am->entry_size);
+    db_stat_update_misc_time_r(am->stat, time);
+    total_time += time;
+
+    /* create index with entries from query */
+    for (i = 0; i < am->num_entries; ++i)
+        if (am->table_keys[i] >= lo && am->table_keys[i] <= hi)
+            query_keys[in_query++] = am->table_keys[i];
+
+    total_time += db_am_engine_merge(am, query_keys, in_query);
+
+    /* the rest of table is cut into runs of sort buffer size, each run is sorted in RAM and written as partition */
+    for (i = 0; i < am->num_entries; ++i)
+    {
+        if (am->table_keys[i] >= lo && am->table_keys[i] <= hi)
+            continue;
+
+        run[in_run++] = am->table_keys[i];
+        if (in_run == run_entries)
+        {
+            qsort(run, in_run, sizeof(*run), db_am_engine_key_cmp);
+            total_time += partitions_add_run(am->partitions, run, in_run);
+            in_run = 0;
+        }
+    }
+
+    if (in_run > 0)
+    {
+        qsort(run, in_run, sizeof(*run), db_am_engine_key_cmp);
+        total_time += partitions_add_run(am->partitions, run, in_run);
+    }
+
+    FREE(query_keys);
+    FREE(run);
+    FREE(am->table_keys);
+
+    am->initialized = true;
+
+    return total_time;
+}
+
+static pcm_time_t db_am_engine_merge(DB_AM *am, btree_key_t *keys, size_t entries)
+{
+    if (entries == 0)
+        return 0;
+
+    /* sorting is done in RAM, so it is not charged */
+    qsort(keys, entries, sizeof(*keys), db_am_engine_key_cmp);
+
+    return db_index_bulkload_keys(am->index, keys, entries);
+}
+
+static pcm_time_t db_am_engine_search(DB_AM *am, query_t type, size_t entries)
+{
+    pcm_time_t time = 0;
+    btree_key_t *keys;
+    btree_key_t lo;
+    btree_key_t hi;
+    size_t extracted;
+    size_t rank;
+
+    TRACE();
+
+    entries = MIN(entries, am->num_entries);
+    if (entries == 0)
+        return 0;
+
+    db_am_engine_prepare(am);
+
+    rank = db_am_engine_query_rank(am, type, entries);
+    lo = am->sorted_keys[rank];
+    hi = am->sorted_keys[rank + entries - 1];
+
+    if (!am->initialized)
+    {
+        time += db_am_engine_init(am, lo, hi, entries);
+        db_am_engine_sync(am);
+        return time;
+    }
+
+    /* load from partitions */
+    time += partitions_extract(am->partitions, lo, hi, &keys, &extracted);
+
+    /* the rest of range is already in index */
+    time += db_index_range_search_key(am->index, lo, entries - MIN(extracted, entries));
+
+    /* insert loaded entries from partitions into index */
+    time += db_am_engine_merge(am, keys, extracted);
+
+    if (am->partitions->num_entries * am->entry_size <= am->sort_buffer_size)
+    {
+        time += partitions_extract_all(am->partitions, &keys, &extracted);
+        time += db_am_engine_merge(am, keys, extracted);
+    }
+
+    db_am_engine_sync(am);
+    return time;
+}
+
+static pcm_time_t db_am_engine_delete(DB_AM *am, size_t entries)
+{
+    pcm_time_t time = 0;
+    btree_key_t *keys;
+    btree_key_t key;
+    size_t extracted;
+    size_t in_index;
+    size_t i;
+
+    TRACE();
+
+    db_am_engine_prepare(am);
+
+    for (i = 0; i < entries; ++i)
+    {
+        in_index = am->index->num_entries;
+        if (in_index + am->partitions->num_entries == 0)
+            break;
+
+        /* each entry is deleted with the same probability */
+        if (db_am_engine_random(am, in_index + am->partitions->num_entries) < in_index)
+            time += db_index_delete(am->index, 1);
+        else
+        {
+            /* seek partitions and invalidate entry */
+            key = partitions_random_key(am->partitions, am->rng);
+            time += partitions_extract(am->partitions, key, key, &keys, &extracted);
+        }
+    }
+
+    db_am_engine_sync(am);
+    return time;
+}
+
+DB_AM *db_am_create(PCM *pcm, Genrand *rng, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, invalidation_type_t invalidation_type, btree_type_t index_type)
 {
     DB_AM *am;
 
@@ -338,10 +717,20 @@ DB_AM *db_am_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entry_
     am->num_entries = num_entries;
     am->entry_size = entry_size;
     am->pcm = pcm;
+    am->stat = db_stat_get_default();
     am->sort_buffer_size = buffer_size;
     am->invalidation_type = invalidation_type;
+    am->sampling_type = SAMPLING_BINOMIAL;
+    am->rng = rng == NULL ? genrand_default() : rng;
     am->num_entries_in_partitions = 0;
     am->num_of_partitions = 0;
+    am->fence_pointers = false;
+    am->seeked_partitions = 0;
+    am->partitions = NULL;
+    am->table_keys = NULL;
+    am->sorted_keys = NULL;
+    am->query_cursor = 0;
+    am->initialized = false;
 
     am->index = db_index_create(pcm, key_size, entry_size, index_node_size, 0.8, index_type);
     if (am->index == NULL)
@@ -361,6 +750,45 @@ DB_AM *db_am_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entry_
     return am;
 }
 
+DB_AM *db_am_create_engine(PCM *pcm, Genrand *rng, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, invalidation_type_t invalidation_type, btree_type_t index_type)
+{
+    DB_AM *am;
+    size_t i;
+
+    TRACE();
+
+    am = db_am_create(pcm, rng, num_entries, key_size, entry_size, buffer_size, index_node_size, invalidation_type, index_type);
+    if (am == NULL)
+        ERROR("db_am_create error\n", NULL);
+
+    /* deletion index is not used by engine, partitions invalidate deleted entries */
+    db_index_destroy(am->index);
+    am->index = db_index_create_engine(pcm, am->rng, key_size, entry_size, index_node_size, 0.8, index_type);
+    if (am->index == NULL)
+    {
+        db_am_destroy(am);
+        ERROR("db_index_create_engine error\n", NULL);
+    }
+
+    am->partitions = partitions_create(pcm, num_entries, key_size, entry_size, invalidation_type);
+    am->table_keys = malloc(MAX(num_entries, (size_t)1) * sizeof(*am->table_keys));
+    am->sorted_keys = malloc(MAX(num_entries, (size_t)1) * sizeof(*am->sorted_keys));
+    if (am->partitions == NULL || am->table_keys == NULL || am->sorted_keys == NULL)
+    {
+        db_am_destroy(am);
+        ERROR("malloc error\n", NULL);
+    }
+
+    /* keys of table are taken from index, so inserted keys never collide with them */
+    for (i = 0; i < num_entries; ++i)
+        am->table_keys[i] = db_index_new_key(am->index);
+
+    (void)memcpy(am->sorted_keys, am->table_keys, num_entries * sizeof(*am->table_keys));
+    qsort(am->sorted_keys, num_entries, sizeof(*am->sorted_keys), db_am_engine_key_cmp);
+
+    return am;
+}
+
 void db_am_destroy(DB_AM *am)
 {
     TRACE();
@@ -370,18 +798,36 @@ void db_am_destroy(DB_AM *am)
 
     db_index_destroy(am->index);
     db_index_destroy(am->deletion_index);
+    partitions_destroy(am->partitions);
+    FREE(am->table_keys);
+    FREE(am->sorted_keys);
 
     FREE(am);
 }
 
-double db_am_search(DB_AM *am, query_t type, size_t entries)
+void db_am_set_stat(DB_AM *am, DB_stat *stat)
 {
-    double time = 0.0;
+    TRACE();
+
+    am->stat = stat;
+    db_index_set_stat(am->index, stat);
+    db_index_set_stat(am->deletion_index, stat);
+
+    if (am->partitions != NULL)
+        partitions_set_stat(am->partitions, stat);
+}
+
+pcm_time_t db_am_search(DB_AM *am, query_t type, size_t entries)
+{
+    pcm_time_t time = 0;
     size_t entries_from_index;
     size_t entries_from_partition;
 
     TRACE();
 
+    if (am->partitions != NULL)
+        return db_am_engine_search(am, type, entries);
+
     if (am->index->num_entries == 0 && am->num_entries_in_partitions == 0)
     {
         time += db_am_init(am, entries);
@@ -406,11 +852,16 @@ double db_am_search(DB_AM *am, query_t type, size_t entries)
     return time;
 }
 
-double db_am_insert(DB_AM *am, size_t entries)
+pcm_time_t db_am_insert(DB_AM *am, size_t entries)
 {
     return db_index_insert(am->index, entries);
 }
 
+pcm_time_t db_am_insert_batch(DB_AM *am, size_t entries)
+{
+    return db_index_insert_batch(am->index, entries);
+}
+
 /* Old way */
 // double db_am_delete(DB_AM* am, size_t entries)
 // {
@@ -433,14 +884,17 @@ double db_am_insert(DB_AM *am, size_t entries)
 // }
 
 /* To be fair lets implement 2x BTree 1 with deletion and 1 with insertion */
-double db_am_delete(DB_AM* am, size_t entries)
+pcm_time_t db_am_delete(DB_AM* am, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
     size_t entries_from_index;
     size_t entries_from_partition;
 
     TRACE();
 
+    if (am->partitions != NULL)
+        return db_am_engine_delete(am, entries);
+
     entries_from_index = get_num_entries_from_index(am, QUERY_RANDOM, entries);
     entries_from_partition = entries - entries_from_index;
 
@@ -448,21 +902,14 @@ double db_am_delete(DB_AM* am, size_t entries)
     time += db_index_delete(am->index, entries_from_index);
 
     /* delete from partition = insert to deletion Tree when we have normal AM */
-    if (am->index->type == BTREE_NORMAL || am->index->type == BTREE_NORMAL_INNERS_RAM)
+    if (am->index->type == BTREE_NORMAL)
     {
         if (entries_from_partition > 0)
         {
-            double _time = 0.0;
-            for (size_t i = 0; i < am->num_of_partitions; ++i)
-            {
-                // time += pcm_read(am->pcm, (size_t)DB_AM_LOG((double)(am->num_entries_in_partitions * am->entry_size), 2.0));
-
-                for (size_t j = 0; j < (size_t)DB_AM_LOG((double)(am->num_entries_in_partitions * am->entry_size), 2.0); ++j)
-                    _time += pcm_read(am->pcm, 1);
-            }
+            pcm_time_t _time = seek_partitions(am, entries_from_partition);
 
             _time += pcm_read(am->pcm, entries_from_partition * am->entry_size);
-            db_stat_update_index_time(_time);
+            db_stat_update_index_time_r(am->stat, _time);
             time += _time;
 
             time = db_index_insert(am->deletion_index, entries_from_partition);
@@ -3,22 +3,183 @@
 #include <log.h>
 #include <dbstat.h>
 #include <common.h>
-#include <time.h>
 #include <stdlib.h>
 #include <genrand.h>
+#include <randdist.h>
+#include <pcmreplay.h>
+#include <unistd.h>
 
-void db_am_experiment_workload(size_t entries)
+/*
+    Create PCM with region for AM engine of experiments on PCM model
+    (partitions need about 160B per entry, index below 4 * entry_size per entry)
+
+    PARAMS
+    @IN entries - number of entries in table
+
+    RETURN
+    Pointer to new PCM iff success
+    NULL iff failure
+*/
+static ___inline___ PCM *db_am_experiment_pcm(size_t entries);
+
+/*
+    Create AM engine on configured PCM (buffer 1% of table) and do the first query (init),
+    counters of PCM are reset after it, so they cover only steps
+
+    PARAMS
+    @IN pcm - pointer to configured PCM (see db_am_experiment_pcm)
+    @IN entries - number of entries in table (N)
+    @IN invalidation_type - invalidation of partitions
+    @IN btree_type - B+Tree type of engine
+    @OUT init_time - time of init (with bank sync and cache flush), NULL iff not needed
+
+    RETURN
+    Pointer to new AM iff success
+    NULL iff failure
+*/
+static DB_AM *db_am_experiment_init(PCM *pcm, size_t entries, invalidation_type_t invalidation_type, btree_type_t btree_type, pcm_time_t *init_time);
+
+/*
+    Run steps of workload of db_am_experiment_wear: range query with 1% selectivity, 0.1% inserts and 0.1% deletes
+
+    PARAMS
+    @IN am - pointer to AM from db_am_experiment_init
+    @IN queries - number of steps (Q)
+
+    RETURN
+    Time of steps (with bank sync and cache flush)
+*/
+static pcm_time_t db_am_experiment_steps(DB_AM *am, size_t queries);
+
+/*
+    Destroy AM from db_am_experiment_init with its generator
+
+    PARAMS
+    @IN am - pointer to AM
+
+    RETURN
+    This is a void function
+*/
+static void db_am_experiment_destroy(DB_AM *am);
+
+/*
+    Run workload of db_am_experiment_wear on AM engine created on configured PCM (init is not measured)
+
+    PARAMS
+    @IN pcm - pointer to configured PCM (see db_am_experiment_pcm)
+    @IN entries - number of entries in table (N)
+    @IN queries - number of steps (Q)
+    @IN invalidation_type - invalidation of partitions
+    @IN btree_type - B+Tree type of engine
+    @OUT init_time - time of init (with bank sync and cache flush), NULL iff not needed
+    @OUT time - time of steps (with bank sync and cache flush), NULL iff not needed
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int db_am_experiment_run(PCM *pcm, size_t entries, size_t queries, invalidation_type_t invalidation_type, btree_type_t btree_type, pcm_time_t *init_time, pcm_time_t *time);
+
+static ___inline___ PCM *db_am_experiment_pcm(size_t entries)
+{
+    return experiments_create_pcm_region(5 * entries * 140, NULL);
+}
+
+static DB_AM *db_am_experiment_init(PCM *pcm, size_t entries, invalidation_type_t invalidation_type, btree_type_t btree_type, pcm_time_t *init_time)
+{
+    DB_AM *am;
+    Genrand *rng;
+    pcm_time_t time;
+    const size_t buffer_size = (size_t)(0.01 * (double)entries * 140);
+
+    /* each configuration gets the same queries */
+    rng = experiments_create_rng(0, 0);
+    if (rng == NULL)
+        ERROR("experiments_create_rng error\n", NULL);
+
+    am = db_am_create_engine(pcm, rng, entries, sizeof(long), 140, buffer_size, 1000, invalidation_type, btree_type);
+    if (am == NULL)
+    {
+        genrand_destroy(rng);
+        ERROR("db_am_create_engine error\n", NULL);
+    }
+
+    /* the first query writes partitions and bulkloads index, cache stays warm but clean */
+    time = db_am_search(am, QUERY_RANDOM, (entries + 99) / 100);
+    time += pcm_cache_flush(pcm);
+    time += pcm_bank_sync(pcm);
+    if (init_time != NULL)
+        *init_time = time;
+
+    pcm_reset_counters(pcm);
+
+    return am;
+}
+
+static pcm_time_t db_am_experiment_steps(DB_AM *am, size_t queries)
+{
+    pcm_time_t time = 0;
+    const size_t query_entries = (am->num_entries + 99) / 100;
+    const size_t updates = (am->num_entries + 999) / 1000;
+    size_t i;
+
+    for (i = 0; i < queries; ++i)
+    {
+        time += db_am_search(am, QUERY_RANDOM, query_entries);
+        time += db_am_insert(am, updates);
+        time += db_am_delete(am, updates);
+    }
+    time += pcm_cache_flush(am->pcm);
+    time += pcm_bank_sync(am->pcm);
+
+    return time;
+}
+
+static void db_am_experiment_destroy(DB_AM *am)
+{
+    Genrand *rng = am->rng;
+
+    db_am_destroy(am);
+    genrand_destroy(rng);
+}
+
+static int db_am_experiment_run(PCM *pcm, size_t entries, size_t queries, invalidation_type_t invalidation_type, btree_type_t btree_type, pcm_time_t *init_time, pcm_time_t *time)
+{
+    DB_AM *am;
+    pcm_time_t steps_time;
+
+    am = db_am_experiment_init(pcm, entries, invalidation_type, btree_type, init_time);
+    if (am == NULL)
+        ERROR("db_am_experiment_init error\n", 1);
+
+    steps_time = db_am_experiment_steps(am, queries);
+    if (time != NULL)
+        *time = steps_time;
+
+    db_am_experiment_destroy(am);
+
+    return 0;
+}
+
+int db_am_experiment_workload(size_t entries)
 {
     DB_AM *am;
     PCM *pcm;
+    Genrand *rng;
     size_t i;
 
     TRACE();
 
-    sgenrand((unsigned long)time(NULL));
+    rng = experiments_create_rng(0, 0);
+    pcm = experiments_create_pcm();
+    am = db_am_create(pcm, rng, entries, sizeof(int), 140, (size_t)(0.01 * (double)entries * 140), 10 * 140, INVALIDATION_OVERWRITE, BTREE_NORMAL);
+    if (am == NULL)
+    {
+        genrand_destroy(rng);
+        pcm_destroy(pcm);
+        ERROR("db_am_create error\n", 1);
+    }
 
-    pcm = pcm_create_default_model();
-    am = db_am_create(pcm, entries, sizeof(int), 140, (size_t)(0.01 * (double)entries * 140), 10 * 140, INVALIDATION_OVERWRITE, BTREE_NORMAL);
     db_stat_reset();
 
     db_stat_start_query();
@@ -36,5 +197,586 @@ void db_am_experiment_workload(size_t entries)
     db_stat_summary_print();
 
     db_am_destroy(am);
+    genrand_destroy(rng);
     pcm_destroy(pcm);
-}
\ No newline at end of file
+
+    return 0;
+}
+
+int db_am_experiment_sampling(size_t entries, size_t in_partitions, double selectivity, size_t samples)
+{
+    DB_AM *am;
+    PCM *pcm;
+    Genrand *rng;
+    double sum;
+    double sum2;
+    double mean;
+    double x;
+    size_t before;
+    size_t i;
+    size_t t;
+
+    const size_t query_entries = (size_t)((double)entries * selectivity);
+    const double p = (double)(entries - in_partitions) / (double)entries;
+    const sampling_t sampling_type[] = {SAMPLING_BINOMIAL, SAMPLING_PER_ENTRY};
+    const char * const names[] = {"Binomial", "Per entry"};
+
+    TRACE();
+
+    /* split is clamped by index and partitions, query must fit in both to be unbiased */
+    if (in_partitions == 0 || in_partitions >= entries || query_entries > MIN(in_partitions, entries - in_partitions))
+        ERROR("query has to fit in index and in partitions\n", 1);
+
+    printf("EXPECTED\tMEAN = %lf\tVAR = %lf\n", (double)query_entries * p, (double)query_entries * p * (1.0 - p));
+    for (t = 0; t < ARRAY_SIZE(sampling_type); ++t)
+    {
+        /* each sample is a fresh AM, samples of one mode consume one stream */
+        rng = experiments_create_rng(0, t);
+        if (rng == NULL)
+            ERROR("experiments_create_rng error\n", 1);
+
+        sum = 0.0;
+        sum2 = 0.0;
+        for (i = 0; i < samples; ++i)
+        {
+            pcm = experiments_create_pcm();
+            am = db_am_create(pcm, rng, entries, sizeof(long), 140, 140, 1000, INVALIDATION_SKIP, BTREE_SKIP_COST);
+            if (am == NULL)
+            {
+                pcm_destroy(pcm);
+                genrand_destroy(rng);
+                ERROR("db_am_create error\n", 1);
+            }
+
+            am->sampling_type = sampling_type[t];
+
+            /* init query puts entries - in_partitions into index, the rest into partitions */
+            (void)db_am_search(am, QUERY_RANDOM, entries - in_partitions);
+
+            before = am->num_entries_in_partitions;
+            (void)db_am_search(am, QUERY_RANDOM, query_entries);
+
+            /* entries which do not come from partitions come from index */
+            x = (double)(query_entries - (before - am->num_entries_in_partitions));
+            sum += x;
+            sum2 += x * x;
+
+            db_am_destroy(am);
+            pcm_destroy(pcm);
+        }
+
+        mean = sum / (double)samples;
+        printf("%s\tMEAN = %lf\tVAR = %lf\n", names[t], mean, sum2 / (double)samples - mean * mean);
+
+        genrand_destroy(rng);
+    }
+
+    return 0;
+}
+
+int db_am_experiment_engine(size_t entries, size_t queries)
+{
+    DB_AM *model;
+    DB_AM *engine;
+    PCM *pcm_model;
+    PCM *pcm_engine;
+    Genrand *rng_model;
+    Genrand *rng_engine;
+    pcm_time_t model_time;
+    pcm_time_t engine_time;
+    const size_t buffer_size = (size_t)(0.01 * (double)entries * 140);
+    const size_t query_entries = (entries + 99) / 100;
+    size_t i;
+    size_t t;
+
+    const query_t query_type[] = {QUERY_RANDOM, QUERY_ALWAYS_NEW, QUERY_SEQUENTIAL_PATTERN};
+    const char * const query_names[] = {"Random", "Always new", "Sequential pattern"};
+
+    TRACE();
+
+    for (t = 0; t < ARRAY_SIZE(query_type); ++t)
+    {
+        pcm_model = experiments_create_pcm();
+        pcm_engine = experiments_create_pcm();
+
+        /* model and engine get the same queries */
+        rng_model = experiments_create_rng(t, 0);
+        rng_engine = experiments_create_rng(t, 0);
+        model = db_am_create(pcm_model, rng_model, entries, sizeof(long), 140, buffer_size, 1000, INVALIDATION_FLAG, BTREE_NORMAL);
+        engine = db_am_create_engine(pcm_engine, rng_engine, entries, sizeof(long), 140, buffer_size, 1000, INVALIDATION_FLAG, BTREE_NORMAL);
+        if (model == NULL || engine == NULL)
+        {
+            db_am_destroy(model);
+            db_am_destroy(engine);
+            genrand_destroy(rng_model);
+            genrand_destroy(rng_engine);
+            pcm_destroy(pcm_model);
+            pcm_destroy(pcm_engine);
+            ERROR("db_am_create error\n", 1);
+        }
+
+        printf("%s\n", query_names[t]);
+        printf("QUERY\tMODEL TIME\tENGINE TIME\tMODEL PARTITIONS\tENGINE PARTITIONS\tMODEL IN PARTITIONS\tENGINE IN PARTITIONS\n");
+        for (i = 0; i < queries; ++i)
+        {
+            model_time = db_am_search(model, query_type[t], query_entries);
+            engine_time = db_am_search(engine, query_type[t], query_entries);
+
+            printf("%zu\t%lf\t%lf\t%zu\t%zu\t%zu\t%zu\n",
+                   i + 1,
+                   pcm_time_to_seconds(model_time),
+                   pcm_time_to_seconds(engine_time),
+                   model->num_of_partitions,
+                   engine->num_of_partitions,
+                   model->num_entries_in_partitions,
+                   engine->num_entries_in_partitions);
+        }
+
+        db_am_destroy(model);
+        db_am_destroy(engine);
+        genrand_destroy(rng_model);
+        genrand_destroy(rng_engine);
+        pcm_destroy(pcm_model);
+        pcm_destroy(pcm_engine);
+    }
+
+    return 0;
+}
+
+int db_am_experiment_invalidation(size_t entries, size_t queries)
+{
+    DB_AM *model;
+    DB_AM *engine;
+    DB_stat *stat_model;
+    DB_stat *stat_engine;
+    PCM *pcm_model;
+    PCM *pcm_engine;
+    Genrand *rng_model;
+    Genrand *rng_engine;
+    const size_t buffer_size = (size_t)(0.01 * (double)entries * 140);
+    const size_t query_entries = (entries + 99) / 100;
+    size_t i;
+    size_t t;
+
+    const invalidation_type_t invalidation_type[] = {INVALIDATION_FLAG, INVALIDATION_BITMAP, INVALIDATION_JOURNAL, INVALIDATION_OVERWRITE, INVALIDATION_SKIP};
+    const char * const invalidation_names[] = {"Flag", "Bitmap", "Journal", "Overwrite", "Skip"};
+
+    TRACE();
+
+    printf("STRATEGY\tMODEL TIME\tENGINE TIME\tMODEL INVALIDATION\tENGINE INVALIDATION\tENGINE LINES READ\tENGINE LINES WRITTEN\n");
+    for (t = 0; t < ARRAY_SIZE(invalidation_type); ++t)
+    {
+        pcm_model = experiments_create_pcm();
+        pcm_engine = experiments_create_pcm();
+        stat_model = db_stat_create();
+        stat_engine = db_stat_create();
+
+        /* each strategy gets the same queries */
+        rng_model = experiments_create_rng(0, 0);
+        rng_engine = experiments_create_rng(0, 0);
+        model = db_am_create(pcm_model, rng_model, entries, sizeof(long), 140, buffer_size, 1000, invalidation_type[t], BTREE_NORMAL);
+        engine = db_am_create_engine(pcm_engine, rng_engine, entries, sizeof(long), 140, buffer_size, 1000, invalidation_type[t], BTREE_NORMAL);
+        if (model == NULL || engine == NULL || stat_model == NULL || stat_engine == NULL)
+        {
+            db_am_destroy(model);
+            db_am_destroy(engine);
+            db_stat_destroy(stat_model);
+            db_stat_destroy(stat_engine);
+            genrand_destroy(rng_model);
+            genrand_destroy(rng_engine);
+            pcm_destroy(pcm_model);
+            pcm_destroy(pcm_engine);
+            ERROR("db_am_create error\n", 1);
+        }
+
+        db_am_set_stat(model, stat_model);
+        db_am_set_stat(engine, stat_engine);
+
+        for (i = 0; i < queries; ++i)
+        {
+            db_stat_start_query_r(stat_model);
+            (void)db_am_search(model, QUERY_RANDOM, query_entries);
+            db_stat_finish_query_r(stat_model);
+
+            db_stat_start_query_r(stat_engine);
+            (void)db_am_search(engine, QUERY_RANDOM, query_entries);
+            db_stat_finish_query_r(stat_engine);
+        }
+
+        printf("%s\t%lf\t%lf\t%lf\t%lf\t%zu\t%zu\n",
+               invalidation_names[t],
+               pcm_time_to_seconds(db_stat_get_total_time_r(stat_model)),
+               pcm_time_to_seconds(db_stat_get_total_time_r(stat_engine)),
+               pcm_time_to_seconds(stat_model->total.invalidation_time),
+               pcm_time_to_seconds(stat_engine->total.invalidation_time),
+               pcm_engine->lines_read,
+               pcm_engine->lines_written);
+
+        db_am_destroy(model);
+        db_am_destroy(engine);
+        db_stat_destroy(stat_model);
+        db_stat_destroy(stat_engine);
+        genrand_destroy(rng_model);
+        genrand_destroy(rng_engine);
+        pcm_destroy(pcm_model);
+        pcm_destroy(pcm_engine);
+    }
+
+    return 0;
+}
+
+int db_am_experiment_wear(size_t entries, size_t queries)
+{
+    PCM *pcm[3];
+    PCM_wear wear;
+    const double endurance = 1e8;
+    const double year = 365.0 * 24.0 * 3600.0;
+    int ret = 0;
+    size_t j;
+    size_t t;
+
+    const invalidation_type_t invalidation_type[] = {INVALIDATION_OVERWRITE, INVALIDATION_BITMAP, INVALIDATION_JOURNAL};
+    const btree_type_t btree_type[] = {BTREE_NORMAL_INNERS_RAM, BTREE_UNSORTED_LEAVES_INNERS_RAM, CBTREE_INNERS_RAM};
+    const char * const names[] = {"AM", "eAM", "PAM"};
+
+    TRACE();
+
+    for (t = 0; t < ARRAY_SIZE(names); ++t)
+    {
+        pcm[t] = db_am_experiment_pcm(entries);
+        if (pcm[t] == NULL || db_am_experiment_run(pcm[t], entries, queries, invalidation_type[t], btree_type[t], NULL, NULL))
+        {
+            pcm_destroy(pcm[t]);
+            pcm[t] = NULL;
+            ret = 1;
+        }
+    }
+
+    printf("TYPE\tTIME\tWEAROUT\tWORN LINES\tMEAN\tP50\tP99\tP99.9\tMAX\tLIFETIME [years]\n");
+    for (t = 0; t < ARRAY_SIZE(names); ++t)
+    {
+        if (pcm[t] == NULL)
+            continue;
+
+        (void)pcm_wear(pcm[t], &wear);
+        printf("%s\t%lf\t%zu\t%zu/%zu\t%lf\t%zu\t%zu\t%zu\t%zu\t%lf\n",
+               names[t],
+               pcm_time_to_seconds(pcm_get_time(pcm[t])),
+               pcm[t]->wearout,
+               wear.worn_lines,
+               wear.lines,
+               wear.mean,
+               wear.p50,
+               wear.p99,
+               wear.p999,
+               wear.max,
+               pcm_lifetime(pcm[t], endurance) / year);
+    }
+
+    for (t = 0; t < ARRAY_SIZE(names); ++t)
+    {
+        if (pcm[t] == NULL)
+            continue;
+
+        (void)pcm_wear(pcm[t], &wear);
+        printf("%s\nWRITES\tLINES\n", names[t]);
+        for (j = 0; j < PCM_WEAR_HISTOGRAM; ++j)
+            if (wear.histogram[j] > 0)
+                printf("[%zu, %zu)\t%zu\n", j == 0 ? 0 : (size_t)1 << (j - 1), j == 0 ? 1 : (size_t)1 << j, wear.histogram[j]);
+
+        pcm_destroy(pcm[t]);
+    }
+
+    return ret;
+}
+
+int db_am_experiment_leveling(size_t entries, size_t queries)
+{
+    PCM *pcm;
+    PCM_wear wear;
+    const double endurance = 1e8;
+    const double year = 365.0 * 24.0 * 3600.0;
+    int ret = 0;
+    size_t t;
+
+    const pcm_leveling_t leveling_type[] = {PCM_LEVELING_NONE, PCM_LEVELING_START_GAP, PCM_LEVELING_SECURITY_REFRESH, PCM_LEVELING_TABLE};
+    const size_t leveling_interval[] = {0, 100, 100, 100000};
+    const char * const names[] = {"NONE", "START-GAP", "SECURITY REFRESH", "TABLE"};
+
+    TRACE();
+
+    printf("LEVELING\tTIME\tMIGRATED LINES\tWEAROUT\tMEAN\tP99\tMAX\tLIFETIME [years]\n");
+    for (t = 0; t < ARRAY_SIZE(names); ++t)
+    {
+        pcm = db_am_experiment_pcm(entries);
+        if (pcm == NULL)
+        {
+            ret = 1;
+            continue;
+        }
+
+        if (pcm_set_leveling(pcm, leveling_type[t], 4096, leveling_interval[t]) ||
+            db_am_experiment_run(pcm, entries, queries, INVALIDATION_OVERWRITE, BTREE_NORMAL_INNERS_RAM, NULL, NULL))
+        {
+            pcm_destroy(pcm);
+            ret = 1;
+            continue;
+        }
+
+        (void)pcm_wear(pcm, &wear);
+        printf("%s\t%lf\t%zu\t%zu\t%lf\t%zu\t%zu\t%lf\n",
+               names[t],
+               pcm_time_to_seconds(pcm_get_time(pcm)),
+               pcm->migrated_lines,
+               pcm->wearout,
+               wear.mean,
+               wear.p99,
+               wear.max,
+               pcm_lifetime(pcm, endurance) / year);
+
+        pcm_destroy(pcm);
+    }
+
+    return ret;
+}
+
+int db_am_experiment_banks(size_t entries, size_t queries)
+{
+    PCM *pcm;
+    pcm_time_t init_time;
+    pcm_time_t query_time;
+    int ret = 0;
+    size_t t;
+
+    const size_t banks[] = {0, 1, 4, 16, 64};
+
+    TRACE();
+
+    printf("BANKS\tINIT TIME\tQUERIES TIME\tSERIAL TIME\n");
+    for (t = 0; t < ARRAY_SIZE(banks); ++t)
+    {
+        pcm = db_am_experiment_pcm(entries);
+        if (pcm == NULL)
+        {
+            ret = 1;
+            continue;
+        }
+
+        if (pcm_set_banks(pcm, banks[t], 64, PCM_BANK_QUEUE) ||
+            db_am_experiment_run(pcm, entries, queries, INVALIDATION_OVERWRITE, BTREE_NORMAL_INNERS_RAM, &init_time, &query_time))
+        {
+            pcm_destroy(pcm);
+            ret = 1;
+            continue;
+        }
+
+        printf("%zu\t%lf\t%lf\t%lf\n",
+               banks[t],
+               pcm_time_to_seconds(init_time),
+               pcm_time_to_seconds(query_time),
+               pcm_time_to_seconds(pcm_get_time(pcm)));
+
+        pcm_destroy(pcm);
+    }
+
+    return ret;
+}
+
+int db_am_experiment_cache(size_t entries, size_t queries)
+{
+    PCM *pcm;
+    pcm_time_t time;
+    int ret = 0;
+    size_t t;
+
+    const btree_type_t btree_type[] = {BTREE_NORMAL_INNERS_RAM, BTREE_NORMAL, BTREE_NORMAL, BTREE_NORMAL, BTREE_NORMAL, BTREE_NORMAL};
+    const size_t cache_lines[] = {0, 0, 1 << 10, 1 << 14, 1 << 18, 1 << 14};
+    const pcm_cache_policy_t cache_policy[] = {PCM_CACHE_LRU, PCM_CACHE_LRU, PCM_CACHE_LRU, PCM_CACHE_LRU, PCM_CACHE_LRU, PCM_CACHE_CLOCK};
+    const char * const names[] = {"INNERS RAM", "PCM", "LRU 64KB", "LRU 1MB", "LRU 16MB", "CLOCK 1MB"};
+
+    TRACE();
+
+    printf("CONFIG\tTIME\tLINES WRITTEN\tWEAROUT\tHIT RATE\tWRITE BACKS\n");
+    for (t = 0; t < ARRAY_SIZE(names); ++t)
+    {
+        pcm = db_am_experiment_pcm(entries);
+        if (pcm == NULL)
+        {
+            ret = 1;
+            continue;
+        }
+
+        if (pcm_set_cache(pcm, cache_lines[t], 8, cache_policy[t], NANO(10)) ||
+            db_am_experiment_run(pcm, entries, queries, INVALIDATION_FLAG, btree_type[t], NULL, &time))
+        {
+            pcm_destroy(pcm);
+            ret = 1;
+            continue;
+        }
+
+        printf("%s\t%lf\t%zu\t%zu\t%lf\t%zu\n",
+               names[t],
+               pcm_time_to_seconds(time),
+               pcm->lines_written,
+               pcm->wearout,
+               pcm->cache_hits + pcm->cache_misses == 0 ? 0.0 : (double)pcm->cache_hits / (double)(pcm->cache_hits + pcm->cache_misses),
+               pcm->cache_write_backs);
+
+        pcm_destroy(pcm);
+    }
+
+    return ret;
+}
+
+int db_am_experiment_write_mode(size_t entries, size_t queries)
+{
+    PCM *pcm;
+    pcm_time_t time;
+    int ret = 0;
+    size_t t;
+    size_t m;
+
+    const btree_type_t btree_type[] = {BTREE_NORMAL, BTREE_UNSORTED_LEAVES};
+    const char * const btree_names[] = {"SORTED", "UNSORTED"};
+    const pcm_write_mode_t write_mode[] = {PCM_WRITE_FULL, PCM_WRITE_DCW, PCM_WRITE_FNW};
+    const char * const mode_names[] = {"FULL", "DCW", "FNW"};
+
+    TRACE();
+
+    printf("LEAVES\tMODE\tTIME\tLINES WRITTEN\tWEAROUT\tBITS WRITTEN\tMAX LINE BITS\n");
+    for (t = 0; t < ARRAY_SIZE(btree_type); ++t)
+        for (m = 0; m < ARRAY_SIZE(write_mode); ++m)
+        {
+            pcm = db_am_experiment_pcm(entries);
+            if (pcm == NULL)
+            {
+                ret = 1;
+                continue;
+            }
+
+            if (pcm_set_write_mode(pcm, write_mode[m], 128) ||
+                db_am_experiment_run(pcm, entries, queries, INVALIDATION_FLAG, btree_type[t], NULL, &time))
+            {
+                pcm_destroy(pcm);
+                ret = 1;
+                continue;
+            }
+
+            printf("%s\t%s\t%lf\t%zu\t%zu\t%zu\t%zu\n",
+                   btree_names[t],
+                   mode_names[m],
+                   pcm_time_to_seconds(time),
+                   pcm->lines_written,
+                   pcm->wearout,
+                   pcm->bits_written,
+                   pcm->max_line_bits);
+
+            pcm_destroy(pcm);
+        }
+
+    return ret;
+}
+
+int db_am_experiment_replay(size_t entries, size_t queries)
+{
+    DB_AM *am;
+    PCM *pcm;
+    PCM_replay_config configs[3 * 2 * 2 * 2];
+    PCM_replay_result results[ARRAY_SIZE(configs)];
+    const PCM_replay_result *check;
+    size_t num_configs = 0;
+    bool match;
+    int replay;
+    int ret = 0;
+    size_t l;
+    size_t w;
+    size_t b;
+    size_t c;
+
+    const size_t mem_line[] = {64, 128, 256};
+    const pcm_time_t write_time[] = {MICRO(1), NANO(500)};
+    const size_t banks[] = {0, 8};
+    const size_t cache_lines[] = {0, 1 << 14};
+    const char * const trace_file = "am_replay.trace";
+
+    TRACE();
+
+    pcm = db_am_experiment_pcm(entries);
+    if (pcm == NULL)
+        ERROR("db_am_experiment_pcm error\n", 1);
+
+    am = db_am_experiment_init(pcm, entries, INVALIDATION_FLAG, BTREE_NORMAL, NULL);
+    if (am == NULL)
+    {
+        pcm_destroy(pcm);
+        ERROR("db_am_experiment_init error\n", 1);
+    }
+
+    /* only steps are recorded, init is skipped */
+    replay = pcm_trace_open(pcm, trace_file);
+    if (replay == 0)
+    {
+        (void)db_am_experiment_steps(am, queries);
+        replay = pcm_trace_close(pcm);
+    }
+
+    db_am_experiment_destroy(am);
+    pcm_destroy(pcm);
+
+    for (l = 0; l < ARRAY_SIZE(mem_line); ++l)
+        for (w = 0; w < ARRAY_SIZE(write_time); ++w)
+            for (b = 0; b < ARRAY_SIZE(banks); ++b)
+                for (c = 0; c < ARRAY_SIZE(cache_lines); ++c)
+                    configs[num_configs++] = (PCM_replay_config){.mem_line = mem_line[l],
+                                                                 .read_time = NANO(50) * mem_line[l] / 64,
+                                                                 .write_time = write_time[w] * mem_line[l] / 64,
+                                                                 .banks = banks[b],
+                                                                 .cache_lines = cache_lines[c],
+                                                                 .cache_time = NANO(10)};
+
+    if (replay == 0)
+        replay = pcm_replay(trace_file, configs, results, num_configs, 0);
+
+    (void)unlink(trace_file);
+
+    /* results are not filled when trace or replay failed */
+    if (replay != 0)
+    {
+        printf("REPLAY CHECK\tFAILED (trace replay error)\n");
+        return 1;
+    }
+
+    if (pcm_replay_save("am_replay.txt", configs, results, num_configs))
+        ret = 1;
+
+    /* the same steps run directly on PCM with cache (cold like in replay) have to give the same counters */
+    check = &results[1];
+    pcm = db_am_experiment_pcm(entries);
+    if (pcm == NULL)
+        ERROR("db_am_experiment_pcm error\n", 1);
+
+    am = db_am_experiment_init(pcm, entries, INVALIDATION_FLAG, BTREE_NORMAL, NULL);
+    if (am != NULL && pcm_set_cache(pcm, configs[1].cache_lines, 8, PCM_CACHE_LRU, configs[1].cache_time) == 0)
+    {
+        (void)db_am_experiment_steps(am, queries);
+        match = check->error == 0 &&
+                check->lines_read == pcm->lines_read &&
+                check->lines_written == pcm->lines_written &&
+                check->wearout == pcm->wearout &&
+                check->cache_hits == pcm->cache_hits &&
+                check->cache_misses == pcm->cache_misses;
+
+        printf("REPLAY CHECK (%zu lines of cache)\t%s\n", configs[1].cache_lines, match ? "OK" : "MISMATCH");
+        if (!match)
+            ret = 1;
+    }
+    else
+        ret = 1;
+
+    if (am != NULL)
+        db_am_experiment_destroy(am);
+
+    pcm_destroy(pcm);
+
+    return ret;
+}
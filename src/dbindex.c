@@ -3,10 +3,103 @@
 #include <pcm.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <dbstat.h>
 #include <dbutils.h>
 
 #define DB_INDEX_LOG(n, k) (log(n) / log(k))
+#define DB_INDEX_ENGINE_INIT_KEYS 1024
+
+/*
+    Generate new unique key for engine (bijective mix of counter, so keys are in random order)
+
+    PARAMS
+    @IN index - pointer to Index
+
+    RETURN
+    New key
+*/
+static ___inline___ btree_key_t db_index_engine_new_key(DB_index *index);
+
+/*
+    Choose position of random existing key in engine_keys
+
+    PARAMS
+    @IN index - pointer to Index
+
+    RETURN
+    Position in engine_keys
+*/
+static ___inline___ size_t db_index_engine_random_pos(DB_index *index);
+
+/*
+    Remember keys inserted into engine
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN keys - inserted keys
+    @IN n - number of keys
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int db_index_engine_add_keys(DB_index *index, const btree_key_t *keys, size_t n);
+
+/*
+    Synchronize shape of index with engine
+
+    PARAMS
+    @IN index - pointer to Index
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void db_index_engine_sync(DB_index *index);
+
+/*
+    Operations of index backed by engine (see public db_index_* functions)
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN entries - number of entries
+
+    RETURN
+    Time of operation
+*/
+static pcm_time_t db_index_engine_insert(DB_index *index, size_t entries);
+static pcm_time_t db_index_engine_bulkload(DB_index *index, size_t entries);
+static pcm_time_t db_index_engine_point_search(DB_index *index, size_t entries);
+static pcm_time_t db_index_engine_range_search(DB_index *index, size_t entries);
+static pcm_time_t db_index_engine_delete(DB_index *index, size_t entries);
+
+/*
+    Bulkload sorted unique keys into engine and remember them as keys of index
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN keys - sorted array of unique keys
+    @IN values - array of values
+    @IN entries - number of keys
+
+    RETURN
+    Bulkload time
+*/
+static pcm_time_t db_index_engine_bulkload_pairs(DB_index *index, const btree_key_t *keys, const btree_value_t *values, size_t entries);
+
+/*
+    Compare keys for qsort
+
+    PARAMS
+    @IN a - pointer to 1st key
+    @IN b - pointer to 2nd key
+
+    RETURN
+    -1 iff a < b
+    0 iff a == b
+    1 iff a > b
+*/
+static int db_index_engine_key_cmp(const void *a, const void *b);
 
 /*
     Get number of leaves needed for entries
@@ -43,6 +136,43 @@ static ___inline___ size_t db_index_get_leaves_number(const DB_index *index);
 */
 static ___inline___ size_t db_index_get_height(const DB_index *index);
 
+/*
+    Calculate height of BTree with entries
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN entries - number of entries in BTree
+
+    RETURN
+    Index (BTree) Height
+*/
+static ___inline___ size_t db_index_get_height_for_entries(const DB_index *index, size_t entries);
+
+/*
+    Calculate height of BTree with leaves
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN leaves - number of leaves in BTree
+
+    RETURN
+    Index (BTree) Height
+*/
+static ___inline___ size_t db_index_get_height_for_leaves(const DB_index *index, size_t leaves);
+
+/*
+    Set number of entries in BTree and update number of nodes on each level.
+    Only levels with changed number of nodes are recalculated
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN entries - new number of entries
+
+    RETURN
+    This is a void function
+*/
+static void db_index_set_num_entries(DB_index *index, size_t entries);
+
 /*
     Get number of keys that can be write into one node
 
@@ -65,13 +195,124 @@ static ___inline___ size_t db_index_keys_per_node(const DB_index *index);
 */
 static ___inline___ size_t db_index_get_inners_number(const DB_index *index);
 
-static double db_index_find_node(DB_index* index);
+/*
+    Get time needed to find node on one level of BTree
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN times - how many levels are searched
+
+    RETURN
+    Time consumed by searching levels
+*/
+static ___inline___ pcm_time_t db_index_find_node_level(const DB_index *index, size_t times);
+
+/*
+    Get bytes read by search in one inner node
+
+    PARAMS
+    @IN index - pointer to Index
+
+    RETURN
+    Bytes read from inner node
+*/
+static ___inline___ size_t db_index_inner_search_bytes(const DB_index *index);
+
+/*
+    Get number of the top levels of inners placed in DRAM for current height and budget
+
+    PARAMS
+    @IN index - pointer to Index
+
+    RETURN
+    Levels in DRAM
+*/
+static size_t db_index_dram_levels(const DB_index *index);
+
+/*
+    Get time needed to search levels of inners, the top levels of each search are in DRAM
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN levels - how many levels are searched
+    @IN searches - how many searches go through these levels
+
+    RETURN
+    Time consumed by searching levels
+*/
+static pcm_time_t db_index_search_inners(DB_index *index, size_t levels, size_t searches);
+
+/*
+    Write the same bytes to inners many times. Writes land mostly on the last level of inners,
+    so they go to DRAM iff all levels of inners are in DRAM
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN bytes - number of bytes to write by single operation
+    @IN times - how many times write is repeated
+
+    RETURN
+    Time consumed by writes
+*/
+static pcm_time_t db_index_write_inners(DB_index *index, size_t bytes, size_t times);
+
+/*
+    Get time needed to find leaf (searching from root via all inner levels)
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN times - how many leaves are searched
+
+    RETURN
+    Time consumed by searching
+*/
+static pcm_time_t db_index_find_node(DB_index* index, size_t times);
+
+/*
+    Get total number of inner levels traversed by consecutive single insertions,
+    when BTree has first, first + 1, ... last entries
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN first - number of entries before first insertion
+    @IN last - number of entries before last insertion
+
+    RETURN
+    Sum of traversed inner levels
+*/
+static size_t db_index_get_levels_for_entries(const DB_index *index, size_t first, size_t last);
+
+/*
+    Get number of insertions which cause a leaf split
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN entries - number of inserted entries
+    @IN diff_leaves - number of new leaves after insertion
+
+    RETURN
+    Number of insertions with split
+*/
+static ___inline___ size_t db_index_get_split_entries(const DB_index *index, size_t entries, size_t diff_leaves);
+
+/*
+    Write down entries into leaves and split nodes if needed.
+    Closed form of inserting entries one by one.
+
+    PARAMS
+    @IN index - pointer to Index
+    @IN entries - number of inserted entries
+    @IN diff_leaves - number of new leaves after insertion
+    @IN diff_inners - number of new inners after insertion
+
+    RETURN
+    Time consumed by writes
+*/
+static pcm_time_t db_index_insert_writes(DB_index *index, size_t entries, size_t diff_leaves, size_t diff_inners);
 
 static ___inline___ size_t db_index_keys_per_node(const DB_index *index)
 {
-    const double keys_per_node = ceil(((double)index->node_size * index->node_factor) / (double)(index->key_size + sizeof(void *)));
-
-    return (size_t)keys_per_node;
+    return index->keys_per_node;
 }
 
 static ___inline___ size_t db_index_get_leaves_number_for_entries(size_t entries, size_t entry_size, size_t node_size)
@@ -83,38 +324,83 @@ static ___inline___ size_t db_index_get_leaves_number_for_entries(size_t entries
 
 static ___inline___ size_t db_index_get_leaves_number(const DB_index *index)
 {
-    return db_index_get_leaves_number_for_entries(index->num_entries, index->entry_size, (size_t)((double)index->node_size * index->node_factor));
+    return index->level_nodes[0];
 }
 
-static ___inline___ size_t db_index_get_height(const DB_index *index)
+static ___inline___ size_t db_index_get_height_for_leaves(const DB_index *index, size_t leaves)
 {
     const size_t keys_per_node = db_index_keys_per_node(index);
-    const size_t leaves = db_index_get_leaves_number(index);
-    const double height = leaves == 1 ? 1.0 : ceil(DB_INDEX_LOG((double)leaves, (double)keys_per_node));
+    double height;
+
+    if (leaves == 0)
+        return 0;
+
+    height = leaves == 1 ? 1.0 : ceil(DB_INDEX_LOG((double)leaves, (double)keys_per_node));
 
     return (size_t)height + 1;
 }
 
-static ___inline___ size_t db_index_get_inners_number(const DB_index *index)
+static ___inline___ size_t db_index_get_height_for_entries(const DB_index *index, size_t entries)
 {
-    size_t inners = 0;
-    size_t nodes =  db_index_get_leaves_number(index);
-    const size_t keys_per_node = db_index_keys_per_node(index);
+    return db_index_get_height_for_leaves(index, db_index_get_leaves_number_for_entries(entries, index->entry_size, index->leaf_size));
+}
 
+static ___inline___ size_t db_index_get_height(const DB_index *index)
+{
+    return index->leaves_height;
+}
+
+static void db_index_set_num_entries(DB_index *index, size_t entries)
+{
+    size_t nodes;
+    size_t level;
+
+    index->num_entries = entries;
+
+    nodes = db_index_get_leaves_number_for_entries(entries, index->entry_size, index->leaf_size);
+    if (nodes == index->level_nodes[0])
+        return;
+
+    index->level_nodes[0] = nodes;
+    index->leaves_height = db_index_get_height_for_leaves(index, nodes);
+
+    /* go up while number of nodes on level has been changed */
+    level = 0;
     while (nodes > 1)
     {
-        nodes = INT_CEIL_DIV(nodes, keys_per_node);
-        inners += nodes;
+        nodes = INT_CEIL_DIV(nodes, index->keys_per_node);
+        ++level;
+
+        if (level < index->levels)
+        {
+            /* levels above are built from this one, so nothing more to do */
+            if (index->level_nodes[level] == nodes)
+                return;
+
+            index->inners -= index->level_nodes[level];
+        }
+
+        index->level_nodes[level] = nodes;
+        index->inners += nodes;
+    }
+
+    /* tree is lower than before, drop unused levels */
+    for (size_t i = level + 1; i < index->levels; ++i)
+    {
+        index->inners -= index->level_nodes[i];
+        index->level_nodes[i] = 0;
     }
 
-    return inners;
+    index->levels = level + 1;
 }
 
-static double db_index_find_node(DB_index* index)
+static ___inline___ size_t db_index_get_inners_number(const DB_index *index)
 {
-    double time = 0.0;
-    ssize_t j;
+    return index->inners;
+}
 
+static ___inline___ size_t db_index_inner_search_bytes(const DB_index *index)
+{
     switch (index->type)
     {
         case BTREE_NORMAL:
@@ -122,33 +408,287 @@ static double db_index_find_node(DB_index* index)
         case OCBTREE:
         case BTREE_2SECTION_NODE:
         case BTREE_UNSORTED_LEAVES:
+        case BTREE_WITH_BUFFERED_TREE:
         {
             /* everything is sorted so scan each level using binary search */
-            for (j = 0; j < (ssize_t)(index->height - 1); ++j)
-                    time += pcm_read(index->pcm, index->node_size / 2); /* binary search is 2x faster than linera in avg due to cache misses */
+            return index->node_size / 2; /* binary search is 2x faster than linera in avg due to cache misses */
+        }
+        case BTREE_UNSORTED_INNERS_UNSORTED_LEAVES:
+        {
+            /* everything is unsorted so scan each level using linear search */
+            return index->node_size;
+        }
+        case BTREE_SKIP_COST:
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static ___inline___ pcm_time_t db_index_find_node_level(const DB_index *index, size_t times)
+{
+    return pcm_read_many(index->pcm, db_index_inner_search_bytes(index), times);
+}
+
+static size_t db_index_dram_levels(const DB_index *index)
+{
+    const size_t inner_levels = index->height > 1 ? index->height - 1 : 0;
+    const size_t levels = MIN(index->dram_levels, inner_levels);
+    size_t bytes = 0;
+    size_t level;
+    size_t i;
+
+    if (index->dram_budget == 0)
+        return levels;
+
+    /* levels are taken from root while they fit in budget */
+    for (i = 0; i < levels; ++i)
+    {
+        level = inner_levels - i;
+        bytes += (level < index->levels ? MAX(index->level_nodes[level], 1) : 1) * index->node_size;
+        if (bytes > index->dram_budget)
+            return i;
+    }
+
+    return levels;
+}
+
+static pcm_time_t db_index_search_inners(DB_index *index, size_t levels, size_t searches)
+{
+    size_t dram;
+    size_t lines;
+
+    /* all inners stay in DRAM even if height changes between searches */
+    if (index->dram_levels == BTREE_DRAM_INNERS && index->dram_budget == 0)
+        dram = levels;
+    else
+        dram = MIN(levels, db_index_dram_levels(index) * searches);
+
+    lines = INT_CEIL_DIV(db_index_inner_search_bytes(index), index->pcm->mem_line) * dram;
+    index->dram_lines_read += lines;
+
+    return db_index_find_node_level(index, levels - dram) + (pcm_time_t)lines * index->dram_time;
+}
+
+static pcm_time_t db_index_write_inners(DB_index *index, size_t bytes, size_t times)
+{
+    size_t lines;
+
+    if (index->height < 2 || db_index_dram_levels(index) < index->height - 1)
+        return pcm_write_many(index->pcm, bytes, times);
+
+    lines = INT_CEIL_DIV(bytes, index->pcm->mem_line) * times;
+    index->dram_lines_written += lines;
+
+    return (pcm_time_t)lines * index->dram_time;
+}
+
+static pcm_time_t db_index_find_node(DB_index* index, size_t times)
+{
+    if (index->height <= 1)
+        return 0;
+
+    return db_index_search_inners(index, (index->height - 1) * times, times);
+}
+
+static size_t db_index_get_levels_for_entries(const DB_index *index, size_t first, size_t last)
+{
+    size_t levels = 0;
+    size_t height;
+    size_t left;
+    size_t right;
+    size_t middle;
+
+    /* height is monotonic, so sum it per segment with constant height */
+    while (first <= last)
+    {
+        height = db_index_get_height_for_entries(index, first);
+
+        /* binary search for the last number of entries with the same height */
+        left = first;
+        right = last;
+        while (left < right)
+        {
+            middle = left + (right - left + 1) / 2;
+            if (db_index_get_height_for_entries(index, middle) == height)
+                left = middle;
+            else
+                right = middle - 1;
+        }
+
+        if (height > 1)
+            levels += (left - first + 1) * (height - 1);
+
+        if (left == last)
+            break;
+
+        first = left + 1;
+    }
+
+    return levels;
+}
+
+static ___inline___ size_t db_index_get_split_entries(const DB_index *index, size_t entries, size_t diff_leaves)
+{
+    /* entry smaller than leaf can add at most 1 leaf, bigger entry adds a leaf every time */
+    if (index->entry_size <= index->leaf_size)
+        return diff_leaves;
+
+    return entries;
+}
+
+static pcm_time_t db_index_insert_writes(DB_index *index, size_t entries, size_t diff_leaves, size_t diff_inners)
+{
+    pcm_time_t time = 0;
+    size_t flushes;
+
+    const size_t split_entries = db_index_get_split_entries(index, entries, diff_leaves);
+
+    switch (index->type)
+    {
+        case BTREE_NORMAL:
+        {
+            /* insert in sorted order to leaf, so we need to move in avg half node */
+            time += pcm_write_many(index->pcm, index->node_size / 2, entries);
+
+            /* now we can insert entry */
+            time += pcm_write_many(index->pcm, index->entry_size, entries);
+
+            /* we need to insert new pointer to inners, if we need a new leaf */
+
+            /* split node */
+            time += pcm_write_many(index->pcm, index->node_size / 2, split_entries);
+
+            /* insert pointer to leaf into inner */
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), split_entries);
+            time += db_index_write_inners(index, index->node_size / 2, split_entries);
+
+            /* insert new inners */
+
+            /* split node */
+            time += db_index_write_inners(index, index->node_size / 2, diff_inners);
+
+            /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
+            time += db_index_write_inners(index, index->node_size / 2, diff_inners);
+
+            /* write down a key with pointer */
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), diff_inners);
+
+            break;
+        }
+        case BTREE_UNSORTED_LEAVES:
+        {
+            /* we need to write down, new entry at the end */
+            time += pcm_write_many(index->pcm, index->entry_size, entries);
+
+            /* and we need to update bitmap */
+            time += pcm_write_many(index->pcm, 1, entries);
+
+            /* if we need a new leaf, we need to split node, move half of node to another leaf and set bitmap */
+            time += pcm_write_many(index->pcm, index->node_size / 2, split_entries);
+            time += pcm_write_many(index->pcm, 1, split_entries);
+
+            /* insert pointer to leaf into inner */
+            time += db_index_write_inners(index, index->node_size / 2, split_entries);
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), split_entries);
+
+            /* insert new inners */
+
+            /* split node */
+            time += db_index_write_inners(index, index->node_size / 2, diff_inners);
+
+            /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
+            time += db_index_write_inners(index, index->node_size / 2, diff_inners);
+
+            /* write down a key with pointer */
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), diff_inners);
 
             break;
         }
         case BTREE_UNSORTED_INNERS_UNSORTED_LEAVES:
+        case BTREE_2SECTION_NODE:
         {
-            /* everything is unsorted so scan each level using linear search */
-            for (j = 0; j < (ssize_t)(index->height - 1); ++j)
-                time += pcm_read(index->pcm, index->node_size);
+            /* we need to write down, new entry at the end */
+            time += pcm_write_many(index->pcm, index->entry_size, entries);
+
+            /* and we need to update bitmap */
+            time += pcm_write_many(index->pcm, 1, entries);
+
+            /* if we need a new leaf, we need to split node, move half of node to another leaf and set bitmap */
+            time += pcm_write_many(index->pcm, index->node_size / 2, split_entries);
+            time += pcm_write_many(index->pcm, 1, split_entries);
+
+            /* write down key + pointer to the new leaf */
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), split_entries);
+            time += db_index_write_inners(index, 1, split_entries);
+
+            /* split node */
+            time += db_index_write_inners(index, index->node_size / 2, diff_inners);
+
+            /* write down a key with pointer */
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), diff_inners);
+
+            /* and we need to update bitmap */
+            time += db_index_write_inners(index, 1, diff_inners);
 
             break;
         }
-        case BTREE_NORMAL_INNERS_RAM:
-        case CBTREE_INNERS_RAM:
-        case BTREE_2SECTION_NODE_INNERS_RAM:
-        case BTREE_WITH_BUFFERED_TREE:
-        case BTREE_UNSORTED_LEAVES_INNERS_RAM:
+        case CBTREE:
         {
-            /* Inners in RAM so skip */
+            /* insert in sorted order to leaf, so we need to move in avg half node */
+            time += pcm_write_many(index->pcm, index->node_size / 2, entries);
+
+            /* now we can insert entry */
+            time += pcm_write_many(index->pcm, index->entry_size, entries);
+
+            /* split = writing to OVF so it cost only writing entry */
+            index->buffered_operation += diff_leaves;
+            flushes = index->buffered_operation / index->overflow_capacity;
+            index->buffered_operation %= index->overflow_capacity;
+
+            /* insert */
+            time += db_index_write_inners(index, index->node_size / 2, flushes);
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), flushes);
+
+            /* inners are not buffered */
+
+            /* split node */
+            time += db_index_write_inners(index, index->node_size / 2, diff_inners);
+
+            /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
+            time += db_index_write_inners(index, index->node_size / 2, diff_inners);
+
+            /* write down a key with pointer */
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), diff_inners);
+
+            break;
+        }
+        case OCBTREE:
+        {
+            /* insert in sorted order to leaf, so we need to move in avg half node */
+            time += pcm_write_many(index->pcm, index->node_size / 2, entries);
+
+            /* now we can insert entry */
+            time += pcm_write_many(index->pcm, index->entry_size, entries);
+
+            /* split = writing to OVF so it cost only writing entry */
+
+            /* inners are also buffered */
+            index->buffered_operation += diff_leaves + diff_inners;
+            flushes = index->buffered_operation / index->overflow_capacity;
+            index->buffered_operation %= index->overflow_capacity;
+
+            /* insert */
+            time += db_index_write_inners(index, index->node_size / 2, flushes);
+            time += db_index_write_inners(index, index->key_size + sizeof(void *), flushes);
+
             break;
         }
         case BTREE_SKIP_COST:
             break;
-
         default:
             break;
     }
@@ -156,9 +696,247 @@ static double db_index_find_node(DB_index* index)
     return time;
 }
 
+static ___inline___ btree_key_t db_index_engine_new_key(DB_index *index)
+{
+    /* finalizer of SplitMix64 is bijection, so keys are unique */
+    unsigned long long z = ++index->engine_next_key;
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (btree_key_t)(z ^ (z >> 31));
+}
+
+static ___inline___ size_t db_index_engine_random_pos(DB_index *index)
+{
+    size_t r = (size_t)genrand_r(index->rng);
+
+    /* genrand gives 32 bits */
+    if (index->engine->num_entries > 0xffffffffUL)
+        r = (r << 32) | (size_t)genrand_r(index->rng);
+
+    return r % index->engine->num_entries;
+}
+
+static int db_index_engine_add_keys(DB_index *index, const btree_key_t *keys, size_t n)
+{
+    btree_key_t *new_keys;
+    size_t capacity;
+    const size_t used = index->engine->num_entries - n;
+
+    if (used + n > index->engine_keys_capacity)
+    {
+        capacity = MAX(index->engine_keys_capacity * 2, used + n);
+        new_keys = realloc(index->engine_keys, capacity * sizeof(*new_keys));
+        if (new_keys == NULL)
+            ERROR("realloc error\n", 1);
+
+        index->engine_keys = new_keys;
+        index->engine_keys_capacity = capacity;
+    }
+
+    (void)memcpy(&index->engine_keys[used], keys, n * sizeof(*keys));
+
+    return 0;
+}
+
+static ___inline___ void db_index_engine_sync(DB_index *index)
+{
+    index->num_entries = index->engine->num_entries;
+    index->height = index->engine->height;
+    index->dram_lines_read = index->engine->dram_lines_read;
+    index->dram_lines_written = index->engine->dram_lines_written;
+}
+
+static int db_index_engine_key_cmp(const void *a, const void *b)
+{
+    const btree_key_t ka = *(const btree_key_t *)a;
+    const btree_key_t kb = *(const btree_key_t *)b;
+
+    if (ka < kb)
+        return -1;
+
+    return ka > kb ? 1 : 0;
+}
+
+static pcm_time_t db_index_engine_insert(DB_index *index, size_t entries)
+{
+    pcm_time_t time = 0;
+    btree_key_t key;
+    size_t i;
+
+    for (i = 0; i < entries; ++i)
+    {
+        key = db_index_engine_new_key(index);
+        time += btree_insert(index->engine, key, (btree_value_t)index->engine_next_key);
+
+        if (db_index_engine_add_keys(index, &key, 1))
+            break;
+    }
+
+    db_index_engine_sync(index);
+    db_stat_update_index_time_r(index->stat, time);
+    return time;
+}
+
+static pcm_time_t db_index_engine_bulkload(DB_index *index, size_t entries)
+{
+    pcm_time_t time = 0;
+    btree_key_t *keys;
+    btree_value_t *values;
+    size_t i;
+
+    if (entries == 0)
+        return 0;
+
+    keys = malloc(entries * sizeof(*keys));
+    values = malloc(entries * sizeof(*values));
+    if (keys == NULL || values == NULL)
+    {
+        FREE(keys);
+        FREE(values);
+        ERROR("malloc error\n", 0);
+    }
+
+    for (i = 0; i < entries; ++i)
+        keys[i] = db_index_engine_new_key(index);
+
+    /* sorting is done in RAM, so it is not charged */
+    qsort(keys, entries, sizeof(*keys), db_index_engine_key_cmp);
+
+    for (i = 0; i < entries; ++i)
+        values[i] = (btree_value_t)keys[i];
+
+    time = db_index_engine_bulkload_pairs(index, keys, values, entries);
+
+    FREE(keys);
+    FREE(values);
+
+    return time;
+}
+
+static pcm_time_t db_index_engine_bulkload_pairs(DB_index *index, const btree_key_t *keys, const btree_value_t *values, size_t entries)
+{
+    pcm_time_t time;
+
+    time = btree_bulkload(index->engine, keys, values, entries, index->node_factor);
+    (void)db_index_engine_add_keys(index, keys, entries);
+
+    db_index_engine_sync(index);
+    db_stat_update_index_time_r(index->stat, time);
+    return time;
+}
+
+static pcm_time_t db_index_engine_point_search(DB_index *index, size_t entries)
+{
+    pcm_time_t time = 0;
+    bool found;
+    size_t i;
+
+    if (index->engine->num_entries == 0)
+        return 0;
+
+    for (i = 0; i < entries; ++i)
+        time += btree_search(index->engine, index->engine_keys[db_index_engine_random_pos(index)], NULL, &found);
+
+    db_stat_update_index_time_r(index->stat, time);
+    return time;
+}
+
+static pcm_time_t db_index_engine_range_search(DB_index *index, size_t entries)
+{
+    pcm_time_t time;
+
+    if (index->engine->num_entries == 0)
+        return 0;
+
+    time = btree_range_search(index->engine, index->engine_keys[db_index_engine_random_pos(index)], entries, NULL);
+
+    db_stat_update_index_time_r(index->stat, time);
+    return time;
+}
+
+static pcm_time_t db_index_engine_delete(DB_index *index, size_t entries)
+{
+    pcm_time_t time = 0;
+    size_t pos;
+    size_t i;
+
+    entries = MIN(entries, index->engine->num_entries);
+    for (i = 0; i < entries; ++i)
+    {
+        pos = db_index_engine_random_pos(index);
+        time += btree_delete(index->engine, index->engine_keys[pos], NULL);
+
+        /* engine has already removed key, so num_entries is the last position */
+        index->engine_keys[pos] = index->engine_keys[index->engine->num_entries];
+    }
+
+    db_index_engine_sync(index);
+    db_stat_update_index_time_r(index->stat, time);
+    return time;
+}
+
+DB_index *db_index_create_engine(PCM *pcm, Genrand *rng, size_t key_size, size_t entry_size, size_t node_size, double node_factor, btree_type_t btree_type)
+{
+    DB_index *index;
+    unsigned int flags = 0;
+
+    TRACE();
+
+    switch (btree_type)
+    {
+        case BTREE_NORMAL:
+            break;
+        case BTREE_NORMAL_INNERS_RAM:
+            flags = BTREE_FLAG_INNERS_IN_RAM;
+            break;
+        case BTREE_UNSORTED_LEAVES:
+            flags = BTREE_FLAG_UNSORTED_LEAVES;
+            break;
+        case BTREE_UNSORTED_LEAVES_INNERS_RAM:
+            flags = BTREE_FLAG_UNSORTED_LEAVES | BTREE_FLAG_INNERS_IN_RAM;
+            break;
+        case CBTREE:
+            flags = BTREE_FLAG_LEAF_OVERFLOW;
+            break;
+        case CBTREE_INNERS_RAM:
+            flags = BTREE_FLAG_LEAF_OVERFLOW | BTREE_FLAG_INNERS_IN_RAM;
+            break;
+        case OCBTREE:
+            flags = BTREE_FLAG_LEAF_OVERFLOW | BTREE_FLAG_INNER_OVERFLOW;
+            break;
+        default:
+            ERROR("B+Tree type is not supported by engine\n", NULL);
+    }
+
+    index = db_index_create(pcm, key_size, entry_size, node_size, node_factor, btree_type);
+    if (index == NULL)
+        ERROR("db_index_create error\n", NULL);
+
+    index->engine = btree_create(pcm, key_size, entry_size, node_size, flags);
+    if (index->engine == NULL)
+    {
+        db_index_destroy(index);
+        ERROR("btree_create error\n", NULL);
+    }
+
+    index->engine_keys = malloc(DB_INDEX_ENGINE_INIT_KEYS * sizeof(*index->engine_keys));
+    if (index->engine_keys == NULL)
+    {
+        db_index_destroy(index);
+        ERROR("malloc error\n", NULL);
+    }
+
+    index->engine_keys_capacity = DB_INDEX_ENGINE_INIT_KEYS;
+    index->rng = rng == NULL ? genrand_default() : rng;
+
+    return index;
+}
+
 DB_index *db_index_create(PCM *pcm, size_t key_size, size_t entry_size, size_t node_size, double node_factor, btree_type_t btree_type)
 {
     DB_index *index;
+    double keys_per_node;
 
     TRACE();
 
@@ -167,15 +945,76 @@ DB_index *db_index_create(PCM *pcm, size_t key_size, size_t entry_size, size_t n
         ERROR("malloc error\n", NULL);
 
     index->pcm = pcm;
+    index->stat = db_stat_get_default();
     index->key_size = key_size;
     index->entry_size = entry_size;
     index->node_size = node_size;
     index->node_factor = node_factor;
     index->type = btree_type;
 
+    keys_per_node = ceil(((double)node_size * node_factor) / (double)(key_size + sizeof(void *)));
+    index->keys_per_node = (size_t)keys_per_node;
+    index->leaf_size = (size_t)((double)node_size * node_factor);
+    (void)memset(index->level_nodes, 0, sizeof(index->level_nodes));
+    index->levels = 1;
+    index->inners = 0;
+    index->leaves_height = 0;
+
     index->num_entries = 0;
     index->height = 0;
     index->buffered_operation = 0;
+    index->overflow_capacity = btree_type == OCBTREE ? OCBTREE_OPERATION_BUFFER_SIZE : CBTREE_OPERATION_BUFFER_SIZE;
+
+    /* *_INNERS_RAM are base types with all inners in DRAM, so only placement charges their inners */
+    switch (btree_type)
+    {
+        case BTREE_NORMAL_INNERS_RAM:
+        {
+            index->type = BTREE_NORMAL;
+            index->dram_levels = BTREE_DRAM_INNERS;
+            break;
+        }
+        case BTREE_UNSORTED_LEAVES_INNERS_RAM:
+        {
+            index->type = BTREE_UNSORTED_LEAVES;
+            index->dram_levels = BTREE_DRAM_INNERS;
+            break;
+        }
+        case CBTREE_INNERS_RAM:
+        {
+            index->type = CBTREE;
+            index->dram_levels = BTREE_DRAM_INNERS;
+            break;
+        }
+        case BTREE_2SECTION_NODE_INNERS_RAM:
+        {
+            index->type = BTREE_2SECTION_NODE;
+            index->dram_levels = BTREE_DRAM_INNERS;
+            break;
+        }
+        case BTREE_WITH_BUFFERED_TREE:
+        {
+            /* inners are in RAM and their access is free */
+            index->dram_levels = BTREE_DRAM_INNERS;
+            break;
+        }
+        default:
+        {
+            index->dram_levels = 0;
+            break;
+        }
+    }
+
+    index->dram_budget = 0;
+    index->dram_time = 0;
+    index->dram_lines_read = 0;
+    index->dram_lines_written = 0;
+
+    index->engine = NULL;
+    index->rng = NULL;
+    index->engine_keys = NULL;
+    index->engine_keys_capacity = 0;
+    index->engine_next_key = 0;
 
     return index;
 }
@@ -187,260 +1026,213 @@ void db_index_destroy(DB_index *index)
     if (index == NULL)
         return;
 
+    btree_destroy(index->engine);
+    FREE(index->engine_keys);
     FREE(index);
 }
 
-double db_index_insert(DB_index *index, size_t entries)
+void db_index_set_stat(DB_index *index, DB_stat *stat)
 {
-    double time = 0.0;
-
-    size_t old_leaves;
-    size_t new_leaves;
-    size_t diff_leaves;
-    size_t old_inners;
-    size_t new_inners;
-    size_t diff_inners;
-
-    size_t i;
-    ssize_t j;
-
     TRACE();
 
-    if (index->type == BTREE_WITH_BUFFERED_TREE)
-    {
-        index->buffered_operation += entries;
-        if (index->buffered_operation >= BTREE_WITH_BUFFERED_TREE_BUFFER_SIZE)
-        {
-            index->num_entries += entries;
-
-            const size_t entries_to_insert = index->buffered_operation;
-            index->buffered_operation = 0;
-            /* temp workaround for breaking the unreal, perfect cache line insertion */
-            time = db_index_bulkload(index, entries_to_insert) * 4.0;
-            db_stat_update_index_time(time * 3);
-
-            /* we added them during buffering and in bulkload so sub bulklaod */
-            index->num_entries -= entries_to_insert;
-
-            return time;
-        }
-    }
-
-    for (i = 0; i < entries; ++i)
-    {
-        /* Find place to insert new data */
-        time += db_index_find_node(index);
-
-        /* check numbers of inners */
-        old_inners = db_index_get_inners_number(index);
-
-        /* check numbers of leaves */
-        old_leaves = db_index_get_leaves_number(index);
+    index->stat = stat;
+}
 
-        /* note insert */
-        ++index->num_entries;
+int db_index_set_overflow_capacity(DB_index *index, size_t capacity)
+{
+    TRACE();
 
-        new_inners = db_index_get_inners_number(index);
-        new_leaves = db_index_get_leaves_number(index);
+    if (capacity == 0)
+        ERROR("Overflow capacity has to be positive\n", 1);
 
-        diff_inners = new_inners - old_inners;
-        diff_leaves = new_leaves - old_leaves;
-        switch (index->type)
-        {
-            case BTREE_NORMAL:
-            {
-                /* insert in sorted order to leaf, so we need to move in avg half node */
-                time += pcm_write(index->pcm, index->node_size / 2);
+    if (index->engine != NULL && btree_set_overflow_capacity(index->engine, capacity))
+        ERROR("btree_set_overflow_capacity error\n", 1);
 
-                /* now we can insert entry */
-                time += pcm_write(index->pcm, index->entry_size);
+    index->overflow_capacity = capacity;
 
-                /* we need to insert new pointer to inners, if we need a new leaf */
-                if (diff_leaves > 0)
-                {
-                    /* split node */
-                    time += pcm_write(index->pcm, index->node_size / 2);
+    return 0;
+}
 
-                    /* insert pointer to leaf into inner */
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
-                    time += pcm_write(index->pcm, index->node_size / 2);
+void db_index_set_placement(DB_index *index, size_t dram_levels, size_t dram_budget, pcm_time_t dram_time)
+{
+    TRACE();
 
-                    /* insert new inners */
-                    for (j = 0; j < (ssize_t)diff_inners; ++j)
-                    {
-                        /* split node */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+    if (index->engine != NULL)
+        btree_set_placement(index->engine, dram_levels, dram_budget, dram_time);
 
-                        /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+    index->dram_levels = dram_levels;
+    index->dram_budget = dram_budget;
+    index->dram_time = dram_time;
+}
 
-                        /* write down a key with pointer */
-                        time += pcm_write(index->pcm, index->key_size + sizeof(void *));
-                    }
-                }
+size_t db_index_dram_footprint(const DB_index *index)
+{
+    size_t levels;
+    size_t nodes = 0;
+    size_t level;
+    size_t i;
 
-                break;
-            }
-            case BTREE_UNSORTED_LEAVES:
-            {
-                /* we need to write down, new entry at the end */
-                time += pcm_write(index->pcm, index->entry_size);
+    TRACE();
 
-                /* and we need to update bitmap */
-                time += pcm_write(index->pcm, 1);
+    if (index->engine != NULL)
+        return btree_dram_footprint(index->engine);
 
-                if (diff_leaves > 0)
-                {
-                    /* if we need a new leaf, we need to split node, move half of node to another leaf and set bitmap */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, 1);
+    levels = db_index_dram_levels(index);
+    for (i = 0; i < levels; ++i)
+    {
+        level = index->height - 1 - i;
+        nodes += level < index->levels ? MAX(index->level_nodes[level], 1) : 1;
+    }
 
-                    /* insert pointer to leaf into inner */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+    return nodes * index->node_size;
+}
 
-                    /* insert new inners */
-                    for (j = 0; j < (ssize_t)diff_inners; ++j)
-                    {
-                        /* split node */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+pcm_time_t db_index_insert(DB_index *index, size_t entries)
+{
+    pcm_time_t time = 0;
 
-                        /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+    size_t old_leaves;
+    size_t new_leaves;
+    size_t old_inners;
+    size_t new_inners;
 
-                        /* write down a key with pointer */
-                        time += pcm_write(index->pcm, index->key_size + sizeof(void *));
-                    }
-                }
+    TRACE();
 
-                break;
-            }
-            case BTREE_UNSORTED_INNERS_UNSORTED_LEAVES:
-            case BTREE_2SECTION_NODE:
-            {
-                /* we need to write down, new entry at the end */
-                time += pcm_write(index->pcm, index->entry_size);
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
 
-                /* and we need to update bitmap */
-                time += pcm_write(index->pcm, 1);
+    if (index->engine != NULL)
+        return db_index_engine_insert(index, entries);
 
-                if (diff_leaves > 0)
-                {
-                    /* if we need a new leaf, we need to split node, move half of node to another leaf and set bitmap */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, 1);
+    if (index->type == BTREE_WITH_BUFFERED_TREE)
+    {
+        index->buffered_operation += entries;
+        if (index->buffered_operation >= BTREE_WITH_BUFFERED_TREE_BUFFER_SIZE)
+        {
+            db_index_set_num_entries(index, index->num_entries + entries);
 
-                    /* write down key + pointer to the new leaf */
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
-                    time += pcm_write(index->pcm, 1);
+            const size_t entries_to_insert = index->buffered_operation;
+            index->buffered_operation = 0;
+            /* temp workaround for breaking the unreal, perfect cache line insertion */
+            time = db_index_bulkload(index, entries_to_insert) * 4;
+            db_stat_update_index_time_r(index->stat, time * 3);
 
-                    for (j = 0; j < (ssize_t)diff_inners; ++j)
-                    {
-                        /* split node */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+            /* we added them during buffering and in bulkload so sub bulklaod */
+            db_index_set_num_entries(index, index->num_entries - entries_to_insert);
 
-                        /* write down a key with pointer */
-                        time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+            return time;
+        }
+    }
 
-                        /* and we need to update bitmap */
-                        time += pcm_write(index->pcm, 1);
-                    }
-                }
-                break;
-            }
-            case CBTREE:
-            {
-                /* insert in sorted order to leaf, so we need to move in avg half node */
-                time += pcm_write(index->pcm, index->node_size / 2);
+    if (entries == 0)
+    {
+        index->height = db_index_get_height(index);
+        db_stat_update_index_time_r(index->stat, time);
+        return time;
+    }
 
-                /* now we can insert entry */
-                time += pcm_write(index->pcm, index->entry_size);
+    /* Find place to insert new data (height is updated after whole insertion) */
+    time += db_index_find_node(index, entries);
 
-                /* split = writing to OVF so it cost only writing entry */
+    /* check numbers of inners and leaves */
+    old_inners = db_index_get_inners_number(index);
+    old_leaves = db_index_get_leaves_number(index);
 
-                index->buffered_operation += diff_leaves;
-                while (index->buffered_operation >= CBTREE_OPERATION_BUFFER_SIZE)
-                {
-                    /* insert */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+    /* note insert */
+    db_index_set_num_entries(index, index->num_entries + entries);
 
-                    index->buffered_operation -= CBTREE_OPERATION_BUFFER_SIZE;
-                }
+    new_inners = db_index_get_inners_number(index);
+    new_leaves = db_index_get_leaves_number(index);
 
-                /* inners are not buffered */
-                for (j = 0; j < (ssize_t)diff_inners; ++j)
-                {
-                    /* split node */
-                    time += pcm_write(index->pcm, index->node_size / 2);
+    /* new inners belong to the new height, so DRAM placement sees them */
+    index->height = db_index_get_height(index);
+    time += db_index_insert_writes(index, entries, new_leaves - old_leaves, new_inners - old_inners);
 
-                    /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                    time += pcm_write(index->pcm, index->node_size / 2);
+    db_stat_update_index_time_r(index->stat, time);
+    return time;
+}
 
-                    /* write down a key with pointer */
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
-                }
+pcm_time_t db_index_insert_batch(DB_index *index, size_t entries)
+{
+    pcm_time_t time = 0;
+    pcm_time_t _time;
+    size_t flushes;
+    size_t levels;
+    size_t leaves;
 
-                break;
-            }
-            case OCBTREE:
-            {
-                /* insert in sorted order to leaf, so we need to move in avg half node */
-                time += pcm_write(index->pcm, index->node_size / 2);
+    size_t old_leaves;
+    size_t new_leaves;
+    size_t old_inners;
+    size_t new_inners;
 
-                /* now we can insert entry */
-                time += pcm_write(index->pcm, index->entry_size);
+    TRACE();
 
-                /* split = writing to OVF so it cost only writing entry */
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
 
-                /* inners are also buffered */
-                index->buffered_operation += diff_leaves + diff_inners;
-                while (index->buffered_operation >= OCBTREE_OPERATION_BUFFER_SIZE)
-                {
-                    /* insert */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+    if (index->engine != NULL)
+        return db_index_engine_insert(index, entries);
 
-                    index->buffered_operation -= OCBTREE_OPERATION_BUFFER_SIZE;
-                }
+    if (entries == 0)
+        return 0;
 
-                break;
-            }
-            case BTREE_NORMAL_INNERS_RAM:
-            case CBTREE_INNERS_RAM: /* OVF nodes do nothing if it is in RAM */
-            {
-                /* insert in sorted order to leaf, so we need to move in avg half node */
-                time += pcm_write(index->pcm, index->node_size / 2);
+    if (index->type == BTREE_WITH_BUFFERED_TREE)
+    {
+        /* every single insert fills buffer by 1, full buffer is flushed via bulkload */
+        index->buffered_operation += entries;
+        flushes = index->buffered_operation / BTREE_WITH_BUFFERED_TREE_BUFFER_SIZE;
+        index->buffered_operation %= BTREE_WITH_BUFFERED_TREE_BUFFER_SIZE;
 
-                /* now we can insert entry */
-                time += pcm_write(index->pcm, index->entry_size);
-                break;
-            }
-            case BTREE_UNSORTED_LEAVES_INNERS_RAM:
-            case BTREE_2SECTION_NODE_INNERS_RAM:
-            {
-                /* we need to write down, new entry at the end */
-                time += pcm_write(index->pcm, index->entry_size);
+        if (flushes > 0)
+        {
+            /* inners are in RAM, so each bulkload of full buffer costs only building the same number of leaves */
+            leaves = db_index_get_leaves_number_for_entries(BTREE_WITH_BUFFERED_TREE_BUFFER_SIZE, index->entry_size, index->leaf_size);
+            _time = pcm_write_many(index->pcm, index->leaf_size * leaves, flushes);
+            db_stat_update_index_time_r(index->stat, _time);
 
-                /* and we need to update bitmap */
-                time += pcm_write(index->pcm, 1);
-                break;
-            }
-            case BTREE_SKIP_COST:
-                break;
-            default:
-                break;
+            /* temp workaround for breaking the unreal, perfect cache line insertion */
+            time = _time * 4;
+            db_stat_update_index_time_r(index->stat, time * 3);
         }
+
+        db_index_set_num_entries(index, index->num_entries + entries);
+
+        /* if last insert flushed buffer, height was taken during bulkload (with buffer counted twice) */
+        if (flushes > 0 && index->buffered_operation == 0)
+            index->height = db_index_get_height_for_entries(index, index->num_entries + BTREE_WITH_BUFFERED_TREE_BUFFER_SIZE);
+        else
+            index->height = db_index_get_height(index);
+
+        return time;
+    }
+
+    /* first insert uses current height, next ones height after previous insert */
+    time += db_index_find_node(index, 1);
+    if (entries > 1)
+    {
+        levels = db_index_get_levels_for_entries(index, index->num_entries + 1, index->num_entries + entries - 1);
+        time += db_index_search_inners(index, levels, entries - 1);
     }
 
+    /* check numbers of inners and leaves */
+    old_inners = db_index_get_inners_number(index);
+    old_leaves = db_index_get_leaves_number(index);
+
+    /* note insert */
+    db_index_set_num_entries(index, index->num_entries + entries);
+
+    new_inners = db_index_get_inners_number(index);
+    new_leaves = db_index_get_leaves_number(index);
+
+    /* new inners belong to the new height, so DRAM placement sees them */
     index->height = db_index_get_height(index);
-    db_stat_update_index_time(time);
+    time += db_index_insert_writes(index, entries, new_leaves - old_leaves, new_inners - old_inners);
+
+    db_stat_update_index_time_r(index->stat, time);
     return time;
 }
 
-double db_index_bulkload(DB_index *index, size_t entries)
+pcm_time_t db_index_bulkload(DB_index *index, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     size_t diff_leaves;
     size_t old_inners;
@@ -452,12 +1244,17 @@ double db_index_bulkload(DB_index *index, size_t entries)
 
     TRACE();
 
-    diff_leaves = db_index_get_leaves_number_for_entries(entries, index->entry_size, (size_t)((double)index->node_size * index->node_factor));
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
+
+    if (index->engine != NULL)
+        return db_index_engine_bulkload(index, entries);
+
+    diff_leaves = db_index_get_leaves_number_for_entries(entries, index->entry_size, index->leaf_size);
 
     /* check numbers of inners */
     old_inners = db_index_get_inners_number(index);
     /* note insert */
-    index->num_entries += entries;
+    db_index_set_num_entries(index, index->num_entries + entries);
 
     /* check number of inners after "fake" insertions to get a diff */
     new_inners = db_index_get_inners_number(index);
@@ -466,11 +1263,14 @@ double db_index_bulkload(DB_index *index, size_t entries)
 
     /* build leaves */
     if (index->type !=  BTREE_SKIP_COST)
-        time += pcm_write(index->pcm, (size_t)((double)index->node_size * index->node_factor) * diff_leaves);
+        time += pcm_write(index->pcm, index->leaf_size * diff_leaves);
 
     /* find place for each leaf */
     for (i = 0; i < diff_leaves; ++i)
-        time += db_index_find_node(index);
+        time += db_index_find_node(index, 1);
+
+    /* new inners belong to the new height, so DRAM placement sees them */
+    index->height = db_index_get_height(index);
 
     switch (index->type)
     {
@@ -478,25 +1278,25 @@ double db_index_bulkload(DB_index *index, size_t entries)
         case BTREE_UNSORTED_LEAVES:
         {
             /* make a gap, or move to another inner */
-            time += pcm_write(index->pcm, index->node_size / 2);
+            time += db_index_write_inners(index, index->node_size / 2, 1);
 
             for (i = 0; i < diff_leaves; ++i)
             {
                 /* write down a key with pointer */
-                time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
             }
 
             /* insert new inners */
             for (j = 0; j < (ssize_t)diff_inners; ++j)
             {
                 /* split node */
-                time += pcm_write(index->pcm, index->node_size / 2);
+                time += db_index_write_inners(index, index->node_size / 2, 1);
 
                 /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                time += pcm_write(index->pcm, index->node_size / 2);
+                time += db_index_write_inners(index, index->node_size / 2, 1);
 
                 /* write down a key with pointer */
-                time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
             }
 
             break;
@@ -507,22 +1307,22 @@ double db_index_bulkload(DB_index *index, size_t entries)
             for (i = 0; i < diff_leaves; ++i)
             {
                 /* write down a key with pointer at the end */
-                time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
                 /* update bitmap */
-                time += pcm_write(index->pcm, 1);
+                time += db_index_write_inners(index, 1, 1);
             }
 
             for (j = 0; j < (ssize_t)diff_inners; ++j)
             {
                 /* split node */
-                time += pcm_write(index->pcm, index->node_size / 2);
+                time += db_index_write_inners(index, index->node_size / 2, 1);
 
                 /* write down a key with pointer */
-                time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
                 /* and we need to update bitmap */
-                time += pcm_write(index->pcm, 1);
+                time += db_index_write_inners(index, 1, 1);
             }
 
             break;
@@ -531,24 +1331,24 @@ double db_index_bulkload(DB_index *index, size_t entries)
         {
             index->buffered_operation += diff_leaves;
 
-            while (index->buffered_operation >= CBTREE_OPERATION_BUFFER_SIZE)
+            while (index->buffered_operation >= index->overflow_capacity)
             {
-                time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
-                index->buffered_operation -= CBTREE_OPERATION_BUFFER_SIZE;
+                index->buffered_operation -= index->overflow_capacity;
             }
 
             /* inners are not buffered */
             for (j = 0; j < (ssize_t)diff_inners; ++j)
             {
                 /* split node */
-                time += pcm_write(index->pcm, index->node_size / 2);
+                time += db_index_write_inners(index, index->node_size / 2, 1);
 
                 /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                time += pcm_write(index->pcm, index->node_size / 2);
+                time += db_index_write_inners(index, index->node_size / 2, 1);
 
                 /* write down a key with pointer */
-                time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
             }
 
             break;
@@ -557,19 +1357,15 @@ double db_index_bulkload(DB_index *index, size_t entries)
         {
             /* inners are also buffered */
             index->buffered_operation += diff_inners;
-            while (index->buffered_operation >= OCBTREE_OPERATION_BUFFER_SIZE)
+            while (index->buffered_operation >= index->overflow_capacity)
             {
                 /* insert */
-                time += pcm_write(index->pcm, index->node_size / 2);
-                time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                time += db_index_write_inners(index, index->node_size / 2, 1);
+                time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
-                index->buffered_operation -= OCBTREE_OPERATION_BUFFER_SIZE;
+                index->buffered_operation -= index->overflow_capacity;
             }
         }
-        case BTREE_NORMAL_INNERS_RAM:
-        case BTREE_UNSORTED_LEAVES_INNERS_RAM:
-        case CBTREE_INNERS_RAM:
-        case BTREE_2SECTION_NODE_INNERS_RAM:
         case BTREE_WITH_BUFFERED_TREE:
         {
             /* leaves have been built. So inners stuffs cost as nothing */
@@ -581,21 +1377,25 @@ double db_index_bulkload(DB_index *index, size_t entries)
             break;
     }
 
-    db_stat_update_index_time(time);
+    db_stat_update_index_time_r(index->stat, time);
 
     index->height = db_index_get_height(index);
     return time;
 }
 
-double db_index_point_search(DB_index *index, size_t entries)
+pcm_time_t db_index_point_search(DB_index *index, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     size_t i;
-    ssize_t j;
 
     TRACE();
 
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
+
+    if (index->engine != NULL)
+        return db_index_engine_point_search(index, entries);
+
     for (i = 0; i < entries; ++i)
     {
         switch (index->type)
@@ -606,7 +1406,8 @@ double db_index_point_search(DB_index *index, size_t entries)
             case BTREE_2SECTION_NODE:
             {
                 /* everything is sorted so scan each level using binary search */
-                for (j = 0; j < (ssize_t)index->height; ++j)
+                time += db_index_find_node(index, 1);
+                if (index->height > 0)
                     time += pcm_read(index->pcm, index->node_size / 2); /* binary search is 2x faster than linera in avg due to cache misses */
 
                 break;
@@ -614,9 +1415,7 @@ double db_index_point_search(DB_index *index, size_t entries)
             case BTREE_UNSORTED_LEAVES:
             {
                 /* scan inner using binary search */
-                for (j = 0; j < (ssize_t)(index->height - 1); ++j)
-                    time += pcm_read(index->pcm, index->node_size / 2); /* binary search is 2x faster than linera in avg due to cache misses */
-
+                time += db_index_find_node(index, 1);
 
                 /* scan unsorted leaf */
                 time += pcm_read(index->pcm, index->node_size);
@@ -626,26 +1425,19 @@ double db_index_point_search(DB_index *index, size_t entries)
             case BTREE_UNSORTED_INNERS_UNSORTED_LEAVES:
             {
                 /* everything is unsorted so scan each level using linear search */
-                for (j = 0; j < (ssize_t)index->height; ++j)
+                time += db_index_find_node(index, 1);
+                if (index->height > 0)
                     time += pcm_read(index->pcm, index->node_size);
 
                 break;
             }
-            case BTREE_NORMAL_INNERS_RAM:
-            case CBTREE_INNERS_RAM:
-            case BTREE_2SECTION_NODE_INNERS_RAM:
             case BTREE_WITH_BUFFERED_TREE:
             {
-                /* scan sorted leaf */
+                /* inners are placed in DRAM, scan sorted leaf */
+                time += db_index_find_node(index, 1);
                 time += pcm_read(index->pcm, index->node_size / 2); /* binary search is 2x faster than linera in avg due to cache misses */
                 break;
             }
-            case BTREE_UNSORTED_LEAVES_INNERS_RAM:
-            {
-                /* scan unsortef leaf */
-                time += pcm_read(index->pcm, index->node_size);
-                break;
-            }
             case BTREE_SKIP_COST:
                 break;
 
@@ -654,35 +1446,40 @@ double db_index_point_search(DB_index *index, size_t entries)
         }
     }
 
-    db_stat_update_index_time(time);
+    db_stat_update_index_time_r(index->stat, time);
     return time;
 }
 
-double db_index_range_search(DB_index *index, size_t entries)
+pcm_time_t db_index_range_search(DB_index *index, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     size_t leaves;
 
     TRACE();
 
-    leaves = db_index_get_leaves_number_for_entries(entries, index->entry_size, (size_t)((double)index->node_size * index->node_factor));
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
+
+    if (index->engine != NULL)
+        return db_index_engine_range_search(index, entries);
+
+    leaves = db_index_get_leaves_number_for_entries(entries, index->entry_size, index->leaf_size);
 
     /* seek 1st leaf */
-    time += db_index_find_node(index);
+    time += db_index_find_node(index, 1);
 
     /* scan all */
     if (index->type != BTREE_SKIP_COST)
-        time += pcm_read(index->pcm, leaves * (size_t)((double)index->node_size * index->node_factor));
+        time += pcm_read(index->pcm, leaves * index->leaf_size);
 
 
-    db_stat_update_index_time(time);
+    db_stat_update_index_time_r(index->stat, time);
     return time;
 }
 
-double db_index_delete(DB_index *index, size_t entries)
+pcm_time_t db_index_delete(DB_index *index, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     size_t old_leaves;
     size_t new_leaves;
@@ -698,6 +1495,11 @@ double db_index_delete(DB_index *index, size_t entries)
 
     TRACE();
 
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
+
+    if (index->engine != NULL)
+        return db_index_engine_delete(index, entries);
+
     /*
         delete = drop during merge
         so we will update the same bitmap,
@@ -705,15 +1507,15 @@ double db_index_delete(DB_index *index, size_t entries)
     */
     if (index->type == BTREE_WITH_BUFFERED_TREE)
     {
-        index->num_entries -= entries;
+        db_index_set_num_entries(index, index->num_entries - entries);
 
-        return 0.0;
+        return 0;
     }
 
     for (i = 0; i < entries; ++i)
     {
         /* Find place to delete data */
-        time += db_index_find_node(index);
+        time += db_index_find_node(index, 1);
 
         /* check numbers of inners */
         old_inners = db_index_get_inners_number(index);
@@ -722,7 +1524,7 @@ double db_index_delete(DB_index *index, size_t entries)
         old_leaves = db_index_get_leaves_number(index);
 
         /* note delete */
-        --index->num_entries;
+        db_index_set_num_entries(index, index->num_entries - 1);
 
         new_inners = db_index_get_inners_number(index);
         new_leaves = db_index_get_leaves_number(index);
@@ -746,20 +1548,20 @@ double db_index_delete(DB_index *index, size_t entries)
                     time += pcm_write(index->pcm, index->node_size / 2);
 
                     /* insert pointer to leaf into inner */
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
-                    time += pcm_write(index->pcm, index->node_size / 2);
+                    time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
+                    time += db_index_write_inners(index, index->node_size / 2, 1);
 
                     /* insert new inners */
                     for (j = 0; j < (ssize_t)diff_inners; ++j)
                     {
                         /* merge node */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+                        time += db_index_write_inners(index, index->node_size / 2, 1);
 
                         /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+                        time += db_index_write_inners(index, index->node_size / 2, 1);
 
                         /* write down a key with pointer */
-                        time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                        time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
                     }
                 }
 
@@ -780,20 +1582,20 @@ double db_index_delete(DB_index *index, size_t entries)
                     time += pcm_write(index->pcm, 1);
 
                     /* insert pointer to leaf into inner */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                    time += db_index_write_inners(index, index->node_size / 2, 1);
+                    time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
                     /* insert new inners */
                     for (j = 0; j < (ssize_t)diff_inners; ++j)
                     {
                         /* merge node */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+                        time += db_index_write_inners(index, index->node_size / 2, 1);
 
                         /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+                        time += db_index_write_inners(index, index->node_size / 2, 1);
 
                         /* write down a key with pointer */
-                        time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                        time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
                     }
                 }
 
@@ -815,19 +1617,19 @@ double db_index_delete(DB_index *index, size_t entries)
                     time += pcm_write(index->pcm, 1);
 
                     /* write down key + pointer to the new leaf */
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
-                    time += pcm_write(index->pcm, 1);
+                    time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
+                    time += db_index_write_inners(index, 1, 1);
 
                     for (j = 0; j < (ssize_t)diff_inners; ++j)
                     {
                         /* merge node */
-                        time += pcm_write(index->pcm, index->node_size / 2);
+                        time += db_index_write_inners(index, index->node_size / 2, 1);
 
                         /* write down a key with pointer */
-                        time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                        time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
                         /* and we need to update bitmap */
-                        time += pcm_write(index->pcm, 1);
+                        time += db_index_write_inners(index, 1, 1);
                     }
                 }
                 break;
@@ -841,28 +1643,28 @@ double db_index_delete(DB_index *index, size_t entries)
                 time += pcm_write(index->pcm, index->entry_size);
 
                 index->buffered_operation += diff_leaves;
-                while (index->buffered_operation >= CBTREE_OPERATION_BUFFER_SIZE)
+                while (index->buffered_operation >= index->overflow_capacity)
                 {
                     /* merge node */
                     time += pcm_write(index->pcm, index->node_size / 2);
 
                     /* insert */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                    time += db_index_write_inners(index, index->node_size / 2, 1);
+                    time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
-                    index->buffered_operation -= CBTREE_OPERATION_BUFFER_SIZE;
+                    index->buffered_operation -= index->overflow_capacity;
                 }
 
                 /* inners are not buffered */
                 for (j = 0; j < (ssize_t)diff_inners; ++j)
                 {
                     /* merge node */
-                    time += pcm_write(index->pcm, index->node_size / 2);
+                    time += db_index_write_inners(index, index->node_size / 2, 1);
 
                     /* we need a new pointer in inner node, but inners are sorted so make a gap, or move to new inner */
-                    time += pcm_write(index->pcm, index->node_size / 2);
+                    time += db_index_write_inners(index, index->node_size / 2, 1);
                     /* write down a key with pointer */
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                    time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
                 }
 
                 break;
@@ -877,37 +1679,17 @@ double db_index_delete(DB_index *index, size_t entries)
 
                 /* inners are also buffered */
                 index->buffered_operation += diff_leaves + diff_inners;
-                while (index->buffered_operation >= OCBTREE_OPERATION_BUFFER_SIZE)
+                while (index->buffered_operation >= index->overflow_capacity)
                 {
                     /* insert */
-                    time += pcm_write(index->pcm, index->node_size / 2);
-                    time += pcm_write(index->pcm, index->key_size + sizeof(void *));
+                    time += db_index_write_inners(index, index->node_size / 2, 1);
+                    time += db_index_write_inners(index, index->key_size + sizeof(void *), 1);
 
-                    index->buffered_operation -= OCBTREE_OPERATION_BUFFER_SIZE;
+                    index->buffered_operation -= index->overflow_capacity;
                 }
 
                 break;
             }
-            case BTREE_NORMAL_INNERS_RAM:
-            case CBTREE_INNERS_RAM:
-            {
-                /* delete from sorted order to leaf, so we need to move in avg half node */
-                time += pcm_write(index->pcm, index->node_size / 2);
-
-                /* now we can insert entry */
-                time += pcm_write(index->pcm, index->entry_size);
-                break;
-            }
-            case BTREE_UNSORTED_LEAVES_INNERS_RAM:
-            case BTREE_2SECTION_NODE_INNERS_RAM:
-            {
-                /* we need to delete it down, new entry at the end */
-                time += pcm_write(index->pcm, index->entry_size);
-
-                /* and we need to update bitmap */
-                time += pcm_write(index->pcm, 1);
-                break;
-            }
             case BTREE_SKIP_COST:
                 break;
             default:
@@ -916,13 +1698,13 @@ double db_index_delete(DB_index *index, size_t entries)
     }
 
     index->height = db_index_get_height(index);
-    db_stat_update_index_time(time);
+    db_stat_update_index_time_r(index->stat, time);
     return time;
 }
 
-double db_index_update(DB_index *index, size_t entries)
+pcm_time_t db_index_update(DB_index *index, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     TRACE();
 
@@ -932,7 +1714,66 @@ double db_index_update(DB_index *index, size_t entries)
     /* insert enrty with new value */
     time += db_index_insert(index, entries);
 
-    db_stat_update_index_time(time);
+    db_stat_update_index_time_r(index->stat, time);
+
+    return time;
+}
+btree_key_t db_index_new_key(DB_index *index)
+{
+    TRACE();
+
+    if (index->engine == NULL)
+        ERROR("Index without engine has no keys\n", 0);
+
+    return db_index_engine_new_key(index);
+}
+
+pcm_time_t db_index_bulkload_keys(DB_index *index, const btree_key_t *keys, size_t entries)
+{
+    pcm_time_t time;
+    btree_value_t *values;
+    size_t i;
+
+    TRACE();
+
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
+
+    if (index->engine == NULL)
+        ERROR("Index without engine has no keys\n", 0);
+
+    if (entries == 0)
+        return 0;
+
+    values = malloc(entries * sizeof(*values));
+    if (values == NULL)
+        ERROR("malloc error\n", 0);
 
+    for (i = 0; i < entries; ++i)
+        values[i] = (btree_value_t)keys[i];
+
+    time = db_index_engine_bulkload_pairs(index, keys, values, entries);
+
+    FREE(values);
+
+    return time;
+}
+
+pcm_time_t db_index_range_search_key(DB_index *index, btree_key_t key, size_t entries)
+{
+    pcm_time_t time;
+
+    TRACE();
+
+    pcm_trace_set_tag(index->pcm, PCM_TRACE_TAG_INDEX);
+
+    if (index->engine == NULL)
+        ERROR("Index without engine has no keys\n", 0);
+
+    if (entries == 0 || index->engine->num_entries == 0)
+        return 0;
+
+    time = btree_range_search(index->engine, key, entries, NULL);
+
+    db_stat_update_index_time_r(index->stat, time);
     return time;
-}
\ No newline at end of file
+}
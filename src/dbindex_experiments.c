@@ -4,8 +4,9 @@
 #include <dbstat.h>
 #include <math.h>
 #include <common.h>
+#include <time.h>
 
-void db_index_experiment_workload(size_t queries)
+int db_index_experiment_workload(size_t queries)
 {
     DB_index *index;
     PCM *pcm;
@@ -16,8 +17,14 @@ void db_index_experiment_workload(size_t queries)
 
     TRACE();
 
-    pcm = pcm_create_default_model();
+    pcm = experiments_create_pcm();
     index = db_index_create(pcm, sizeof(long), 140, 1000, 0.8, BTREE_NORMAL);
+    if (index == NULL)
+    {
+        pcm_destroy(pcm);
+        ERROR("db_index_create error\n", 1);
+    }
+
     db_stat_reset();
 
     /* bukload N / 2 */
@@ -84,4 +91,199 @@ void db_index_experiment_workload(size_t queries)
     db_stat_summary_print();
     db_index_destroy(index);
     pcm_destroy(pcm);
-}
\ No newline at end of file
+
+    return 0;
+}
+
+int db_index_experiment_engine(size_t entries, size_t queries)
+{
+    DB_index *model;
+    DB_index *engine;
+    PCM *pcm_model;
+    PCM *pcm_engine;
+    Genrand *rng;
+    struct timespec start;
+    struct timespec end;
+    pcm_time_t model_time;
+    pcm_time_t engine_time;
+    size_t lines_written;
+    double wall;
+    size_t i;
+    size_t s;
+    size_t t;
+
+    enum {STEP_BULKLOAD, STEP_INSERT, STEP_POINT_SEARCH, STEP_RANGE_SEARCH, STEP_DELETE, STEPS};
+    const char * const step_names[] = {"Bulkload", "Insert", "Point search", "Range search", "Delete"};
+    const btree_type_t btree_type[] = {BTREE_NORMAL, BTREE_NORMAL_INNERS_RAM, BTREE_UNSORTED_LEAVES, BTREE_UNSORTED_LEAVES_INNERS_RAM, CBTREE, OCBTREE};
+    const char * const btree_names[] = {"B+-tree", "B+-tree (inners in RAM)", "B+-tree (unsorted leaves)", "B+-tree (unsorted leaves, inners in RAM)", "CB-tree", "OCB-tree"};
+
+    TRACE();
+
+    for (t = 0; t < ARRAY_SIZE(btree_type); ++t)
+    {
+        pcm_model = experiments_create_pcm();
+        pcm_engine = experiments_create_pcm();
+        rng = experiments_create_rng(t, 0);
+        model = db_index_create(pcm_model, sizeof(long), 140, 1000, 0.8, btree_type[t]);
+        engine = db_index_create_engine(pcm_engine, rng, sizeof(long), 140, 1000, 0.8, btree_type[t]);
+        if (model == NULL || engine == NULL)
+        {
+            db_index_destroy(model);
+            db_index_destroy(engine);
+            genrand_destroy(rng);
+            pcm_destroy(pcm_model);
+            pcm_destroy(pcm_engine);
+            ERROR("db_index_create error\n", 1);
+        }
+
+        printf("%s\n", btree_names[t]);
+        printf("STEP\tMODEL TIME\tENGINE TIME\tENGINE / MODEL\tENGINE OPS/s\tENGINE LINES WRITTEN\n");
+        for (s = 0; s < STEPS; ++s)
+        {
+            model_time = 0;
+            engine_time = 0;
+            lines_written = pcm_engine->lines_written;
+
+            (void)clock_gettime(CLOCK_MONOTONIC, &start);
+            switch (s)
+            {
+                case STEP_BULKLOAD:
+                {
+                    model_time += db_index_bulkload(model, entries);
+                    engine_time += db_index_bulkload(engine, entries);
+                    break;
+                }
+                case STEP_INSERT:
+                {
+                    for (i = 0; i < queries; ++i)
+                    {
+                        model_time += db_index_insert(model, 1);
+                        engine_time += db_index_insert(engine, 1);
+                    }
+                    break;
+                }
+                case STEP_POINT_SEARCH:
+                {
+                    for (i = 0; i < queries; ++i)
+                    {
+                        model_time += db_index_point_search(model, 1);
+                        engine_time += db_index_point_search(engine, 1);
+                    }
+                    break;
+                }
+                case STEP_RANGE_SEARCH:
+                {
+                    for (i = 0; i < queries; ++i)
+                    {
+                        model_time += db_index_range_search(model, (model->num_entries + 99) / 100);
+                        engine_time += db_index_range_search(engine, (engine->num_entries + 99) / 100);
+                    }
+                    break;
+                }
+                case STEP_DELETE:
+                {
+                    for (i = 0; i < queries; ++i)
+                    {
+                        model_time += db_index_delete(model, 1);
+                        engine_time += db_index_delete(engine, 1);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+            (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+            /* wall time includes model, but model is closed form so it is negligible */
+            wall = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+            printf("%s\t%lf\t%lf\t%lf\t%.0lf\t%zu\n",
+                   step_names[s],
+                   pcm_time_to_seconds(model_time),
+                   pcm_time_to_seconds(engine_time),
+                   model_time > 0 ? (double)engine_time / (double)model_time : 0.0,
+                   (double)(s == STEP_BULKLOAD ? entries : queries) / wall,
+                   pcm_engine->lines_written - lines_written);
+        }
+
+        db_index_destroy(model);
+        db_index_destroy(engine);
+        genrand_destroy(rng);
+        pcm_destroy(pcm_model);
+        pcm_destroy(pcm_engine);
+    }
+
+    return 0;
+}
+
+int db_index_experiment_placement(size_t entries, size_t queries)
+{
+    DB_index *index;
+    PCM *pcm;
+    Genrand *rng;
+    pcm_time_t time;
+    int ret = 0;
+    size_t i;
+    size_t t;
+    size_t p;
+    size_t e;
+
+    const btree_type_t btree_type[] = {BTREE_NORMAL, CBTREE};
+    const char * const btree_names[] = {"B+-tree", "CB-tree"};
+    const size_t dram_levels[] = {0, 1, 2, BTREE_DRAM_INNERS, BTREE_DRAM_INNERS};
+    const size_t dram_budget[] = {0, 0, 0, 0, 1 << 20};
+    const char * const placement_names[] = {"PCM", "Root", "2 levels", "All inners", "Inners in 1MB"};
+
+    TRACE();
+
+    for (t = 0; t < ARRAY_SIZE(btree_type); ++t)
+    {
+        printf("%s\n", btree_names[t]);
+        printf("PLACEMENT\tMODEL TIME\tMODEL DRAM LINES\tMODEL DRAM BYTES\tENGINE TIME\tENGINE DRAM LINES\tENGINE DRAM BYTES\n");
+        for (p = 0; p < ARRAY_SIZE(placement_names); ++p)
+        {
+            printf("%s", placement_names[p]);
+            for (e = 0; e < 2; ++e)
+            {
+                pcm = experiments_create_pcm();
+                rng = experiments_create_rng(t, p);
+                if (e == 0)
+                    index = db_index_create(pcm, sizeof(long), 140, 1000, 0.8, btree_type[t]);
+                else
+                    index = db_index_create_engine(pcm, rng, sizeof(long), 140, 1000, 0.8, btree_type[t]);
+
+                /* keep columns of row aligned */
+                if (index == NULL)
+                {
+                    printf("\t-\t-\t-");
+                    genrand_destroy(rng);
+                    pcm_destroy(pcm);
+                    ret = 1;
+                    continue;
+                }
+
+                db_index_set_placement(index, dram_levels[p], dram_budget[p], NANO(10));
+                (void)db_index_bulkload(index, entries);
+
+                time = 0;
+                for (i = 0; i < queries; ++i)
+                {
+                    time += db_index_insert(index, 1);
+                    time += db_index_point_search(index, 1);
+                    time += db_index_delete(index, 1);
+                }
+
+                printf("\t%lf\t%zu\t%zu",
+                       pcm_time_to_seconds(time),
+                       index->dram_lines_read + index->dram_lines_written,
+                       db_index_dram_footprint(index));
+
+                db_index_destroy(index);
+                genrand_destroy(rng);
+                pcm_destroy(pcm);
+            }
+            printf("\n");
+        }
+    }
+
+    return ret;
+}
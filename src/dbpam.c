@@ -4,7 +4,7 @@
 #include <dbpam.h>
 #include <log.h>
 
-DB_PAM *db_pam_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, btree_type_t index_type)
+DB_PAM *db_pam_create(PCM *pcm, Genrand *rng, size_t num_entries, size_t key_size, size_t entry_size, size_t buffer_size, size_t index_node_size, btree_type_t index_type)
 {
     DB_PAM *pam;
 
@@ -14,7 +14,7 @@ DB_PAM *db_pam_create(PCM *pcm, size_t num_entries, size_t key_size, size_t entr
     if (pam == NULL)
         ERROR("malloc error\n", NULL);
 
-    pam->am = db_am_create(pcm, num_entries, key_size, entry_size, buffer_size, index_node_size, INVALIDATION_JOURNAL, index_type);
+    pam->am = db_am_create(pcm, rng, num_entries, key_size, entry_size, buffer_size, index_node_size, INVALIDATION_JOURNAL, index_type);
     if (pam->am == NULL)
     {
         FREE(pam);
@@ -33,17 +33,27 @@ void db_pam_destroy(DB_PAM *pam)
     FREE(pam);
 }
 
-double db_pam_search(DB_PAM *pam, query_t type, size_t entries)
+void db_pam_set_stat(DB_PAM *pam, DB_stat *stat)
+{
+    db_am_set_stat(pam->am, stat);
+}
+
+pcm_time_t db_pam_search(DB_PAM *pam, query_t type, size_t entries)
 {
     return db_am_search(pam->am, type, entries);
 }
 
-double db_pam_insert(DB_PAM *pam, size_t entries)
+pcm_time_t db_pam_insert(DB_PAM *pam, size_t entries)
 {
     return db_am_insert(pam->am, entries);
 }
 
-double db_pam_delete(DB_PAM* pam, size_t entries)
+pcm_time_t db_pam_insert_batch(DB_PAM *pam, size_t entries)
+{
+    return db_am_insert_batch(pam->am, entries);
+}
+
+pcm_time_t db_pam_delete(DB_PAM* pam, size_t entries)
 {
     return db_am_delete(pam->am, entries);
 }
\ No newline at end of file
@@ -3,22 +3,28 @@
 #include <log.h>
 #include <dbstat.h>
 #include <common.h>
-#include <time.h>
 #include <stdlib.h>
 #include <genrand.h>
 
-void db_pam_experiment_workload(size_t entries)
+int db_pam_experiment_workload(size_t entries)
 {
     DB_PAM *pam;
     PCM *pcm;
+    Genrand *rng;
     size_t i;
 
     TRACE();
 
-    sgenrand((unsigned long)time(NULL));
+    rng = experiments_create_rng(0, 0);
+    pcm = experiments_create_pcm();
+    pam = db_pam_create(pcm, rng, entries, sizeof(int), 140, (size_t)(0.01 * (double)entries * 140), 10 * 140, BTREE_WITH_BUFFERED_TREE);
+    if (pam == NULL)
+    {
+        genrand_destroy(rng);
+        pcm_destroy(pcm);
+        ERROR("db_pam_create error\n", 1);
+    }
 
-    pcm = pcm_create_default_model();
-    pam = db_pam_create(pcm, entries, sizeof(int), 140, (size_t)(0.01 * (double)entries * 140), 10 * 140, BTREE_WITH_BUFFERED_TREE);
     db_stat_reset();
 
     db_stat_start_query();
@@ -36,5 +42,8 @@ void db_pam_experiment_workload(size_t entries)
     db_stat_summary_print();
 
     db_pam_destroy(pam);
+    genrand_destroy(rng);
     pcm_destroy(pcm);
+
+    return 0;
 }
\ No newline at end of file
@@ -16,6 +16,7 @@ DB_raw *db_raw_create(PCM *pcm, size_t entry_size)
 
     raw->entry_size = entry_size;
     raw->pcm = pcm;
+    raw->stat = db_stat_get_default();
     raw->num_entries = 0;
 
     return raw;
@@ -31,13 +32,22 @@ void db_raw_destroy(DB_raw *raw)
     FREE(raw);
 }
 
-double db_raw_insert(DB_raw *raw, size_t entries)
+void db_raw_set_stat(DB_raw *raw, DB_stat *stat)
 {
-    double time = 0.0;
+    TRACE();
+
+    raw->stat = stat;
+}
+
+pcm_time_t db_raw_insert(DB_raw *raw, size_t entries)
+{
+    pcm_time_t time = 0;
     size_t i;
 
     TRACE();
 
+    pcm_trace_set_tag(raw->pcm, PCM_TRACE_TAG_RAW);
+
     for (i = 0; i < entries; ++i)
     {
         /* write at the end */
@@ -46,73 +56,81 @@ double db_raw_insert(DB_raw *raw, size_t entries)
         ++raw->num_entries;
     }
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(raw->stat, time);
     return time;
 }
 
-double db_raw_bulkload(DB_raw *raw, size_t entries)
+pcm_time_t db_raw_bulkload(DB_raw *raw, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     TRACE();
 
+    pcm_trace_set_tag(raw->pcm, PCM_TRACE_TAG_RAW);
+
     /* insert at the end */
     time += pcm_write(raw->pcm, raw->entry_size * entries);
     raw->num_entries += entries;
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(raw->stat, time);
     return time;
 }
 
-double db_raw_point_search(DB_raw *raw, size_t entries)
+pcm_time_t db_raw_point_search(DB_raw *raw, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     TRACE();
 
+    pcm_trace_set_tag(raw->pcm, PCM_TRACE_TAG_RAW);
+
     (void)entries;
 
     /* data are unsorted, so scan all */
     time += pcm_read(raw->pcm, raw->entry_size * raw->num_entries);
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(raw->stat, time);
     return time;
 }
 
-double db_raw_range_search(DB_raw *raw, size_t entries)
+pcm_time_t db_raw_range_search(DB_raw *raw, size_t entries)
 {
-   double time = 0.0;
+   pcm_time_t time = 0;
 
     TRACE();
 
+    pcm_trace_set_tag(raw->pcm, PCM_TRACE_TAG_RAW);
+
     (void)entries;
 
     /* data are unsorted, so scan all */
     time += pcm_read(raw->pcm, raw->entry_size * raw->num_entries);
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(raw->stat, time);
     return time;
 }
 
-double db_raw_delete(DB_raw *raw, size_t entries)
+pcm_time_t db_raw_delete(DB_raw *raw, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     TRACE();
 
+    pcm_trace_set_tag(raw->pcm, PCM_TRACE_TAG_RAW);
+
     db_raw_range_search(raw, entries);
     db_raw_insert(raw, entries);
 
     // becuase insert add 1x entries, we need undo it and note deletion
     raw->num_entries -=  2 * entries;
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(raw->stat, time);
     return time;
 }
 
-double db_raw_update(DB_raw *raw, size_t entries)
+pcm_time_t db_raw_update(DB_raw *raw, size_t entries)
 {
-    double time = 0.0;
+    pcm_time_t time = 0;
 
     TRACE();
 
@@ -122,6 +140,6 @@ double db_raw_update(DB_raw *raw, size_t entries)
     // becuase insert add 1x entries, we need undo it
     raw->num_entries -= entries;
 
-    db_stat_update_misc_time(time);
+    db_stat_update_misc_time_r(raw->stat, time);
     return time;
 }
\ No newline at end of file
@@ -5,7 +5,7 @@
 #include <math.h>
 #include <common.h>
 
-void db_raw_experiment_workload(size_t queries)
+int db_raw_experiment_workload(size_t queries)
 {
     DB_raw *raw;
     PCM *pcm;
@@ -16,8 +16,14 @@ void db_raw_experiment_workload(size_t queries)
 
     TRACE();
 
-    pcm = pcm_create_default_model();
+    pcm = experiments_create_pcm();
     raw = db_raw_create(pcm, 140);
+    if (raw == NULL)
+    {
+        pcm_destroy(pcm);
+        ERROR("db_raw_create error\n", 1);
+    }
+
     db_stat_reset();
 
     /* bukload N / 2 */
@@ -84,4 +90,6 @@ void db_raw_experiment_workload(size_t queries)
     db_stat_summary_print();
     db_raw_destroy(raw);
     pcm_destroy(pcm);
+
+    return 0;
 }
\ No newline at end of file
@@ -2,9 +2,9 @@
 #include <dbstat.h>
 #include <common.h>
 #include <string.h>
+#include <stdlib.h>
 
-DB_snapshot db_current_query;
-DB_snapshot db_total;
+DB_stat db_stat_default;
 
 /*
     Print on stdout info about snapshot
@@ -15,61 +15,125 @@ DB_snapshot db_total;
     RETURN
     This is a void function
 */
-static ___inline___ void __db_stat_print(DB_snapshot *sh);
+static ___inline___ void __db_stat_print(const DB_snapshot *sh);
 
-static ___inline___ void __db_stat_print(DB_snapshot *sh)
+static ___inline___ void __db_stat_print(const DB_snapshot *sh)
 {
-    printf("\tINVALIDATION  TIME     = %lfs\n", sh->invalidation_time);
-    printf("\tINDEX         TIME     = %lfs\n", sh->index_time);
-    printf("\tMISC          TIME     = %lfs\n", sh->misc_time);
-    printf("\tTOTAL         TIME     = %lfs\n", __db_stat_get_time(sh));
+    printf("\tINVALIDATION  TIME     = %lfs\n", pcm_time_to_seconds(sh->invalidation_time));
+    printf("\tINDEX         TIME     = %lfs\n", pcm_time_to_seconds(sh->index_time));
+    printf("\tMISC          TIME     = %lfs\n", pcm_time_to_seconds(sh->misc_time));
+    printf("\tTOTAL         TIME     = %lfs\n", pcm_time_to_seconds(__db_stat_get_time(sh)));
 }
 
-void db_stat_reset(void)
+DB_stat *db_stat_create(void)
+{
+    DB_stat *stat;
+
+    TRACE();
+
+    stat = malloc(sizeof(*stat));
+    if (stat == NULL)
+        ERROR("malloc error\n", NULL);
+
+    db_stat_reset_r(stat);
+
+    return stat;
+}
+
+void db_stat_destroy(DB_stat *stat)
+{
+    TRACE();
+
+    if (stat == NULL || stat == &db_stat_default)
+        return;
+
+    FREE(stat);
+}
+
+void db_stat_merge(DB_stat *dst, const DB_stat *src)
+{
+    TRACE();
+
+    dst->total.invalidation_time += src->total.invalidation_time;
+    dst->total.index_time += src->total.index_time;
+    dst->total.misc_time += src->total.misc_time;
+}
+
+void db_stat_reset_r(DB_stat *stat)
 {
     TRACE();
 
     LOG("Reseting db statistics\n");
-    (void)memset(&db_current_query, 0, sizeof(db_current_query));
-    (void)memset(&db_total, 0, sizeof(db_total));
+    (void)memset(&stat->current_query, 0, sizeof(stat->current_query));
+    (void)memset(&stat->total, 0, sizeof(stat->total));
 }
 
-void db_stat_reset_query(void)
+void db_stat_reset_query_r(DB_stat *stat)
 {
     TRACE();
 
     LOG("Reseting only current query stat\n");
-    (void)memset(&db_current_query, 0, sizeof(db_current_query));
+    (void)memset(&stat->current_query, 0, sizeof(stat->current_query));
 }
 
-void db_stat_start_query(void)
+void db_stat_start_query_r(DB_stat *stat)
 {
     TRACE();
 
     LOG("Start new query\n");
-    db_stat_reset_query();
+    db_stat_reset_query_r(stat);
 }
 
-void db_stat_finish_query(void)
+void db_stat_finish_query_r(DB_stat *stat)
 {
     TRACE();
 
     LOG("Finishing query\n");
 
     /* update total */
-    db_total.invalidation_time += db_current_query.invalidation_time;
-    db_total.index_time += db_current_query.index_time;
-    db_total.misc_time += db_current_query.misc_time;
+    stat->total.invalidation_time += stat->current_query.invalidation_time;
+    stat->total.index_time += stat->current_query.index_time;
+    stat->total.misc_time += stat->current_query.misc_time;
 }
 
-void db_stat_current_print(void)
+void db_stat_current_print_r(DB_stat *stat)
 {
     printf("CURRENT QUERY\n\n");
-    __db_stat_print(&db_current_query);
+    __db_stat_print(&stat->current_query);
 }
 
-void db_stat_summary_print(void)
+void db_stat_summary_print_r(DB_stat *stat)
 {
     printf("TOTAL\n\n");
-    __db_stat_print(&db_total);
-}
\ No newline at end of file
+    __db_stat_print(&stat->total);
+}
+
+void db_stat_reset(void)
+{
+    db_stat_reset_r(&db_stat_default);
+}
+
+void db_stat_reset_query(void)
+{
+    db_stat_reset_query_r(&db_stat_default);
+}
+
+void db_stat_start_query(void)
+{
+    db_stat_start_query_r(&db_stat_default);
+}
+
+void db_stat_finish_query(void)
+{
+    db_stat_finish_query_r(&db_stat_default);
+}
+
+void db_stat_current_print(void)
+{
+    db_stat_current_print_r(&db_stat_default);
+}
+
+void db_stat_summary_print(void)
+{
+    db_stat_summary_print_r(&db_stat_default);
+}
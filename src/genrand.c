@@ -33,10 +33,18 @@
 /* ACM Transactions on Modeling and Computer Simulation,           */
 /* Vol. 8, No. 1, January 1998, pp 3--30.                          */
 
+/* xoshiro256** backend: David Blackman and Sebastiano Vigna (2018),  */
+/* "Scrambled Linear Pseudorandom Number Generators", public domain  */
+/* reference code at http://prng.di.unimi.it/                        */
+
 #include <genrand.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GENRAND_XOSHIRO
 
 /* Period parameters */
-#define N 624
+#define N GENRAND_STATE_SIZE
 #define M 397
 #define MATRIX_A 0x9908b0df   /* constant vector a */
 #define UPPER_MASK 0x80000000 /* most significant w-r bits */
@@ -50,13 +58,157 @@
 #define TEMPERING_SHIFT_T(y)  (y << 15)
 #define TEMPERING_SHIFT_L(y)  (y >> 18)
 
-static unsigned long mt[N]; /* the array for the state vector  */
-static int mti=N+1; /* mti==N+1 means mt[N] is not initialized */
+/*
+    Initializing the array with a key of 32-bit words (init_by_array of mt19937ar, 2002),
+    used by substreams to keep all 64 bits of derived seed
+
+    PARAMS
+    @IN rng - generator
+    @IN key - array of 32-bit words
+    @IN len - length of key
+
+    RETURN
+    This is a void function
+*/
+static void sgenrand_array_r(Genrand *rng, const unsigned long *key, size_t len);
+
+/*
+    Generate N words at one time and temper them into rng->buf
+
+    PARAMS
+    @IN rng - generator
+
+    RETURN
+    This is a void function
+*/
+static void genrand_mt_refill(Genrand *rng);
+
+#else
+
+/* xoshiro256** lanes are processed as one vector, gcc lowers it to SSE2 / AVX2 */
+typedef unsigned long long genrand_vec_t __attribute__ ((vector_size (sizeof(unsigned long long) * GENRAND_LANES)));
+
+#define GENRAND_ROTL(x, k) (((x) << (k)) | ((x) >> (64 - (k))))
+
+/*
+    Generate next GENRAND_BLOCK_SIZE numbers into rng->buf.
+    Number i of block comes from lane (i % GENRAND_LANES), upper 32 bits are used
+
+    PARAMS
+    @IN rng - generator
+
+    RETURN
+    This is a void function
+*/
+static void genrand_xoshiro_refill(Genrand *rng);
+
+/*
+    Advance one lane state (4 words) by a jump polynomial, i.e. by 2^128 steps for
+    genrand_xoshiro_jump_poly and by 2^192 steps for genrand_xoshiro_long_jump_poly
+
+    PARAMS
+    @IN s - state of one lane
+    @IN poly - jump polynomial
+
+    RETURN
+    This is a void function
+*/
+static void genrand_xoshiro_jump(unsigned long long *s, const unsigned long long *poly);
+
+/*
+    Seed all lanes: lane 0 comes from seed by SplitMix64 and is moved by stream long jumps,
+    next lanes are jumps of previous one, so lanes and streams never overlap
+
+    PARAMS
+    @IN rng - generator
+    @IN seed - 64-bit seed
+    @IN stream - number of long jumps
+
+    RETURN
+    This is a void function
+*/
+static void genrand_xoshiro_seed(Genrand *rng, unsigned long long seed, unsigned long stream);
+
+static const unsigned long long genrand_xoshiro_jump_poly[4] =
+    {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+
+static const unsigned long long genrand_xoshiro_long_jump_poly[4] =
+    {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+#endif
+
+static Genrand default_rng = { .mti = GENRAND_UNSEEDED };
+
+/* SplitMix64 step, used to derive seeds of substreams */
+static unsigned long long splitmix64(unsigned long long *x);
+
+static unsigned long long splitmix64(unsigned long long *x)
+{
+    unsigned long long z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+Genrand *genrand_create(unsigned long seed)
+{
+    Genrand *rng;
+
+    rng = malloc(sizeof(*rng));
+    if (rng == NULL)
+        return NULL;
+
+    sgenrand_r(rng, seed);
+
+    return rng;
+}
+
+Genrand *genrand_create_stream(unsigned long master_seed, unsigned long stream)
+{
+    Genrand *rng;
+#ifndef GENRAND_XOSHIRO
+    unsigned long long x = (unsigned long long)master_seed;
+    unsigned long key[2];
+#endif
+
+    rng = malloc(sizeof(*rng));
+    if (rng == NULL)
+        return NULL;
+
+#ifndef GENRAND_XOSHIRO
+    /* mixing is a bijection of stream, so streams of one master seed get different 64-bit seeds */
+    (void)splitmix64(&x);
+    x ^= (unsigned long long)stream * 0xd1b54a32d192ed03ULL;
+    x = splitmix64(&x);
+
+    key[0] = (unsigned long)(x & 0xffffffffULL);
+    key[1] = (unsigned long)(x >> 32);
+    sgenrand_array_r(rng, key, 2);
+#else
+    genrand_xoshiro_seed(rng, (unsigned long long)master_seed, stream);
+#endif
+
+    return rng;
+}
+
+void genrand_destroy(Genrand *rng)
+{
+    free(rng);
+}
+
+Genrand *genrand_default(void)
+{
+    return &default_rng;
+}
+
+#ifndef GENRAND_XOSHIRO
 
 /* Initializing the array with a seed */
-void sgenrand(unsigned long seed)
+void sgenrand_r(Genrand *rng, unsigned long seed)
 {
     int i;
+    unsigned long *mt = rng->mt;
 
     for (i=0;i<N;i++) {
          mt[i] = seed & 0xffff0000;
@@ -64,40 +216,225 @@ void sgenrand(unsigned long seed)
          mt[i] |= (seed & 0xffff0000) >> 16;
          seed = 69069 * seed + 1;
     }
-    mti = N;
+    rng->mti = N;
 }
 
-unsigned long genrand(void)
+static void sgenrand_array_r(Genrand *rng, const unsigned long *key, size_t len)
+{
+    unsigned long *mt = rng->mt;
+    size_t i;
+    size_t j;
+    size_t k;
+
+    mt[0] = 19650218UL;
+    for (i = 1; i < N; i++)
+        mt[i] = (1812433253UL * (mt[i - 1] ^ (mt[i - 1] >> 30)) + i) & 0xffffffffUL;
+
+    i = 1;
+    j = 0;
+    for (k = N > len ? N : len; k > 0; k--) {
+        mt[i] = ((mt[i] ^ ((mt[i - 1] ^ (mt[i - 1] >> 30)) * 1664525UL)) + key[j] + j) & 0xffffffffUL;
+        i++;
+        j++;
+        if (i >= N) {
+            mt[0] = mt[N - 1];
+            i = 1;
+        }
+        if (j >= len)
+            j = 0;
+    }
+    for (k = N - 1; k > 0; k--) {
+        mt[i] = ((mt[i] ^ ((mt[i - 1] ^ (mt[i - 1] >> 30)) * 1566083941UL)) - i) & 0xffffffffUL;
+        i++;
+        if (i >= N) {
+            mt[0] = mt[N - 1];
+            i = 1;
+        }
+    }
+
+    mt[0] = 0x80000000UL; /* MSB is 1, assuring non-zero initial array */
+    rng->mti = N;
+}
+
+static void genrand_mt_refill(Genrand *rng)
 {
     unsigned long y;
-    static unsigned long mag01[2]={0x0, MATRIX_A};
+    static const unsigned long mag01[2]={0x0, MATRIX_A};
     /* mag01[x] = x * MATRIX_A  for x=0,1 */
+    unsigned long *mt = rng->mt;
+    unsigned long *buf = rng->buf;
+    int kk;
+
+    for (kk=0;kk<N-M;kk++) {
+        y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+        mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1];
+    }
+    for (;kk<N-1;kk++) {
+        y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+        mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1];
+    }
+    y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
+    mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1];
 
-    if (mti >= N) { /* generate N words at one time */
-        int kk;
+    /* tempering has no dependency between words, so this loop is vectorized */
+    for (kk=0;kk<N;kk++) {
+        y = mt[kk];
+        y ^= TEMPERING_SHIFT_U(y);
+        y ^= TEMPERING_SHIFT_S(y) & TEMPERING_MASK_B;
+        y ^= TEMPERING_SHIFT_T(y) & TEMPERING_MASK_C;
+        y ^= TEMPERING_SHIFT_L(y);
+        buf[kk] = y;
+    }
+}
 
-        if (mti == N+1)   /* if sgenrand() has not been called, */
-            sgenrand(4357); /* a default initial seed is used   */
+#else
 
-        for (kk=0;kk<N-M;kk++) {
-            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-            mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1];
-        }
-        for (;kk<N-1;kk++) {
-            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-            mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1];
+static void genrand_xoshiro_refill(Genrand *rng)
+{
+    genrand_vec_t s0;
+    genrand_vec_t s1;
+    genrand_vec_t s2;
+    genrand_vec_t s3;
+    genrand_vec_t t;
+    genrand_vec_t r;
+    unsigned long long out[GENRAND_LANES];
+    size_t i;
+    size_t j;
+
+    /* state may be not aligned to vector size (malloc), so copy it */
+    memcpy(&s0, rng->s[0], sizeof(s0));
+    memcpy(&s1, rng->s[1], sizeof(s1));
+    memcpy(&s2, rng->s[2], sizeof(s2));
+    memcpy(&s3, rng->s[3], sizeof(s3));
+
+    for (i = 0; i < GENRAND_BLOCK_SIZE; i += GENRAND_LANES)
+    {
+        r = s1 * 5;
+        r = GENRAND_ROTL(r, 7) * 9;
+
+        t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = GENRAND_ROTL(s3, 45);
+
+        memcpy(out, &r, sizeof(out));
+        for (j = 0; j < GENRAND_LANES; ++j)
+            rng->buf[i + j] = (unsigned long)(out[j] >> 32);
+    }
+
+    memcpy(rng->s[0], &s0, sizeof(s0));
+    memcpy(rng->s[1], &s1, sizeof(s1));
+    memcpy(rng->s[2], &s2, sizeof(s2));
+    memcpy(rng->s[3], &s3, sizeof(s3));
+}
+
+static void genrand_xoshiro_jump(unsigned long long *s, const unsigned long long *poly)
+{
+    unsigned long long j[4] = {0, 0, 0, 0};
+    unsigned long long t;
+    size_t i;
+    size_t b;
+
+    for (i = 0; i < 4; ++i)
+        for (b = 0; b < 64; ++b)
+        {
+            if (poly[i] & (1ULL << b))
+            {
+                j[0] ^= s[0];
+                j[1] ^= s[1];
+                j[2] ^= s[2];
+                j[3] ^= s[3];
+            }
+
+            /* one step of xoshiro256 state */
+            t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = GENRAND_ROTL(s[3], 45);
         }
-        y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
-        mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1];
 
-        mti = 0;
+    memcpy(s, j, sizeof(j));
+}
+
+static void genrand_xoshiro_seed(Genrand *rng, unsigned long long seed, unsigned long stream)
+{
+    unsigned long long lane[4];
+    unsigned long k;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < 4; ++i)
+        lane[i] = splitmix64(&seed);
+
+    for (k = 0; k < stream; ++k)
+        genrand_xoshiro_jump(lane, genrand_xoshiro_long_jump_poly);
+
+    for (j = 0; j < GENRAND_LANES; ++j)
+    {
+        if (j > 0)
+            genrand_xoshiro_jump(lane, genrand_xoshiro_jump_poly);
+
+        for (i = 0; i < 4; ++i)
+            rng->s[i][j] = lane[i];
     }
 
-    y = mt[mti++];
-    y ^= TEMPERING_SHIFT_U(y);
-    y ^= TEMPERING_SHIFT_S(y) & TEMPERING_MASK_B;
-    y ^= TEMPERING_SHIFT_T(y) & TEMPERING_MASK_C;
-    y ^= TEMPERING_SHIFT_L(y);
+    rng->mti = GENRAND_BLOCK_SIZE;
+}
+
+/* Initializing the state of every lane with a seed */
+void sgenrand_r(Genrand *rng, unsigned long seed)
+{
+    genrand_xoshiro_seed(rng, (unsigned long long)seed, 0);
+}
+
+#endif
+
+void genrand_refill(Genrand *rng)
+{
+    if (rng->mti == GENRAND_UNSEEDED)   /* if sgenrand() has not been called, */
+        sgenrand_r(rng, 4357); /* a default initial seed is used   */
+
+#ifndef GENRAND_XOSHIRO
+    genrand_mt_refill(rng);
+#else
+    genrand_xoshiro_refill(rng);
+#endif
 
-    return y;
-}
\ No newline at end of file
+    rng->mti = 0;
+}
+
+void genrand_fill_r(Genrand *rng, unsigned long *buf, size_t n)
+{
+    size_t len;
+
+    while (n > 0)
+    {
+        if (rng->mti >= GENRAND_BLOCK_SIZE)
+            genrand_refill(rng);
+
+        len = GENRAND_BLOCK_SIZE - rng->mti;
+        if (len > n)
+            len = n;
+
+        memcpy(buf, &rng->buf[rng->mti], len * sizeof(*buf));
+        rng->mti += len;
+        buf += len;
+        n -= len;
+    }
+}
+
+void sgenrand(unsigned long seed)
+{
+    sgenrand_r(&default_rng, seed);
+}
+
+unsigned long genrand(void)
+{
+    return genrand_r(&default_rng);
+}
@@ -1,6 +1,80 @@
 #include <log.h>
 #include <common.h>
-#include <experiments.h>
+#include <workload.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* spec run when main.out is called without spec files */
+#define DEFAULT_SPEC "specs/paper.ini"
+
+typedef struct Options
+{
+    const char **specs;
+    size_t num_specs;
+    const char **experiments; /* names of selected experiments, all iff num_experiments == 0 */
+    size_t num_experiments;
+
+    /* 0 means value from spec */
+    size_t entries;
+    size_t key_size;
+    size_t data_size;
+
+    bool seed_set;
+    unsigned long seed;
+    bool threads_set;
+    size_t threads;
+
+    const char *output_dir; /* NULL means current directory */
+    bool quiet;
+    bool progress;
+    bool list;
+} Options;
+
+/*
+    Print usage of main.out
+
+    PARAMS
+    @IN prog - name of program
+    @IN fd - output stream
+
+    RETURN
+    This is a void function
+*/
+static void usage(const char *prog, FILE *fd);
+
+/*
+    Parse command line
+
+    PARAMS
+    @IN argc - number of arguments
+    @IN argv - arguments
+    @OUT options - parsed options (specs and experiments point to argv)
+
+    RETURN
+    0 iff success
+    1 iff options are wrong
+    -1 iff help was printed
+*/
+static int parse_options(int argc, char **argv, Options *options);
+
+/*
+    Create output directory with missing parents (iff needed) and use it as current directory
+
+    PARAMS
+    @IN dir - path to directory
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int enter_output_dir(const char *dir);
 
 ___before_main___(0) void init(void);
 ___after_main___(0) void deinit(void);
@@ -15,140 +89,253 @@ ___after_main___(0) void deinit(void)
 	log_deinit();
 }
 
-int main(void)
+static void usage(const char *prog, FILE *fd)
 {
-    // db_raw_experiment_workload(1000);
-    // db_index_experiment_workload(1000);
-    // db_am_experiment_workload(1000000);
-    // db_pam_experiment_workload(1000000);
+    fprintf(fd,
+            "Usage: %s [OPTIONS] [SPEC...]\n"
+            "Run experiments described by spec files (default " DEFAULT_SPEC ")\n"
+            "\n"
+            "  -e, --experiment NAME  run only experiment NAME (can be repeated)\n"
+            "  -l, --list             list experiments of specs and exit\n"
+            "  -n, --entries N        override number of entries\n"
+            "  -k, --key-size N       override size of key\n"
+            "  -d, --data-size N      override size of record\n"
+            "  -s, --seed N|time      override master seed\n"
+            "  -j, --threads N        override number of worker threads (0 means number of CPUs)\n"
+            "  -o, --output DIR       write results to DIR (created iff needed)\n"
+            "  -q, --quiet            do not print progress of paper experiments (results are still printed)\n"
+            "  -p, --progress         print progress of experiments to stderr\n"
+            "  -h, --help             print this help\n",
+            prog);
+}
 
-    struct
+static int parse_options(int argc, char **argv, Options *options)
+{
+    static const struct option long_options[] =
     {
-        size_t key_size;
-        size_t data_size;
-        size_t entries;
+        {"experiment", required_argument, NULL, 'e'},
+        {"list", no_argument, NULL, 'l'},
+        {"entries", required_argument, NULL, 'n'},
+        {"key-size", required_argument, NULL, 'k'},
+        {"data-size", required_argument, NULL, 'd'},
+        {"seed", required_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 'j'},
+        {"output", required_argument, NULL, 'o'},
+        {"quiet", no_argument, NULL, 'q'},
+        {"progress", no_argument, NULL, 'p'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    int ret = 0;
+
+    (void)memset(options, 0, sizeof(*options));
+
+    /* every argument can be experiment or spec, so argc is enough for both arrays */
+    options->experiments = malloc(sizeof(*options->experiments) * (size_t)argc);
+    options->specs = malloc(sizeof(*options->specs) * (size_t)argc);
+    if (options->experiments == NULL || options->specs == NULL)
+    {
+        fprintf(stderr, "malloc error\n");
+        return 1;
     }
-    table = {.key_size = sizeof(int), .data_size = sizeof(void*), .entries = 100000000};
-
-    const double selectivity = 0.05;
-
-    experiment1("ex1", table.key_size, table.data_size, table.entries, QUERY_RANDOM, selectivity);
-
-    experiment_index("ex2_index_write_intensive", table.key_size, table.data_size, table.entries, &(StressBatch){.inserts = 40000, .deletes = 40000, .psearches = 20000}, 10);
-    experiment_index("ex2_index_read_intensive", table.key_size, table.data_size, table.entries, &(StressBatch){.inserts = 10000, .deletes = 10000, .psearches = 80000}, 10);
-    experiment_index("ex2_index_balanced", table.key_size, table.data_size, table.entries, &(StressBatch){.inserts = 25000, .deletes = 25000, .psearches = 50000}, 10);
-
-    // experiment2("ex2", table.key_size, table.data_size, table.entries, QUERY_RANDOM, selectivity);
-    experiment3("ex3_random", table.key_size, table.data_size, table.entries, QUERY_RANDOM, selectivity);
-    experiment3("ex3_newkeys", table.key_size, table.data_size, table.entries, QUERY_ALWAYS_NEW, selectivity);
-    experiment3("ex3_seq", table.key_size, table.data_size, table.entries, QUERY_SEQUENTIAL_PATTERN, selectivity);
-
-    experiment3_1("ex3_1_random", table.key_size, table.data_size, table.entries, QUERY_RANDOM, selectivity);
-    experiment3_1("ex3_1_newkeys", table.key_size, table.data_size, table.entries, QUERY_ALWAYS_NEW, selectivity);
-    experiment3_1("ex3_1_seq", table.key_size, table.data_size, table.entries, QUERY_SEQUENTIAL_PATTERN, selectivity);
-
-    // experiment_stress("ex4_stress1",
-    //                   table.key_size,
-    //                   table.data_size,
-    //                   table.entries,
-    //                   &(StressBatch){.inserts = 500, .deletes = 500, .rsearches = 1000, .selectivity_min = 0.01},
-    //                   20);
-
-    // experiment_stress("ex4_stress2",
-    //                   table.key_size,
-    //                   table.data_size,
-    //                   table.entries,
-    //                   &(StressBatch){.inserts = 5, .deletes = 5, .rsearches = 10, .selectivity_min = 0.01},
-    //                   100);
-
-    // experiment_stress("ex4_stress3",
-    //                   table.key_size,
-    //                   table.data_size,
-    //                   table.entries,
-    //                   &(StressBatch){.inserts = 10, .deletes = 10, .rsearches = 80, .selectivity_min = 0.01},
-    //                   40);
-
-    // experiment_stress("ex4_stress4",
-    //                   table.key_size,
-    //                   table.data_size,
-    //                   table.entries,
-    //                   &(StressBatch){.inserts = 100000, .deletes = 100000, .rsearches = 5, .selectivity_min = 0.01},
-    //                   5);
-
-    const double sel_min  = 0.01;
-    const double sel_max  = 0.05;
-    const double sel_step = 0.01;
-    experiment_stress_step("ex4_stress_step1",
-                           table.key_size,
-                           table.data_size,
-                           table.entries,
-                           &(StressBatch){.inserts = 500, .deletes = 500, .rsearches = 1000, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-                           20);
-
-    // experiment_stress_step("ex4_stress_step2",
-    //                        table.key_size,
-    //                        table.data_size,
-    //                        table.entries,
-    //                        &(StressBatch){.inserts = 5, .deletes = 5, .rsearches = 10, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-    //                        100);
-
-    // experiment_stress_step("ex4_stress_step3",
-    //                        table.key_size,
-    //                        table.data_size,
-    //                        table.entries,
-    //                        &(StressBatch){.inserts = 10, .deletes = 10, .rsearches = 80, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-    //                        40);
-
-    experiment_stress_step("ex4_stress_step4",
-                           table.key_size,
-                           table.data_size,
-                           table.entries,
-                           &(StressBatch){.inserts = 100000, .deletes = 100000, .rsearches = 5, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-                           5);
-
-    experiment_stress_step("ex4_stress_step5",
-                           table.key_size,
-                           table.data_size,
-                           table.entries,
-                           &(StressBatch){.inserts = 100000000, .deletes = 100000, .rsearches = 20, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-                           10);
-
-    experiment_stress_pam_step("ex4_1_stress_step1",
-                               table.key_size,
-                               table.data_size,
-                               table.entries,
-                               &(StressBatch){.inserts = 500, .deletes = 500, .rsearches = 1000, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-                               20);
-
-    experiment_stress_pam_step("ex4_1_stress_step4",
-                               table.key_size,
-                               table.data_size,
-                               table.entries,
-                               &(StressBatch){.inserts = 100000, .deletes = 100000, .rsearches = 5, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-                               5);
-
-    experiment_stress_pam_step("ex4_1_stress_step5",
-                               table.key_size,
-                               table.data_size,
-                               table.entries,
-                               &(StressBatch){.inserts = 100000000, .deletes = 100000, .rsearches = 20, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-                               10);
-
-    // experiment_stress_pam_step("ex4_1_stress_step5B",
-    //                            table.key_size,
-    //                            table.data_size,
-    //                            table.entries,
-    //                            &(StressBatch){.inserts = 100000000, .deletes = 100000, .rsearches = 20, .selectivity_min = 0.01, .selectivity_max = 0.2, .selectivity_step = 0.01},
-    //                            10);
-
-
-    experiment_stress_pam_step("ex4_1_stress_step6",
-                               table.key_size,
-                               table.data_size,
-                               table.entries,
-                               &(StressBatch){.inserts = 10000000, .deletes = 10000 , .rsearches = 10, .selectivity_min = sel_min, .selectivity_max = sel_max, .selectivity_step = sel_step},
-                               10);
 
+    while (ret == 0 && (opt = getopt_long(argc, argv, "e:ln:k:d:s:j:o:qph", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'e':
+                options->experiments[options->num_experiments++] = optarg;
+                break;
+            case 'l':
+                options->list = true;
+                break;
+            case 'n':
+                ret = workload_parse_size(optarg, &options->entries);
+                break;
+            case 'k':
+                ret = workload_parse_size(optarg, &options->key_size);
+                break;
+            case 'd':
+                ret = workload_parse_size(optarg, &options->data_size);
+                break;
+            case 's':
+                options->seed_set = true;
+                ret = workload_parse_seed(optarg, &options->seed);
+                break;
+            case 'j':
+                options->threads_set = true;
+                ret = workload_parse_size(optarg, &options->threads);
+                break;
+            case 'o':
+                options->output_dir = optarg;
+                break;
+            case 'q':
+                options->quiet = true;
+                break;
+            case 'p':
+                options->progress = true;
+                break;
+            case 'h':
+                usage(argv[0], stdout);
+                return -1;
+            default:
+                usage(argv[0], stderr);
+                return 1;
+        }
+
+        if (ret != 0)
+            fprintf(stderr, "%s: wrong value of -%c: %s\n", argv[0], opt, optarg);
+    }
+
+    if (ret != 0)
+        return 1;
+
+    while (optind < argc)
+        options->specs[options->num_specs++] = argv[optind++];
+
+    if (options->num_specs == 0)
+        options->specs[options->num_specs++] = DEFAULT_SPEC;
 
     return 0;
-}
\ No newline at end of file
+}
+
+static int enter_output_dir(const char *dir)
+{
+    char path[PATH_MAX];
+    char *sep;
+
+    if (strlen(dir) >= sizeof(path))
+    {
+        fprintf(stderr, "%s: path is too long\n", dir);
+        return 1;
+    }
+
+    (void)strcpy(path, dir);
+
+    /* like mkdir -p, every missing parent is created */
+    for (sep = strchr(path + 1, '/'); ; sep = strchr(sep + 1, '/'))
+    {
+        if (sep != NULL)
+            *sep = '\0';
+
+        if (mkdir(path, 0755) != 0 && errno != EEXIST)
+        {
+            perror(path);
+            return 1;
+        }
+
+        if (sep == NULL)
+            break;
+
+        *sep = '/';
+    }
+
+    if (chdir(dir) != 0)
+    {
+        perror(dir);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    Workload **workloads;
+    bool *found;
+    bool *found_in_spec;
+    size_t i;
+    size_t n;
+    size_t j;
+    int ret;
+
+    ret = parse_options(argc, argv, &options);
+    if (ret != 0)
+    {
+        FREE(options.experiments);
+        FREE(options.specs);
+        return ret > 0 ? 1 : 0;
+    }
+
+    workloads = calloc(options.num_specs, sizeof(*workloads));
+    found = calloc(options.num_experiments + 1, sizeof(*found));
+    found_in_spec = calloc(options.num_experiments + 1, sizeof(*found_in_spec));
+    if (workloads == NULL || found == NULL || found_in_spec == NULL)
+    {
+        fprintf(stderr, "calloc error\n");
+        ret = 1;
+        goto out;
+    }
+
+    /* all specs are loaded before the first experiment, so broken spec or name does not waste run */
+    for (i = 0; i < options.num_specs; ++i)
+    {
+        workloads[i] = workload_load(options.specs[i]);
+        if (workloads[i] == NULL)
+        {
+            ret = 1;
+            continue;
+        }
+
+        workload_override_sizes(workloads[i], options.entries, options.key_size, options.data_size);
+        if (options.seed_set)
+            workloads[i]->seed = options.seed;
+        if (options.threads_set)
+            workloads[i]->threads = options.threads;
+        workloads[i]->progress = options.progress;
+        workloads[i]->quiet = options.quiet;
+
+        if (options.num_experiments > 0)
+        {
+            (void)workload_select(workloads[i], options.experiments, options.num_experiments, found_in_spec);
+            for (n = 0; n < options.num_experiments; ++n)
+                found[n] = found[n] || found_in_spec[n];
+        }
+    }
+
+    for (n = 0; n < options.num_experiments; ++n)
+        if (!found[n])
+        {
+            fprintf(stderr, "%s: unknown experiment %s\n", argv[0], options.experiments[n]);
+            ret = 1;
+        }
+
+    if (ret != 0)
+        goto out;
+
+    if (options.list)
+    {
+        for (i = 0; i < options.num_specs; ++i)
+            for (j = 0; j < workloads[i]->num_experiments; ++j)
+                if (workloads[i]->experiments[j].enabled)
+                    printf("%s\t%s\t%s\n", options.specs[i], workloads[i]->experiments[j].name, workload_type_name(workloads[i]->experiments[j].type));
+
+        goto out;
+    }
+
+    if (options.output_dir != NULL && enter_output_dir(options.output_dir))
+    {
+        ret = 1;
+        goto out;
+    }
+
+    for (i = 0; i < options.num_specs; ++i)
+        if (workload_run(workloads[i]))
+            ret = 1;
+
+out:
+    if (workloads != NULL)
+        for (i = 0; i < options.num_specs; ++i)
+            workload_destroy(workloads[i]);
+
+    FREE(workloads);
+    FREE(found);
+    FREE(found_in_spec);
+    FREE(options.experiments);
+    FREE(options.specs);
+
+    return ret;
+}
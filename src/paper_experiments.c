@@ -10,15 +10,81 @@
 #include <genrand.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <string.h>
+#include <stdbool.h>
+#include <taskpool.h>
 
 #define FILE_MAX_LEN 1024
 #define NODE_MAX_SIZE 512
 #define NODE_BULKLOAD_FACTOR 0.8
 #define SORT_BUFFER_SIZE (512 * 1000)
 
-void experiment1(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
+static unsigned long experiments_seed = 4357;
+static size_t experiments_threads = 0; /* 0 means number of CPUs */
+static bool experiments_quiet = false; /* results go only to files, nothing on stdout */
+
+/* PCM model of every structure in experiments, pcm_create_default_model by default */
+static size_t experiments_mem_line = 64;
+static pcm_time_t experiments_read_time = NANO(50);
+static pcm_time_t experiments_write_time = MICRO(1);
+
+/*
+    Get sort buffer size of stress batch
+
+    PARAMS
+    @IN batch - pointer to batch description
+
+    RETURN
+    batch->buffer_size iff set, SORT_BUFFER_SIZE otherwise
+*/
+static ___inline___ size_t experiment_buffer_size(const StressBatch *batch);
+
+static ___inline___ size_t experiment_buffer_size(const StressBatch *batch)
+{
+    return batch->buffer_size > 0 ? batch->buffer_size : SORT_BUFFER_SIZE;
+}
+
+void experiments_set_seed(unsigned long seed)
+{
+    experiments_seed = seed;
+}
+
+void experiments_set_threads(size_t threads)
+{
+    experiments_threads = threads;
+}
+
+void experiments_set_quiet(bool quiet)
+{
+    experiments_quiet = quiet;
+}
+
+void experiments_set_pcm(size_t mem_line, pcm_time_t read_time, pcm_time_t write_time)
+{
+    experiments_mem_line = mem_line;
+    experiments_read_time = read_time;
+    experiments_write_time = write_time;
+}
+
+Genrand *experiments_create_rng(size_t cell, size_t structure)
+{
+    return genrand_create_stream(experiments_seed, (unsigned long)(cell * EXPERIMENT_MAX_STRUCTURES + structure));
+}
+
+PCM *experiments_create_pcm(void)
+{
+    return pcm_create(experiments_mem_line, experiments_read_time, experiments_write_time);
+}
+
+PCM *experiments_create_pcm_region(size_t size, const char *path)
+{
+    return pcm_create_region(experiments_mem_line, experiments_read_time, experiments_write_time, size, path);
+}
+
+int experiment1(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
 {
     PCM *pcm;
+    Genrand *rng;
     DB_AM *am;
 
     size_t query;
@@ -32,19 +98,29 @@ void experiment1(const char * const file, size_t key_size, size_t data_size, siz
 
     TRACE();
 
-    sgenrand((unsigned long)time(NULL));
-
     snprintf(file_name, sizeof(file_name), "%s_invalidation.txt", file);
     fd = open(file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ERROR("open error\n", 1);
+
     dprintf(fd, "TYPE\tTime\tPCM Wear-out\n");
 
     for (i = 0; i < ARRAY_SIZE(invalidation_type); ++i)
     {
-        pcm = pcm_create_default_model();
-        am = db_am_create(pcm, entries, key_size, data_size, (size_t)(0.01 * (double)entries * (double)data_size), 4000, invalidation_type[i], BTREE_SKIP_COST);
+        pcm = experiments_create_pcm();
+        rng = experiments_create_rng(0, i);
+        am = db_am_create(pcm, rng, entries, key_size, data_size, (size_t)(0.01 * (double)entries * (double)data_size), 4000, invalidation_type[i], BTREE_SKIP_COST);
+        if (am == NULL)
+        {
+            pcm_destroy(pcm);
+            genrand_destroy(rng);
+            close(fd);
+            ERROR("db_am_create error\n", 1);
+        }
 
         db_stat_reset();
-        printf("%s\n", invalidation_names[i]);
+        if (!experiments_quiet)
+            printf("%s\n", invalidation_names[i]);
         query = 0;
         do
         {
@@ -52,24 +128,32 @@ void experiment1(const char * const file, size_t key_size, size_t data_size, siz
             db_am_search(am, type, (size_t)((double)entries * selectivity));
             db_stat_finish_query();
 
-            printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", query, am->index->num_entries, am->index->num_entries + am->num_entries_in_partitions);
+            if (!experiments_quiet)
+                printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", query, am->index->num_entries, am->index->num_entries + am->num_entries_in_partitions);
             ++query;
         } while (am->num_entries_in_partitions > 0);
 
-        printf("AFTER %zu queries we have full index\n", query);
-        db_stat_summary_print();
-        dprintf(fd, "%s\t%lf\t%zu\n", invalidation_names[i], db_total.invalidation_time, pcm->wearout);
+        if (!experiments_quiet)
+        {
+            printf("AFTER %zu queries we have full index\n", query);
+            db_stat_summary_print();
+        }
+        dprintf(fd, "%s\t%lf\t%zu\n", invalidation_names[i], pcm_time_to_seconds(db_total.invalidation_time), pcm->wearout);
 
         db_am_destroy(am);
         pcm_destroy(pcm);
+        genrand_destroy(rng);
     }
 
     close(fd);
+
+    return 0;
 }
 
-void experiment2(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
+int experiment2(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
 {
     PCM *pcm;
+    Genrand *rng;
     DB_AM *am;
 
     size_t query;
@@ -83,19 +167,29 @@ void experiment2(const char * const file, size_t key_size, size_t data_size, siz
 
     TRACE();
 
-    sgenrand((unsigned long)time(NULL));
-
     snprintf(file_name, sizeof(file_name), "%s_BTREE.txt", file);
     fd = open(file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ERROR("open error\n", 1);
+
     dprintf(fd, "TYPE\tTime\tPCM Wear-out\n");
 
     for (i = 0; i < ARRAY_SIZE(btree_type); ++i)
     {
-        pcm = pcm_create_default_model();
-        am = db_am_create(pcm, entries, key_size, data_size, (size_t)(0.01 * (double)entries * (double)data_size), 4000, INVALIDATION_SKIP, btree_type[i]);
+        pcm = experiments_create_pcm();
+        rng = experiments_create_rng(0, i);
+        am = db_am_create(pcm, rng, entries, key_size, data_size, (size_t)(0.01 * (double)entries * (double)data_size), 4000, INVALIDATION_SKIP, btree_type[i]);
+        if (am == NULL)
+        {
+            pcm_destroy(pcm);
+            genrand_destroy(rng);
+            close(fd);
+            ERROR("db_am_create error\n", 1);
+        }
 
         db_stat_reset();
-        printf("%s\n", btree_names[i]);
+        if (!experiments_quiet)
+            printf("%s\n", btree_names[i]);
         query = 0;
         do
         {
@@ -103,28 +197,38 @@ void experiment2(const char * const file, size_t key_size, size_t data_size, siz
             db_am_search(am, type, (size_t)((double)entries * selectivity));
             db_stat_finish_query();
 
-            printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", query, am->index->num_entries, am->index->num_entries + am->num_entries_in_partitions);
+            if (!experiments_quiet)
+                printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", query, am->index->num_entries, am->index->num_entries + am->num_entries_in_partitions);
             ++query;
         } while (am->num_entries_in_partitions > 0);
 
-        printf("AFTER %zu queries we have full index\n", query);
-        db_stat_summary_print();
-        dprintf(fd, "%s\t%lf\t%zu\n", btree_names[i], db_total.index_time, pcm->wearout);
+        if (!experiments_quiet)
+        {
+            printf("AFTER %zu queries we have full index\n", query);
+            db_stat_summary_print();
+        }
+        dprintf(fd, "%s\t%lf\t%zu\n", btree_names[i], pcm_time_to_seconds(db_total.index_time), pcm->wearout);
 
         db_am_destroy(am);
         pcm_destroy(pcm);
+        genrand_destroy(rng);
     }
 
     close(fd);
+
+    return 0;
 }
 
-void experiment3(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
+int experiment3(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
 {
     PCM *pcm_am;
     PCM *pcm_eam;
     PCM *pcm_index;
     PCM *pcm_raw;
     PCM *pcm_pam;
+    Genrand *rng_am;
+    Genrand *rng_eam;
+    Genrand *rng_pam;
 
     DB_index *index;
     DB_raw *raw;
@@ -135,15 +239,15 @@ void experiment3(const char * const file, size_t key_size, size_t data_size, siz
     size_t i;
 
     int fd;
-    double raw_time;
-    double index_time;
-    double pam_time;
-    double am_time;
-    double eam_time;
+    pcm_time_t raw_time;
+    pcm_time_t index_time;
+    pcm_time_t pam_time;
+    pcm_time_t am_time;
+    pcm_time_t eam_time;
 
-    double total_am_time = 0.0;
-    double total_eam_time = 0.0;
-    double total_pam_time = 0.0;
+    pcm_time_t total_am_time = 0;
+    pcm_time_t total_eam_time = 0;
+    pcm_time_t total_pam_time = 0;
 
     char query_file_name[FILE_MAX_LEN];
     char total_file_name[FILE_MAX_LEN];
@@ -153,19 +257,41 @@ void experiment3(const char * const file, size_t key_size, size_t data_size, siz
     // const size_t buffer_size = (size_t)(0.0001 * (double)entries * (double)data_size);
     const size_t buffer_size = SORT_BUFFER_SIZE;
 
+    int ret = 0;
+
     TRACE();
 
-    pcm_raw = pcm_create_default_model();
-    pcm_index = pcm_create_default_model();
-    pcm_am = pcm_create_default_model();
-    pcm_eam = pcm_create_default_model();
-    pcm_pam = pcm_create_default_model();
+    pcm_raw = experiments_create_pcm();
+    pcm_index = experiments_create_pcm();
+    pcm_am = experiments_create_pcm();
+    pcm_eam = experiments_create_pcm();
+    pcm_pam = experiments_create_pcm();
+    rng_am = experiments_create_rng(0, 0);
+    rng_eam = experiments_create_rng(0, 1);
+    rng_pam = experiments_create_rng(0, 2);
 
     index = db_index_create(pcm_index, key_size, data_size, node_size, node_factor, BTREE_NORMAL);
     raw = db_raw_create(pcm_raw, data_size);
-    am = db_am_create(pcm_am, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_OVERWRITE, BTREE_NORMAL_INNERS_RAM);
-    eam = db_am_create(pcm_eam, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_BITMAP, BTREE_UNSORTED_LEAVES_INNERS_RAM);
-    pam = db_pam_create(pcm_pam, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
+    am = db_am_create(pcm_am, rng_am, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_OVERWRITE, BTREE_NORMAL_INNERS_RAM);
+    eam = db_am_create(pcm_eam, rng_eam, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_BITMAP, BTREE_UNSORTED_LEAVES_INNERS_RAM);
+    pam = db_pam_create(pcm_pam, rng_pam, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
+    if (index == NULL || raw == NULL || am == NULL || eam == NULL || pam == NULL)
+    {
+        db_index_destroy(index);
+        db_raw_destroy(raw);
+        db_pam_destroy(pam);
+        db_am_destroy(am);
+        db_am_destroy(eam);
+        pcm_destroy(pcm_index);
+        pcm_destroy(pcm_raw);
+        pcm_destroy(pcm_am);
+        pcm_destroy(pcm_eam);
+        pcm_destroy(pcm_pam);
+        genrand_destroy(rng_am);
+        genrand_destroy(rng_eam);
+        genrand_destroy(rng_pam);
+        ERROR("structure create error\n", 1);
+    }
 
     db_index_bulkload(index, entries);
     db_raw_bulkload(raw, entries);
@@ -176,7 +302,8 @@ void experiment3(const char * const file, size_t key_size, size_t data_size, siz
     db_index_range_search(index, (size_t)((double)entries * selectivity));
     db_stat_finish_query();
     index_time = db_stat_get_current_time();
-    db_stat_summary_print();
+    if (!experiments_quiet)
+        db_stat_summary_print();
 
     /* time for search from raw */
     db_stat_reset();
@@ -184,20 +311,24 @@ void experiment3(const char * const file, size_t key_size, size_t data_size, siz
     db_raw_range_search(raw, (size_t)((double)entries * selectivity));
     db_stat_finish_query();
     raw_time = db_stat_get_current_time();
-    db_stat_summary_print();
+    if (!experiments_quiet)
+        db_stat_summary_print();
 
     db_pam_search(pam, type, 1);
     db_am_search(am, type, 1);
     db_am_search(eam, type, 1);
 
     /* skip cost of init */
-    pcm_am->wearout = 0;
-    pcm_eam->wearout = 0;
-    pcm_pam->wearout = 0;
+    pcm_reset_counters(pcm_am);
+    pcm_reset_counters(pcm_eam);
+    pcm_reset_counters(pcm_pam);
 
     db_stat_reset();
     snprintf(query_file_name, sizeof(query_file_name), "%s_per_query.txt", file);
     fd = open(query_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ret = 1;
+
     dprintf(fd, "Query\tIndex\tScan\tPAM\tAM\teAM\n");
     i = 0;
     do
@@ -220,14 +351,18 @@ void experiment3(const char * const file, size_t key_size, size_t data_size, siz
         eam_time = db_stat_get_current_time();
         total_eam_time += eam_time;
 
-        dprintf(fd, "%zu\t%lf\t%lf\t%lf\t%lf\t%lf\n", i + 1, index_time, raw_time, pam_time, am_time, eam_time);
-        printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", i + 1, am->index->num_entries, am->index->num_entries + am->num_entries_in_partitions);
+        dprintf(fd, "%zu\t%lf\t%lf\t%lf\t%lf\t%lf\n", i + 1, pcm_time_to_seconds(index_time), pcm_time_to_seconds(raw_time), pcm_time_to_seconds(pam_time), pcm_time_to_seconds(am_time), pcm_time_to_seconds(eam_time));
+        if (!experiments_quiet)
+            printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", i + 1, am->index->num_entries, am->index->num_entries + am->num_entries_in_partitions);
 
         ++i;
     } while (pam->am->num_entries_in_partitions > 0 || eam->num_entries_in_partitions > 0 || am->num_entries_in_partitions > 0);
 
-    printf("AFTER %zu queries we have full index\n", i);
-    db_stat_summary_print();
+    if (!experiments_quiet)
+    {
+        printf("AFTER %zu queries we have full index\n", i);
+        db_stat_summary_print();
+    }
 
     db_index_destroy(index);
     db_raw_destroy(raw);
@@ -238,10 +373,13 @@ void experiment3(const char * const file, size_t key_size, size_t data_size, siz
 
     snprintf(total_file_name, sizeof(total_file_name), "%s_total.txt", file);
     fd = open(total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ret = 1;
+
     dprintf(fd, "Type\tTime\tPCM Wear-out\n");
-    dprintf(fd, "AM\t%lf\t%zu\n", total_am_time, pcm_am->wearout);
-    dprintf(fd, "eAM\t%lf\t%zu\n", total_eam_time, pcm_eam->wearout);
-    dprintf(fd, "PAM\t%lf\t%zu\n", total_pam_time, pcm_pam->wearout);
+    dprintf(fd, "AM\t%lf\t%zu\n", pcm_time_to_seconds(total_am_time), pcm_am->wearout);
+    dprintf(fd, "eAM\t%lf\t%zu\n", pcm_time_to_seconds(total_eam_time), pcm_eam->wearout);
+    dprintf(fd, "PAM\t%lf\t%zu\n", pcm_time_to_seconds(total_pam_time), pcm_pam->wearout);
     close(fd);
 
     pcm_destroy(pcm_index);
@@ -249,13 +387,21 @@ void experiment3(const char * const file, size_t key_size, size_t data_size, siz
     pcm_destroy(pcm_am);
     pcm_destroy(pcm_eam);
     pcm_destroy(pcm_pam);
+    genrand_destroy(rng_am);
+    genrand_destroy(rng_eam);
+    genrand_destroy(rng_pam);
+
+    return ret;
 }
 
-void experiment3_1(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
+int experiment3_1(const char * const file, size_t key_size, size_t data_size, size_t entries, query_t type, double selectivity)
 {
     PCM *pcm_pam_ub;
     PCM *pcm_pam_sb;
     PCM* pcm_pam_bb;
+    Genrand *rng_pam_ub;
+    Genrand *rng_pam_sb;
+    Genrand *rng_pam_bb;
 
     DB_PAM *pam_ub;
     DB_PAM *pam_sb;
@@ -264,13 +410,13 @@ void experiment3_1(const char * const file, size_t key_size, size_t data_size, s
     size_t i;
 
     int fd;
-    double pam_ub_time;
-    double pam_sb_time;
-    double pam_bb_time;
+    pcm_time_t pam_ub_time;
+    pcm_time_t pam_sb_time;
+    pcm_time_t pam_bb_time;
 
-    double total_pam_ub_time = 0.0;
-    double total_pam_sb_time = 0.0;
-    double total_pam_bb_time = 0.0;
+    pcm_time_t total_pam_ub_time = 0;
+    pcm_time_t total_pam_sb_time = 0;
+    pcm_time_t total_pam_bb_time = 0;
 
     char total_file_name[FILE_MAX_LEN];
 
@@ -279,24 +425,42 @@ void experiment3_1(const char * const file, size_t key_size, size_t data_size, s
     // const size_t buffer_size = (size_t)(0.0001 * (double)entries * (double)data_size);
     const size_t buffer_size = SORT_BUFFER_SIZE;
 
-    TRACE();
+    int ret = 0;
 
-    pcm_pam_ub = pcm_create_default_model();
-    pcm_pam_sb = pcm_create_default_model();
-    pcm_pam_bb = pcm_create_default_model();
+    TRACE();
 
-    pam_bb = db_pam_create(pcm_pam_bb, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
-    pam_sb = db_pam_create(pcm_pam_sb, entries, key_size, data_size, buffer_size, node_size, BTREE_2SECTION_NODE_INNERS_RAM);
-    pam_ub = db_pam_create(pcm_pam_ub, entries, key_size, data_size, buffer_size, node_size, BTREE_UNSORTED_LEAVES_INNERS_RAM);
+    pcm_pam_ub = experiments_create_pcm();
+    pcm_pam_sb = experiments_create_pcm();
+    pcm_pam_bb = experiments_create_pcm();
+    rng_pam_ub = experiments_create_rng(0, 0);
+    rng_pam_sb = experiments_create_rng(0, 1);
+    rng_pam_bb = experiments_create_rng(0, 2);
+
+    pam_bb = db_pam_create(pcm_pam_bb, rng_pam_bb, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
+    pam_sb = db_pam_create(pcm_pam_sb, rng_pam_sb, entries, key_size, data_size, buffer_size, node_size, BTREE_2SECTION_NODE_INNERS_RAM);
+    pam_ub = db_pam_create(pcm_pam_ub, rng_pam_ub, entries, key_size, data_size, buffer_size, node_size, BTREE_UNSORTED_LEAVES_INNERS_RAM);
+    if (pam_bb == NULL || pam_sb == NULL || pam_ub == NULL)
+    {
+        db_pam_destroy(pam_sb);
+        db_pam_destroy(pam_ub);
+        db_pam_destroy(pam_bb);
+        pcm_destroy(pcm_pam_ub);
+        pcm_destroy(pcm_pam_sb);
+        pcm_destroy(pcm_pam_bb);
+        genrand_destroy(rng_pam_ub);
+        genrand_destroy(rng_pam_sb);
+        genrand_destroy(rng_pam_bb);
+        ERROR("db_pam_create error\n", 1);
+    }
 
     db_pam_search(pam_ub, type, 1);
     db_pam_search(pam_sb, type, 1);
     db_pam_search(pam_bb, type, 1);
 
     /* skip cost of init */
-    pcm_pam_ub->wearout = 0;
-    pcm_pam_sb->wearout = 0;
-    pcm_pam_bb->wearout = 0;
+    pcm_reset_counters(pcm_pam_ub);
+    pcm_reset_counters(pcm_pam_sb);
+    pcm_reset_counters(pcm_pam_bb);
 
     db_stat_reset();
     i = 0;
@@ -320,13 +484,17 @@ void experiment3_1(const char * const file, size_t key_size, size_t data_size, s
         pam_bb_time = db_stat_get_current_time();
         total_pam_bb_time += pam_bb_time;
 
-        printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", i + 1, pam_sb->am->index->num_entries, pam_sb->am->index->num_entries + pam_sb->am->num_entries_in_partitions);
+        if (!experiments_quiet)
+            printf("QUERY %zu:\tENTRIES  (%zu/%zu)\n", i + 1, pam_sb->am->index->num_entries, pam_sb->am->index->num_entries + pam_sb->am->num_entries_in_partitions);
 
         ++i;
     } while (pam_bb->am->num_entries_in_partitions > 0 || pam_sb->am->num_entries_in_partitions > 0 || pam_ub->am->num_entries_in_partitions > 0);
 
-    printf("AFTER %zu queries we have full index\n", i);
-    db_stat_summary_print();
+    if (!experiments_quiet)
+    {
+        printf("AFTER %zu queries we have full index\n", i);
+        db_stat_summary_print();
+    }
 
     db_pam_destroy(pam_sb);
     db_pam_destroy(pam_ub);
@@ -334,77 +502,109 @@ void experiment3_1(const char * const file, size_t key_size, size_t data_size, s
 
     snprintf(total_file_name, sizeof(total_file_name), "%s_total.txt", file);
     fd = open(total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ret = 1;
+
     dprintf(fd, "Type\tTime\tPCM Wear-out\n");
-    dprintf(fd, "PAM UB+tree\t%lf\t%zu\n", total_pam_ub_time, pcm_pam_ub->wearout);
-    dprintf(fd, "PAM SB+tree\t%lf\t%zu\n", total_pam_sb_time, pcm_pam_sb->wearout);
-    dprintf(fd, "PAM BB+tree\t%lf\t%zu\n", total_pam_bb_time, pcm_pam_bb->wearout);
+    dprintf(fd, "PAM UB+tree\t%lf\t%zu\n", pcm_time_to_seconds(total_pam_ub_time), pcm_pam_ub->wearout);
+    dprintf(fd, "PAM SB+tree\t%lf\t%zu\n", pcm_time_to_seconds(total_pam_sb_time), pcm_pam_sb->wearout);
+    dprintf(fd, "PAM BB+tree\t%lf\t%zu\n", pcm_time_to_seconds(total_pam_bb_time), pcm_pam_bb->wearout);
     close(fd);
 
     pcm_destroy(pcm_pam_ub);
     pcm_destroy(pcm_pam_sb);
     pcm_destroy(pcm_pam_bb);
+    genrand_destroy(rng_pam_ub);
+    genrand_destroy(rng_pam_sb);
+    genrand_destroy(rng_pam_bb);
+
+    return ret;
 }
 
-void experiment_stress(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
+int experiment_stress(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
 {
     PCM *pcm_am;
     PCM *pcm_eam;
     PCM *pcm_pam;
+    Genrand *rng_am;
+    Genrand *rng_eam;
+    Genrand *rng_pam;
 
     DB_PAM *pam;
     DB_AM *am;
     DB_AM *eam;
 
     int fd;
-    double pam_time;
-    double am_time;
-    double eam_time;
+    pcm_time_t pam_time;
+    pcm_time_t am_time;
+    pcm_time_t eam_time;
 
-    double total_am_time = 0.0;
-    double total_eam_time = 0.0;
-    double total_pam_time = 0.0;
+    pcm_time_t total_am_time = 0;
+    pcm_time_t total_eam_time = 0;
+    pcm_time_t total_pam_time = 0;
 
     char total_file_name[FILE_MAX_LEN];
     char query_file_name[FILE_MAX_LEN];
 
     const size_t node_size = NODE_MAX_SIZE;
     // const size_t buffer_size = (size_t)(0.01 * (double)entries * (double)data_size);
-    const size_t buffer_size = SORT_BUFFER_SIZE;
+    const size_t buffer_size = experiment_buffer_size(batch);
 
-    TRACE();
+    int ret = 0;
 
-    pcm_am = pcm_create_default_model();
-    pcm_eam = pcm_create_default_model();
-    pcm_pam = pcm_create_default_model();
+    TRACE();
 
-    am = db_am_create(pcm_am, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_OVERWRITE, BTREE_NORMAL_INNERS_RAM);
-    eam = db_am_create(pcm_eam, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_BITMAP, BTREE_UNSORTED_LEAVES_INNERS_RAM);
-    pam = db_pam_create(pcm_pam, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
+    pcm_am = experiments_create_pcm();
+    pcm_eam = experiments_create_pcm();
+    pcm_pam = experiments_create_pcm();
+    rng_am = experiments_create_rng(0, 0);
+    rng_eam = experiments_create_rng(0, 1);
+    rng_pam = experiments_create_rng(0, 2);
+
+    am = db_am_create(pcm_am, rng_am, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_OVERWRITE, BTREE_NORMAL_INNERS_RAM);
+    eam = db_am_create(pcm_eam, rng_eam, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_BITMAP, BTREE_UNSORTED_LEAVES_INNERS_RAM);
+    pam = db_pam_create(pcm_pam, rng_pam, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
+    if (am == NULL || eam == NULL || pam == NULL)
+    {
+        db_pam_destroy(pam);
+        db_am_destroy(am);
+        db_am_destroy(eam);
+        pcm_destroy(pcm_am);
+        pcm_destroy(pcm_eam);
+        pcm_destroy(pcm_pam);
+        genrand_destroy(rng_am);
+        genrand_destroy(rng_eam);
+        genrand_destroy(rng_pam);
+        ERROR("structure create error\n", 1);
+    }
 
     db_pam_search(pam, QUERY_RANDOM, 1);
     db_am_search(am, QUERY_RANDOM, 1);
     db_am_search(eam, QUERY_RANDOM, 1);
 
     /* Lets skip cost of init */
-    pcm_am->wearout = 0;
-    pcm_eam->wearout = 0;
-    pcm_pam->wearout = 0;
+    pcm_reset_counters(pcm_am);
+    pcm_reset_counters(pcm_eam);
+    pcm_reset_counters(pcm_pam);
     db_stat_reset();
 
     snprintf(query_file_name, sizeof(query_file_name), "%s_per_batch.txt", file);
     fd = open(query_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ret = 1;
+
     dprintf(fd, "Query\tPAM\tAM\teAM\n");
     for (size_t i = 0; i < batches; ++i)
     {
-        printf("%s: BATCH %zu/%zu\n", file, (i + 1), batches);
+        if (!experiments_quiet)
+            printf("%s: BATCH %zu/%zu\n", file, (i + 1), batches);
 
         /* PAM BATCH */
         db_stat_start_query();
         for (size_t q = 0; q < batch->rsearches; ++q)
             db_pam_search(pam, QUERY_RANDOM, (size_t)((double)entries * batch->selectivity_min));
 
-        for (size_t q = 0; q < batch->inserts; ++q)
-            db_pam_insert(pam, 1);
+        db_pam_insert_batch(pam, batch->inserts);
 
         for (size_t q = 0; q < batch->deletes; ++q)
             db_pam_delete(pam, 1);
@@ -418,8 +618,7 @@ void experiment_stress(const char* file, size_t key_size, size_t data_size, size
         for (size_t q = 0; q < batch->rsearches; ++q)
             db_am_search(am, QUERY_RANDOM, (size_t)((double)entries * batch->selectivity_min));
 
-        for (size_t q = 0; q < batch->inserts; ++q)
-            db_am_insert(am, 1);
+        db_am_insert_batch(am, batch->inserts);
 
         for (size_t q = 0; q < batch->deletes; ++q)
             db_am_delete(am, 1);
@@ -433,8 +632,7 @@ void experiment_stress(const char* file, size_t key_size, size_t data_size, size
         for (size_t q = 0; q < batch->rsearches; ++q)
             db_am_search(eam, QUERY_RANDOM, (size_t)((double)entries * batch->selectivity_min));
 
-        for (size_t q = 0; q < batch->inserts; ++q)
-            db_am_insert(eam, 1);
+        db_am_insert_batch(eam, batch->inserts);
 
         for (size_t q = 0; q < batch->deletes; ++q)
             db_am_delete(eam, 1);
@@ -443,10 +641,11 @@ void experiment_stress(const char* file, size_t key_size, size_t data_size, size
         eam_time = db_stat_get_current_time();
         total_eam_time += eam_time;
 
-        dprintf(fd, "%zu\t%lf\t%lf\t%lf\n", (i + 1), pam_time, am_time, eam_time);
+        dprintf(fd, "%zu\t%lf\t%lf\t%lf\n", (i + 1), pcm_time_to_seconds(pam_time), pcm_time_to_seconds(am_time), pcm_time_to_seconds(eam_time));
     }
 
-    db_stat_summary_print();
+    if (!experiments_quiet)
+        db_stat_summary_print();
 
     db_pam_destroy(pam);
     db_am_destroy(am);
@@ -454,15 +653,21 @@ void experiment_stress(const char* file, size_t key_size, size_t data_size, size
 
     snprintf(total_file_name, sizeof(total_file_name), "%s_total.txt", file);
     fd = open(total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ret = 1;
+
     dprintf(fd, "Type\tTime\tPCM Wear-out\n");
     // dprintf(fd, "AM\t%lf\t%zu\n", total_am_time, pcm_am->wearout);
-    dprintf(fd, "eAM\t%lf\t%zu\n", total_eam_time, pcm_eam->wearout);
-    dprintf(fd, "PAM\t%lf\t%zu\n", total_pam_time, pcm_pam->wearout);
+    dprintf(fd, "eAM\t%lf\t%zu\n", pcm_time_to_seconds(total_eam_time), pcm_eam->wearout);
+    dprintf(fd, "PAM\t%lf\t%zu\n", pcm_time_to_seconds(total_pam_time), pcm_pam->wearout);
     close(fd);
 
     /* Normalize time and wearout to PAM */
     snprintf(total_file_name, sizeof(total_file_name), "%s_total_norma.txt", file);
     fd = open(total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ret = 1;
+
     dprintf(fd, "Type\tTime\tPCM Wear-out\n");
     // dprintf(fd, "AM\t%Lf\t%Lf\n", (long double)total_am_time / (long double)total_pam_time, (long double)pcm_am->wearout / (long double)pcm_pam->wearout);
     dprintf(fd, "eAM\t%Lf\t%Lf\n", (long double)total_eam_time / (long double)total_pam_time, (long double)pcm_eam->wearout / (long double)pcm_pam->wearout);
@@ -472,300 +677,454 @@ void experiment_stress(const char* file, size_t key_size, size_t data_size, size
     pcm_destroy(pcm_am);
     pcm_destroy(pcm_eam);
     pcm_destroy(pcm_pam);
+    genrand_destroy(rng_am);
+    genrand_destroy(rng_eam);
+    genrand_destroy(rng_pam);
+
+    return ret;
 }
 
 
-void experiment_stress_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
+/*
+    One cell of stress step experiment (1 structure with 1 selectivity)
+*/
+typedef struct StressCell
 {
-    char time_total_file_name[FILE_MAX_LEN];
-    char time_total_norma_file_name[FILE_MAX_LEN];
-    char mem_total_file_name[FILE_MAX_LEN];
-    char mem_total_norma_file_name[FILE_MAX_LEN];
-    int time_fd_total;
-    int time_fd_norma;
-    int mem_fd_total;
-    int mem_fd_norma;
+    /* input */
+    const char *file;
+    size_t key_size;
+    size_t data_size;
+    size_t entries;
+    size_t buffer_size;
+    const StressBatch *batch;
+    size_t batches;
+    double selectivity;
+    size_t step;
+    size_t structure;
+    const StressStructure *desc;
+
+    /* output */
+    pcm_time_t total_time;
+    size_t wearout;
+    int ret; /* 0 iff cell is done */
+} StressCell;
+
+/*
+    Run stress batches on one structure. Each cell has own PCM, random stream and statistics,
+    so cells are independent and can be executed in parallel
+
+    PARAMS
+    @IN arg - pointer to StressCell
+
+    RETURN
+    This is a void function
+*/
+static void experiment_stress_cell(void *arg);
+
+/*
+    Get selectivities used by stress step experiment
+
+    PARAMS
+    @IN batch - pointer to batch description
+    @OUT selectivity - array of selectivities (or NULL to get only the number of selectivities)
+
+    RETURN
+    Number of selectivities
+*/
+static size_t experiment_stress_selectivities(const StressBatch *batch, double *selectivity);
+
+/*
+    Run all cells of stress step experiment in parallel
+
+    PARAMS
+    @IN file - base file name
+    @IN key_size - sizeof(key) in Table T
+    @IN data_size - sizeof(Record) in Table T
+    @IN entries - how many entries is in Table T
+    @IN buffer_size - sort buffer size in bytes
+    @IN batch - pointer to batch description
+    @IN batches - number of batches
+    @IN structures - array of tested structures
+    @IN num_structures - number of tested structures
+    @OUT num_selectivities - number of selectivities (rows of returned array)
+
+    RETURN
+    Array of cells (num_selectivities x num_structures) iff success
+    NULL iff failure
+*/
+static StressCell *experiment_stress_run(const char *file, size_t key_size, size_t data_size, size_t entries, size_t buffer_size, const StressBatch *batch, size_t batches, const StressStructure *structures, size_t num_structures, size_t *num_selectivities);
+
+static void experiment_stress_cell(void *arg)
+{
+    StressCell *cell = (StressCell *)arg;
+    const StressStructure *desc = cell->desc;
+    const size_t query_entries = (size_t)((double)cell->entries * cell->selectivity);
 
-    snprintf(time_total_file_name, sizeof(time_total_file_name), "%s_time_total.txt", file);
-    time_fd_total = open(time_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
-    dprintf(time_fd_total, "Selectivity\tPAM\teAM\tAM\n");
+    PCM *pcm;
+    Genrand *rng;
+    DB_stat *stat;
+    DB_PAM *pam = NULL;
+    DB_AM *am = NULL;
 
-    snprintf(time_total_norma_file_name, sizeof(time_total_norma_file_name), "%s_time_total_norma.txt", file);
-    time_fd_norma = open(time_total_norma_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
-    dprintf(time_fd_norma, "Selectivity\tPAM\teAM\tAM\n");
+    const size_t node_size = NODE_MAX_SIZE;
 
-    snprintf(mem_total_file_name, sizeof(mem_total_file_name), "%s_wearout_total.txt", file);
-    mem_fd_total = open(mem_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
-    dprintf(mem_fd_total, "Wearout\tPAM\teAM\tAM\n");
+    TRACE();
 
-    snprintf(mem_total_norma_file_name, sizeof(mem_total_norma_file_name), "%s_wearout_total_norma.txt", file);
-    mem_fd_norma = open(mem_total_norma_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
-    dprintf(mem_fd_norma, "Wearout\tPAM\teAM\tAM\n");
+    pcm = experiments_create_pcm();
+    rng = experiments_create_rng(cell->step, cell->structure);
+    stat = db_stat_create();
 
-    for (double sel = batch->selectivity_min; sel <= batch->selectivity_max + 0.001; sel += batch->selectivity_step)
+    if (desc->pam)
+        pam = db_pam_create(pcm, rng, cell->entries, cell->key_size, cell->data_size, cell->buffer_size, node_size, desc->btree_type);
+    else
+        am = db_am_create(pcm, rng, cell->entries, cell->key_size, cell->data_size, cell->buffer_size, node_size, desc->invalidation_type, desc->btree_type);
+
+    if (stat == NULL || (pam == NULL && am == NULL))
     {
-        PCM *pcm_am;
-        PCM *pcm_eam;
-        PCM *pcm_pam;
+        db_stat_destroy(stat);
+        genrand_destroy(rng);
+        pcm_destroy(pcm);
+        cell->ret = 1;
+        return;
+    }
 
-        DB_PAM *pam;
-        DB_AM *am;
-        DB_AM *eam;
+    if (desc->pam)
+    {
+        db_pam_set_stat(pam, stat);
+        db_pam_search(pam, QUERY_RANDOM, 1);
+    }
+    else
+    {
+        db_am_set_stat(am, stat);
+        db_am_search(am, QUERY_RANDOM, 1);
+    }
 
-        double pam_time;
-        double am_time;
-        double eam_time;
+    /* Lets skip cost of init */
+    pcm_reset_counters(pcm);
+    db_stat_reset_r(stat);
 
-        double total_am_time = 0.0;
-        double total_eam_time = 0.0;
-        double total_pam_time = 0.0;
+    cell->total_time = 0;
+    for (size_t i = 0; i < cell->batches; ++i)
+    {
+        if (!experiments_quiet)
+            printf("%s: SEL: %.4lf/%.4lf: %s: BATCH %zu/%zu\n", cell->file, cell->selectivity, cell->batch->selectivity_max, desc->name, (i + 1), cell->batches);
 
-        const size_t node_size = NODE_MAX_SIZE;
-        // const size_t buffer_size = (size_t)(0.01 * (double)entries * (double)data_size);
-        size_t buffer_size = SORT_BUFFER_SIZE;
-        if (strcmp(file, "ex4_stress_step4") == 0 || strcmp(file, "ex4_stress_step5") == 0)
-            buffer_size = SORT_BUFFER_SIZE * 30;
+        db_stat_start_query_r(stat);
+        if (desc->pam)
+        {
+            for (size_t q = 0; q < cell->batch->rsearches; ++q)
+                db_pam_search(pam, QUERY_RANDOM, query_entries);
 
-        TRACE();
+            db_pam_insert_batch(pam, cell->batch->inserts);
 
-        pcm_am = pcm_create_default_model();
-        pcm_eam = pcm_create_default_model();
-        pcm_pam = pcm_create_default_model();
+            for (size_t q = 0; q < cell->batch->deletes; ++q)
+                db_pam_delete(pam, 1);
+        }
+        else
+        {
+            for (size_t q = 0; q < cell->batch->rsearches; ++q)
+                db_am_search(am, QUERY_RANDOM, query_entries);
 
-        am = db_am_create(pcm_am, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_OVERWRITE, BTREE_NORMAL_INNERS_RAM);
-        eam = db_am_create(pcm_eam, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_BITMAP, BTREE_UNSORTED_LEAVES_INNERS_RAM);
-        pam = db_pam_create(pcm_pam, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
+            db_am_insert_batch(am, cell->batch->inserts);
 
-        db_pam_search(pam, QUERY_RANDOM, 1);
-        db_am_search(am, QUERY_RANDOM, 1);
-        db_am_search(eam, QUERY_RANDOM, 1);
+            for (size_t q = 0; q < cell->batch->deletes; ++q)
+                db_am_delete(am, 1);
+        }
+        db_stat_finish_query_r(stat);
 
-        /* Lets skip cost of init */
-        pcm_am->wearout = 0;
-        pcm_eam->wearout = 0;
-        pcm_pam->wearout = 0;
-        db_stat_reset();
+        cell->total_time += db_stat_get_current_time_r(stat);
+    }
 
-        for (size_t i = 0; i < batches; ++i)
-        {
-            printf("%s: SEL: %.4lf/%.4lf: BATCH %zu/%zu\n", file, sel, batch->selectivity_max,  (i + 1), batches);
+    cell->wearout = pcm->wearout;
 
-            /* PAM BATCH */
-            db_stat_start_query();
-            for (size_t q = 0; q < batch->rsearches; ++q)
-                db_pam_search(pam, QUERY_RANDOM, (size_t)((double)entries * sel));
+    db_pam_destroy(pam);
+    db_am_destroy(am);
+    db_stat_destroy(stat);
+    genrand_destroy(rng);
+    pcm_destroy(pcm);
+}
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_pam_insert(pam, 1);
+static size_t experiment_stress_selectivities(const StressBatch *batch, double *selectivity)
+{
+    size_t n = 0;
 
-            for (size_t q = 0; q < batch->deletes; ++q)
-                db_pam_delete(pam, 1);
+    /* step == 0 means only min selectivity */
+    if (batch->selectivity_step <= 0.0)
+    {
+        if (selectivity != NULL)
+            selectivity[0] = batch->selectivity_min;
 
-            db_stat_finish_query();
-            pam_time = db_stat_get_current_time();
-            total_pam_time += pam_time;
+        return 1;
+    }
 
-            /* AM BATCH */
-            db_stat_start_query();
-            for (size_t q = 0; q < batch->rsearches; ++q)
-                db_am_search(am, QUERY_RANDOM, (size_t)((double)entries * sel));
+    for (double sel = batch->selectivity_min; sel <= batch->selectivity_max + 0.001; sel += batch->selectivity_step)
+    {
+        if (selectivity != NULL)
+            selectivity[n] = sel;
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_am_insert(am, 1);
+        ++n;
+    }
 
-            for (size_t q = 0; q < batch->deletes; ++q)
-                db_am_delete(am, 1);
+    return n;
+}
 
-            db_stat_finish_query();
-            am_time = db_stat_get_current_time();
-            total_am_time += am_time;
+static StressCell *experiment_stress_run(const char *file, size_t key_size, size_t data_size, size_t entries, size_t buffer_size, const StressBatch *batch, size_t batches, const StressStructure *structures, size_t num_structures, size_t *num_selectivities)
+{
+    StressCell *cells;
+    double *selectivity;
+    size_t n;
 
-            /* eAM BATCH */
-            db_stat_start_query();
-            for (size_t q = 0; q < batch->rsearches; ++q)
-                db_am_search(eam, QUERY_RANDOM, (size_t)((double)entries * sel));
+    TRACE();
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_am_insert(eam, 1);
+    n = experiment_stress_selectivities(batch, NULL);
 
-            for (size_t q = 0; q < batch->deletes; ++q)
-                db_am_delete(eam, 1);
+    selectivity = malloc(sizeof(*selectivity) * n);
+    if (selectivity == NULL)
+        ERROR("malloc error\n", NULL);
 
-            db_stat_finish_query();
-            eam_time = db_stat_get_current_time();
-            total_eam_time += eam_time;
+    cells = malloc(sizeof(*cells) * n * num_structures);
+    if (cells == NULL)
+    {
+        FREE(selectivity);
+        ERROR("malloc error\n", NULL);
+    }
+
+    (void)experiment_stress_selectivities(batch, selectivity);
+    for (size_t s = 0; s < n; ++s)
+        for (size_t i = 0; i < num_structures; ++i)
+            cells[s * num_structures + i] = (StressCell){.file = file,
+                                                        .key_size = key_size,
+                                                        .data_size = data_size,
+                                                        .entries = entries,
+                                                        .buffer_size = buffer_size,
+                                                        .batch = batch,
+                                                        .batches = batches,
+                                                        .selectivity = selectivity[s],
+                                                        .step = s,
+                                                        .structure = i,
+                                                        .desc = &structures[i]};
+
+    FREE(selectivity);
+
+    if (taskpool_run(experiments_threads, experiment_stress_cell, cells, sizeof(*cells), n * num_structures) != 0)
+    {
+        FREE(cells);
+        ERROR("taskpool_run error\n", NULL);
+    }
+
+    for (size_t i = 0; i < n * num_structures; ++i)
+        if (cells[i].ret != 0)
+        {
+            FREE(cells);
+            ERROR("experiment_stress_cell error\n", NULL);
         }
 
-        // db_stat_summary_print();
+    *num_selectivities = n;
+    return cells;
+}
 
-        db_pam_destroy(pam);
-        db_am_destroy(am);
-        db_am_destroy(eam);
+int experiment_stress_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
+{
+    char time_total_file_name[FILE_MAX_LEN];
+    char time_total_norma_file_name[FILE_MAX_LEN];
+    char mem_total_file_name[FILE_MAX_LEN];
+    char mem_total_norma_file_name[FILE_MAX_LEN];
+    int time_fd_total;
+    int time_fd_norma;
+    int mem_fd_total;
+    int mem_fd_norma;
+
+    StressCell *cells;
+    size_t num_selectivities;
 
-        dprintf(time_fd_total, "%.4lf\t%lf\t%lf\t%lf\n", sel, total_pam_time, total_eam_time, total_am_time);
-        dprintf(time_fd_norma, "%.4lf\t%Lf\t%Lf\t%Lf\n", sel, (long double)total_pam_time / (long double)total_pam_time, (long double)total_eam_time / (long double)total_pam_time, (long double)total_am_time / (long double)total_pam_time);
+    /* columns in output files */
+    enum {PAM, EAM, AM, STRUCTURES};
+    const StressStructure structures[] =
+    {
+        [PAM] = {.name = "PAM", .pam = true, .btree_type = BTREE_WITH_BUFFERED_TREE},
+        [EAM] = {.name = "eAM", .pam = false, .invalidation_type = INVALIDATION_BITMAP, .btree_type = BTREE_UNSORTED_LEAVES_INNERS_RAM},
+        [AM] = {.name = "AM", .pam = false, .invalidation_type = INVALIDATION_OVERWRITE, .btree_type = BTREE_NORMAL_INNERS_RAM},
+    };
 
-        dprintf(mem_fd_total, "%.4lf\t%zu\t%zu\t%zu\n", sel, pcm_pam->wearout, pcm_eam->wearout, pcm_am->wearout);
-        dprintf(mem_fd_norma, "%.4lf\t%Lf\t%Lf\t%Lf\n", sel, (long double)pcm_pam->wearout / (long double)pcm_pam->wearout, (long double)pcm_eam->wearout / (long double)pcm_pam->wearout, (long double)pcm_am->wearout / (long double)pcm_pam->wearout);
+    // const size_t buffer_size = (size_t)(0.01 * (double)entries * (double)data_size);
+    const size_t buffer_size = experiment_buffer_size(batch);
 
-        pcm_destroy(pcm_am);
-        pcm_destroy(pcm_eam);
-        pcm_destroy(pcm_pam);
+    int ret = 0;
+
+    TRACE();
+
+    cells = experiment_stress_run(file, key_size, data_size, entries, buffer_size, batch, batches, structures, STRUCTURES, &num_selectivities);
+    if (cells == NULL)
+        ERROR("experiment_stress_run error\n", 1);
+
+    snprintf(time_total_file_name, sizeof(time_total_file_name), "%s_time_total.txt", file);
+    time_fd_total = open(time_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (time_fd_total < 0)
+        ret = 1;
+
+    dprintf(time_fd_total, "Selectivity\tPAM\teAM\tAM\n");
+
+    snprintf(time_total_norma_file_name, sizeof(time_total_norma_file_name), "%s_time_total_norma.txt", file);
+    time_fd_norma = open(time_total_norma_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (time_fd_norma < 0)
+        ret = 1;
+
+    dprintf(time_fd_norma, "Selectivity\tPAM\teAM\tAM\n");
+
+    snprintf(mem_total_file_name, sizeof(mem_total_file_name), "%s_wearout_total.txt", file);
+    mem_fd_total = open(mem_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (mem_fd_total < 0)
+        ret = 1;
+
+    dprintf(mem_fd_total, "Wearout\tPAM\teAM\tAM\n");
+
+    snprintf(mem_total_norma_file_name, sizeof(mem_total_norma_file_name), "%s_wearout_total_norma.txt", file);
+    mem_fd_norma = open(mem_total_norma_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (mem_fd_norma < 0)
+        ret = 1;
+
+    dprintf(mem_fd_norma, "Wearout\tPAM\teAM\tAM\n");
+
+    /* write results in selectivity order, independent of execution order */
+    for (size_t s = 0; s < num_selectivities; ++s)
+    {
+        const StressCell *row = &cells[s * STRUCTURES];
+        const double sel = row[PAM].selectivity;
+
+        dprintf(time_fd_total, "%.4lf\t%lf\t%lf\t%lf\n", sel, pcm_time_to_seconds(row[PAM].total_time), pcm_time_to_seconds(row[EAM].total_time), pcm_time_to_seconds(row[AM].total_time));
+        dprintf(time_fd_norma, "%.4lf\t%Lf\t%Lf\t%Lf\n", sel, (long double)row[PAM].total_time / (long double)row[PAM].total_time, (long double)row[EAM].total_time / (long double)row[PAM].total_time, (long double)row[AM].total_time / (long double)row[PAM].total_time);
+
+        dprintf(mem_fd_total, "%.4lf\t%zu\t%zu\t%zu\n", sel, row[PAM].wearout, row[EAM].wearout, row[AM].wearout);
+        dprintf(mem_fd_norma, "%.4lf\t%Lf\t%Lf\t%Lf\n", sel, (long double)row[PAM].wearout / (long double)row[PAM].wearout, (long double)row[EAM].wearout / (long double)row[PAM].wearout, (long double)row[AM].wearout / (long double)row[PAM].wearout);
     }
 
     close(time_fd_total);
     close(time_fd_norma);
     close(mem_fd_total);
     close(mem_fd_norma);
+
+    FREE(cells);
+
+    return ret;
 }
 
-void experiment_stress_pam_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
+int experiment_stress_pam_step(const char* file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
 {
     char time_total_file_name[FILE_MAX_LEN];
     int time_fd_total;
 
-    snprintf(time_total_file_name, sizeof(time_total_file_name), "%s_time_total.txt", file);
-    time_fd_total = open(time_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
-    dprintf(time_fd_total, "Selectivity\teAM\tPAM UB+tree\tPAM SB+tree\tPAM BB+tree\n");
+    StressCell *cells;
+    size_t num_selectivities;
 
-    for (double sel = batch->selectivity_min; sel <= batch->selectivity_max + 0.001; sel += batch->selectivity_step)
+    enum {EAM, PAM_UB, PAM_SB, PAM_BB, STRUCTURES};
+    const StressStructure structures[] =
     {
-        PCM *pcm_eam;
-        PCM *pcm_pam_ub;
-        PCM *pcm_pam_sb;
-        PCM* pcm_pam_bb;
-
-        DB_AM *eam;
-        DB_PAM *pam_ub;
-        DB_PAM *pam_sb;
-        DB_PAM *pam_bb;
-
-
-        double eam_time;
-        double pam_ub_time;
-        double pam_sb_time;
-        double pam_bb_time;
-
-        double total_eam_time = 0.0;
-        double total_pam_ub_time = 0.0;
-        double total_pam_sb_time = 0.0;
-        double total_pam_bb_time = 0.0;
-
-        const size_t node_size = NODE_MAX_SIZE;
-        // const size_t buffer_size = (size_t)(0.01 * (double)entries * (double)data_size);
-        size_t buffer_size = SORT_BUFFER_SIZE;
-        if (strcmp(file, "ex4_1_stress_step4") == 0 || strcmp(file, "ex4_1_stress_step5") == 0 || strcmp(file, "ex4_1_stress_step6") == 0)
-            buffer_size = SORT_BUFFER_SIZE * 30;
-
-        TRACE();
-
-        pcm_eam = pcm_create_default_model();
-        pcm_pam_ub = pcm_create_default_model();
-        pcm_pam_sb = pcm_create_default_model();
-        pcm_pam_bb = pcm_create_default_model();
-
-        eam = db_am_create(pcm_eam, entries, key_size, data_size, buffer_size, node_size, INVALIDATION_BITMAP, BTREE_UNSORTED_LEAVES_INNERS_RAM);
-        pam_bb = db_pam_create(pcm_pam_bb, entries, key_size, data_size, buffer_size, node_size, BTREE_WITH_BUFFERED_TREE);
-        pam_sb = db_pam_create(pcm_pam_sb, entries, key_size, data_size, buffer_size, node_size, BTREE_2SECTION_NODE_INNERS_RAM);
-        pam_ub = db_pam_create(pcm_pam_ub, entries, key_size, data_size, buffer_size, node_size, BTREE_UNSORTED_LEAVES_INNERS_RAM);
-
-        db_pam_search(pam_ub, QUERY_RANDOM, 1);
-        db_pam_search(pam_sb, QUERY_RANDOM, 1);
-        db_pam_search(pam_bb, QUERY_RANDOM, 1);
-        db_am_search(eam, QUERY_RANDOM, 1);
-
-        /* Lets skip cost of init */
-        pcm_eam->wearout = 0;
-        pcm_pam_ub->wearout = 0;
-        pcm_pam_sb->wearout = 0;
-        pcm_pam_bb->wearout = 0;
-        db_stat_reset();
+        [EAM] = {.name = "eAM", .pam = false, .invalidation_type = INVALIDATION_BITMAP, .btree_type = BTREE_UNSORTED_LEAVES_INNERS_RAM},
+        [PAM_UB] = {.name = "PAM UB+tree", .pam = true, .btree_type = BTREE_UNSORTED_LEAVES_INNERS_RAM},
+        [PAM_SB] = {.name = "PAM SB+tree", .pam = true, .btree_type = BTREE_2SECTION_NODE_INNERS_RAM},
+        [PAM_BB] = {.name = "PAM BB+tree", .pam = true, .btree_type = BTREE_WITH_BUFFERED_TREE},
+    };
 
-        for (size_t i = 0; i < batches; ++i)
-        {
-            printf("%s: SEL: %.4lf/%.4lf: BATCH %zu/%zu\n", file, sel, batch->selectivity_max,  (i + 1), batches);
+    // const size_t buffer_size = (size_t)(0.01 * (double)entries * (double)data_size);
+    const size_t buffer_size = experiment_buffer_size(batch);
 
-            /* PAM BB BATCH */
-            db_stat_start_query();
-            for (size_t q = 0; q < batch->rsearches; ++q)
-                db_pam_search(pam_bb, QUERY_RANDOM, (size_t)((double)entries * sel));
+    int ret = 0;
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_pam_insert(pam_bb, 1);
+    TRACE();
 
-            for (size_t q = 0; q < batch->deletes; ++q)
-                db_pam_delete(pam_bb, 1);
+    cells = experiment_stress_run(file, key_size, data_size, entries, buffer_size, batch, batches, structures, STRUCTURES, &num_selectivities);
+    if (cells == NULL)
+        ERROR("experiment_stress_run error\n", 1);
 
-            db_stat_finish_query();
-            pam_bb_time = db_stat_get_current_time();
-            total_pam_bb_time += pam_bb_time;
+    snprintf(time_total_file_name, sizeof(time_total_file_name), "%s_time_total.txt", file);
+    time_fd_total = open(time_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (time_fd_total < 0)
+        ret = 1;
 
+    dprintf(time_fd_total, "Selectivity\teAM\tPAM UB+tree\tPAM SB+tree\tPAM BB+tree\n");
 
-            /* PAM SB BATCH */
-            db_stat_start_query();
-            for (size_t q = 0; q < batch->rsearches; ++q)
-                db_pam_search(pam_sb, QUERY_RANDOM, (size_t)((double)entries * sel));
+    for (size_t s = 0; s < num_selectivities; ++s)
+    {
+        const StressCell *row = &cells[s * STRUCTURES];
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_pam_insert(pam_sb, 1);
+        dprintf(time_fd_total, "%.4lf\t%lf\t%lf\t%lf\t%lf\n", row[EAM].selectivity, pcm_time_to_seconds(row[EAM].total_time), pcm_time_to_seconds(row[PAM_SB].total_time), pcm_time_to_seconds(row[PAM_UB].total_time), pcm_time_to_seconds(row[PAM_BB].total_time));
+    }
 
-            for (size_t q = 0; q < batch->deletes; ++q)
-                db_pam_delete(pam_sb, 1);
+    close(time_fd_total);
 
-            db_stat_finish_query();
-            pam_sb_time = db_stat_get_current_time();
-            total_pam_sb_time += pam_sb_time;
+    FREE(cells);
 
-            /* PAM UB BATCH */
-            db_stat_start_query();
-            for (size_t q = 0; q < batch->rsearches; ++q)
-                db_pam_search(pam_ub, QUERY_RANDOM, (size_t)((double)entries * sel));
+    return ret;
+}
+
+int experiment_stress_custom(const char *file, size_t key_size, size_t data_size, size_t entries, const StressBatch *batch, size_t batches, const StressStructure *structures, size_t num_structures)
+{
+    char time_total_file_name[FILE_MAX_LEN];
+    char mem_total_file_name[FILE_MAX_LEN];
+    int time_fd_total;
+    int mem_fd_total;
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_pam_insert(pam_ub, 1);
+    StressCell *cells;
+    size_t num_selectivities;
 
-            for (size_t q = 0; q < batch->deletes; ++q)
-                db_pam_delete(pam_ub, 1);
+    int ret = 0;
 
-            db_stat_finish_query();
-            pam_ub_time = db_stat_get_current_time();
-            total_pam_ub_time += pam_ub_time;
+    TRACE();
 
-            /* eAM BATCH */
-            db_stat_start_query();
-            for (size_t q = 0; q < batch->rsearches; ++q)
-                db_am_search(eam, QUERY_RANDOM, (size_t)((double)entries * sel));
+    /* each structure needs its own random stream in cell */
+    if (num_structures == 0 || num_structures > EXPERIMENT_MAX_STRUCTURES)
+        ERROR("num_structures out of range\n", 1);
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_am_insert(eam, 1);
+    cells = experiment_stress_run(file, key_size, data_size, entries, experiment_buffer_size(batch), batch, batches, structures, num_structures, &num_selectivities);
+    if (cells == NULL)
+        ERROR("experiment_stress_run error\n", 1);
 
-            for (size_t q = 0; q < batch->deletes; ++q)
-                db_am_delete(eam, 1);
+    snprintf(time_total_file_name, sizeof(time_total_file_name), "%s_time_total.txt", file);
+    time_fd_total = open(time_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (time_fd_total < 0)
+        ret = 1;
 
-            db_stat_finish_query();
-            eam_time = db_stat_get_current_time();
-            total_eam_time += eam_time;
-        }
+    dprintf(time_fd_total, "Selectivity");
 
-        // db_stat_summary_print();
+    snprintf(mem_total_file_name, sizeof(mem_total_file_name), "%s_wearout_total.txt", file);
+    mem_fd_total = open(mem_total_file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (mem_fd_total < 0)
+        ret = 1;
 
-        db_pam_destroy(pam_ub);
-        db_pam_destroy(pam_sb);
-        db_pam_destroy(pam_bb);
-        db_am_destroy(eam);
+    dprintf(mem_fd_total, "Wearout");
 
-        dprintf(time_fd_total, "%.4lf\t%lf\t%lf\t%lf\t%lf\n", sel, total_eam_time, total_pam_sb_time, total_pam_ub_time, total_pam_bb_time);
+    for (size_t i = 0; i < num_structures; ++i)
+    {
+        dprintf(time_fd_total, "\t%s", structures[i].name);
+        dprintf(mem_fd_total, "\t%s", structures[i].name);
+    }
+    dprintf(time_fd_total, "\n");
+    dprintf(mem_fd_total, "\n");
 
-        pcm_destroy(pcm_eam);
-        pcm_destroy(pcm_pam_ub);
-        pcm_destroy(pcm_pam_sb);
-        pcm_destroy(pcm_pam_bb);
+    for (size_t s = 0; s < num_selectivities; ++s)
+    {
+        const StressCell *row = &cells[s * num_structures];
+
+        dprintf(time_fd_total, "%.4lf", row[0].selectivity);
+        dprintf(mem_fd_total, "%.4lf", row[0].selectivity);
+        for (size_t i = 0; i < num_structures; ++i)
+        {
+            dprintf(time_fd_total, "\t%lf", pcm_time_to_seconds(row[i].total_time));
+            dprintf(mem_fd_total, "\t%zu", row[i].wearout);
+        }
+        dprintf(time_fd_total, "\n");
+        dprintf(mem_fd_total, "\n");
     }
 
     close(time_fd_total);
+    close(mem_fd_total);
+
+    FREE(cells);
+
+    return ret;
 }
 
-void experiment_index(const char * const file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
+int experiment_index(const char * const file, size_t key_size, size_t data_size, size_t entries, StressBatch* batch, size_t batches)
 {
     DB_index* index;
     PCM* pcm;
@@ -781,31 +1140,39 @@ void experiment_index(const char * const file, size_t key_size, size_t data_size
 
     TRACE();
 
-    sgenrand((unsigned long)time(NULL));
-
     snprintf(file_name, sizeof(file_name), "%s.txt", file);
     fd = open(file_name, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0644);
+    if (fd < 0)
+        ERROR("open error\n", 1);
+
     dprintf(fd, "TYPE\tTime\n");
 
     for (i = 0; i < ARRAY_SIZE(btree_type); ++i)
     {
-        pcm = pcm_create_default_model();
+        pcm = experiments_create_pcm();
         index = db_index_create(pcm, key_size, data_size, node_size, 0.8, btree_type[i]);
+        if (index == NULL)
+        {
+            pcm_destroy(pcm);
+            close(fd);
+            ERROR("db_index_create error\n", 1);
+        }
 
         /* lets skip cost of init */
         db_index_bulkload(index, entries);
-        pcm->wearout = 0;
+        pcm_reset_counters(pcm);
 
         db_stat_reset();
-        printf("%s\n", btree_names[i]);
+        if (!experiments_quiet)
+            printf("%s\n", btree_names[i]);
 
         db_stat_start_query();
         for (size_t b = 0; b < batches; ++b)
         {
-            printf("%s: BATCH %zu/%zu\n", file, (b + 1), batches);
+            if (!experiments_quiet)
+                printf("%s: BATCH %zu/%zu\n", file, (b + 1), batches);
 
-            for (size_t q = 0; q < batch->inserts; ++q)
-                db_index_insert(index, 1);
+            db_index_insert_batch(index, batch->inserts);
 
             for (size_t q = 0; q < batch->psearches; ++q)
                 db_index_point_search(index, 1);
@@ -815,12 +1182,15 @@ void experiment_index(const char * const file, size_t key_size, size_t data_size
         }
         db_stat_finish_query();
 
-        db_stat_summary_print();
-        dprintf(fd, "%s\t%lf\n", btree_names[i], db_stat_get_total_time());
+        if (!experiments_quiet)
+            db_stat_summary_print();
+        dprintf(fd, "%s\t%lf\n", btree_names[i], pcm_time_to_seconds(db_stat_get_total_time()));
 
         db_index_destroy(index);
         pcm_destroy(pcm);
     }
 
     close(fd);
+
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,794 @@
+#include <partitions.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define PARTITIONS_INIT_PARTS 16
+#define PARTITIONS_NO_LINE    SIZE_MAX
+
+/* reads of query, lines are only counted without region, otherwise run of consecutive lines is read at once */
+typedef struct Partitions_reader
+{
+    size_t first; /* the first line of pending run (line of region) */
+    size_t lines; /* lines of pending run, all read lines iff PCM has no region */
+    pcm_time_t time; /* time of runs read so far */
+} Partitions_reader;
+
+/*
+    Get memory line of entry in region
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN pos - position of entry in region
+
+    RETURN
+    Memory line with the first byte of entry
+*/
+static ___inline___ size_t partitions_line(const Partitions *parts, size_t pos);
+
+/*
+    Get number of memory lines touched by entries [first, last] of region
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN first - position of the first entry
+    @IN last - position of the last entry
+
+    RETURN
+    Number of memory lines
+*/
+static ___inline___ size_t partitions_span_lines(const Partitions *parts, size_t first, size_t last);
+
+/*
+    Read lines [line, line + lines) of area, consecutive reads are joined into one run
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN reader - pointer to reader of query
+    @IN base - address of area (entries, bitmaps or journal), PCM_NO_ADDR iff area has no place in region
+    @IN line - the first memory line in area
+    @IN lines - number of memory lines
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void partitions_read(const Partitions *parts, Partitions_reader *reader, size_t base, size_t line, size_t lines);
+
+/*
+    Charge pending run of reader (before write, so lines are read before they are written)
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN reader - pointer to reader of query
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void partitions_read_flush(const Partitions *parts, Partitions_reader *reader);
+
+/*
+    Charge all reads of query
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN reader - pointer to reader of query
+
+    RETURN
+    Read time
+*/
+static ___inline___ pcm_time_t partitions_read_end(const Partitions *parts, Partitions_reader *reader);
+
+/*
+    Find the first entry of partition with key >= key by binary search
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN part - pointer to Partition
+    @IN key - key to find
+    @IN reader - reader of probed lines, NULL iff search is done in RAM (fences)
+    @OUT last_line - line of the last probe (PARTITIONS_NO_LINE iff nothing was probed)
+
+    RETURN
+    Position of the first entry with key >= key (end of partition iff there is no such entry)
+*/
+static ___inline___ size_t partitions_lower_bound(const Partitions *parts, const Partition *part, btree_key_t key, Partitions_reader *reader, size_t *last_line);
+
+/*
+    Invalidate entry in RAM mirror of region
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN part - pointer to Partition with entry
+    @IN pos - position of entry in region
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void partitions_invalidate_entry(Partitions *parts, Partition *part, size_t pos);
+
+/*
+    Get number of not yet read memory lines of entry (scan goes forward, so lines <= last_line are read)
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN pos - position of entry in region
+    @IN/OUT last_line - the last read line (PARTITIONS_NO_LINE iff nothing was read)
+
+    RETURN
+    Number of new memory lines
+*/
+static ___inline___ size_t partitions_touch(const Partitions *parts, size_t pos, size_t *last_line);
+
+/*
+    Read not yet read memory lines of entry
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN reader - pointer to reader of query
+    @IN pos - position of entry in region
+    @IN/OUT last_line - the last read line (PARTITIONS_NO_LINE iff nothing was read)
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void partitions_read_entry(const Partitions *parts, Partitions_reader *reader, size_t pos, size_t *last_line);
+
+/*
+    Read memory line of bitmap with bit of entry iff it is not read yet (scan goes forward)
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN reader - pointer to reader of query
+    @IN pos - position of entry in region
+    @IN/OUT last_line - the last read line of bitmap (PARTITIONS_NO_LINE iff nothing was read)
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void partitions_read_bitmap(const Partitions *parts, Partitions_reader *reader, size_t pos, size_t *last_line);
+
+/*
+    Get number of memory lines of bitmap bits [first, last]
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN first - position of the first entry
+    @IN last - position of the last entry
+
+    RETURN
+    Number of memory lines
+*/
+static ___inline___ size_t partitions_bitmap_lines(const Partitions *parts, size_t first, size_t last);
+
+/*
+    Charge write of bytes spread over [offset, offset + len) of area (by address iff area is in region of PCM)
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN base - address of area (entries, bitmaps or journal), PCM_NO_ADDR iff area has no place in region
+    @IN offset - offset in area
+    @IN len - number of bytes covering all written bytes
+    @IN bytes - number of written bytes
+
+    RETURN
+    Write time
+*/
+static ___inline___ pcm_time_t partitions_write(Partitions *parts, size_t base, size_t offset, size_t len, size_t bytes);
+
+/*
+    Write marks (flags or bitmap bytes) placed on the same memory line
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN base - address of area with marks
+    @IN line - memory line in area
+    @IN bytes - number of written bytes on line
+
+    RETURN
+    Write time
+*/
+static ___inline___ pcm_time_t partitions_write_marks(Partitions *parts, size_t base, size_t line, size_t bytes);
+
+/*
+    Scan partition from lb while key <= hi, extract and invalidate valid entries
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN part - pointer to Partition
+    @IN lb - position of the first entry with key >= lo
+    @IN hi - the last key of range
+    @IN last_line - line of the last probe of seek
+    @IN reader - pointer to reader of query
+    @OUT entries - number of extracted keys is added here
+
+    RETURN
+    Invalidation time
+*/
+static pcm_time_t partitions_scan(Partitions *parts, Partition *part, size_t lb, btree_key_t hi, size_t last_line, Partitions_reader *reader, size_t *entries);
+
+/*
+    Close the gap [from, to) in partition by moving tail of partition (INVALIDATION_OVERWRITE)
+
+    PARAMS
+    @IN parts - pointer to Partitions
+    @IN part - pointer to Partition
+    @IN from - the first position of gap
+    @IN to - the first position after gap
+
+    RETURN
+    Time of moving tail
+*/
+static pcm_time_t partitions_compact(Partitions *parts, Partition *part, size_t from, size_t to);
+
+/*
+    Get number of memory lines of journal
+
+    PARAMS
+    @IN parts - pointer to Partitions
+
+    RETURN
+    Number of memory lines
+*/
+static ___inline___ size_t partitions_journal_lines(const Partitions *parts);
+
+/*
+    Drop partitions without valid entries
+
+    PARAMS
+    @IN parts - pointer to Partitions
+
+    RETURN
+    This is a void function
+*/
+static void partitions_drop_empty(Partitions *parts);
+
+
+static ___inline___ size_t partitions_line(const Partitions *parts, size_t pos)
+{
+    return (pos * parts->entry_size) / parts->pcm->mem_line;
+}
+
+static ___inline___ size_t partitions_span_lines(const Partitions *parts, size_t first, size_t last)
+{
+    const size_t first_line = partitions_line(parts, first);
+    const size_t last_line = ((last + 1) * parts->entry_size - 1) / parts->pcm->mem_line;
+
+    return last_line - first_line + 1;
+}
+
+static ___inline___ void partitions_read(const Partitions *parts, Partitions_reader *reader, size_t base, size_t line, size_t lines)
+{
+    if (lines == 0)
+        return;
+
+    if (base == PCM_NO_ADDR)
+    {
+        reader->lines += lines;
+        return;
+    }
+
+    /* areas are aligned to memory line */
+    line += base / parts->pcm->mem_line;
+    if (reader->lines > 0 && reader->first + reader->lines == line)
+    {
+        reader->lines += lines;
+        return;
+    }
+
+    partitions_read_flush(parts, reader);
+    reader->first = line;
+    reader->lines = lines;
+}
+
+static ___inline___ void partitions_read_flush(const Partitions *parts, Partitions_reader *reader)
+{
+    if (parts->addr == PCM_NO_ADDR || reader->lines == 0)
+        return;
+
+    reader->time += pcm_read_at(parts->pcm, reader->first * parts->pcm->mem_line, reader->lines * parts->pcm->mem_line);
+    reader->lines = 0;
+}
+
+static ___inline___ pcm_time_t partitions_read_end(const Partitions *parts, Partitions_reader *reader)
+{
+    if (parts->addr == PCM_NO_ADDR)
+        return pcm_read_lines(parts->pcm, reader->lines);
+
+    partitions_read_flush(parts, reader);
+
+    return reader->time;
+}
+
+static ___inline___ size_t partitions_lower_bound(const Partitions *parts, const Partition *part, btree_key_t key, Partitions_reader *reader, size_t *last_line)
+{
+    size_t l = part->first;
+    size_t r = part->first + part->entries;
+    size_t mid;
+    size_t line;
+
+    *last_line = PARTITIONS_NO_LINE;
+    while (l < r)
+    {
+        mid = l + (r - l) / 2;
+        if (reader != NULL)
+        {
+            line = partitions_line(parts, mid);
+            if (line != *last_line)
+            {
+                partitions_read(parts, reader, parts->addr, line, 1);
+                *last_line = line;
+            }
+        }
+
+        if (parts->keys[mid] < key)
+            l = mid + 1;
+        else
+            r = mid;
+    }
+
+    return l;
+}
+
+static ___inline___ void partitions_invalidate_entry(Partitions *parts, Partition *part, size_t pos)
+{
+    const size_t i = parts->live_pos[pos];
+    const size_t last = parts->live[parts->num_entries - 1];
+
+    parts->valid[pos] = false;
+    --part->valid;
+
+    /* swap with the last valid entry */
+    parts->live[i] = last;
+    parts->live_pos[last] = i;
+    --parts->num_entries;
+}
+
+static ___inline___ size_t partitions_touch(const Partitions *parts, size_t pos, size_t *last_line)
+{
+    size_t first = partitions_line(parts, pos);
+    const size_t last = ((pos + 1) * parts->entry_size - 1) / parts->pcm->mem_line;
+
+    if (*last_line != PARTITIONS_NO_LINE && first <= *last_line)
+        first = *last_line + 1;
+
+    if (first > last)
+        return 0;
+
+    *last_line = last;
+    return last - first + 1;
+}
+
+static ___inline___ void partitions_read_entry(const Partitions *parts, Partitions_reader *reader, size_t pos, size_t *last_line)
+{
+    const size_t lines = partitions_touch(parts, pos, last_line);
+
+    partitions_read(parts, reader, parts->addr, *last_line + 1 - lines, lines);
+}
+
+static ___inline___ void partitions_read_bitmap(const Partitions *parts, Partitions_reader *reader, size_t pos, size_t *last_line)
+{
+    const size_t line = (pos / 8) / parts->pcm->mem_line;
+
+    if (line == *last_line)
+        return;
+
+    *last_line = line;
+    partitions_read(parts, reader, parts->bitmap_addr, line, 1);
+}
+
+static ___inline___ size_t partitions_bitmap_lines(const Partitions *parts, size_t first, size_t last)
+{
+    return (last / 8) / parts->pcm->mem_line - (first / 8) / parts->pcm->mem_line + 1;
+}
+
+static ___inline___ pcm_time_t partitions_write(Partitions *parts, size_t base, size_t offset, size_t len, size_t bytes)
+{
+    if (base != PCM_NO_ADDR)
+        return pcm_write_bytes_at(parts->pcm, base + offset, len, bytes);
+
+    return pcm_write_lines(parts->pcm, (offset + len - 1) / parts->pcm->mem_line - offset / parts->pcm->mem_line + 1, bytes);
+}
+
+static ___inline___ pcm_time_t partitions_write_marks(Partitions *parts, size_t base, size_t line, size_t bytes)
+{
+    if (bytes == 0)
+        return 0;
+
+    return partitions_write(parts, base, line * parts->pcm->mem_line, 1, bytes);
+}
+
+static pcm_time_t partitions_scan(Partitions *parts, Partition *part, size_t lb, btree_key_t hi, size_t last_line, Partitions_reader *reader, size_t *entries)
+{
+    pcm_time_t time = 0;
+    const size_t end = part->first + part->entries;
+    const invalidation_type_t type = parts->invalidation_type;
+
+    /* bitmap and journal say which entries are invalid, so those are not read */
+    const bool skip_invalid = type == INVALIDATION_BITMAP || type == INVALIDATION_JOURNAL;
+
+    const size_t mark_base = type == INVALIDATION_BITMAP ? parts->bitmap_addr : parts->addr;
+    size_t mark_line = PARTITIONS_NO_LINE;
+    size_t mark_byte = PARTITIONS_NO_LINE;
+    size_t bitmap_line = PARTITIONS_NO_LINE;
+    size_t marks = 0;
+    size_t line;
+    size_t j;
+
+    for (j = lb; j < end && parts->keys[j] <= hi; ++j)
+    {
+        /* bit of entry says if it is valid */
+        if (type == INVALIDATION_BITMAP)
+            partitions_read_bitmap(parts, reader, j, &bitmap_line);
+
+        if (!parts->valid[j])
+        {
+            if (!skip_invalid)
+                partitions_read_entry(parts, reader, j, &last_line);
+
+            continue;
+        }
+
+        partitions_read_entry(parts, reader, j, &last_line);
+        parts->extracted[(*entries)++] = parts->keys[j];
+        partitions_invalidate_entry(parts, part, j);
+
+        if (type == INVALIDATION_FLAG)
+        {
+            /* flag is a byte of entry, flags on the same line are written at once */
+            line = partitions_line(parts, j);
+        }
+        else if (type == INVALIDATION_BITMAP)
+        {
+            /* bit of entry, bytes of bitmap on the same line are written at once */
+            if (j / 8 == mark_byte)
+                continue;
+
+            mark_byte = j / 8;
+            line = mark_byte / parts->pcm->mem_line;
+        }
+        else
+            continue;
+
+        if (line != mark_line)
+        {
+            partitions_read_flush(parts, reader);
+            time += partitions_write_marks(parts, mark_base, mark_line, marks);
+            mark_line = line;
+            marks = 0;
+        }
+        ++marks;
+    }
+
+    /* the first key out of range ends the scan */
+    if (j < end)
+        partitions_read_entry(parts, reader, j, &last_line);
+
+    if (type == INVALIDATION_BITMAP)
+        partitions_read_bitmap(parts, reader, MIN(j, end - 1), &bitmap_line);
+
+    partitions_read_flush(parts, reader);
+    time += partitions_write_marks(parts, mark_base, mark_line, marks);
+
+    if (type == INVALIDATION_OVERWRITE)
+        time += partitions_compact(parts, part, lb, j);
+
+    return time;
+}
+
+static pcm_time_t partitions_compact(Partitions *parts, Partition *part, size_t from, size_t to)
+{
+    pcm_time_t time = 0;
+    const size_t end = part->first + part->entries;
+    const size_t gap = to - from;
+    const size_t tail = end - to;
+    size_t src;
+    size_t dst;
+
+    if (gap == 0)
+        return 0;
+
+    for (src = to; src < end; ++src)
+    {
+        dst = src - gap;
+        parts->keys[dst] = parts->keys[src];
+        parts->valid[dst] = parts->valid[src];
+
+        if (parts->valid[src])
+        {
+            parts->live_pos[dst] = parts->live_pos[src];
+            parts->live[parts->live_pos[dst]] = dst;
+        }
+    }
+
+    for (dst = end - gap; dst < end; ++dst)
+        parts->valid[dst] = false;
+
+    part->entries -= gap;
+
+    if (tail > 0)
+    {
+        if (parts->addr != PCM_NO_ADDR)
+            time += pcm_read_at(parts->pcm, parts->addr + to * parts->entry_size, (end - to) * parts->entry_size);
+        else
+            time += pcm_read_lines(parts->pcm, partitions_span_lines(parts, to, end - 1));
+        time += partitions_write(parts, parts->addr, from * parts->entry_size, tail * parts->entry_size, tail * parts->entry_size);
+    }
+
+    return time;
+}
+
+static ___inline___ size_t partitions_journal_lines(const Partitions *parts)
+{
+    return INT_CEIL_DIV(parts->journal_entries * 2 * parts->key_size, parts->pcm->mem_line);
+}
+
+static void partitions_drop_empty(Partitions *parts)
+{
+    size_t i;
+    size_t j = 0;
+
+    for (i = 0; i < parts->num_parts; ++i)
+        if (parts->parts[i].valid > 0)
+            parts->parts[j++] = parts->parts[i];
+
+    parts->num_parts = j;
+
+    /* journal refers only to existing partitions */
+    if (parts->num_parts == 0)
+        parts->journal_entries = 0;
+}
+
+Partitions *partitions_create(PCM *pcm, size_t capacity, size_t key_size, size_t entry_size, invalidation_type_t invalidation_type)
+{
+    Partitions *parts;
+    const size_t n = MAX(capacity, (size_t)1);
+
+    TRACE();
+
+    parts = calloc(1, sizeof(Partitions));
+    if (parts == NULL)
+        ERROR("calloc error\n", NULL);
+
+    parts->keys = malloc(n * sizeof(*parts->keys));
+    parts->valid = malloc(n * sizeof(*parts->valid));
+    parts->live = malloc(n * sizeof(*parts->live));
+    parts->live_pos = malloc(n * sizeof(*parts->live_pos));
+    parts->extracted = malloc(n * sizeof(*parts->extracted));
+    parts->parts = malloc(PARTITIONS_INIT_PARTS * sizeof(*parts->parts));
+    if (parts->keys == NULL || parts->valid == NULL || parts->live == NULL ||
+        parts->live_pos == NULL || parts->extracted == NULL || parts->parts == NULL)
+    {
+        partitions_destroy(parts);
+        ERROR("malloc error\n", NULL);
+    }
+
+    parts->region_capacity = capacity;
+    parts->parts_capacity = PARTITIONS_INIT_PARTS;
+    parts->key_size = key_size;
+    parts->entry_size = entry_size;
+    parts->invalidation_type = invalidation_type;
+    parts->pcm = pcm;
+    parts->stat = db_stat_get_default();
+
+    /* areas of entries, bitmaps and journal (at most 1 range per extracted entry) get places in region */
+    parts->addr = PCM_NO_ADDR;
+    parts->bitmap_addr = PCM_NO_ADDR;
+    parts->journal_addr = PCM_NO_ADDR;
+    if (pcm->region != NULL)
+    {
+        if (pcm_alloc(pcm, n * entry_size, &parts->addr) ||
+            pcm_alloc(pcm, INT_CEIL_DIV(n, 8), &parts->bitmap_addr) ||
+            pcm_alloc(pcm, n * 2 * key_size, &parts->journal_addr))
+        {
+            partitions_destroy(parts);
+            ERROR("pcm_alloc error\n", NULL);
+        }
+    }
+
+    return parts;
+}
+
+void partitions_destroy(Partitions *parts)
+{
+    TRACE();
+
+    if (parts == NULL)
+        return;
+
+    FREE(parts->keys);
+    FREE(parts->valid);
+    FREE(parts->live);
+    FREE(parts->live_pos);
+    FREE(parts->extracted);
+    FREE(parts->parts);
+    FREE(parts);
+}
+
+void partitions_set_stat(Partitions *parts, DB_stat *stat)
+{
+    TRACE();
+
+    parts->stat = stat;
+}
+
+pcm_time_t partitions_add_run(Partitions *parts, const btree_key_t *keys, size_t entries)
+{
+    pcm_time_t time;
+    Partition *part;
+    Partition *new_parts;
+    size_t capacity;
+    size_t pos;
+    size_t i;
+
+    TRACE();
+
+    pcm_trace_set_tag(parts->pcm, PCM_TRACE_TAG_PARTITIONS);
+
+    if (entries == 0)
+        return 0;
+
+    if (parts->region_entries + entries > parts->region_capacity)
+        ERROR("Region of partitions is full\n", 0);
+
+    if (parts->num_parts == parts->parts_capacity)
+    {
+        capacity = parts->parts_capacity * 2;
+        new_parts = realloc(parts->parts, capacity * sizeof(*new_parts));
+        if (new_parts == NULL)
+            ERROR("realloc error\n", 0);
+
+        parts->parts = new_parts;
+        parts->parts_capacity = capacity;
+    }
+
+    part = &parts->parts[parts->num_parts++];
+    part->first = parts->region_entries;
+    part->entries = entries;
+    part->valid = entries;
+    part->seeks = 0;
+
+    (void)memcpy(&parts->keys[part->first], keys, entries * sizeof(*keys));
+    for (i = 0; i < entries; ++i)
+    {
+        pos = part->first + i;
+        parts->valid[pos] = true;
+        parts->live_pos[pos] = parts->num_entries;
+        parts->live[parts->num_entries++] = pos;
+    }
+
+    parts->region_entries += entries;
+
+    time = partitions_write(parts, parts->addr, part->first * parts->entry_size, entries * parts->entry_size, entries * parts->entry_size);
+    db_stat_update_misc_time_r(parts->stat, time);
+
+    return time;
+}
+
+pcm_time_t partitions_extract(Partitions *parts, btree_key_t lo, btree_key_t hi, btree_key_t **keys, size_t *entries)
+{
+    pcm_time_t read_time;
+    pcm_time_t invalidation_time = 0;
+    Partitions_reader reader = {.first = 0, .lines = 0, .time = 0};
+    Partition *part;
+    size_t journal_bytes;
+    size_t last_line;
+    size_t lb;
+    size_t end;
+    size_t i;
+    size_t n = 0;
+
+    TRACE();
+
+    pcm_trace_set_tag(parts->pcm, PCM_TRACE_TAG_PARTITIONS);
+
+    /* journal is read before partitions to know which ranges are already extracted */
+    if (parts->invalidation_type == INVALIDATION_JOURNAL)
+        partitions_read(parts, &reader, parts->journal_addr, 0, partitions_journal_lines(parts));
+
+    for (i = 0; i < parts->num_parts; ++i)
+    {
+        part = &parts->parts[i];
+        end = part->first + part->entries;
+
+        lb = partitions_lower_bound(parts, part, lo, parts->fence_pointers ? NULL : &reader, &last_line);
+
+        /* fences in RAM say if partition has entries from the query */
+        if (parts->fence_pointers && (lb == end || parts->keys[lb] > hi))
+            continue;
+
+        ++part->seeks;
+        ++parts->seeked_partitions;
+        if (lb == end)
+            continue;
+
+        invalidation_time += partitions_scan(parts, part, lb, hi, last_line, &reader, &n);
+    }
+
+    /* append extracted range to journal, it starts at the end of journal */
+    if (parts->invalidation_type == INVALIDATION_JOURNAL && n > 0)
+    {
+        partitions_read_flush(parts, &reader);
+        journal_bytes = parts->journal_entries * 2 * parts->key_size;
+        invalidation_time += partitions_write(parts, parts->journal_addr, journal_bytes, 2 * parts->key_size, 2 * parts->key_size);
+        ++parts->journal_entries;
+    }
+
+    partitions_drop_empty(parts);
+
+    read_time = partitions_read_end(parts, &reader);
+    db_stat_update_misc_time_r(parts->stat, read_time);
+    db_stat_update_invalidation_time_r(parts->stat, invalidation_time);
+
+    *keys = parts->extracted;
+    *entries = n;
+
+    return read_time + invalidation_time;
+}
+
+pcm_time_t partitions_extract_all(Partitions *parts, btree_key_t **keys, size_t *entries)
+{
+    pcm_time_t time;
+    Partition *part;
+    const bool skip_invalid = parts->invalidation_type == INVALIDATION_BITMAP || parts->invalidation_type == INVALIDATION_JOURNAL;
+    Partitions_reader reader = {.first = 0, .lines = 0, .time = 0};
+    size_t last_line;
+    size_t i;
+    size_t j;
+    size_t n = 0;
+
+    TRACE();
+
+    pcm_trace_set_tag(parts->pcm, PCM_TRACE_TAG_PARTITIONS);
+
+    if (parts->invalidation_type == INVALIDATION_JOURNAL)
+        partitions_read(parts, &reader, parts->journal_addr, 0, partitions_journal_lines(parts));
+
+    for (i = 0; i < parts->num_parts; ++i)
+    {
+        part = &parts->parts[i];
+        last_line = PARTITIONS_NO_LINE;
+
+        if (parts->invalidation_type == INVALIDATION_BITMAP)
+            partitions_read(parts, &reader, parts->bitmap_addr, (part->first / 8) / parts->pcm->mem_line,
+                            partitions_bitmap_lines(parts, part->first, part->first + part->entries - 1));
+
+        for (j = part->first; j < part->first + part->entries; ++j)
+        {
+            if (parts->valid[j])
+            {
+                parts->extracted[n++] = parts->keys[j];
+                parts->valid[j] = false;
+            }
+            else if (skip_invalid)
+                continue;
+
+            partitions_read_entry(parts, &reader, j, &last_line);
+        }
+    }
+
+    /* partitions are dropped, so entries need no invalidation */
+    parts->num_parts = 0;
+    parts->num_entries = 0;
+    parts->journal_entries = 0;
+
+    time = partitions_read_end(parts, &reader);
+    db_stat_update_misc_time_r(parts->stat, time);
+
+    *keys = parts->extracted;
+    *entries = n;
+
+    return time;
+}
+
+btree_key_t partitions_random_key(const Partitions *parts, Genrand *rng)
+{
+    size_t r = (size_t)genrand_r(rng);
+
+    /* genrand gives 32 bits */
+    if (parts->num_entries > 0xffffffffUL)
+        r = (r << 32) | (size_t)genrand_r(rng);
+
+    return parts->keys[parts->live[r % parts->num_entries]];
+}
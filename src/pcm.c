@@ -2,8 +2,802 @@
 #include <log.h>
 #include <common.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <math.h>
 
-PCM *pcm_create(size_t mem_line, double rtime, double wtime)
+/* values < PCM_WEAR_SUB_BUCKETS have own buckets, then each power of 2 has PCM_WEAR_SUB_BUCKETS buckets */
+#define PCM_WEAR_SUB_BUCKETS      8
+#define PCM_WEAR_SUB_BUCKETS_BITS 3
+#define PCM_WEAR_BUCKETS          (PCM_WEAR_SUB_BUCKETS * (sizeof(size_t) * 8 - PCM_WEAR_SUB_BUCKETS_BITS + 1))
+
+/* odd multipliers of sketch hashes, one per row */
+static const unsigned long long pcm_sketch_seeds[PCM_WEAR_SKETCH_DEPTH] =
+{
+    0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL, 0x94d049bb133111ebULL, 0xd6e8feb86659fd93ULL
+};
+
+struct PCM_leveling
+{
+    pcm_leveling_t type;
+    size_t lines; /* lines in domain or segment */
+    size_t interval;
+    size_t domains; /* domains or segments */
+
+    size_t *writes; /* writes to domain since last step (Start-Gap, Security Refresh) */
+
+    /* Start-Gap: physical line of domain is (line + start) % lines, lines from gap are shifted by spare line */
+    size_t *start;
+    size_t *gap;
+
+    /* Security Refresh: line is remapped by key iff it is refreshed, by prev_key otherwise */
+    size_t *key;
+    size_t *prev_key;
+    size_t *refresh; /* lines [0, refresh) are refreshed in this round */
+    unsigned long long seed; /* generator of keys */
+
+    /* table: segment is placed in physical segment map[segment] */
+    size_t *map;
+    size_t *inverse;
+    size_t *segment_writes; /* writes of physical segment */
+    size_t *interval_writes; /* writes of segment in this interval */
+    size_t table_writes; /* writes in this interval */
+};
+
+struct PCM_cache
+{
+    pcm_cache_policy_t policy;
+    size_t sets;
+    size_t ways;
+    pcm_time_t time; /* DRAM access time per line */
+
+    /* slot = set * ways + way */
+    size_t *tags; /* line in slot, PCM_NO_ADDR iff slot is empty */
+    size_t *dirty_bytes; /* bytes written to line since it came to cache, line is dirty iff > 0 */
+    bool *stored; /* dirty line is written only by pcm_store_at, so write back compares content */
+    unsigned char *old_data; /* content of PCM cells of dirty line (region holds new content), NULL iff PCM has no region */
+    unsigned char *scratch; /* new content of line during write back */
+    unsigned long long *used; /* LRU: tick of the last use, CLOCK: reference bit */
+    size_t *hands; /* CLOCK: hand of each set */
+    unsigned long long tick;
+};
+
+struct PCM_trace
+{
+    FILE *file;
+    unsigned char *buffer; /* PCM_TRACE_BUFFER bytes */
+    size_t used; /* bytes in buffer */
+    size_t next_addr; /* end of previous access by address, address of record is delta from it */
+    unsigned int tag; /* tag of previous record */
+    bool failed; /* write to file has failed */
+};
+
+/* record is op byte and at most 5 varints */
+#define PCM_TRACE_RECORD_MAX (1 + 5 * 10)
+
+/*
+    Append unsigned varint (7 bits per byte, the lowest first) to buffer of trace
+
+    PARAMS
+    @IN trace - pointer to trace
+    @IN value - value
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void pcm_trace_varint(struct PCM_trace *trace, unsigned long long value);
+
+/*
+    Write buffer of trace to file
+
+    PARAMS
+    @IN trace - pointer to trace
+
+    RETURN
+    This is a void function
+*/
+static void pcm_trace_flush(struct PCM_trace *trace);
+
+/*
+    Charge lines without record in trace (accesses of region are recorded by their public functions)
+
+    PARAMS
+    @IN pcm - pointer to PCM
+    @IN lines - number of touched memory lines
+    @IN bytes - number of written bytes
+
+    RETURN
+    time consumed by read / write
+*/
+static ___inline___ pcm_time_t pcm_charge_read(PCM *pcm, size_t lines);
+static ___inline___ pcm_time_t pcm_charge_write(PCM *pcm, size_t lines, size_t bytes);
+
+/*
+    Write bytes [addr, addr + len) of region via cache (iff enabled), without record in trace
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN len - number of bytes
+    @IN bytes - number of written bytes
+
+    RETURN
+    time consumed by write
+*/
+static pcm_time_t pcm_write_access(PCM *pcm, size_t addr, size_t len, size_t bytes);
+
+/*
+    Charge access to lines of region [addr, addr + len)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN len - number of bytes
+    @IN write - true iff access is write (lines are counted in line_writes)
+    @OUT migration - time of migrations of wear leveling (only for write)
+
+    RETURN
+    Number of touched lines
+*/
+static ___inline___ size_t pcm_touch_lines(PCM *pcm, size_t addr, size_t len, bool write, pcm_time_t *migration);
+
+/*
+    Map line of region to physical line (by wear leveling iff enabled)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN line - line of region
+
+    RETURN
+    Physical line
+*/
+static ___inline___ size_t pcm_physical_line(const PCM *pcm, size_t line);
+
+/*
+    Get bank of physical line
+
+    PARAMS
+    @IN pcm - pointer to PCM with banks
+    @IN line - physical line (see pcm_physical_line)
+
+    RETURN
+    Bank
+*/
+static ___inline___ size_t pcm_bank(const PCM *pcm, size_t line);
+
+/*
+    Read line from bank, read is served before queued writes of bank
+
+    PARAMS
+    @IN pcm - pointer to PCM with banks
+    @IN bank - bank
+    @IN now - time of issue
+
+    RETURN
+    Time when read ends
+*/
+static ___inline___ pcm_time_t pcm_bank_read(PCM *pcm, size_t bank, pcm_time_t now);
+
+/*
+    Queue write of line in bank, issuer stalls iff queue of bank is full
+
+    PARAMS
+    @IN pcm - pointer to PCM with banks
+    @IN bank - bank
+    @IN time - time of write in bank
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void pcm_bank_write(PCM *pcm, size_t bank, pcm_time_t time);
+
+/*
+    Read bytes [addr, addr + len) of region directly from PCM (without cache)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN len - number of bytes (> 0)
+
+    RETURN
+    time consumed by read
+*/
+static pcm_time_t pcm_read_region(PCM *pcm, size_t addr, size_t len);
+
+/*
+    Write bytes spread over [addr, addr + len) of region directly to PCM (without cache)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN len - number of bytes (> 0)
+    @IN bytes - number of written bytes
+
+    RETURN
+    time consumed by write
+*/
+static pcm_time_t pcm_write_region(PCM *pcm, size_t addr, size_t len, size_t bytes);
+
+/*
+    Program bytes [addr, addr + len) of one line with data by write mode (content of region is updated)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN data - new content
+    @IN len - number of bytes in line
+
+    RETURN
+    Number of programmed bits
+*/
+static size_t pcm_program_bits(PCM *pcm, size_t addr, const unsigned char *data, size_t len);
+
+/*
+    Store data to region directly (without cache) and charge lines by programmed bits
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN addr - address in region
+    @IN data - new content
+    @IN len - number of bytes (> 0)
+
+    RETURN
+    time consumed by write
+*/
+static pcm_time_t pcm_store_region(PCM *pcm, size_t addr, const unsigned char *data, size_t len);
+
+/*
+    Destroy cache
+
+    PARAMS
+    @IN cache - pointer to cache
+
+    RETURN
+    This is a void function
+*/
+static void pcm_cache_destroy(struct PCM_cache *cache);
+
+/*
+    Find slot of line in cache
+
+    PARAMS
+    @IN cache - pointer to cache
+    @IN line - line of region
+
+    RETURN
+    Slot iff line is in cache
+    PCM_NO_ADDR iff line is not in cache
+*/
+static size_t pcm_cache_lookup(const struct PCM_cache *cache, size_t line);
+
+/*
+    Choose slot for line in its set (empty slot or victim of replacement policy)
+
+    PARAMS
+    @IN cache - pointer to cache
+    @IN line - line of region
+
+    RETURN
+    Slot
+*/
+static size_t pcm_cache_victim(struct PCM_cache *cache, size_t line);
+
+/*
+    Write dirty line from slot back to PCM, line written only by stores is charged by write mode
+
+    PARAMS
+    @IN pcm - pointer to PCM with cache
+    @IN slot - slot of cache
+
+    RETURN
+    Time of write back (0 iff line is clean)
+*/
+static ___inline___ pcm_time_t pcm_cache_write_back(PCM *pcm, size_t slot);
+
+/*
+    Access bytes [addr, addr + len) of region through cache
+
+    PARAMS
+    @IN pcm - pointer to PCM with cache
+    @IN addr - address in region
+    @IN len - number of bytes (> 0)
+    @IN bytes - number of written bytes (only for write)
+    @IN write - true iff access is write
+    @IN store - true iff write stores data (content of region is changed after access)
+
+    RETURN
+    Time of access
+*/
+static pcm_time_t pcm_cache_access(PCM *pcm, size_t addr, size_t len, size_t bytes, bool write, bool store);
+
+/*
+    Destroy state of wear leveling
+
+    PARAMS
+    @IN leveling - pointer to state of wear leveling
+
+    RETURN
+    This is a void function
+*/
+static void pcm_leveling_destroy(struct PCM_leveling *leveling);
+
+/*
+    Get new key of Security Refresh (splitmix64)
+
+    PARAMS
+    @IN leveling - pointer to state of wear leveling
+
+    RETURN
+    Key in [0, lines)
+*/
+static ___inline___ size_t pcm_leveling_key(struct PCM_leveling *leveling);
+
+/*
+    Map line of region to physical line
+
+    PARAMS
+    @IN leveling - pointer to state of wear leveling
+    @IN line - line of region
+
+    RETURN
+    Physical line
+*/
+static ___inline___ size_t pcm_leveling_map(const struct PCM_leveling *leveling, size_t line);
+
+/*
+    Migrate physical line (read and write of line)
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN line - written physical line
+
+    RETURN
+    Time of migration
+*/
+static ___inline___ pcm_time_t pcm_leveling_migrate(PCM *pcm, size_t line);
+
+/*
+    Count write of line of region in wear leveling and migrate lines when interval passed
+
+    PARAMS
+    @IN pcm - pointer to PCM with region and wear leveling
+    @IN line - written line of region
+    @IN physical - physical line of written line
+
+    RETURN
+    Time of migrations
+*/
+static pcm_time_t pcm_leveling_step(PCM *pcm, size_t line, size_t physical);
+
+/*
+    Get number of lines of region in use
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+
+    RETURN
+    Number of lines
+*/
+static ___inline___ size_t pcm_used_lines(const PCM *pcm);
+
+/*
+    Get column of line in row of sketch
+
+    PARAMS
+    @IN line - memory line
+    @IN row - row of sketch
+
+    RETURN
+    Column of sketch
+*/
+static ___inline___ size_t pcm_sketch_col(size_t line, size_t row);
+
+/*
+    Count write of memory line (exact or in sketch) and update the hottest line
+
+    PARAMS
+    @IN pcm - pointer to PCM with region
+    @IN line - memory line
+
+    RETURN
+    This is a void function
+*/
+static ___inline___ void pcm_count_line_write(PCM *pcm, size_t line);
+
+/*
+    Get bucket of writes in wear histogram with precision 1/PCM_WEAR_SUB_BUCKETS
+
+    PARAMS
+    @IN writes - number of writes
+
+    RETURN
+    Bucket
+*/
+static ___inline___ size_t pcm_wear_bucket(size_t writes);
+
+/*
+    Get the lowest number of writes in bucket
+
+    PARAMS
+    @IN bucket - bucket
+
+    RETURN
+    Number of writes
+*/
+static ___inline___ size_t pcm_wear_bucket_low(size_t bucket);
+
+/*
+    Get percentile of writes from buckets
+
+    PARAMS
+    @IN buckets - lines in each bucket
+    @IN lines - number of all lines
+    @IN q - percentile in [0, 1]
+
+    RETURN
+    Number of writes
+*/
+static size_t pcm_wear_percentile(const size_t *buckets, size_t lines, double q);
+
+
+static ___inline___ size_t pcm_touch_lines(PCM *pcm, size_t addr, size_t len, bool write, pcm_time_t *migration)
+{
+    const size_t first = addr / pcm->mem_line;
+    const size_t last = (addr + len - 1) / pcm->mem_line;
+    size_t physical;
+    size_t line;
+
+    if (!write)
+        return last - first + 1;
+
+    *migration = 0;
+    for (line = first; line <= last; ++line)
+    {
+        if (pcm->leveling == NULL)
+        {
+            pcm_count_line_write(pcm, line);
+            continue;
+        }
+
+        physical = pcm_leveling_map(pcm->leveling, line);
+        pcm_count_line_write(pcm, physical);
+        *migration += pcm_leveling_step(pcm, line, physical);
+    }
+
+    return last - first + 1;
+}
+
+static ___inline___ size_t pcm_physical_line(const PCM *pcm, size_t line)
+{
+    return pcm->leveling == NULL ? line : pcm_leveling_map(pcm->leveling, line);
+}
+
+static ___inline___ size_t pcm_bank(const PCM *pcm, size_t line)
+{
+    return (line * pcm->mem_line / pcm->bank_interleave) % pcm->banks;
+}
+
+static ___inline___ pcm_time_t pcm_bank_read(PCM *pcm, size_t bank, pcm_time_t now)
+{
+    /* write is read-modify-write */
+    const pcm_time_t write_time = pcm->write_time + pcm->read_time;
+    pcm_time_t start = now;
+
+    if (pcm->bank_busy[bank] > now)
+    {
+        /* queued writes are served one by one from bank_writes, read waits only for the one in service */
+        if (now < pcm->bank_writes[bank])
+            start = pcm->bank_writes[bank];
+        else
+            start = MIN(pcm->bank_writes[bank] + INT_CEIL_DIV(now - pcm->bank_writes[bank], write_time) * write_time,
+                        pcm->bank_busy[bank]);
+
+        pcm->bank_busy[bank] += pcm->read_time;
+    }
+    else
+        pcm->bank_busy[bank] = now + pcm->read_time;
+
+    /* the rest of queued writes starts after read */
+    pcm->bank_writes[bank] = start + pcm->read_time;
+
+    return start + pcm->read_time;
+}
+
+static ___inline___ void pcm_bank_write(PCM *pcm, size_t bank, pcm_time_t time)
+{
+    /* queue is measured in whole writes */
+    const pcm_time_t queue_time = (pcm_time_t)pcm->bank_queue * (pcm->write_time + pcm->read_time);
+
+    if (pcm->bank_busy[bank] <= pcm->clock)
+    {
+        pcm->bank_busy[bank] = pcm->clock;
+        pcm->bank_writes[bank] = pcm->clock;
+    }
+
+    pcm->bank_busy[bank] += time;
+
+    if (pcm->bank_busy[bank] - pcm->clock > queue_time)
+        pcm->clock = pcm->bank_busy[bank] - queue_time;
+}
+
+static void pcm_cache_destroy(struct PCM_cache *cache)
+{
+    if (cache == NULL)
+        return;
+
+    FREE(cache->tags);
+    FREE(cache->dirty_bytes);
+    FREE(cache->stored);
+    FREE(cache->old_data);
+    FREE(cache->scratch);
+    FREE(cache->used);
+    FREE(cache->hands);
+    FREE(cache);
+}
+
+static void pcm_leveling_destroy(struct PCM_leveling *leveling)
+{
+    if (leveling == NULL)
+        return;
+
+    FREE(leveling->writes);
+    FREE(leveling->start);
+    FREE(leveling->gap);
+    FREE(leveling->key);
+    FREE(leveling->prev_key);
+    FREE(leveling->refresh);
+    FREE(leveling->map);
+    FREE(leveling->inverse);
+    FREE(leveling->segment_writes);
+    FREE(leveling->interval_writes);
+    FREE(leveling);
+}
+
+static ___inline___ size_t pcm_leveling_key(struct PCM_leveling *leveling)
+{
+    unsigned long long z = (leveling->seed += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+
+    return (size_t)z & (leveling->lines - 1);
+}
+
+static ___inline___ size_t pcm_leveling_map(const struct PCM_leveling *leveling, size_t line)
+{
+    const size_t domain = line / leveling->lines;
+    const size_t offset = line % leveling->lines;
+    size_t physical;
+
+    switch (leveling->type)
+    {
+        case PCM_LEVELING_START_GAP:
+        {
+            physical = (offset + leveling->start[domain]) % leveling->lines;
+            if (physical >= leveling->gap[domain])
+                ++physical;
+
+            return domain * (leveling->lines + 1) + physical;
+        }
+        case PCM_LEVELING_SECURITY_REFRESH:
+        {
+            /* line is refreshed iff it or its pair from swap has been passed by refresh pointer */
+            if (offset < leveling->refresh[domain] ||
+                (offset ^ leveling->prev_key[domain] ^ leveling->key[domain]) < leveling->refresh[domain])
+                return domain * leveling->lines + (offset ^ leveling->key[domain]);
+
+            return domain * leveling->lines + (offset ^ leveling->prev_key[domain]);
+        }
+        case PCM_LEVELING_TABLE:
+            return leveling->map[domain] * leveling->lines + offset;
+        case PCM_LEVELING_NONE:
+        default:
+            return line;
+    }
+}
+
+static ___inline___ pcm_time_t pcm_leveling_migrate(PCM *pcm, size_t line)
+{
+    ++pcm->migrated_lines;
+    pcm_count_line_write(pcm, line);
+
+    if (pcm->bank_busy != NULL)
+        pcm_bank_write(pcm, pcm_bank(pcm, line), pcm->write_time + pcm->read_time);
+
+    return pcm_charge_write(pcm, 1, pcm->mem_line);
+}
+
+static pcm_time_t pcm_leveling_step(PCM *pcm, size_t line, size_t physical)
+{
+    struct PCM_leveling *leveling = pcm->leveling;
+    const size_t domain = line / leveling->lines;
+    const size_t lines = leveling->lines;
+    pcm_time_t time = 0;
+    size_t segments;
+    size_t hot;
+    size_t cold;
+    size_t prev;
+    size_t other;
+    size_t pair;
+    size_t i;
+
+    switch (leveling->type)
+    {
+        case PCM_LEVELING_START_GAP:
+        {
+            if (++leveling->writes[domain] < leveling->interval)
+                return 0;
+
+            leveling->writes[domain] = 0;
+
+            /* gap moves by 1 line down, from the top after rotation of whole domain */
+            if (leveling->gap[domain] == 0)
+            {
+                leveling->gap[domain] = lines;
+                leveling->start[domain] = (leveling->start[domain] + 1) % lines;
+                return pcm_leveling_migrate(pcm, domain * (lines + 1));
+            }
+
+            return pcm_leveling_migrate(pcm, domain * (lines + 1) + leveling->gap[domain]--);
+        }
+        case PCM_LEVELING_SECURITY_REFRESH:
+        {
+            if (++leveling->writes[domain] < leveling->interval)
+                return 0;
+
+            leveling->writes[domain] = 0;
+
+            /* line and its pair swap places, swap is done by the lower one */
+            i = leveling->refresh[domain];
+            pair = i ^ leveling->prev_key[domain] ^ leveling->key[domain];
+            if (pair > i)
+            {
+                time += pcm_leveling_migrate(pcm, domain * lines + (i ^ leveling->key[domain]));
+                time += pcm_leveling_migrate(pcm, domain * lines + (i ^ leveling->prev_key[domain]));
+            }
+
+            if (++leveling->refresh[domain] == lines)
+            {
+                leveling->prev_key[domain] = leveling->key[domain];
+                leveling->key[domain] = pcm_leveling_key(leveling);
+                leveling->refresh[domain] = 0;
+            }
+
+            return time;
+        }
+        case PCM_LEVELING_TABLE:
+        {
+            ++leveling->segment_writes[physical / lines];
+            ++leveling->interval_writes[domain];
+
+            if (++leveling->table_writes < leveling->interval)
+                return 0;
+
+            leveling->table_writes = 0;
+
+            /* the hottest segment of interval goes to the least worn physical segment, unused segments are spares */
+            segments = MIN(INT_CEIL_DIV(pcm_used_lines(pcm), lines), leveling->domains);
+            hot = 0;
+            for (i = 1; i < segments; ++i)
+                if (leveling->interval_writes[i] > leveling->interval_writes[hot])
+                    hot = i;
+
+            cold = 0;
+            for (i = 1; i < leveling->domains; ++i)
+                if (leveling->segment_writes[i] < leveling->segment_writes[cold])
+                    cold = i;
+
+            (void)memset(leveling->interval_writes, 0, leveling->domains * sizeof(*leveling->interval_writes));
+
+            /* swap writes whole segments, so it pays off only for big difference of wear */
+            prev = leveling->map[hot];
+            if (prev == cold || leveling->segment_writes[prev] - leveling->segment_writes[cold] <= PCM_LEVELING_TABLE_GAP * lines)
+                return 0;
+
+            other = leveling->inverse[cold];
+            leveling->map[hot] = cold;
+            leveling->inverse[cold] = hot;
+            leveling->map[other] = prev;
+            leveling->inverse[prev] = other;
+
+            /* unused segment has no data to move */
+            for (i = 0; i < lines; ++i)
+            {
+                time += pcm_leveling_migrate(pcm, cold * lines + i);
+                if (other < segments)
+                    time += pcm_leveling_migrate(pcm, prev * lines + i);
+            }
+
+            leveling->segment_writes[cold] += lines;
+            if (other < segments)
+                leveling->segment_writes[prev] += lines;
+
+            return time;
+        }
+        case PCM_LEVELING_NONE:
+        default:
+            return 0;
+    }
+}
+
+static ___inline___ size_t pcm_used_lines(const PCM *pcm)
+{
+    /* region without allocations is used directly by addresses */
+    return INT_CEIL_DIV(pcm->region_used > 0 ? pcm->region_used : pcm->region_size, pcm->mem_line);
+}
+
+static ___inline___ size_t pcm_sketch_col(size_t line, size_t row)
+{
+    unsigned long long h = ((unsigned long long)line + 1) * pcm_sketch_seeds[row];
+
+    return (size_t)((h ^ (h >> 32)) & (PCM_WEAR_SKETCH_WIDTH - 1));
+}
+
+static ___inline___ void pcm_count_line_write(PCM *pcm, size_t line)
+{
+    size_t writes = SIZE_MAX;
+    size_t row;
+    size_t *counter;
+
+    if (pcm->line_writes != NULL)
+        writes = ++pcm->line_writes[line];
+    else
+        for (row = 0; row < PCM_WEAR_SKETCH_DEPTH; ++row)
+        {
+            counter = &pcm->wear_sketch[row * PCM_WEAR_SKETCH_WIDTH + pcm_sketch_col(line, row)];
+            ++(*counter);
+            writes = MIN(writes, *counter);
+        }
+
+    pcm->max_line_writes = MAX(pcm->max_line_writes, writes);
+}
+
+static ___inline___ size_t pcm_wear_bucket(size_t writes)
+{
+    size_t e;
+
+    if (writes < PCM_WEAR_SUB_BUCKETS)
+        return writes;
+
+    /* exponent and the next PCM_WEAR_SUB_BUCKETS_BITS bits of mantissa */
+    e = (size_t)LOG2(writes);
+    return PCM_WEAR_SUB_BUCKETS * (e - PCM_WEAR_SUB_BUCKETS_BITS + 1) + ((writes >> (e - PCM_WEAR_SUB_BUCKETS_BITS)) & (PCM_WEAR_SUB_BUCKETS - 1));
+}
+
+static ___inline___ size_t pcm_wear_bucket_low(size_t bucket)
+{
+    const size_t e = bucket / PCM_WEAR_SUB_BUCKETS + PCM_WEAR_SUB_BUCKETS_BITS - 1;
+
+    if (bucket < PCM_WEAR_SUB_BUCKETS)
+        return bucket;
+
+    return (PCM_WEAR_SUB_BUCKETS + bucket % PCM_WEAR_SUB_BUCKETS) << (e - PCM_WEAR_SUB_BUCKETS_BITS);
+}
+
+static size_t pcm_wear_percentile(const size_t *buckets, size_t lines, double q)
+{
+    const double r = ceil(q * (double)lines);
+    const size_t rank = MAX((size_t)r, (size_t)1);
+    size_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < PCM_WEAR_BUCKETS; ++i)
+    {
+        sum += buckets[i];
+        if (sum >= rank)
+            return pcm_wear_bucket_low(i);
+    }
+
+    return 0;
+}
+
+PCM *pcm_create(size_t mem_line, pcm_time_t rtime, pcm_time_t wtime)
 {
     PCM *pcm;
 
@@ -16,7 +810,85 @@ PCM *pcm_create(size_t mem_line, double rtime, double wtime)
     pcm->mem_line = mem_line;
     pcm->read_time = rtime;
     pcm->write_time = wtime;
-    pcm->wearout = 0;
+    pcm->region = NULL;
+    pcm->region_size = 0;
+    pcm->region_used = 0;
+    pcm->line_writes = NULL;
+    pcm->wear_sketch = NULL;
+    pcm->region_fd = -1;
+    pcm->physical_lines = 0;
+    pcm->leveling = NULL;
+    pcm->banks = 0;
+    pcm->bank_interleave = 0;
+    pcm->bank_queue = 0;
+    pcm->bank_busy = NULL;
+    pcm->bank_writes = NULL;
+    pcm->cache = NULL;
+    pcm->write_mode = PCM_WRITE_FULL;
+    pcm->round_bits = 0;
+    pcm->fnw_flags = NULL;
+    pcm->line_bits = NULL;
+    pcm->trace = NULL;
+    pcm->trace_tag = PCM_TRACE_TAG_NONE;
+    pcm_reset_counters(pcm);
+
+    return pcm;
+}
+
+PCM *pcm_create_region(size_t mem_line, pcm_time_t rtime, pcm_time_t wtime, size_t size, const char *path)
+{
+    PCM *pcm;
+    void *region;
+
+    TRACE();
+
+    if (size == 0)
+        ERROR("Region cannot be empty\n", NULL);
+
+    pcm = pcm_create(mem_line, rtime, wtime);
+    if (pcm == NULL)
+        ERROR("pcm_create error\n", NULL);
+
+    if (path != NULL)
+    {
+        pcm->region_fd = open(path, O_RDWR | O_CREAT, 0600);
+        if (pcm->region_fd < 0)
+        {
+            pcm_destroy(pcm);
+            ERROR("open error\n", NULL);
+        }
+
+        if (ftruncate(pcm->region_fd, (off_t)size))
+        {
+            pcm_destroy(pcm);
+            ERROR("ftruncate error\n", NULL);
+        }
+
+        region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, pcm->region_fd, 0);
+    }
+    else
+        region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (region == MAP_FAILED)
+    {
+        pcm_destroy(pcm);
+        ERROR("mmap error\n", NULL);
+    }
+
+    pcm->region = region;
+    pcm->region_size = size;
+    pcm->physical_lines = INT_CEIL_DIV(size, mem_line);
+
+    if (pcm->physical_lines <= PCM_WEAR_EXACT_LINES)
+        pcm->line_writes = calloc(pcm->physical_lines, sizeof(*pcm->line_writes));
+    else
+        pcm->wear_sketch = calloc(PCM_WEAR_SKETCH_DEPTH * PCM_WEAR_SKETCH_WIDTH, sizeof(*pcm->wear_sketch));
+
+    if (pcm->line_writes == NULL && pcm->wear_sketch == NULL)
+    {
+        pcm_destroy(pcm);
+        ERROR("calloc error\n", NULL);
+    }
 
     return pcm;
 }
@@ -25,5 +897,977 @@ void pcm_destroy(PCM *pcm)
 {
     TRACE();
 
+    if (pcm == NULL)
+        return;
+
+    (void)pcm_trace_close(pcm);
+
+    if (pcm->region != NULL)
+        (void)munmap(pcm->region, pcm->region_size);
+
+    if (pcm->region_fd >= 0)
+        (void)close(pcm->region_fd);
+
+    pcm_leveling_destroy(pcm->leveling);
+    pcm_cache_destroy(pcm->cache);
+    FREE(pcm->fnw_flags);
+    FREE(pcm->line_bits);
+    FREE(pcm->bank_busy);
+    FREE(pcm->bank_writes);
+    FREE(pcm->line_writes);
+    FREE(pcm->wear_sketch);
     FREE(pcm);
-}
\ No newline at end of file
+}
+
+void pcm_reset_counters(PCM *pcm)
+{
+    TRACE();
+
+    pcm->lines_read = 0;
+    pcm->lines_written = 0;
+    pcm->wearout = 0;
+    pcm->max_line_writes = 0;
+    pcm->migrated_lines = 0;
+    pcm->cache_hits = 0;
+    pcm->cache_misses = 0;
+    pcm->cache_write_backs = 0;
+    pcm->bits_written = 0;
+    pcm->max_line_bits = 0;
+    pcm->saved_time = 0;
+    pcm->clock = 0;
+
+    if (pcm->line_bits != NULL)
+        (void)memset(pcm->line_bits, 0, pcm->physical_lines * sizeof(*pcm->line_bits));
+
+    if (pcm->bank_busy != NULL)
+    {
+        (void)memset(pcm->bank_busy, 0, pcm->banks * sizeof(*pcm->bank_busy));
+        (void)memset(pcm->bank_writes, 0, pcm->banks * sizeof(*pcm->bank_writes));
+    }
+
+    if (pcm->line_writes != NULL)
+        (void)memset(pcm->line_writes, 0, pcm->physical_lines * sizeof(*pcm->line_writes));
+
+    if (pcm->wear_sketch != NULL)
+        (void)memset(pcm->wear_sketch, 0, PCM_WEAR_SKETCH_DEPTH * PCM_WEAR_SKETCH_WIDTH * sizeof(*pcm->wear_sketch));
+}
+
+int pcm_alloc(PCM *pcm, size_t bytes, size_t *addr)
+{
+    const size_t aligned = INT_CEIL_DIV(bytes, pcm->mem_line) * pcm->mem_line;
+
+    TRACE();
+
+    if (pcm->region == NULL)
+        ERROR("PCM has no region\n", 1);
+
+    if (aligned > pcm->region_size - pcm->region_used)
+        ERROR("PCM region is full\n", 1);
+
+    *addr = pcm->region_used;
+    pcm->region_used += aligned;
+
+    return 0;
+}
+
+static ___inline___ void pcm_trace_varint(struct PCM_trace *trace, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        trace->buffer[trace->used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+
+    trace->buffer[trace->used++] = (unsigned char)value;
+}
+
+static void pcm_trace_flush(struct PCM_trace *trace)
+{
+    if (trace->used > 0 && fwrite(trace->buffer, 1, trace->used, trace->file) != trace->used)
+        trace->failed = true;
+
+    trace->used = 0;
+}
+
+static ___inline___ pcm_time_t pcm_charge_read(PCM *pcm, size_t lines)
+{
+    pcm->lines_read += lines;
+    return (pcm_time_t)lines * pcm->read_time;
+}
+
+static ___inline___ pcm_time_t pcm_charge_write(PCM *pcm, size_t lines, size_t bytes)
+{
+    pcm->wearout += bytes;
+    pcm->lines_written += lines;
+    return (pcm_time_t)lines * pcm->write_time + pcm_charge_read(pcm, lines);
+}
+
+static pcm_time_t pcm_read_region(PCM *pcm, size_t addr, size_t len)
+{
+    const pcm_time_t now = pcm->clock;
+    pcm_time_t end = now;
+    pcm_time_t line_end;
+    size_t line;
+    size_t last;
+
+    if (pcm->bank_busy == NULL)
+        return pcm_charge_read(pcm, pcm_touch_lines(pcm, addr, len, false, NULL));
+
+    (void)pcm_charge_read(pcm, pcm_touch_lines(pcm, addr, len, false, NULL));
+
+    /* lines are issued together, issuer waits for the last one */
+    last = (addr + len - 1) / pcm->mem_line;
+    for (line = addr / pcm->mem_line; line <= last; ++line)
+    {
+        line_end = pcm_bank_read(pcm, pcm_bank(pcm, pcm_physical_line(pcm, line)), now);
+        end = MAX(end, line_end);
+    }
+
+    pcm->clock = end;
+
+    return end - now;
+}
+
+static pcm_time_t pcm_write_region(PCM *pcm, size_t addr, size_t len, size_t bytes)
+{
+    const pcm_time_t now = pcm->clock;
+    const size_t last = (addr + len - 1) / pcm->mem_line;
+    pcm_time_t migration;
+    size_t lines;
+    size_t line;
+
+    /* lines go to banks of their physical lines before wear leveling moves them */
+    if (pcm->bank_busy != NULL)
+        for (line = addr / pcm->mem_line; line <= last; ++line)
+            pcm_bank_write(pcm, pcm_bank(pcm, pcm_physical_line(pcm, line)), pcm->write_time + pcm->read_time);
+
+    lines = pcm_touch_lines(pcm, addr, len, true, &migration);
+
+    if (pcm->bank_busy == NULL)
+        return pcm_charge_write(pcm, lines, bytes) + migration;
+
+    (void)pcm_charge_write(pcm, lines, bytes);
+
+    /* migrations are queued in banks too */
+    return pcm->clock - now;
+}
+
+static size_t pcm_program_bits(PCM *pcm, size_t addr, const unsigned char *data, size_t len)
+{
+    unsigned char *old = pcm->region + addr;
+    unsigned char word[PCM_FNW_WORD];
+    size_t bits = 0;
+    size_t plain;
+    size_t flipped;
+    size_t first;
+    size_t w;
+    size_t i;
+    bool flag;
+
+    if (pcm->write_mode == PCM_WRITE_DCW)
+    {
+        for (i = 0; i < len; ++i)
+            bits += (size_t)__builtin_popcount((unsigned int)(old[i] ^ data[i]));
+
+        (void)memcpy(old, data, len);
+
+        return bits;
+    }
+
+    /* Flip-N-Write: cells of word hold data or its inversion (flag bit), the cheaper one is programmed */
+    for (w = addr / PCM_FNW_WORD; w <= (addr + len - 1) / PCM_FNW_WORD; ++w)
+    {
+        first = w * PCM_FNW_WORD;
+        flag = (pcm->fnw_flags[w / 8] >> (w % 8)) & 1;
+        plain = 0;
+        flipped = 0;
+
+        for (i = 0; i < PCM_FNW_WORD; ++i)
+        {
+            word[i] = first + i >= addr && first + i < addr + len ? data[first + i - addr] : pcm->region[first + i];
+
+            /* cells hold region ^ (flag ? 0xff : 0) */
+            plain += (size_t)__builtin_popcount((unsigned int)(pcm->region[first + i] ^ word[i]));
+            flipped += (size_t)__builtin_popcount((unsigned int)(unsigned char)~(pcm->region[first + i] ^ word[i]));
+        }
+
+        /* cost of each choice depends on current state of cells and flag */
+        if (flag)
+        {
+            const size_t tmp = plain;
+
+            plain = flipped + 1;
+            flipped = tmp;
+        }
+        else
+            ++flipped;
+
+        if (flipped < plain)
+        {
+            bits += flipped;
+            pcm->fnw_flags[w / 8] = (unsigned char)(pcm->fnw_flags[w / 8] | (1U << (w % 8)));
+        }
+        else
+        {
+            bits += plain;
+            pcm->fnw_flags[w / 8] = (unsigned char)(pcm->fnw_flags[w / 8] & ~(1U << (w % 8)));
+        }
+
+        (void)memcpy(&pcm->region[first], word, PCM_FNW_WORD);
+    }
+
+    return bits;
+}
+
+static pcm_time_t pcm_store_region(PCM *pcm, size_t addr, const unsigned char *data, size_t len)
+{
+    const size_t rounds = INT_CEIL_DIV(pcm->mem_line * 8, pcm->round_bits);
+    const size_t last = (addr + len - 1) / pcm->mem_line;
+    const pcm_time_t now = pcm->clock;
+    pcm_time_t time = 0;
+    pcm_time_t write_time;
+    pcm_time_t migration;
+    size_t physical;
+    size_t bits;
+    size_t line;
+    size_t lo;
+    size_t hi;
+
+    for (line = addr / pcm->mem_line; line <= last; ++line)
+    {
+        lo = MAX(addr, line * pcm->mem_line);
+        hi = MIN(addr + len, (line + 1) * pcm->mem_line);
+        bits = pcm_program_bits(pcm, lo, data + (lo - addr), hi - lo);
+
+        /* line is read to compare, unchanged line is not written */
+        (void)pcm_charge_read(pcm, 1);
+        physical = pcm_physical_line(pcm, line);
+        write_time = 0;
+        migration = 0;
+
+        if (bits > 0)
+        {
+            (void)pcm_touch_lines(pcm, line * pcm->mem_line, 1, true, &migration);
+
+            write_time = pcm->write_time * INT_CEIL_DIV(bits, pcm->round_bits) / rounds;
+            pcm->saved_time += pcm->write_time - write_time;
+            pcm->wearout += INT_CEIL_DIV(bits, 8);
+            ++pcm->lines_written;
+            pcm->bits_written += bits;
+
+            if (pcm->line_bits != NULL)
+            {
+                pcm->line_bits[physical] += bits;
+                pcm->max_line_bits = MAX(pcm->max_line_bits, pcm->line_bits[physical]);
+            }
+        }
+
+        if (pcm->bank_busy != NULL)
+            pcm_bank_write(pcm, pcm_bank(pcm, physical), pcm->read_time + write_time);
+        else
+            time += pcm->read_time + write_time + migration;
+    }
+
+    if (pcm->bank_busy != NULL)
+        return pcm->clock - now;
+
+    return time;
+}
+
+static size_t pcm_cache_lookup(const struct PCM_cache *cache, size_t line)
+{
+    const size_t set = line % cache->sets;
+    size_t way;
+
+    for (way = 0; way < cache->ways; ++way)
+        if (cache->tags[set * cache->ways + way] == line)
+            return set * cache->ways + way;
+
+    return PCM_NO_ADDR;
+}
+
+static size_t pcm_cache_victim(struct PCM_cache *cache, size_t line)
+{
+    const size_t set = line % cache->sets;
+    const size_t first = set * cache->ways;
+    size_t victim = first;
+    size_t way;
+
+    for (way = 0; way < cache->ways; ++way)
+        if (cache->tags[first + way] == PCM_NO_ADDR)
+            return first + way;
+
+    if (cache->policy == PCM_CACHE_LRU)
+    {
+        for (way = 1; way < cache->ways; ++way)
+            if (cache->used[first + way] < cache->used[victim])
+                victim = first + way;
+
+        return victim;
+    }
+
+    /* CLOCK: hand clears reference bits until it finds slot without it */
+    while (cache->used[first + cache->hands[set]])
+    {
+        cache->used[first + cache->hands[set]] = 0;
+        cache->hands[set] = (cache->hands[set] + 1) % cache->ways;
+    }
+
+    victim = first + cache->hands[set];
+    cache->hands[set] = (cache->hands[set] + 1) % cache->ways;
+
+    return victim;
+}
+
+static ___inline___ pcm_time_t pcm_cache_write_back(PCM *pcm, size_t slot)
+{
+    struct PCM_cache *cache = pcm->cache;
+    const size_t bytes = MIN(cache->dirty_bytes[slot], pcm->mem_line);
+    const size_t addr = cache->tags[slot] * pcm->mem_line;
+    size_t size;
+
+    if (bytes == 0)
+        return 0;
+
+    cache->dirty_bytes[slot] = 0;
+    ++pcm->cache_write_backs;
+
+    if (cache->stored[slot] && pcm->write_mode != PCM_WRITE_FULL)
+    {
+        /* cells still hold content from before the first store, region gets it back to be compared */
+        size = MIN(pcm->mem_line, pcm->region_size - addr);
+        (void)memcpy(cache->scratch, pcm->region + addr, size);
+        (void)memcpy(pcm->region + addr, cache->old_data + slot * pcm->mem_line, size);
+
+        return pcm_store_region(pcm, addr, cache->scratch, size);
+    }
+
+    return pcm_write_region(pcm, addr, pcm->mem_line, bytes);
+}
+
+static pcm_time_t pcm_cache_access(PCM *pcm, size_t addr, size_t len, size_t bytes, bool write, bool store)
+{
+    struct PCM_cache *cache = pcm->cache;
+    const size_t last = (addr + len - 1) / pcm->mem_line;
+    pcm_time_t time = 0;
+    size_t overlap;
+    size_t line;
+    size_t slot;
+
+    for (line = addr / pcm->mem_line; line <= last; ++line)
+    {
+        slot = pcm_cache_lookup(cache, line);
+        if (slot != PCM_NO_ADDR)
+        {
+            ++pcm->cache_hits;
+            time += cache->time;
+            if (pcm->bank_busy != NULL)
+                pcm->clock += cache->time;
+        }
+        else
+        {
+            ++pcm->cache_misses;
+            slot = pcm_cache_victim(cache, line);
+            time += pcm_cache_write_back(pcm, slot);
+
+            /* write miss allocates line without fetch, line is written back by dirty bytes */
+            if (!write)
+                time += pcm_read_region(pcm, line * pcm->mem_line, pcm->mem_line);
+
+            cache->tags[slot] = line;
+        }
+
+        cache->used[slot] = cache->policy == PCM_CACHE_LRU ? ++cache->tick : 1;
+
+        if (write)
+        {
+            /* the first write of clean line keeps content of cells for write back */
+            if (cache->dirty_bytes[slot] == 0)
+            {
+                cache->stored[slot] = store && cache->old_data != NULL;
+                if (cache->stored[slot])
+                    (void)memcpy(cache->old_data + slot * pcm->mem_line, pcm->region + line * pcm->mem_line,
+                                 MIN(pcm->mem_line, pcm->region_size - line * pcm->mem_line));
+            }
+            else if (!store)
+                cache->stored[slot] = false;
+
+            /* bytes are spread over lines like the range */
+            overlap = MIN(addr + len, (line + 1) * pcm->mem_line) - MAX(addr, line * pcm->mem_line);
+            cache->dirty_bytes[slot] += MAX(INT_CEIL_DIV(bytes * overlap, len), (size_t)1);
+        }
+    }
+
+    return time;
+}
+
+pcm_time_t pcm_read_at(PCM *pcm, size_t addr, size_t len)
+{
+    if (len == 0)
+        return 0;
+
+    if (addr > pcm->region_size || len > pcm->region_size - addr)
+        ERROR("Read out of PCM region\n", 0);
+
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_READ_AT, addr, len, 1, len);
+
+    if (pcm->cache != NULL)
+        return pcm_cache_access(pcm, addr, len, 0, false, false);
+
+    return pcm_read_region(pcm, addr, len);
+}
+
+pcm_time_t pcm_write_at(PCM *pcm, size_t addr, size_t len)
+{
+    return pcm_write_bytes_at(pcm, addr, len, len);
+}
+
+static pcm_time_t pcm_write_access(PCM *pcm, size_t addr, size_t len, size_t bytes)
+{
+    if (pcm->cache != NULL)
+        return pcm_cache_access(pcm, addr, len, bytes, true, false);
+
+    return pcm_write_region(pcm, addr, len, bytes);
+}
+
+pcm_time_t pcm_write_bytes_at(PCM *pcm, size_t addr, size_t len, size_t bytes)
+{
+    if (len == 0)
+        return 0;
+
+    if (addr > pcm->region_size || len > pcm->region_size - addr)
+        ERROR("Write out of PCM region\n", 0);
+
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_WRITE_AT, addr, len, 1, bytes);
+
+    return pcm_write_access(pcm, addr, len, bytes);
+}
+
+pcm_time_t pcm_store_at(PCM *pcm, size_t addr, const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    pcm_time_t time = 0;
+    size_t line;
+    size_t lo;
+    size_t hi;
+
+    if (len == 0)
+        return 0;
+
+    if (addr > pcm->region_size || len > pcm->region_size - addr)
+        ERROR("Write out of PCM region\n", 0);
+
+    if (pcm->trace != NULL)
+        pcm_trace_record(pcm, PCM_TRACE_STORE_AT, addr, len, 1, len);
+
+    if (pcm->cache != NULL)
+    {
+        /* line by line, so line evicted by the next one has its new content */
+        for (line = addr / pcm->mem_line; line <= (addr + len - 1) / pcm->mem_line; ++line)
+        {
+            lo = MAX(addr, line * pcm->mem_line);
+            hi = MIN(addr + len, (line + 1) * pcm->mem_line);
+            time += pcm_cache_access(pcm, lo, hi - lo, hi - lo, true, true);
+            (void)memcpy(pcm->region + lo, bytes + (lo - addr), hi - lo);
+        }
+
+        return time;
+    }
+
+    if (pcm->write_mode != PCM_WRITE_FULL)
+        return pcm_store_region(pcm, addr, bytes, len);
+
+    (void)memcpy(pcm->region + addr, data, len);
+
+    return pcm_write_region(pcm, addr, len, len);
+}
+
+int pcm_trace_open(PCM *pcm, const char *path)
+{
+    struct PCM_trace *trace;
+
+    TRACE();
+
+    if (pcm_trace_close(pcm))
+        ERROR("pcm_trace_close error\n", 1);
+
+    trace = malloc(sizeof(*trace));
+    if (trace == NULL)
+        ERROR("malloc error\n", 1);
+
+    trace->buffer = malloc(PCM_TRACE_BUFFER);
+    if (trace->buffer == NULL)
+    {
+        FREE(trace);
+        ERROR("malloc error\n", 1);
+    }
+
+    trace->file = fopen(path, "wb");
+    if (trace->file == NULL)
+    {
+        FREE(trace->buffer);
+        FREE(trace);
+        ERROR("fopen error\n", 1);
+    }
+
+    trace->next_addr = 0;
+    trace->tag = PCM_TRACE_TAG_NONE;
+    trace->failed = false;
+
+    /* header, parameters of recording PCM are kept for reference */
+    (void)memcpy(trace->buffer, PCM_TRACE_MAGIC, sizeof(PCM_TRACE_MAGIC) - 1);
+    trace->used = sizeof(PCM_TRACE_MAGIC) - 1;
+    trace->buffer[trace->used++] = PCM_TRACE_VERSION;
+    pcm_trace_varint(trace, pcm->mem_line);
+    pcm_trace_varint(trace, pcm->read_time);
+    pcm_trace_varint(trace, pcm->write_time);
+    pcm_trace_varint(trace, pcm->region_size);
+
+    pcm->trace = trace;
+
+    return 0;
+}
+
+int pcm_trace_close(PCM *pcm)
+{
+    struct PCM_trace *trace = pcm->trace;
+    bool failed;
+
+    TRACE();
+
+    if (trace == NULL)
+        return 0;
+
+    pcm_trace_flush(trace);
+    failed = trace->failed;
+    if (fclose(trace->file))
+        failed = true;
+
+    FREE(trace->buffer);
+    FREE(trace);
+    pcm->trace = NULL;
+
+    if (failed)
+        ERROR("Trace is not written\n", 1);
+
+    return 0;
+}
+
+void pcm_trace_record(PCM *pcm, pcm_trace_op_t op, size_t addr, size_t size, size_t times, size_t extra)
+{
+    struct PCM_trace *trace = pcm->trace;
+    unsigned int head = (unsigned int)op;
+    long long delta;
+
+    if (trace->used + PCM_TRACE_RECORD_MAX > PCM_TRACE_BUFFER)
+        pcm_trace_flush(trace);
+
+    if (pcm->trace_tag != trace->tag)
+        head |= PCM_TRACE_HAS_TAG;
+    if (times != 1)
+        head |= PCM_TRACE_HAS_TIMES;
+    if (extra != size)
+        head |= PCM_TRACE_HAS_EXTRA;
+
+    trace->buffer[trace->used++] = (unsigned char)head;
+
+    if (head & PCM_TRACE_HAS_TAG)
+    {
+        pcm_trace_varint(trace, pcm->trace_tag);
+        trace->tag = pcm->trace_tag;
+    }
+
+    /* sequential accesses have delta 0, zigzag keeps small backward jumps short */
+    if (op >= PCM_TRACE_READ_AT)
+    {
+        delta = (long long)(addr - trace->next_addr);
+        pcm_trace_varint(trace, ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+        trace->next_addr = addr + size;
+    }
+
+    pcm_trace_varint(trace, size);
+
+    if (head & PCM_TRACE_HAS_TIMES)
+        pcm_trace_varint(trace, times);
+
+    if (head & PCM_TRACE_HAS_EXTRA)
+        pcm_trace_varint(trace, extra);
+}
+
+int pcm_set_write_mode(PCM *pcm, pcm_write_mode_t mode, size_t round_bits)
+{
+    TRACE();
+
+    if (pcm->region == NULL)
+        ERROR("PCM has no region\n", 1);
+
+    if (mode != PCM_WRITE_FULL && (round_bits == 0 || pcm->mem_line % PCM_FNW_WORD != 0))
+        ERROR("Round bits cannot be 0 and memory line has to be multiple of word\n", 1);
+
+    FREE(pcm->fnw_flags);
+    FREE(pcm->line_bits);
+
+    if (mode == PCM_WRITE_FNW)
+    {
+        /* data in region is stored plain */
+        pcm->fnw_flags = calloc(INT_CEIL_DIV(pcm->region_size, PCM_FNW_WORD * 8), sizeof(*pcm->fnw_flags));
+        if (pcm->fnw_flags == NULL)
+            ERROR("calloc error\n", 1);
+    }
+
+    if (mode != PCM_WRITE_FULL && pcm->line_writes != NULL)
+    {
+        pcm->line_bits = calloc(pcm->physical_lines, sizeof(*pcm->line_bits));
+        if (pcm->line_bits == NULL)
+        {
+            FREE(pcm->fnw_flags);
+            ERROR("calloc error\n", 1);
+        }
+    }
+
+    pcm->write_mode = mode;
+    pcm->round_bits = round_bits;
+    pcm_reset_counters(pcm);
+
+    return 0;
+}
+
+int pcm_set_cache(PCM *pcm, size_t lines, size_t ways, pcm_cache_policy_t policy, pcm_time_t time)
+{
+    struct PCM_cache *cache;
+    size_t slot;
+
+    TRACE();
+
+    (void)pcm_cache_flush(pcm);
+    pcm_cache_destroy(pcm->cache);
+    pcm->cache = NULL;
+
+    if (lines == 0)
+        return 0;
+
+    if (ways == 0 || lines % ways != 0)
+        ERROR("Lines of cache have to be multiple of ways\n", 1);
+
+    cache = calloc(1, sizeof(*cache));
+    if (cache == NULL)
+        ERROR("calloc error\n", 1);
+
+    cache->policy = policy;
+    cache->sets = lines / ways;
+    cache->ways = ways;
+    cache->time = time;
+    cache->tags = malloc(lines * sizeof(*cache->tags));
+    cache->dirty_bytes = calloc(lines, sizeof(*cache->dirty_bytes));
+    cache->stored = calloc(lines, sizeof(*cache->stored));
+    cache->used = calloc(lines, sizeof(*cache->used));
+    cache->hands = calloc(cache->sets, sizeof(*cache->hands));
+    if (pcm->region != NULL)
+    {
+        cache->old_data = malloc(lines * pcm->mem_line);
+        cache->scratch = malloc(pcm->mem_line);
+    }
+
+    if (cache->tags == NULL || cache->dirty_bytes == NULL || cache->stored == NULL || cache->used == NULL || cache->hands == NULL ||
+        (pcm->region != NULL && (cache->old_data == NULL || cache->scratch == NULL)))
+    {
+        pcm_cache_destroy(cache);
+        ERROR("Malloc error\n", 1);
+    }
+
+    for (slot = 0; slot < lines; ++slot)
+        cache->tags[slot] = PCM_NO_ADDR;
+
+    pcm->cache = cache;
+
+    return 0;
+}
+
+pcm_time_t pcm_cache_flush(PCM *pcm)
+{
+    pcm_time_t time = 0;
+    size_t slot;
+
+    TRACE();
+
+    if (pcm->cache == NULL)
+        return 0;
+
+    for (slot = 0; slot < pcm->cache->sets * pcm->cache->ways; ++slot)
+        time += pcm_cache_write_back(pcm, slot);
+
+    return time;
+}
+
+int pcm_set_banks(PCM *pcm, size_t banks, size_t interleave, size_t queue)
+{
+    pcm_time_t *bank_busy;
+    pcm_time_t *bank_writes;
+
+    TRACE();
+
+    FREE(pcm->bank_busy);
+    FREE(pcm->bank_writes);
+    pcm->banks = 0;
+    pcm->clock = 0;
+
+    if (banks == 0)
+        return 0;
+
+    if (interleave == 0 || interleave % pcm->mem_line != 0)
+        ERROR("Interleave has to be multiple of memory line\n", 1);
+
+    bank_busy = calloc(banks, sizeof(*bank_busy));
+    bank_writes = calloc(banks, sizeof(*bank_writes));
+    if (bank_busy == NULL || bank_writes == NULL)
+    {
+        FREE(bank_busy);
+        FREE(bank_writes);
+        ERROR("calloc error\n", 1);
+    }
+
+    pcm->banks = banks;
+    pcm->bank_interleave = interleave;
+    pcm->bank_queue = queue;
+    pcm->bank_busy = bank_busy;
+    pcm->bank_writes = bank_writes;
+
+    return 0;
+}
+
+pcm_time_t pcm_bank_sync(PCM *pcm)
+{
+    const pcm_time_t now = pcm->clock;
+    size_t bank;
+
+    for (bank = 0; bank < pcm->banks; ++bank)
+        pcm->clock = MAX(pcm->clock, pcm->bank_busy[bank]);
+
+    return pcm->clock - now;
+}
+
+int pcm_set_leveling(PCM *pcm, pcm_leveling_t type, size_t lines, size_t interval)
+{
+    struct PCM_leveling *leveling;
+    const size_t region_lines = INT_CEIL_DIV(pcm->region_size, pcm->mem_line);
+    size_t physical_lines = region_lines;
+    size_t *line_writes;
+    size_t i;
+
+    TRACE();
+
+    if (pcm->region == NULL)
+        ERROR("PCM has no region\n", 1);
+
+    pcm_leveling_destroy(pcm->leveling);
+    pcm->leveling = NULL;
+
+    if (type != PCM_LEVELING_NONE)
+    {
+        if (lines == 0 || interval == 0)
+            ERROR("Lines and interval cannot be 0\n", 1);
+
+        if (type == PCM_LEVELING_SECURITY_REFRESH && (lines & (lines - 1)) != 0)
+            ERROR("Domain of Security Refresh has to be power of 2\n", 1);
+
+        leveling = calloc(1, sizeof(*leveling));
+        if (leveling == NULL)
+            ERROR("calloc error\n", 1);
+
+        leveling->type = type;
+        leveling->lines = lines;
+        leveling->interval = interval;
+        leveling->domains = INT_CEIL_DIV(region_lines, lines);
+        leveling->seed = 0x2545f4914f6cdd1dULL;
+
+        switch (type)
+        {
+            case PCM_LEVELING_START_GAP:
+            {
+                leveling->writes = calloc(leveling->domains, sizeof(*leveling->writes));
+                leveling->start = calloc(leveling->domains, sizeof(*leveling->start));
+                leveling->gap = malloc(leveling->domains * sizeof(*leveling->gap));
+                if (leveling->writes == NULL || leveling->start == NULL || leveling->gap == NULL)
+                {
+                    pcm_leveling_destroy(leveling);
+                    ERROR("Malloc error\n", 1);
+                }
+
+                /* spare line is at the top of each domain */
+                for (i = 0; i < leveling->domains; ++i)
+                    leveling->gap[i] = lines;
+
+                physical_lines = leveling->domains * (lines + 1);
+                break;
+            }
+            case PCM_LEVELING_SECURITY_REFRESH:
+            {
+                leveling->writes = calloc(leveling->domains, sizeof(*leveling->writes));
+                leveling->key = malloc(leveling->domains * sizeof(*leveling->key));
+                leveling->prev_key = calloc(leveling->domains, sizeof(*leveling->prev_key));
+                leveling->refresh = calloc(leveling->domains, sizeof(*leveling->refresh));
+                if (leveling->writes == NULL || leveling->key == NULL || leveling->prev_key == NULL || leveling->refresh == NULL)
+                {
+                    pcm_leveling_destroy(leveling);
+                    ERROR("Malloc error\n", 1);
+                }
+
+                /* data is placed by key 0, the first round moves it to the new key */
+                for (i = 0; i < leveling->domains; ++i)
+                    leveling->key[i] = pcm_leveling_key(leveling);
+
+                physical_lines = leveling->domains * lines;
+                break;
+            }
+            case PCM_LEVELING_TABLE:
+            {
+                leveling->map = malloc(leveling->domains * sizeof(*leveling->map));
+                leveling->inverse = malloc(leveling->domains * sizeof(*leveling->inverse));
+                leveling->segment_writes = calloc(leveling->domains, sizeof(*leveling->segment_writes));
+                leveling->interval_writes = calloc(leveling->domains, sizeof(*leveling->interval_writes));
+                if (leveling->map == NULL || leveling->inverse == NULL || leveling->segment_writes == NULL || leveling->interval_writes == NULL)
+                {
+                    pcm_leveling_destroy(leveling);
+                    ERROR("Malloc error\n", 1);
+                }
+
+                for (i = 0; i < leveling->domains; ++i)
+                {
+                    leveling->map[i] = i;
+                    leveling->inverse[i] = i;
+                }
+
+                physical_lines = leveling->domains * lines;
+                break;
+            }
+            case PCM_LEVELING_NONE:
+            default:
+            {
+                pcm_leveling_destroy(leveling);
+                ERROR("Unknown wear leveling\n", 1);
+            }
+        }
+
+        pcm->leveling = leveling;
+    }
+
+    /* counters cover spare lines too */
+    if (pcm->line_writes != NULL && physical_lines != pcm->physical_lines)
+    {
+        line_writes = calloc(physical_lines, sizeof(*line_writes));
+        if (line_writes == NULL)
+        {
+            pcm_leveling_destroy(pcm->leveling);
+            pcm->leveling = NULL;
+            ERROR("calloc error\n", 1);
+        }
+
+        FREE(pcm->line_writes);
+        pcm->line_writes = line_writes;
+        pcm->physical_lines = physical_lines;
+
+        if (pcm->line_bits != NULL)
+        {
+            FREE(pcm->line_bits);
+            pcm->line_bits = calloc(physical_lines, sizeof(*pcm->line_bits));
+            if (pcm->line_bits == NULL)
+                ERROR("calloc error\n", 1);
+        }
+    }
+
+    pcm->physical_lines = physical_lines;
+    pcm_reset_counters(pcm);
+
+    return 0;
+}
+
+size_t pcm_line_writes(const PCM *pcm, size_t line)
+{
+    size_t writes = SIZE_MAX;
+    size_t row;
+
+    if (pcm->line_writes != NULL)
+        return pcm->line_writes[line];
+
+    if (pcm->wear_sketch == NULL)
+        return 0;
+
+    for (row = 0; row < PCM_WEAR_SKETCH_DEPTH; ++row)
+        writes = MIN(writes, pcm->wear_sketch[row * PCM_WEAR_SKETCH_WIDTH + pcm_sketch_col(line, row)]);
+
+    return writes;
+}
+
+int pcm_wear(const PCM *pcm, PCM_wear *wear)
+{
+    const struct PCM_leveling *leveling = pcm->leveling;
+    size_t buckets[PCM_WEAR_BUCKETS];
+    size_t writes;
+    size_t sum = 0;
+    size_t physical;
+    size_t segments = 0;
+    size_t segment;
+    size_t line;
+
+    TRACE();
+
+    if (pcm->region == NULL)
+        ERROR("PCM has no region\n", 1);
+
+    (void)memset(buckets, 0, sizeof(buckets));
+    (void)memset(wear, 0, sizeof(*wear));
+
+    physical = pcm_used_lines(pcm);
+
+    /* physical lines of domains in use */
+    if (leveling != NULL)
+    {
+        segments = INT_CEIL_DIV(physical, leveling->lines);
+        physical = segments * (leveling->lines + (leveling->type == PCM_LEVELING_START_GAP ? 1 : 0));
+    }
+
+    /* table moves segments to unused physical segments too, physical segment is in use iff it has data or wear */
+    if (leveling != NULL && leveling->type == PCM_LEVELING_TABLE)
+        physical = pcm->physical_lines;
+
+    for (line = 0; line < physical; ++line)
+    {
+        if (leveling != NULL && leveling->type == PCM_LEVELING_TABLE)
+        {
+            segment = line / leveling->lines;
+            if (leveling->inverse[segment] >= segments && leveling->segment_writes[segment] == 0)
+                continue;
+        }
+
+        ++wear->lines;
+        writes = pcm_line_writes(pcm, line);
+        sum += writes;
+        ++buckets[pcm_wear_bucket(writes)];
+        ++wear->histogram[writes == 0 ? 0 : (size_t)LOG2(writes) + 1];
+
+        if (writes > 0)
+            ++wear->worn_lines;
+
+        wear->max = MAX(wear->max, writes);
+    }
+
+    wear->mean = (double)sum / (double)wear->lines;
+    wear->p50 = pcm_wear_percentile(buckets, wear->lines, 0.5);
+    wear->p90 = pcm_wear_percentile(buckets, wear->lines, 0.9);
+    wear->p99 = pcm_wear_percentile(buckets, wear->lines, 0.99);
+    wear->p999 = pcm_wear_percentile(buckets, wear->lines, 0.999);
+
+    return 0;
+}
+
+double pcm_lifetime(const PCM *pcm, double endurance)
+{
+    TRACE();
+
+    if (pcm->max_line_writes == 0)
+        return INFINITY;
+
+    return pcm_time_to_seconds(pcm_get_time(pcm)) * endurance / (double)pcm->max_line_writes;
+}
@@ -0,0 +1,457 @@
+#include <pcmreplay.h>
+#include <taskpool.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* associativity of DRAM cache of replayed configurations */
+#define PCM_REPLAY_CACHE_WAYS 8
+
+/* records are decoded in place from mapped trace */
+typedef struct PCM_replay_reader
+{
+    const unsigned char *pos;
+    const unsigned char *end;
+    size_t next_addr; /* end of previous access by address */
+    unsigned int tag;
+} PCM_replay_reader;
+
+typedef struct PCM_replay_record
+{
+    pcm_trace_op_t op;
+    unsigned int tag;
+    size_t addr;
+    size_t size;
+    size_t times;
+    size_t extra;
+} PCM_replay_record;
+
+/* group of configurations replayed by one worker */
+typedef struct PCM_replay_task
+{
+    const unsigned char *records; /* the first record of trace */
+    const unsigned char *end;
+    size_t mem_line; /* of recording PCM */
+    size_t region_size; /* of recording PCM, 0 iff it had no region */
+    const PCM_replay_config *configs;
+    PCM_replay_result *results;
+    size_t num_configs;
+} PCM_replay_task;
+
+/*
+    Decode varint
+
+    PARAMS
+    @IN reader - pointer to reader
+    @OUT value - decoded value
+
+    RETURN
+    0 iff success
+    Non-zero value iff trace ends inside varint
+*/
+static ___inline___ int pcm_replay_varint(PCM_replay_reader *reader, unsigned long long *value);
+
+/*
+    Decode next record
+
+    PARAMS
+    @IN reader - pointer to reader
+    @OUT record - decoded record
+
+    RETURN
+    0 iff success
+    Non-zero value iff record is broken
+*/
+static int pcm_replay_next(PCM_replay_reader *reader, PCM_replay_record *record);
+
+/*
+    Create PCM of configuration
+
+    PARAMS
+    @IN config - configuration
+    @IN region_size - size of region (0 iff PCM is only cost model)
+
+    RETURN
+    Pointer to new PCM iff success
+    NULL iff failure
+*/
+static PCM *pcm_replay_create_pcm(const PCM_replay_config *config, size_t region_size);
+
+/*
+    Replay record on PCM
+
+    PARAMS
+    @IN pcm - pointer to PCM
+    @IN record - record
+    @IN mem_line - memory line of recording PCM
+
+    RETURN
+    Time of access
+*/
+static pcm_time_t pcm_replay_access(PCM *pcm, const PCM_replay_record *record, size_t mem_line);
+
+/*
+    Replay whole trace on group of configurations (task of taskpool)
+
+    PARAMS
+    @IN arg - pointer to PCM_replay_task
+
+    RETURN
+    This is a void function
+*/
+static void pcm_replay_task(void *arg);
+
+static ___inline___ int pcm_replay_varint(PCM_replay_reader *reader, unsigned long long *value)
+{
+    unsigned int shift = 0;
+    unsigned char byte;
+
+    *value = 0;
+    do
+    {
+        if (reader->pos == reader->end || shift >= 64)
+            return 1;
+
+        byte = *reader->pos++;
+        *value |= (unsigned long long)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return 0;
+}
+
+static int pcm_replay_next(PCM_replay_reader *reader, PCM_replay_record *record)
+{
+    unsigned long long value;
+    unsigned int head;
+
+    head = *reader->pos++;
+    record->op = (pcm_trace_op_t)(head & PCM_TRACE_OP_MASK);
+    if (record->op >= PCM_TRACE_OPS)
+        return 1;
+
+    if (head & PCM_TRACE_HAS_TAG)
+    {
+        if (pcm_replay_varint(reader, &value))
+            return 1;
+
+        reader->tag = (unsigned int)value;
+    }
+    record->tag = reader->tag;
+
+    record->addr = PCM_NO_ADDR;
+    if (record->op >= PCM_TRACE_READ_AT)
+    {
+        if (pcm_replay_varint(reader, &value))
+            return 1;
+
+        /* zigzag delta from the end of previous access by address */
+        record->addr = reader->next_addr + (size_t)((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    if (pcm_replay_varint(reader, &value))
+        return 1;
+    record->size = (size_t)value;
+
+    record->times = 1;
+    if (head & PCM_TRACE_HAS_TIMES)
+    {
+        if (pcm_replay_varint(reader, &value))
+            return 1;
+
+        record->times = (size_t)value;
+    }
+
+    record->extra = record->size;
+    if (head & PCM_TRACE_HAS_EXTRA)
+    {
+        if (pcm_replay_varint(reader, &value))
+            return 1;
+
+        record->extra = (size_t)value;
+    }
+
+    if (record->op >= PCM_TRACE_READ_AT)
+        reader->next_addr = record->addr + record->size;
+
+    return 0;
+}
+
+static PCM *pcm_replay_create_pcm(const PCM_replay_config *config, size_t region_size)
+{
+    PCM *pcm;
+
+    if (region_size == 0)
+        pcm = pcm_create(config->mem_line, config->read_time, config->write_time);
+    else
+        pcm = pcm_create_region(config->mem_line, config->read_time, config->write_time, region_size, NULL);
+
+    if (pcm == NULL)
+        ERROR("pcm_create error\n", NULL);
+
+    if (config->banks > 0 && pcm_set_banks(pcm, config->banks, config->mem_line, PCM_BANK_QUEUE))
+    {
+        pcm_destroy(pcm);
+        ERROR("pcm_set_banks error\n", NULL);
+    }
+
+    if (config->cache_lines > 0 && pcm_set_cache(pcm, config->cache_lines, PCM_REPLAY_CACHE_WAYS, PCM_CACHE_LRU, config->cache_time))
+    {
+        pcm_destroy(pcm);
+        ERROR("pcm_set_cache error\n", NULL);
+    }
+
+    return pcm;
+}
+
+static pcm_time_t pcm_replay_access(PCM *pcm, const PCM_replay_record *record, size_t mem_line)
+{
+    switch (record->op)
+    {
+        case PCM_TRACE_READ:
+            return pcm_read_many(pcm, record->size, record->times);
+        case PCM_TRACE_WRITE:
+            return pcm_write_many(pcm, record->size, record->times);
+        case PCM_TRACE_READ_LINES:
+        {
+            /* lines are rescaled to memory line of this PCM */
+            return pcm_read_lines(pcm, INT_CEIL_DIV(record->size * mem_line, pcm->mem_line));
+        }
+        case PCM_TRACE_WRITE_LINES:
+            return pcm_write_lines(pcm, INT_CEIL_DIV(record->size * mem_line, pcm->mem_line), record->extra);
+        case PCM_TRACE_READ_AT:
+            return pcm_read_at(pcm, record->addr, record->size);
+        case PCM_TRACE_WRITE_AT:
+            return pcm_write_bytes_at(pcm, record->addr, record->size, record->extra);
+        case PCM_TRACE_STORE_AT:
+        {
+            /* data is not recorded, so every byte is written */
+            return pcm_write_at(pcm, record->addr, record->size);
+        }
+        case PCM_TRACE_OPS:
+            break;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static void pcm_replay_task(void *arg)
+{
+    PCM_replay_task *task = (PCM_replay_task *)arg;
+    PCM_replay_reader reader;
+    PCM_replay_record record;
+    PCM_replay_result *result;
+    PCM **pcms;
+    pcm_time_t time;
+    size_t tag;
+    size_t records = 0;
+    size_t i;
+    int error = 0;
+
+    TRACE();
+
+    pcms = calloc(task->num_configs, sizeof(*pcms));
+    if (pcms == NULL)
+    {
+        for (i = 0; i < task->num_configs; ++i)
+            task->results[i].error = 1;
+
+        return;
+    }
+
+    for (i = 0; i < task->num_configs; ++i)
+    {
+        (void)memset(&task->results[i], 0, sizeof(task->results[i]));
+        pcms[i] = pcm_replay_create_pcm(&task->configs[i], task->region_size);
+        if (pcms[i] == NULL)
+            task->results[i].error = 1;
+    }
+
+    /* each record is decoded once and replayed on every PCM of group */
+    reader = (PCM_replay_reader){.pos = task->records, .end = task->end, .next_addr = 0, .tag = PCM_TRACE_TAG_NONE};
+    while (reader.pos < reader.end)
+    {
+        if (pcm_replay_next(&reader, &record))
+        {
+            error = 1;
+            break;
+        }
+
+        tag = record.tag < PCM_TRACE_TAGS ? record.tag : PCM_TRACE_TAG_NONE;
+        for (i = 0; i < task->num_configs; ++i)
+        {
+            if (pcms[i] == NULL)
+                continue;
+
+            time = pcm_replay_access(pcms[i], &record, task->mem_line);
+            task->results[i].time += time;
+            task->results[i].tag_time[tag] += time;
+        }
+        ++records;
+    }
+
+    for (i = 0; i < task->num_configs; ++i)
+    {
+        result = &task->results[i];
+        if (pcms[i] == NULL)
+            continue;
+
+        /* dirty lines reach PCM at the end of workload, then banks serve queued writes */
+        time = pcm_cache_flush(pcms[i]);
+        time += pcm_bank_sync(pcms[i]);
+        result->time += time;
+        result->tag_time[PCM_TRACE_TAG_NONE] += time;
+
+        result->lines_read = pcms[i]->lines_read;
+        result->lines_written = pcms[i]->lines_written;
+        result->wearout = pcms[i]->wearout;
+        result->cache_hits = pcms[i]->cache_hits;
+        result->cache_misses = pcms[i]->cache_misses;
+        result->records = records;
+        result->error = error;
+
+        pcm_destroy(pcms[i]);
+    }
+
+    FREE(pcms);
+}
+
+int pcm_replay(const char *path, const PCM_replay_config *configs, PCM_replay_result *results, size_t num_configs, size_t threads)
+{
+    PCM_replay_reader reader;
+    PCM_replay_task *tasks;
+    unsigned long long header[4]; /* mem_line, read_time, write_time, region_size */
+    const unsigned char *trace;
+    struct stat st;
+    size_t num_tasks;
+    size_t first;
+    size_t i;
+    int fd;
+    int ret = 0;
+
+    TRACE();
+
+    if (num_configs == 0)
+        return 0;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        ERROR("open error\n", 1);
+
+    if (fstat(fd, &st) || (size_t)st.st_size <= sizeof(PCM_TRACE_MAGIC))
+    {
+        (void)close(fd);
+        ERROR("Trace is too short\n", 1);
+    }
+
+    trace = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    (void)close(fd);
+    if (trace == MAP_FAILED)
+        ERROR("mmap error\n", 1);
+
+    /* trace is streamed once by each worker */
+    (void)madvise((void *)trace, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    reader = (PCM_replay_reader){.pos = trace + sizeof(PCM_TRACE_MAGIC), .end = trace + st.st_size, .next_addr = 0, .tag = PCM_TRACE_TAG_NONE};
+    if (memcmp(trace, PCM_TRACE_MAGIC, sizeof(PCM_TRACE_MAGIC) - 1))
+    {
+        (void)munmap((void *)trace, (size_t)st.st_size);
+        ERROR("Unknown format of trace\n", 1);
+    }
+
+    /* older header has other fields, so its records cannot be found */
+    if (trace[sizeof(PCM_TRACE_MAGIC) - 1] != PCM_TRACE_VERSION)
+    {
+        (void)munmap((void *)trace, (size_t)st.st_size);
+        ERROR("Unsupported version of trace, record it again\n", 1);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(header); ++i)
+        if (pcm_replay_varint(&reader, &header[i]))
+        {
+            (void)munmap((void *)trace, (size_t)st.st_size);
+            ERROR("Header of trace is broken\n", 1);
+        }
+
+    /* configurations are split evenly between workers */
+    num_tasks = MIN(num_configs, threads == 0 ? taskpool_default_threads() : threads);
+    tasks = malloc(num_tasks * sizeof(*tasks));
+    if (tasks == NULL)
+    {
+        (void)munmap((void *)trace, (size_t)st.st_size);
+        ERROR("malloc error\n", 1);
+    }
+
+    first = 0;
+    for (i = 0; i < num_tasks; ++i)
+    {
+        tasks[i] = (PCM_replay_task){.records = reader.pos,
+                                     .end = reader.end,
+                                     .mem_line = (size_t)header[0],
+                                     .region_size = (size_t)header[3],
+                                     .configs = &configs[first],
+                                     .results = &results[first],
+                                     .num_configs = num_configs / num_tasks + (i < num_configs % num_tasks ? 1 : 0)};
+        first += tasks[i].num_configs;
+    }
+
+    if (taskpool_run(num_tasks, pcm_replay_task, tasks, sizeof(*tasks), num_tasks))
+        ret = 1;
+
+    for (i = 0; i < num_configs; ++i)
+        if (results[i].error)
+            ret = 1;
+
+    FREE(tasks);
+    (void)munmap((void *)trace, (size_t)st.st_size);
+
+    if (ret)
+        ERROR("Replay error\n", 1);
+
+    return 0;
+}
+
+int pcm_replay_save(const char *path, const PCM_replay_config *configs, const PCM_replay_result *results, size_t num_configs)
+{
+    size_t i;
+    int fd;
+
+    TRACE();
+
+    fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0)
+        ERROR("open error\n", 1);
+
+    dprintf(fd, "MEM LINE\tREAD TIME\tWRITE TIME\tBANKS\tCACHE LINES\tTIME\tOTHER TIME\tINDEX TIME\tPARTITIONS TIME\tAM TIME\tRAW TIME\tLINES READ\tLINES WRITTEN\tWEAROUT\tCACHE HIT RATE\n");
+    for (i = 0; i < num_configs; ++i)
+        dprintf(fd, "%zu\t%.9lf\t%.9lf\t%zu\t%zu\t%lf\t%lf\t%lf\t%lf\t%lf\t%lf\t%zu\t%zu\t%zu\t%lf\n",
+                configs[i].mem_line,
+                pcm_time_to_seconds(configs[i].read_time),
+                pcm_time_to_seconds(configs[i].write_time),
+                configs[i].banks,
+                configs[i].cache_lines,
+                pcm_time_to_seconds(results[i].time),
+                pcm_time_to_seconds(results[i].tag_time[PCM_TRACE_TAG_NONE]),
+                pcm_time_to_seconds(results[i].tag_time[PCM_TRACE_TAG_INDEX]),
+                pcm_time_to_seconds(results[i].tag_time[PCM_TRACE_TAG_PARTITIONS]),
+                pcm_time_to_seconds(results[i].tag_time[PCM_TRACE_TAG_AM]),
+                pcm_time_to_seconds(results[i].tag_time[PCM_TRACE_TAG_RAW]),
+                results[i].lines_read,
+                results[i].lines_written,
+                results[i].wearout,
+                results[i].cache_hits + results[i].cache_misses == 0 ? 0.0 : (double)results[i].cache_hits / (double)(results[i].cache_hits + results[i].cache_misses));
+
+    if (close(fd))
+        ERROR("close error\n", 1);
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <randdist.h>
+#include <genrand.h>
+#include <common.h>
+#include <math.h>
+
+/* inversion is faster than BTPE when n * p is small */
+#define BINOMIAL_INVERSION_MAX_MEAN 30.0
+
+/*
+    Binomial by inversion, expected time O(n * p)
+
+    PARAMS
+    @IN rng - pointer to generator
+    @IN n - number of trials
+    @IN p - probability of success (p <= 0.5)
+
+    RETURN
+    Random number from Binomial(n, p)
+*/
+static size_t genrand_binomial_inversion(Genrand *rng, size_t n, double p);
+
+/*
+    Binomial by BTPE algorithm (Kachitvichyanukul & Schmeiser, 1988), expected time O(1)
+
+    PARAMS
+    @IN rng - pointer to generator
+    @IN n - number of trials
+    @IN p - probability of success
+
+    RETURN
+    Random number from Binomial(n, p)
+*/
+static size_t genrand_binomial_btpe(Genrand *rng, size_t n, double p);
+
+static size_t genrand_binomial_inversion(Genrand *rng, size_t n, double p)
+{
+    const double q = 1.0 - p;
+    const double qn = exp((double)n * log(q));
+    const double np = (double)n * p;
+    const double bound = MIN((double)n, np + 10.0 * sqrt(np * q + 1.0));
+
+    size_t x = 0;
+    double px = qn;
+    double u = genrand_real(rng);
+
+    while (u > px)
+    {
+        ++x;
+        if ((double)x > bound)
+        {
+            /* numerical tail, start again */
+            x = 0;
+            px = qn;
+            u = genrand_real(rng);
+        }
+        else
+        {
+            u -= px;
+            px = ((double)(n - x + 1) * p * px) / ((double)x * q);
+        }
+    }
+
+    return x;
+}
+
+static size_t genrand_binomial_btpe(Genrand *rng, size_t n, double p)
+{
+    const double dn = (double)n;
+    const double r = MIN(p, 1.0 - p);
+    const double q = 1.0 - r;
+    const double fm = dn * r + r;
+    const double m = floor(fm);
+    const double p1 = floor(2.195 * sqrt(dn * r * q) - 4.6 * q) + 0.5;
+    const double xm = m + 0.5;
+    const double xl = xm - p1;
+    const double xr = xm + p1;
+    const double c = 0.134 + 20.5 / (15.3 + m);
+    const double al = (fm - xl) / (fm - xl * r);
+    const double laml = al * (1.0 + al / 2.0);
+    const double ar = (xr - fm) / (xr * q);
+    const double lamr = ar * (1.0 + ar / 2.0);
+    const double p2 = p1 * (1.0 + 2.0 * c);
+    const double p3 = p2 + c / laml;
+    const double p4 = p3 + c / lamr;
+    const double nrq = dn * r * q;
+
+    double u;
+    double v;
+    double x;
+    double y;
+    double k;
+
+    for (;;)
+    {
+        /* triangular region in the middle */
+        u = genrand_real(rng) * p4;
+        v = genrand_real(rng);
+        if (u <= p1)
+        {
+            y = floor(xm - p1 * v + u);
+            break;
+        }
+
+        if (u <= p2)
+        {
+            /* parallelograms */
+            x = xl + (u - p1) / c;
+            v = v * c + 1.0 - fabs(m - x + 0.5) / p1;
+            if (v > 1.0)
+                continue;
+
+            y = floor(x);
+        }
+        else if (u <= p3)
+        {
+            /* left exponential tail */
+            if (v == 0.0)
+                continue;
+
+            y = floor(xl + log(v) / laml);
+            if (y < 0.0)
+                continue;
+
+            v = v * (u - p2) * laml;
+        }
+        else
+        {
+            /* right exponential tail */
+            if (v == 0.0)
+                continue;
+
+            y = floor(xr - log(v) / lamr);
+            if (y > dn)
+                continue;
+
+            v = v * (u - p3) * lamr;
+        }
+
+        k = fabs(y - m);
+        if (k <= 20.0 || k >= nrq / 2.0 - 1.0)
+        {
+            /* explicit evaluation of f(y) / f(m) */
+            const double s = r / q;
+            const double a = s * (dn + 1.0);
+            double f = 1.0;
+            double i;
+
+            if (m < y)
+            {
+                for (i = m + 1.0; i <= y; i += 1.0)
+                    f *= (a / i - s);
+            }
+            else if (m > y)
+            {
+                for (i = y + 1.0; i <= m; i += 1.0)
+                    f /= (a / i - s);
+            }
+
+            if (v > f)
+                continue;
+
+            break;
+        }
+
+        /* squeeze using upper and lower bounds on log(f(y)) */
+        {
+            const double rho = (k / nrq) * ((k * (k / 3.0 + 0.625) + 0.16666666666666666) / nrq + 0.5);
+            const double t = -k * k / (2.0 * nrq);
+            const double a = log(v);
+
+            if (a < t - rho)
+                break;
+
+            if (a > t + rho)
+                continue;
+
+            {
+                /* final acceptance test with Stirling's formula */
+                const double x1 = y + 1.0;
+                const double f1 = m + 1.0;
+                const double z = dn + 1.0 - m;
+                const double w = dn - y + 1.0;
+                const double x2 = x1 * x1;
+                const double f2 = f1 * f1;
+                const double z2 = z * z;
+                const double w2 = w * w;
+
+                if (a > (xm * log(f1 / x1) +
+                         (dn - m + 0.5) * log(z / w) +
+                         (y - m) * log(w * r / (x1 * q)) +
+                         (13680. - (462. - (132. - (99. - 140. / f2) / f2) / f2) / f2) / f1 / 166320. +
+                         (13680. - (462. - (132. - (99. - 140. / z2) / z2) / z2) / z2) / z / 166320. +
+                         (13680. - (462. - (132. - (99. - 140. / x2) / x2) / x2) / x2) / x1 / 166320. +
+                         (13680. - (462. - (132. - (99. - 140. / w2) / w2) / w2) / w2) / w / 166320.))
+                    continue;
+
+                break;
+            }
+        }
+    }
+
+    if (p > 0.5)
+        y = dn - y;
+
+    return (size_t)y;
+}
+
+size_t genrand_binomial(Genrand *rng, size_t n, double p)
+{
+    if (n == 0 || p <= 0.0)
+        return 0;
+
+    if (p >= 1.0)
+        return n;
+
+    if (p <= 0.5)
+    {
+        if ((double)n * p <= BINOMIAL_INVERSION_MAX_MEAN)
+            return genrand_binomial_inversion(rng, n, p);
+
+        return genrand_binomial_btpe(rng, n, p);
+    }
+
+    if ((double)n * (1.0 - p) <= BINOMIAL_INVERSION_MAX_MEAN)
+        return n - genrand_binomial_inversion(rng, n, 1.0 - p);
+
+    return genrand_binomial_btpe(rng, n, p);
+}
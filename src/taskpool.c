@@ -0,0 +1,96 @@
+#include <taskpool.h>
+#include <log.h>
+#include <common.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+typedef struct TaskPool
+{
+    task_fn_t fn;
+    char *tasks;
+    size_t task_size;
+    size_t num_tasks;
+    size_t next_task; /* shared counter, only via atomics */
+} TaskPool;
+
+/*
+    Worker main loop, take tasks until all are taken
+
+    PARAMS
+    @IN arg - pointer to TaskPool
+
+    RETURN
+    NULL
+*/
+static void *taskpool_worker(void *arg);
+
+static void *taskpool_worker(void *arg)
+{
+    TaskPool *pool = (TaskPool *)arg;
+    size_t task;
+
+    for (;;)
+    {
+        task = __atomic_fetch_add(&pool->next_task, 1, __ATOMIC_RELAXED);
+        if (task >= pool->num_tasks)
+            break;
+
+        pool->fn(pool->tasks + task * pool->task_size);
+    }
+
+    return NULL;
+}
+
+size_t taskpool_default_threads(void)
+{
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return cpus > 0 ? (size_t)cpus : 1;
+}
+
+int taskpool_run(size_t threads, task_fn_t fn, void *tasks, size_t task_size, size_t num_tasks)
+{
+    TaskPool pool = {.fn = fn, .tasks = (char *)tasks, .task_size = task_size, .num_tasks = num_tasks, .next_task = 0};
+    pthread_t *workers;
+    size_t i;
+    size_t created;
+
+    TRACE();
+
+    if (threads == 0)
+        threads = taskpool_default_threads();
+
+    threads = MIN(threads, num_tasks);
+
+    /* do not create threads for one worker */
+    if (threads <= 1)
+    {
+        (void)taskpool_worker(&pool);
+        return 0;
+    }
+
+    workers = malloc(sizeof(*workers) * threads);
+    if (workers == NULL)
+        ERROR("malloc error\n", 1);
+
+    created = 0;
+    for (i = 0; i < threads; ++i)
+    {
+        if (pthread_create(&workers[i], NULL, taskpool_worker, &pool) != 0)
+            break;
+
+        ++created;
+    }
+
+    /* if some threads have not been created, main thread works as well */
+    if (created < threads)
+        (void)taskpool_worker(&pool);
+
+    for (i = 0; i < created; ++i)
+        (void)pthread_join(workers[i], NULL);
+
+    FREE(workers);
+
+    return 0;
+}
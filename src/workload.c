@@ -0,0 +1,886 @@
+#include <workload.h>
+#include <log.h>
+#include <common.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+
+#define WORKLOAD_LINE_LEN 1024
+#define WORKLOAD_INIT_CAPACITY 16
+
+typedef enum
+{
+    WORKLOAD_SECTION_NONE,
+    WORKLOAD_SECTION_TABLE,
+    WORKLOAD_SECTION_PCM,
+    WORKLOAD_SECTION_RUN,
+    WORKLOAD_SECTION_EXPERIMENT
+} workload_section_t;
+
+typedef struct WorkloadName
+{
+    const char *name;
+    int value;
+} WorkloadName;
+
+static const WorkloadName workload_type_names[] =
+{
+    {"experiment1", WORKLOAD_EXPERIMENT1},
+    {"experiment2", WORKLOAD_EXPERIMENT2},
+    {"experiment3", WORKLOAD_EXPERIMENT3},
+    {"experiment3_1", WORKLOAD_EXPERIMENT3_1},
+    {"stress", WORKLOAD_STRESS},
+    {"stress_step", WORKLOAD_STRESS_STEP},
+    {"stress_pam_step", WORKLOAD_STRESS_PAM_STEP},
+    {"stress_custom", WORKLOAD_STRESS_CUSTOM},
+    {"index", WORKLOAD_INDEX},
+    {"db_raw_workload", WORKLOAD_DB_RAW_WORKLOAD},
+    {"db_index_workload", WORKLOAD_DB_INDEX_WORKLOAD},
+    {"db_index_engine", WORKLOAD_DB_INDEX_ENGINE},
+    {"db_index_placement", WORKLOAD_DB_INDEX_PLACEMENT},
+    {"db_am_workload", WORKLOAD_DB_AM_WORKLOAD},
+    {"db_am_engine", WORKLOAD_DB_AM_ENGINE},
+    {"db_am_invalidation", WORKLOAD_DB_AM_INVALIDATION},
+    {"db_am_wear", WORKLOAD_DB_AM_WEAR},
+    {"db_am_leveling", WORKLOAD_DB_AM_LEVELING},
+    {"db_am_banks", WORKLOAD_DB_AM_BANKS},
+    {"db_am_cache", WORKLOAD_DB_AM_CACHE},
+    {"db_am_write_mode", WORKLOAD_DB_AM_WRITE_MODE},
+    {"db_am_replay", WORKLOAD_DB_AM_REPLAY},
+    {"db_am_sampling", WORKLOAD_DB_AM_SAMPLING},
+    {"db_pam_workload", WORKLOAD_DB_PAM_WORKLOAD},
+};
+
+static const WorkloadName workload_query_names[] =
+{
+    {"random", QUERY_RANDOM},
+    {"new", QUERY_ALWAYS_NEW},
+    {"sequential", QUERY_SEQUENTIAL_PATTERN},
+};
+
+static const WorkloadName workload_btree_names[] =
+{
+    {"normal", BTREE_NORMAL},
+    {"unsorted_leaves", BTREE_UNSORTED_LEAVES},
+    {"unsorted_inners_unsorted_leaves", BTREE_UNSORTED_INNERS_UNSORTED_LEAVES},
+    {"cbtree", CBTREE},
+    {"ocbtree", OCBTREE},
+    {"2section_node", BTREE_2SECTION_NODE},
+    {"skip_cost", BTREE_SKIP_COST},
+    {"normal_inners_ram", BTREE_NORMAL_INNERS_RAM},
+    {"unsorted_leaves_inners_ram", BTREE_UNSORTED_LEAVES_INNERS_RAM},
+    {"cbtree_inners_ram", CBTREE_INNERS_RAM},
+    {"2section_node_inners_ram", BTREE_2SECTION_NODE_INNERS_RAM},
+    {"with_buffered_tree", BTREE_WITH_BUFFERED_TREE},
+};
+
+static const WorkloadName workload_invalidation_names[] =
+{
+    {"flag", INVALIDATION_FLAG},
+    {"bitmap", INVALIDATION_BITMAP},
+    {"journal", INVALIDATION_JOURNAL},
+    {"overwrite", INVALIDATION_OVERWRITE},
+    {"skip", INVALIDATION_SKIP},
+};
+
+/*
+    Remove white characters from both sides of string (in place)
+
+    PARAMS
+    @IN str - string
+
+    RETURN
+    Pointer to the first non white character of str
+*/
+static char *workload_strip(char *str);
+
+/*
+    Find value of name in table of names (case insensitive)
+
+    PARAMS
+    @IN names - table of names
+    @IN num_names - number of names
+    @IN name - name to find
+    @OUT value - value of name
+
+    RETURN
+    0 iff success
+    Non-zero value iff name is unknown
+*/
+static int workload_lookup(const WorkloadName *names, size_t num_names, const char *name, int *value);
+
+/*
+    Parse non-negative floating point number
+
+    PARAMS
+    @IN str - string
+    @OUT value - parsed value
+
+    RETURN
+    0 iff success
+    Non-zero value iff str is not number
+*/
+static int workload_parse_double(const char *str, double *value);
+
+/*
+    Parse time with unit (ps, ns, us, ms, s, ns when unit is missing)
+
+    PARAMS
+    @IN str - string
+    @OUT value - parsed time
+
+    RETURN
+    0 iff success
+    Non-zero value iff str is not time
+*/
+static int workload_parse_time(const char *str, pcm_time_t *value);
+
+/*
+    Parse structure of stress_custom experiment: name, am|pam, btree[, invalidation]
+
+    PARAMS
+    @IN str - value of structure key (modified)
+    @IN experiment - pointer to experiment
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int workload_parse_structure(char *str, WorkloadExperiment *experiment);
+
+/*
+    Apply key of section
+
+    PARAMS
+    @IN workload - pointer to workload
+    @IN section - current section
+    @IN key - key
+    @IN value - value (may be modified)
+
+    RETURN
+    0 iff success
+    Non-zero value iff key or value is wrong
+*/
+static int workload_set(Workload *workload, workload_section_t section, const char *key, char *value);
+
+/*
+    Add experiment with default parameters to workload
+
+    PARAMS
+    @IN workload - pointer to workload
+    @IN name - name of experiment
+
+    RETURN
+    Pointer to new experiment iff success
+    NULL iff failure
+*/
+static WorkloadExperiment *workload_add_experiment(Workload *workload, const char *name);
+
+/*
+    Check if experiment has all parameters required by its type
+
+    PARAMS
+    @IN experiment - pointer to experiment
+
+    RETURN
+    NULL iff experiment is complete
+    Error message otherwise
+*/
+static const char *workload_check_experiment(const WorkloadExperiment *experiment);
+
+/*
+    Run one experiment
+
+    PARAMS
+    @IN workload - pointer to workload
+    @IN experiment - pointer to experiment
+
+    RETURN
+    0 iff success
+    Non-zero value iff failure
+*/
+static int workload_run_experiment(const Workload *workload, const WorkloadExperiment *experiment);
+
+static char *workload_strip(char *str)
+{
+    char *end;
+
+    while (isspace((unsigned char)*str))
+        ++str;
+
+    end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1]))
+        --end;
+
+    *end = '\0';
+
+    return str;
+}
+
+static int workload_lookup(const WorkloadName *names, size_t num_names, const char *name, int *value)
+{
+    size_t i;
+
+    for (i = 0; i < num_names; ++i)
+        if (strcasecmp(names[i].name, name) == 0)
+        {
+            *value = names[i].value;
+            return 0;
+        }
+
+    return 1;
+}
+
+int workload_parse_size(const char *str, size_t *value)
+{
+    unsigned long long v;
+    char *end;
+
+    if (*str == '\0' || *str == '-')
+        return 1;
+
+    errno = 0;
+    v = strtoull(str, &end, 10);
+    if (errno != 0 || *end != '\0')
+        return 1;
+
+    *value = (size_t)v;
+
+    return 0;
+}
+
+int workload_parse_seed(const char *str, unsigned long *value)
+{
+    size_t seed;
+
+    if (strcmp(str, "time") == 0)
+    {
+        *value = (unsigned long)time(NULL);
+        return 0;
+    }
+
+    if (workload_parse_size(str, &seed))
+        return 1;
+
+    *value = (unsigned long)seed;
+
+    return 0;
+}
+
+static int workload_parse_double(const char *str, double *value)
+{
+    double v;
+    char *end;
+
+    if (*str == '\0')
+        return 1;
+
+    errno = 0;
+    v = strtod(str, &end);
+    if (errno != 0 || *end != '\0' || v < 0.0)
+        return 1;
+
+    *value = v;
+
+    return 0;
+}
+
+static int workload_parse_time(const char *str, pcm_time_t *value)
+{
+    double v;
+    double unit;
+    char *end;
+
+    if (*str == '\0')
+        return 1;
+
+    errno = 0;
+    v = strtod(str, &end);
+    if (errno != 0 || v < 0.0)
+        return 1;
+
+    while (isspace((unsigned char)*end))
+        ++end;
+
+    /* pcm_time_t is in picoseconds */
+    if (*end == '\0' || strcmp(end, "ns") == 0)
+        unit = 1e3;
+    else if (strcmp(end, "ps") == 0)
+        unit = 1.0;
+    else if (strcmp(end, "us") == 0)
+        unit = 1e6;
+    else if (strcmp(end, "ms") == 0)
+        unit = 1e9;
+    else if (strcmp(end, "s") == 0)
+        unit = 1e12;
+    else
+        return 1;
+
+    *value = (pcm_time_t)(v * unit + 0.5);
+
+    return 0;
+}
+
+static int workload_parse_structure(char *str, WorkloadExperiment *experiment)
+{
+    StressStructure *structure;
+    char *fields[4];
+    size_t num_fields = 0;
+    char *save;
+    char *field;
+    int value;
+
+    if (experiment->num_structures == EXPERIMENT_MAX_STRUCTURES)
+        return 1;
+
+    for (field = strtok_r(str, ",", &save); field != NULL; field = strtok_r(NULL, ",", &save))
+    {
+        if (num_fields == ARRAY_SIZE(fields))
+            return 1;
+
+        fields[num_fields++] = workload_strip(field);
+    }
+
+    if (num_fields < 3 || fields[0][0] == '\0' || strlen(fields[0]) >= WORKLOAD_NAME_LEN)
+        return 1;
+
+    structure = &experiment->structures[experiment->num_structures];
+    (void)memset(structure, 0, sizeof(*structure));
+    structure->invalidation_type = INVALIDATION_FLAG;
+
+    if (strcasecmp(fields[1], "pam") == 0)
+        structure->pam = true;
+    else if (strcasecmp(fields[1], "am") == 0)
+        structure->pam = false;
+    else
+        return 1;
+
+    if (workload_lookup(workload_btree_names, ARRAY_SIZE(workload_btree_names), fields[2], &value))
+        return 1;
+    structure->btree_type = (btree_type_t)value;
+
+    if (num_fields == 4)
+    {
+        if (structure->pam || workload_lookup(workload_invalidation_names, ARRAY_SIZE(workload_invalidation_names), fields[3], &value))
+            return 1;
+
+        structure->invalidation_type = (invalidation_type_t)value;
+    }
+
+    (void)strcpy(experiment->structure_names[experiment->num_structures], fields[0]);
+    ++experiment->num_structures;
+
+    return 0;
+}
+
+static int workload_set(Workload *workload, workload_section_t section, const char *key, char *value)
+{
+    WorkloadExperiment *experiment;
+    int v;
+
+    switch (section)
+    {
+        case WORKLOAD_SECTION_TABLE:
+        {
+            if (strcmp(key, "entries") == 0)
+                return workload_parse_size(value, &workload->entries);
+            if (strcmp(key, "key_size") == 0)
+                return workload_parse_size(value, &workload->key_size);
+            if (strcmp(key, "data_size") == 0)
+                return workload_parse_size(value, &workload->data_size);
+
+            return 1;
+        }
+        case WORKLOAD_SECTION_PCM:
+        {
+            if (strcmp(key, "mem_line") == 0)
+                return workload_parse_size(value, &workload->mem_line) || workload->mem_line == 0;
+            if (strcmp(key, "read_time") == 0)
+                return workload_parse_time(value, &workload->read_time);
+            if (strcmp(key, "write_time") == 0)
+                return workload_parse_time(value, &workload->write_time);
+
+            return 1;
+        }
+        case WORKLOAD_SECTION_RUN:
+        {
+            if (strcmp(key, "seed") == 0)
+            {
+                return workload_parse_seed(value, &workload->seed);
+            }
+            if (strcmp(key, "threads") == 0)
+                return workload_parse_size(value, &workload->threads);
+
+            return 1;
+        }
+        case WORKLOAD_SECTION_EXPERIMENT:
+        {
+            experiment = &workload->experiments[workload->num_experiments - 1];
+
+            if (strcmp(key, "type") == 0)
+            {
+                if (workload_lookup(workload_type_names, ARRAY_SIZE(workload_type_names), value, &v))
+                    return 1;
+
+                experiment->type = (workload_type_t)v;
+                return 0;
+            }
+            if (strcmp(key, "query") == 0)
+            {
+                if (workload_lookup(workload_query_names, ARRAY_SIZE(workload_query_names), value, &v))
+                    return 1;
+
+                experiment->query = (query_t)v;
+                return 0;
+            }
+            if (strcmp(key, "structure") == 0)
+                return workload_parse_structure(value, experiment);
+            if (strcmp(key, "entries") == 0)
+                return workload_parse_size(value, &experiment->entries);
+            if (strcmp(key, "key_size") == 0)
+                return workload_parse_size(value, &experiment->key_size);
+            if (strcmp(key, "data_size") == 0)
+                return workload_parse_size(value, &experiment->data_size);
+            if (strcmp(key, "selectivity") == 0)
+                return workload_parse_double(value, &experiment->selectivity);
+            if (strcmp(key, "rsearches") == 0)
+                return workload_parse_size(value, &experiment->batch.rsearches);
+            if (strcmp(key, "psearches") == 0)
+                return workload_parse_size(value, &experiment->batch.psearches);
+            if (strcmp(key, "inserts") == 0)
+                return workload_parse_size(value, &experiment->batch.inserts);
+            if (strcmp(key, "deletes") == 0)
+                return workload_parse_size(value, &experiment->batch.deletes);
+            if (strcmp(key, "selectivity_min") == 0)
+                return workload_parse_double(value, &experiment->batch.selectivity_min);
+            if (strcmp(key, "selectivity_max") == 0)
+                return workload_parse_double(value, &experiment->batch.selectivity_max);
+            if (strcmp(key, "selectivity_step") == 0)
+                return workload_parse_double(value, &experiment->batch.selectivity_step);
+            if (strcmp(key, "buffer_size") == 0)
+                return workload_parse_size(value, &experiment->batch.buffer_size);
+            if (strcmp(key, "batches") == 0)
+                return workload_parse_size(value, &experiment->batches);
+            if (strcmp(key, "queries") == 0)
+                return workload_parse_size(value, &experiment->queries);
+            if (strcmp(key, "in_partitions") == 0)
+                return workload_parse_size(value, &experiment->in_partitions);
+            if (strcmp(key, "samples") == 0)
+                return workload_parse_size(value, &experiment->samples);
+
+            return 1;
+        }
+        case WORKLOAD_SECTION_NONE:
+        default:
+            return 1;
+    }
+}
+
+static WorkloadExperiment *workload_add_experiment(Workload *workload, const char *name)
+{
+    WorkloadExperiment *experiment;
+    WorkloadExperiment *new_experiments;
+    size_t capacity;
+
+    if (workload->num_experiments == workload->capacity)
+    {
+        capacity = workload->capacity == 0 ? WORKLOAD_INIT_CAPACITY : workload->capacity * 2;
+        new_experiments = realloc(workload->experiments, capacity * sizeof(*new_experiments));
+        if (new_experiments == NULL)
+            ERROR("realloc error\n", NULL);
+
+        workload->experiments = new_experiments;
+        workload->capacity = capacity;
+    }
+
+    experiment = &workload->experiments[workload->num_experiments++];
+    (void)memset(experiment, 0, sizeof(*experiment));
+    (void)strcpy(experiment->name, name);
+    experiment->type = WORKLOAD_TYPES;
+    experiment->enabled = true;
+    experiment->query = QUERY_RANDOM;
+    experiment->selectivity = 0.05;
+    experiment->batches = 1;
+    experiment->queries = 100;
+
+    return experiment;
+}
+
+static const char *workload_check_experiment(const WorkloadExperiment *experiment)
+{
+    switch (experiment->type)
+    {
+        case WORKLOAD_STRESS_CUSTOM:
+        {
+            if (experiment->num_structures == 0)
+                return "stress_custom needs at least 1 structure";
+
+            return NULL;
+        }
+        case WORKLOAD_DB_AM_SAMPLING:
+        {
+            if (experiment->samples == 0)
+                return "db_am_sampling needs samples";
+
+            return NULL;
+        }
+        case WORKLOAD_TYPES:
+            return "missing type of experiment";
+        default:
+        {
+            if (experiment->num_structures > 0)
+                return "structure is supported only by stress_custom";
+
+            return NULL;
+        }
+    }
+}
+
+static int workload_run_experiment(const Workload *workload, const WorkloadExperiment *experiment)
+{
+    StressStructure structures[EXPERIMENT_MAX_STRUCTURES];
+    StressBatch batch = experiment->batch;
+    const char * const file = experiment->name;
+    const size_t entries = experiment->entries > 0 ? experiment->entries : workload->entries;
+    const size_t key_size = experiment->key_size > 0 ? experiment->key_size : workload->key_size;
+    const size_t data_size = experiment->data_size > 0 ? experiment->data_size : workload->data_size;
+    size_t i;
+
+    switch (experiment->type)
+    {
+        case WORKLOAD_EXPERIMENT1:
+            return experiment1(file, key_size, data_size, entries, experiment->query, experiment->selectivity);
+        case WORKLOAD_EXPERIMENT2:
+            return experiment2(file, key_size, data_size, entries, experiment->query, experiment->selectivity);
+        case WORKLOAD_EXPERIMENT3:
+            return experiment3(file, key_size, data_size, entries, experiment->query, experiment->selectivity);
+        case WORKLOAD_EXPERIMENT3_1:
+            return experiment3_1(file, key_size, data_size, entries, experiment->query, experiment->selectivity);
+        case WORKLOAD_STRESS:
+            return experiment_stress(file, key_size, data_size, entries, &batch, experiment->batches);
+        case WORKLOAD_STRESS_STEP:
+            return experiment_stress_step(file, key_size, data_size, entries, &batch, experiment->batches);
+        case WORKLOAD_STRESS_PAM_STEP:
+            return experiment_stress_pam_step(file, key_size, data_size, entries, &batch, experiment->batches);
+        case WORKLOAD_STRESS_CUSTOM:
+        {
+            for (i = 0; i < experiment->num_structures; ++i)
+            {
+                structures[i] = experiment->structures[i];
+                structures[i].name = experiment->structure_names[i];
+            }
+
+            return experiment_stress_custom(file, key_size, data_size, entries, &batch, experiment->batches, structures, experiment->num_structures);
+        }
+        case WORKLOAD_INDEX:
+            return experiment_index(file, key_size, data_size, entries, &batch, experiment->batches);
+        case WORKLOAD_DB_RAW_WORKLOAD:
+            return db_raw_experiment_workload(entries);
+        case WORKLOAD_DB_INDEX_WORKLOAD:
+            return db_index_experiment_workload(entries);
+        case WORKLOAD_DB_INDEX_ENGINE:
+            return db_index_experiment_engine(entries, experiment->queries);
+        case WORKLOAD_DB_INDEX_PLACEMENT:
+            return db_index_experiment_placement(entries, experiment->queries);
+        case WORKLOAD_DB_AM_WORKLOAD:
+            return db_am_experiment_workload(entries);
+        case WORKLOAD_DB_AM_ENGINE:
+            return db_am_experiment_engine(entries, experiment->queries);
+        case WORKLOAD_DB_AM_INVALIDATION:
+            return db_am_experiment_invalidation(entries, experiment->queries);
+        case WORKLOAD_DB_AM_WEAR:
+            return db_am_experiment_wear(entries, experiment->queries);
+        case WORKLOAD_DB_AM_LEVELING:
+            return db_am_experiment_leveling(entries, experiment->queries);
+        case WORKLOAD_DB_AM_BANKS:
+            return db_am_experiment_banks(entries, experiment->queries);
+        case WORKLOAD_DB_AM_CACHE:
+            return db_am_experiment_cache(entries, experiment->queries);
+        case WORKLOAD_DB_AM_WRITE_MODE:
+            return db_am_experiment_write_mode(entries, experiment->queries);
+        case WORKLOAD_DB_AM_REPLAY:
+            return db_am_experiment_replay(entries, experiment->queries);
+        case WORKLOAD_DB_AM_SAMPLING:
+            return db_am_experiment_sampling(entries, experiment->in_partitions, experiment->selectivity, experiment->samples);
+        case WORKLOAD_DB_PAM_WORKLOAD:
+            return db_pam_experiment_workload(entries);
+        case WORKLOAD_TYPES:
+        default:
+            break;
+    }
+
+    return 1;
+}
+
+Workload *workload_load(const char *path)
+{
+    Workload *workload;
+    WorkloadExperiment *experiment;
+    FILE *file;
+    char line[WORKLOAD_LINE_LEN];
+    workload_section_t section = WORKLOAD_SECTION_NONE;
+    const char *msg = NULL;
+    size_t line_num = 0;
+    size_t i;
+    char *str;
+    char *key;
+    char *value;
+    char *end;
+
+    TRACE();
+
+    file = fopen(path, "r");
+    if (file == NULL)
+        ERROR("fopen error\n", NULL);
+
+    workload = calloc(1, sizeof(*workload));
+    if (workload == NULL)
+    {
+        (void)fclose(file);
+        ERROR("calloc error\n", NULL);
+    }
+
+    /* the same defaults as main.c used to hard-code */
+    workload->entries = 100000000;
+    workload->key_size = sizeof(int);
+    workload->data_size = sizeof(void *);
+    workload->mem_line = 64;
+    workload->read_time = NANO(50);
+    workload->write_time = MICRO(1);
+    workload->seed = 4357;
+    workload->threads = 0;
+    workload->progress = false;
+    workload->quiet = false;
+
+    while (msg == NULL && fgets(line, sizeof(line), file) != NULL)
+    {
+        ++line_num;
+
+        if (strchr(line, '\n') == NULL && !feof(file))
+        {
+            msg = "line is too long";
+            break;
+        }
+
+        /* comments start with # or ; */
+        str = line + strcspn(line, "#;");
+        *str = '\0';
+
+        str = workload_strip(line);
+        if (*str == '\0')
+            continue;
+
+        if (*str == '[')
+        {
+            end = strchr(str, ']');
+            if (end == NULL || end[1] != '\0')
+            {
+                msg = "broken section header";
+                break;
+            }
+
+            *end = '\0';
+            str = workload_strip(str + 1);
+
+            if (strcmp(str, "table") == 0)
+                section = WORKLOAD_SECTION_TABLE;
+            else if (strcmp(str, "pcm") == 0)
+                section = WORKLOAD_SECTION_PCM;
+            else if (strcmp(str, "run") == 0)
+                section = WORKLOAD_SECTION_RUN;
+            else if (strncmp(str, "experiment", strlen("experiment")) == 0 && isspace((unsigned char)str[strlen("experiment")]))
+            {
+                str = workload_strip(str + strlen("experiment"));
+                if (strlen(str) >= WORKLOAD_NAME_LEN || strpbrk(str, "/ \t") != NULL)
+                {
+                    msg = "wrong name of experiment";
+                    break;
+                }
+
+                for (i = 0; i < workload->num_experiments; ++i)
+                    if (strcmp(workload->experiments[i].name, str) == 0)
+                        msg = "duplicated name of experiment";
+
+                if (msg == NULL && workload_add_experiment(workload, str) == NULL)
+                    msg = "cannot add experiment";
+
+                section = WORKLOAD_SECTION_EXPERIMENT;
+            }
+            else
+                msg = "unknown section";
+
+            continue;
+        }
+
+        value = strchr(str, '=');
+        if (value == NULL)
+        {
+            msg = "expected key = value";
+            break;
+        }
+
+        *value = '\0';
+        key = workload_strip(str);
+        value = workload_strip(value + 1);
+
+        if (workload_set(workload, section, key, value))
+            msg = "unknown key or wrong value";
+    }
+
+    (void)fclose(file);
+
+    if (msg == NULL)
+        for (i = 0; i < workload->num_experiments; ++i)
+        {
+            experiment = &workload->experiments[i];
+            msg = workload_check_experiment(experiment);
+            if (msg != NULL)
+            {
+                fprintf(stderr, "%s: experiment %s: %s\n", path, experiment->name, msg);
+                workload_destroy(workload);
+                return NULL;
+            }
+        }
+
+    if (msg != NULL)
+    {
+        fprintf(stderr, "%s:%zu: %s\n", path, line_num, msg);
+        workload_destroy(workload);
+        return NULL;
+    }
+
+    return workload;
+}
+
+void workload_destroy(Workload *workload)
+{
+    TRACE();
+
+    if (workload == NULL)
+        return;
+
+    FREE(workload->experiments);
+    FREE(workload);
+}
+
+void workload_override_sizes(Workload *workload, size_t entries, size_t key_size, size_t data_size)
+{
+    size_t i;
+
+    TRACE();
+
+    if (entries > 0)
+        workload->entries = entries;
+    if (key_size > 0)
+        workload->key_size = key_size;
+    if (data_size > 0)
+        workload->data_size = data_size;
+
+    /* experiments fall back to table when their value is 0 */
+    for (i = 0; i < workload->num_experiments; ++i)
+    {
+        if (entries > 0)
+            workload->experiments[i].entries = 0;
+        if (key_size > 0)
+            workload->experiments[i].key_size = 0;
+        if (data_size > 0)
+            workload->experiments[i].data_size = 0;
+    }
+}
+
+size_t workload_select(Workload *workload, const char * const *names, size_t num_names, bool *found)
+{
+    WorkloadExperiment *experiment;
+    size_t enabled = 0;
+    size_t i;
+    size_t n;
+
+    TRACE();
+
+    if (found != NULL)
+        for (n = 0; n < num_names; ++n)
+            found[n] = false;
+
+    for (i = 0; i < workload->num_experiments; ++i)
+    {
+        experiment = &workload->experiments[i];
+        experiment->enabled = false;
+
+        for (n = 0; n < num_names; ++n)
+            if (strcmp(experiment->name, names[n]) == 0)
+            {
+                experiment->enabled = true;
+                if (found != NULL)
+                    found[n] = true;
+            }
+
+        if (experiment->enabled)
+            ++enabled;
+    }
+
+    return enabled;
+}
+
+const char *workload_type_name(workload_type_t type)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(workload_type_names); ++i)
+        if (workload_type_names[i].value == (int)type)
+            return workload_type_names[i].name;
+
+    return NULL;
+}
+
+int workload_run(const Workload *workload)
+{
+    const WorkloadExperiment *experiment;
+    struct timespec start;
+    struct timespec end;
+    size_t enabled = 0;
+    size_t done = 0;
+    int ret = 0;
+    size_t i;
+
+    TRACE();
+
+    if (workload == NULL)
+        ERROR("workload == NULL\n", 1);
+
+    experiments_set_seed(workload->seed);
+    experiments_set_threads(workload->threads);
+    experiments_set_quiet(workload->quiet);
+    experiments_set_pcm(workload->mem_line, workload->read_time, workload->write_time);
+
+    for (i = 0; i < workload->num_experiments; ++i)
+        if (workload->experiments[i].enabled)
+            ++enabled;
+
+    for (i = 0; i < workload->num_experiments; ++i)
+    {
+        experiment = &workload->experiments[i];
+        if (!experiment->enabled)
+            continue;
+
+        ++done;
+        if (workload->progress)
+            fprintf(stderr, "[%zu/%zu] %s (%s)\n", done, enabled, experiment->name, workload_type_name(experiment->type));
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &start);
+        if (workload_run_experiment(workload, experiment))
+        {
+            fprintf(stderr, "experiment %s failed\n", experiment->name);
+            ret = 1;
+        }
+        (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (workload->progress)
+            fprintf(stderr, "[%zu/%zu] %s done in %.3lfs\n", done, enabled, experiment->name, (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9);
+    }
+
+    return ret;
+}